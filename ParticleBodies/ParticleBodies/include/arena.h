@@ -0,0 +1,100 @@
+#pragma once
+
+// Includes
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace pb {
+
+	// Define class that allocates objects from large blocks of memory and releases them all at
+	// once when destroyed. Objects created with the arena are destroyed in reverse order of
+	// creation, so a scene with millions of bodies costs a few allocations instead of one per body
+	class Arena {
+	public:
+		// Constructor, the blocks are allocated when needed
+		explicit Arena(size_t const block_size = 1 << 20)
+			: block_size(block_size), current(nullptr), remaining(0) {}
+
+		// Destructor runs the destructors of the owned objects and frees the blocks
+		~Arena() {
+			for (auto owned = owned_objects.rbegin(); owned != owned_objects.rend(); owned++) {
+				owned->destroy(owned->objects, owned->count);
+			}
+		}
+
+		// The arena owns its blocks, it can not be copied
+		Arena(Arena const &) = delete;
+		Arena & operator=(Arena const &) = delete;
+
+		// Allocate uninitialised memory
+		void * allocate(size_t const size, size_t const alignment) {
+			size_t padding = (alignment - reinterpret_cast<std::uintptr_t>(current) % alignment) % alignment;
+			if (padding + size > remaining) {
+				// Allocations larger than a block get their own block
+				size_t const new_block_size = std::max(block_size, size + alignment);
+				blocks.push_back(std::unique_ptr<unsigned char[]>(new unsigned char[new_block_size]));
+				current = blocks.back().get();
+				remaining = new_block_size;
+				padding = (alignment - reinterpret_cast<std::uintptr_t>(current) % alignment) % alignment;
+			}
+			void * const memory = current + padding;
+			current += padding + size;
+			remaining -= padding + size;
+
+			return memory;
+		}
+
+		// Allocate uninitialised memory for an array of objects, e.g. to construct them in parallel
+		template <typename T>
+		T * allocateArray(size_t const count) {
+			return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+		}
+
+		// Take ownership of an array of objects constructed in memory of the arena
+		template <typename T>
+		void own(T * const objects, size_t const count) {
+			OwnedObjects const owned = { objects, count, &destroyObjects<T> };
+			owned_objects.push_back(owned);
+		}
+
+		// Create an object owned by the arena
+		template <typename T, typename... ARGS>
+		T * create(ARGS &&... args) {
+			T * const object = new (allocate(sizeof(T), alignof(T))) T(std::forward<ARGS>(args)...);
+			own(object, 1);
+
+			return object;
+		}
+
+	private:
+		// Objects to destroy with the arena
+		struct OwnedObjects {
+			void * objects;
+			size_t count;
+			void (*destroy)(void * const objects, size_t const count);
+		};
+
+		// Destroy an array of objects
+		template <typename T>
+		static void destroyObjects(void * const objects, size_t const count) {
+			for (size_t i = count; i > 0; i--) {
+				static_cast<T *>(objects)[i - 1].~T();
+			}
+		}
+
+		// Size of the blocks
+		size_t const block_size;
+		// Blocks and free space of the last one
+		std::vector<std::unique_ptr<unsigned char[]> > blocks;
+		unsigned char * current;
+		size_t remaining;
+		// Objects to destroy
+		std::vector<OwnedObjects> owned_objects;
+	};
+
+} // pb namespace
\ No newline at end of file
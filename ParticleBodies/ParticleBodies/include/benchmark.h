@@ -0,0 +1,85 @@
+#pragma once
+
+// Includes
+#include "precision.h"
+
+namespace pb {
+
+	// Define class that runs the headless benchmarks of the simulation core
+	class Benchmark {
+	public:
+		// Run all the benchmarks and print the results to the standard output, return 1 if any of
+		// their self checks failed and 0 otherwise
+		static int runAll();
+
+		// Measure the throughput of System::computeStep on a grid of spheres falling on a static sphere
+		static void systemStep(size_t const bodies_per_side, real const particle_diameter, size_t const steps);
+
+		// Measure the cost of writing a checkpoint every interval steps and check that restarting from
+		// the checkpoint reproduces the trajectory exactly
+		static void checkpointRestart(size_t const bodies_per_side, size_t const steps, size_t const interval);
+
+		// Measure the cost on the simulation thread of recording a trajectory of moving bodies, the
+		// size of the compressed file and the cost of playing it back
+		static void trajectoryRecording(size_t const num_bodies, size_t const frames);
+
+		// Measure the time to load a grid of spheres from a scene description against creating
+		// and adding the bodies one by one
+		static void sceneLoading(size_t const bodies_per_side, real const particle_diameter);
+
+		// Measure the cost of spawning and despawning projectiles owned by a system of resident bodies
+		static void bodyChurn(size_t const num_bodies, size_t const operations);
+
+		// Measure the cost of commands queued by producer threads and applied by the simulation thread
+		static void commandQueue(size_t const num_producers, size_t const bodies_per_producer);
+
+		// Measure how the steps of separated piles of spheres scale with the number of threads and
+		// check that the result does not depend on it
+		static void islandScaling(size_t const num_piles, size_t const pile_height, size_t const steps);
+
+		// Measure the steps of a single block of touching spheres, whose contacts run in colour batches
+		static void colouredContacts(size_t const bodies_per_side, size_t const steps);
+
+		// Measure the contact detection and response stages on their own, on two overlapping spheres
+		static void contactStages(real const particle_diameter, size_t const repetitions);
+
+		// Compare the contact detectors on two large finely discretised spheres touching at one point
+		static void touchingBodies(real const particle_diameter, size_t const repetitions);
+
+		// Compare the particle contacts and the contacts against a signed distance field on two
+		// touching spheres over several orientations, in time and in error of the normals
+		static void distanceFieldContacts(real const particle_diameter, size_t const repetitions);
+
+		// Compare the broad phases and the contact detectors on small finely discretised spheres
+		// falling on a large coarse one
+		static void multiScaleContacts(size_t const bodies_per_side, size_t const steps);
+
+		// Compare the particle contacts and the analytic checks on spheres resting on a plane
+		static void analyticContacts(size_t const bodies_per_side, size_t const steps);
+
+		// Compare the explicit and the linearly implicit steps of a sphere falling on stiff contacts
+		// over a range of time steps
+		static void stiffContacts(real const stiffness, real const duration);
+
+		// Compare the penalty contacts and the contact impulses on a pile of spheres at 60 steps per second
+		static void contactImpulses(size_t const pile_height, real const duration);
+
+		// Measure the throughput of the body to world particle transform kernels
+		static void particleTransform(size_t const num_particles, size_t const repetitions);
+
+		// Compare the throughput of the particle transform and of the Euler step of the bodies in the
+		// scalars of every precision policy, whatever the policy of the build
+		static void precisionPolicies(size_t const num_particles, size_t const num_bodies, size_t const repetitions);
+
+		// Measure the throughput of the state integration sweeps of the body state store
+		static void stateIntegration(size_t const num_bodies, size_t const steps);
+
+		// Compare the orientation updates on a body tumbling without torque over a range of time
+		// steps, in error of the quaternion norm and of the energy
+		static void orientationIntegration(real const spin, real const duration);
+
+		// Measure the world inverse inertia expression R * I^-1 * R^T against a lazy per element evaluation
+		static void matrixExpressions(size_t const repetitions);
+	};
+
+} // pb namespace
\ No newline at end of file
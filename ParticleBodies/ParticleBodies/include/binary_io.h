@@ -0,0 +1,120 @@
+#pragma once
+
+// Includes
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace pb {
+
+	// Define class that appends the bytes of trivially copyable values to a buffer, values are
+	// stored with the native layout of the machine
+	class BinaryWriter {
+	public:
+		// Constructor
+		explicit BinaryWriter(std::vector<unsigned char> & buffer)
+			: buffer(buffer) {}
+
+		// Append a value
+		template <typename T>
+		void write(T const & value) {
+			write(&value, 1);
+		}
+
+		// Append an array of values
+		template <typename T>
+		void write(T const * const values, size_t const count) {
+			size_t const offset = buffer.size();
+			buffer.resize(offset + count * sizeof(T));
+			if (count > 0) {
+				std::memcpy(&buffer[offset], values, count * sizeof(T));
+			}
+		}
+
+		// Append zero bytes up to a multiple of the given alignment
+		void align(size_t const alignment) {
+			buffer.resize(((buffer.size() + alignment - 1) / alignment) * alignment, 0);
+		}
+
+		// Number of bytes written
+		size_t size() const {
+			return buffer.size();
+		}
+
+	private:
+		// Output buffer
+		std::vector<unsigned char> & buffer;
+	};
+
+	// Define class that reads values from a block of memory, all reads are bounds checked
+	class BinaryReader {
+	public:
+		// Constructor
+		BinaryReader(unsigned char const * const data, size_t const size)
+			: data(data), length(size), offset(0) {}
+
+		// Read a value, return false if the end of the data is reached
+		template <typename T>
+		bool read(T * const value) {
+			return read(value, 1);
+		}
+
+		// Read an array of values
+		template <typename T>
+		bool read(T * const values, size_t const count) {
+			if (count > (length - offset) / sizeof(T)) {
+				return false;
+			}
+			if (count > 0) {
+				std::memcpy(values, data + offset, count * sizeof(T));
+			}
+			offset += count * sizeof(T);
+
+			return true;
+		}
+
+		// Skip bytes up to a multiple of the given alignment
+		bool align(size_t const alignment) {
+			return seek(((offset + alignment - 1) / alignment) * alignment);
+		}
+
+		// Move to an absolute position
+		bool seek(size_t const position) {
+			if (position > length) {
+				return false;
+			}
+			offset = position;
+
+			return true;
+		}
+
+		// Current position
+		size_t tell() const {
+			return offset;
+		}
+
+		// Pointer to the current position
+		unsigned char const * current() const {
+			return (data + offset);
+		}
+
+	private:
+		// Data and its size
+		unsigned char const * data;
+		size_t length;
+		// Current position
+		size_t offset;
+	};
+
+	// 64 bit FNV-1a hash of a block of memory, used to validate records of binary files
+	inline std::uint64_t hashBytes(void const * const data, size_t const size,
+								   std::uint64_t hash = 14695981039346656037ull) {
+		unsigned char const * bytes = static_cast<unsigned char const *>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -1,63 +1,122 @@
 #pragma once
 
 // Includes
-#include "physical_properties.h"
+#include "body_state_store.h"
 #include <GL/glew.h>
+#include <memory>
 #include <vector>
 
 namespace pb {
 
+	// Classes forward declaration
+	class Arena;
+
+	// Shapes of the bodies, used to serialise and recreate them
+	enum ShapeType {
+		SHAPE_SPHERE = 0,
+		SHAPE_PLANE,
+		NUM_SHAPE_TYPES
+	};
+
 	// This class defines the basic body interface, all objects that run in the simulation
-	// must extend this class and the virtual methods
+	// must extend this class and the virtual methods. The physical state of the body lives in a
+	// BodyStateStore, the body is a handle to its slot
 	class Body {
 	public:
 		// Constructor
 		Body();
 
-		Body(math::vec3f const & cm, float const mass,
-			 math::quaternionf const & orientation);
+		// Create the state of the body in a store, a store owned by the body if none is given
+		Body(math::vec3r const & cm, real const mass,
+			 math::quaternionr const & orientation, BodyStateStore * const store = nullptr);
 
 		// Virtual destructor
 		virtual ~Body();
 
+		// Maximum number of parameters describing the shape of a body
+		static size_t const MAX_SHAPE_PARAMETERS = 4;
+
+		// Create a body given its shape type and parameters, return nullptr if the type is unknown.
+		// The state is created in the given store and the body is allocated from the given arena
+		// if any, otherwise the caller owns the body
+		static Body * create(ShapeType const type, real const parameters[MAX_SHAPE_PARAMETERS],
+							 math::vec3r const & cm, real const mass,
+							 math::quaternionr const & orientation,
+							 BodyStateStore * const store = nullptr, Arena * const arena = nullptr);
+
+		// Get the volume of a shape, zero if the type is unknown
+		static real getShapeVolume(ShapeType const type, real const parameters[MAX_SHAPE_PARAMETERS]);
+
 		// Add force to body
-		void addForce(math::vec3f const & f);
+		void addForce(math::vec3r const & f);
 
 		// Reset forces on body
 		void resetForce();
 
-		// Add force as torque
-		void addForceAsTorque(math::vec3f const & f, math::vec3f const & p);
+		// Add torque of a force applied at an arm from the center of mass in world space, p x f
+		void addForceAsTorque(math::vec3r const & f, math::vec3r const & p);
 
 		// Reset torque
 		void resetTorque();
 
 		// Generate BBOX of the body
-		virtual void generateBBOX(math::vec3f * min, math::vec3f * max) const = 0;
+		virtual void generateBBOX(math::vec3r * min, math::vec3r * max) const = 0;
 
 		// Check if a point is inside the object
-		virtual bool pointInside(math::vec3f const & p) const = 0;
+		virtual bool pointInside(math::vec3r const & p) const = 0;
+
+		// Compute the signed distance of a point to the surface, negative inside. Return false if
+		// the shape has no closed form for it
+		virtual bool signedDistance(math::vec3r const & p, real & distance) const;
+
+		// Get the shape of the body
+		virtual ShapeType getShapeType() const = 0;
+
+		// Get the parameters describing the shape, unused entries are set to zero
+		virtual void getShapeParameters(real parameters[MAX_SHAPE_PARAMETERS]) const = 0;
+
+		// Move the state of the body to a store, usually the one of a System. The body becomes a
+		// handle to the new slot
+		void bindStateStore(BodyStateStore * const store);
+
+		// Move the state of the body back to a store owned by the body, e.g. when it is removed
+		// from a System
+		void releaseStateStore();
+
+		// Get the store holding the state of the body and the index of the body inside it
+		BodyStateStore * getStateStore() const;
+		size_t getStateIndex() const;
+
+		// Update the index of the body after the owner of the store moved its slot
+		void setStateIndex(size_t const index);
+
+		// Get mass of the body
+		real getMass() const;
 
 		// Get center of mass of the body
-		math::vec3f const & getCenterOfMass() const;
+		math::vec3r getCenterOfMass() const;
 
-		// Get rotation quaternion
-		math::mat4x4f getOrientationMatrix() const;
+		// Get rotation quaternion as 4x4 matrix, cached by the last state update
+		math::mat4x4r const & getOrientationMatrix() const;
 
-		// Compute velocity of a point, in world space, on the body 
-		math::vec3f pointVelocityWorld(math::vec3f const & p) const;
+		// Get model matrix, orientation followed by the translation to the center of mass,
+		// cached by the last state update
+		math::mat4x4r const & getModelMatrix() const;
 
-		// Compute velocity of a point in local space on the body
-		math::vec3f pointVelocityLocal(math::vec3f const & p) const;
+		// Get orientation matrix cached by the last state update
+		math::mat3x3r const & getRotationMatrix() const;
 
-		// Copy the body state information to an array
-		void bodyStateToArray(float y[]) const;
+		// Get linear velocity
+		math::vec3r getLinearVelocity() const;
 
-		// Copy the array into the object state
-		void arrayToBodyState(float const y[]);
+		// Get angular velocity
+		math::vec3r getAngularVelocity() const;
 
-		// Copy state derivative to array
-		void ddtBodyStateToArray(float y_dot[]) const;
+		// Compute velocity of a point, in world space, on the body 
+		math::vec3r pointVelocityWorld(math::vec3r const & p) const;
+
+		// Compute velocity of a point in local space on the body
+		math::vec3r pointVelocityLocal(math::vec3r const & p) const;
 
 		// Draw body
 		void drawBody(GLuint const v_buff,
@@ -71,11 +130,19 @@ namespace pb {
 		// Postprocessing after drawing
 		virtual void drawPostprocess() const = 0;
 
+		// Draw the shape between the preprocessing and the postprocessing, the sphere mesh by default
+		virtual void drawShape(GLuint const num_elements) const;
+
 		// Compute inertia tensor of the body
 		virtual void computeInertiaTensor() = 0;
 
-		// Body physical description
-		PhysicalProperties physical_properties;
+		// Store holding the body state and index of the body in the store
+		BodyStateStore * states;
+		size_t state_index;
+
+	private:
+		// Store owned by the body until it is bound to another one
+		std::unique_ptr<BodyStateStore> local_states;
 	};
 
 } // pb namespace
\ No newline at end of file
@@ -1,7 +1,12 @@
 #pragma once
 
 #include <GL/glew.h>
-#include "particle.h"
+#include "distance_field.h"
+#include "particle_levels.h"
+#include "particle_transform.h"
+#include "sphere_tree.h"
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace pb {
@@ -13,39 +18,142 @@ namespace pb {
 	// This class defines the connection between a Body and his physical approximation
 	class BodyParticlesDiscretisation {
 	public:
-		// Constructor
-		BodyParticlesDiscretisation(Body * const body, float const particle_diameter);
+		// Constructor, the particles are made larger if the body is more than INT16_MAX particles
+		// long. getSpacing gives the diameter that was used
+		BodyParticlesDiscretisation(Body * const body, real const particle_diameter);
 
-		// Check if two object are colliding
-		void colliding(BodyParticlesDiscretisation & other);
+		// Create discretisation from an existing particle set, e.g. read from a checkpoint
+		BodyParticlesDiscretisation(Body * const body, contact_real const origin[3],
+									contact_real const spacing, contact_real const particle_radius,
+									std::vector<Particle> const & particles);
+
+		// Create discretisation with the particles, the tree and the distance field of the
+		// discretisation of the same shape for another body
+		BodyParticlesDiscretisation(Body * const body, BodyParticlesDiscretisation const & shape);
+
+		// Update pose and world box of the body from the current body state, without the particles
+		void updateWorldTransform();
+
+		// Update pose and world box of the body and world position and velocity of all the particles
+		void updateWorldParticles();
+
+		// Free the world particles, a body that can not touch another one does not need them
+		void releaseWorldParticles();
+
+		// Get world position and velocity of the particles, computed by updateWorldParticles. Empty
+		// after releaseWorldParticles
+		ParticleWorldBuffer const & getWorldParticles() const;
+
+		// Get pose and velocity of the body in contact precision, computed by updateWorldTransform
+		BodyTransform const & getWorldTransform() const;
+
+		// Get bounding sphere hierarchy of the particles in body space
+		ParticleSphereTree const & getParticleTree() const;
+
+		// Get coarser discretisations of the particles in body space, from the finest one above the
+		// particles to the coarsest one
+		ParticleLevels const & getParticleLevels() const;
+
+		// Build signed distance field of the body, shared by the discretisations later created
+		// from this one. Only the bodies sampled by the distance field contacts need one, it costs
+		// far more than the particles of a small body
+		void buildDistanceField();
+
+		// Get signed distance field of the body in body space, null if not built
+		SignedDistanceField const * getDistanceField() const;
+
+		// Add a contact force to a particle and record it for the next transfer
+		void addContactForce(size_t const particle, math::vec3c const & f);
+
+		// Add a contact force at a point in world space, transferred with the particle forces
+		void addContactForceAtPoint(contact_real const point[3], math::vec3c const & f);
+
+		// Get world space box enclosing the particles, computed by updateWorldTransform from the
+		// box of the particles in body space. It is empty (min > max) if the body has no particles
+		contact_real const * getWorldBoundsMin() const;
+		contact_real const * getWorldBoundsMax() const;
 
 		// Draw all particles
 		void drawParticles(GLuint const sphere_v_buff,
 						   GLuint const sphere_i_buff,
 						   GLuint const num_elements) const;
 
-		// Apply forces from particles to object
+		// Apply forces from particles to object. Only the particles that got a contact force since
+		// the last transfer are visited, in index order
 		void transferForcesParticlesBody();
 
+		// Get number of particles that got a contact force since the last transfer
+		size_t getNumActiveParticles() const;
+
 		// Get pointer to the body
 		Body * const getBody() const;
 
+		// Get number of particles
+		size_t getNumParticles() const;
+
+		// Get list of particles
+		std::vector<Particle> const & getParticles() const;
+
+		// Get position in body space of the particle with voxel coordinates (0, 0, 0)
+		contact_real const * getOrigin() const;
+
+		// Get distance between two neighbouring particles, the diameter of the particles. Larger than
+		// the requested one if the body was too long for the 16 bit voxel coordinates
+		contact_real getSpacing() const;
+
+		// Get radius of the particles
+		contact_real getParticleRadius() const;
+
 	private:
-		// Generate body particles discretisation
-		void generateParticles(float const particle_diameter,
+		// Generate body particles discretisation and return their diameter, larger than the requested
+		// one if the body needs more voxels along an axis than the 16 bit coordinates hold
+		real generateParticles(real const particle_diameter,
 							   bool const process_interior = true);
 
-		// Resolve force between two particle of two different bodies that are colliding
-		void solveContact(Particle & p1, math::vec3f const & p1_world_position, math::vec3f const & p1_world_speed,
-						  Particle & p2, math::vec3f const & p2_world_position, math::vec3f const & p2_world_speed);
+		// Compute the box of the particle centers in body space
+		void computeLocalBounds();
+
+		// Decode particle position in body space
+		math::vec3c particlePositionLocal(Particle const & particle) const;
 
 		// Transform particle position to world space
-		math::vec3f particlePositionWorld(Particle const & particle) const;
+		math::vec3c particlePositionWorld(Particle const & particle) const;
 
 		// Physical body
 		Body * const body;
+		// Position in body space of the particle with voxel coordinates (0, 0, 0)
+		contact_real origin[3];
+		// Distance between two neighbouring particles
+		contact_real spacing;
+		// Radius shared by all the particles of the body
+		contact_real particle_radius;
 		// List of particles
 		std::vector<Particle> particles;
+		// Bounding sphere hierarchy of the particles, coarser discretisations of them and distance
+		// field of the body, the field is shared by the discretisations of the same shape
+		ParticleSphereTree particle_tree;
+		ParticleLevels particle_levels;
+		std::shared_ptr<SignedDistanceField const> distance_field;
+		// Box of the particle centers in body space
+		contact_real local_min[3];
+		contact_real local_max[3];
+		// World position and velocity of the particles and the pose they were computed from, the
+		// particles are only kept by the bodies that can touch another one
+		ParticleWorldBuffer world;
+		BodyTransform world_transform;
+		// Particles that got a contact force since the last transfer and flag of every particle
+		std::vector<std::uint32_t> active_particles;
+		std::vector<std::uint8_t> particle_active;
+		// Contact forces at points and their arm from the center of mass in world space,
+		// transferred after the particle forces
+		struct PointForce {
+			math::vec3r force;
+			math::vec3r arm;
+		};
+		std::vector<PointForce> point_forces;
+		// World box enclosing the particles
+		contact_real world_min[3];
+		contact_real world_max[3];
 	};
 
 } // pb namespace
\ No newline at end of file
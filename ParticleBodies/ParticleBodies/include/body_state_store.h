@@ -0,0 +1,207 @@
+#pragma once
+
+// Includes
+#include "precision.h"
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Define class that holds the state of a set of rigid bodies as structure of arrays. Every
+	// scalar component (e.g. the y coordinate of the center of mass) is stored in its own aligned
+	// array indexed by body, so that the integrator and the derived quantities update run as
+	// single sweeps over contiguous memory without packing the state of the bodies
+	class BodyStateStore {
+	public:
+		// Size of the integrated state of a body
+		static size_t const STATE_SIZE = 13;
+
+		// Offset of the components of the integrated state
+		enum StateComponent {
+			// Position
+			STATE_X = 0,
+			// Orientation, real part first
+			STATE_Q = 3,
+			// Linear momentum
+			STATE_P = 7,
+			// Angular momentum
+			STATE_L = 10
+		};
+
+		// Update of the orientation by the steps of integrateEuler and integrateVelocity
+		enum OrientationIntegration {
+			// Euler step of dq/dt = 0.5 * (0, omega) * q, the quaternion drifts from unit length
+			ORIENTATION_LINEAR = 0,
+			// Rotation exp(0.5 * omega * step) * q by the angular velocity of the start of the step,
+			// or of the end of the step for integrateVelocity. This is only a fix of the quaternion
+			// norm: the error of the orientation and of the energy of a tumbling body is the one of
+			// the linear update, so it does not allow larger steps. Use ORIENTATION_GYROSCOPIC for that
+			ORIENTATION_EXPONENTIAL,
+			// Exact rotation with the angular velocity of the new angular momentum at the
+			// orientation half way through the step. The angular velocity of a spinning body that
+			// is not symmetric changes as it rotates even without torque, this follows that change
+			ORIENTATION_GYROSCOPIC
+		};
+
+		// Constructor
+		BodyStateStore();
+
+		// The store is referenced by the bodies, it can not be copied
+		BodyStateStore(BodyStateStore const &) = delete;
+		BodyStateStore & operator=(BodyStateStore const &) = delete;
+
+		// Add a body at rest, return its index
+		size_t add(real const mass, math::vec3r const & x, math::quaternionr const & q);
+
+		// Add a copy of a body of another store, return its index
+		size_t add(BodyStateStore const & other, size_t const other_index);
+
+		// Remove a body moving the last one to its slot, return the previous index of the moved
+		// body (equal to index if the removed body was the last one)
+		size_t remove(size_t const index);
+
+		// Number of bodies in the store
+		size_t size() const;
+
+		// Distance between two components of the state, all the arrays have this length
+		size_t capacity() const;
+
+		// Grow the arrays so that they can hold at least the given number of bodies
+		void reserve(size_t const new_capacity);
+
+		// Integrated state, component c of body i is state(c)[i]. The arrays of the components
+		// are contiguous so the whole state can be processed as a single array of
+		// STATE_SIZE * capacity() elements
+		real * state(size_t const component);
+		real const * state(size_t const component) const;
+
+		// State derivative, same layout of the state
+		real * ddtState(size_t const component);
+		real const * ddtState(size_t const component) const;
+
+		// Set the inertia tensor of a body in body space and its inverse
+		void setInertiaTensorBody(size_t const index, math::mat3x3r const & inertia,
+								  math::mat3x3r const & inv_inertia);
+
+		// Gather single body quantities
+		real getMass(size_t const index) const;
+		math::mat3x3r getInertiaTensorBody(size_t const index) const;
+		math::mat3x3r getInverseInertiaTensorBody(size_t const index) const;
+		math::vec3r getPosition(size_t const index) const;
+		math::quaternionr getOrientation(size_t const index) const;
+		math::vec3r getLinearMomentum(size_t const index) const;
+		math::vec3r getAngularMomentum(size_t const index) const;
+		math::quaternionr getUnitOrientation(size_t const index) const;
+		math::mat3x3r getInverseInertiaTensor(size_t const index) const;
+		math::vec3r getLinearVelocity(size_t const index) const;
+		math::vec3r getAngularVelocity(size_t const index) const;
+		math::vec3r getForce(size_t const index) const;
+		math::vec3r getTorque(size_t const index) const;
+
+		// Get the matrices of a body cached by the last derived quantities update, rotation,
+		// rotation as 4x4 matrix and model matrix, rotation followed by the translation to the
+		// center of mass. The references are valid until a body is added or removed
+		math::mat3x3r const & getRotationMatrix(size_t const index) const;
+		math::mat4x4r const & getOrientationMatrix(size_t const index) const;
+		math::mat4x4r const & getModelMatrix(size_t const index) const;
+
+		// Scatter single body state, derived quantities are not updated
+		void setPosition(size_t const index, math::vec3r const & x);
+		void setOrientation(size_t const index, math::quaternionr const & q);
+		void setLinearMomentum(size_t const index, math::vec3r const & P);
+		void setAngularMomentum(size_t const index, math::vec3r const & L);
+
+		// Accumulate force and torque on a body
+		void addForce(size_t const index, math::vec3r const & f);
+		void addTorque(size_t const index, math::vec3r const & t);
+
+		// Reset force or torque of a body
+		void resetForce(size_t const index);
+		void resetTorque(size_t const index);
+
+		// Reset force and torque of all the bodies
+		void resetForces();
+
+		// Compute normalised orientation, orientation and model matrices, velocities and world
+		// inverse inertia tensor of all the bodies. The getters of the derived quantities return the values of the
+		// last update, they are not recomputed from the state
+		void computeDerivedQuantities();
+
+		// Compute the derived quantities of a single body
+		void computeDerivedQuantities(size_t const index);
+
+		// Compute the state derivative of all the bodies from the derived quantities and the forces
+		void computeStateDerivative();
+
+		// Advance the bodies of a list by one explicit Euler step of length step, then update their
+		// derived quantities. Same result as computeStateDerivative, an Euler step on the whole state
+		// and computeDerivedQuantities, but bodies of different lists can be advanced in parallel.
+		// Runs of consecutive indices are swept as ranges, so sorted lists are the fastest
+		void integrateEuler(std::uint32_t const * const indices, size_t const count, real const step);
+
+		// Set the velocities of a body at the end of a step of length step found by a velocity
+		// level solver, then move its position and orientation with them and update its derived
+		// quantities. Force and torque are set to the average ones of the step
+		void integrateVelocity(size_t const index, math::vec3r const & v, math::vec3r const & omega, real const step);
+
+		// Set the orientation update of the steps, computeStateDerivative is always linear
+		void setOrientationIntegration(OrientationIntegration const integration);
+
+		// Get the orientation update of the steps
+		OrientationIntegration getOrientationIntegration() const;
+
+	private:
+		// Arrays of the store, the value is the index of the first array of the quantity
+		enum Array {
+			ARRAY_STATE = 0,
+			ARRAY_DDT_STATE = ARRAY_STATE + STATE_SIZE,
+			ARRAY_MASS = ARRAY_DDT_STATE + STATE_SIZE,
+			ARRAY_INV_MASS = ARRAY_MASS + 1,
+			ARRAY_INERTIA_BODY = ARRAY_INV_MASS + 1,
+			ARRAY_INV_INERTIA_BODY = ARRAY_INERTIA_BODY + 9,
+			ARRAY_Q_UNIT = ARRAY_INV_INERTIA_BODY + 9,
+			ARRAY_INV_INERTIA = ARRAY_Q_UNIT + 4,
+			ARRAY_V = ARRAY_INV_INERTIA + 9,
+			ARRAY_OMEGA = ARRAY_V + 3,
+			ARRAY_FORCE = ARRAY_OMEGA + 3,
+			ARRAY_TORQUE = ARRAY_FORCE + 3,
+			NUM_ARRAYS = ARRAY_TORQUE + 3
+		};
+
+		// Matrices of a body, stored by body rather than by component so that they can be
+		// returned by reference
+		struct BodyMatrices {
+			math::mat3x3r rotation;
+			math::mat4x4r orientation;
+			math::mat4x4r model;
+		};
+
+		// Get array
+		real * array(size_t const a);
+		real const * array(size_t const a) const;
+
+		// Compute the derived quantities of the bodies in [begin, end)
+		void computeDerivedQuantities(size_t const begin, size_t const end);
+
+		// Advance the bodies in [begin, end) by one explicit Euler step, one sweep of every array
+		void integrateEuler(size_t const begin, size_t const end, real const step);
+
+		// Orientation of a body after a step from q with angular velocity omega and, at the end
+		// of the step, angular momentum L, for the non linear orientation updates
+		math::quaternionr rotateOrientation(size_t const index, math::quaternionr const & q, math::vec3r const & omega,
+											math::vec3r const & L, real const step) const;
+
+		// Orientation update of the steps
+		OrientationIntegration orientation_integration;
+
+		// Number of bodies and length of the arrays
+		size_t num_bodies;
+		size_t array_capacity;
+		// Memory of all the arrays and first aligned element
+		std::vector<real> buffer;
+		real * base;
+		// Cached matrices of the bodies, one per element of the arrays
+		std::vector<BodyMatrices> matrices;
+	};
+
+} // pb namespace
\ No newline at end of file
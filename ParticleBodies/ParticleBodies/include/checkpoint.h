@@ -0,0 +1,83 @@
+#pragma once
+
+// Includes
+#include "system.h"
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pb {
+
+	// Checkpoint file layout
+	//
+	// Header: magic "PBCK", version, size of real and contact_real, number of bodies and particle
+	// sets, offsets of the two state slots and size of a slot.
+	// Description: the particle sets (origin, spacing, radius and voxel coordinates), shared by
+	// the bodies with identical discretisations, followed by shape, parameters, mass, inertia and
+	// particle set index of every body.
+	// Slots: sequence number, t, delta_t, the STATE_SIZE arrays of the body states and a hash of
+	// the slot. The valid slot with the highest sequence number is the checkpoint.
+	struct CheckpointFormat {
+		static std::uint32_t const MAGIC = 0x4b434250;
+		static std::uint32_t const VERSION = 1;
+	};
+
+	// Define class that writes checkpoints of a system to a file. The first write stores the
+	// description of the bodies, the following ones only overwrite the oldest state slot so a
+	// checkpoint costs a single write of the states, and a crash during a write leaves the
+	// previous checkpoint valid. The description is written again if the set of bodies changes
+	class CheckpointWriter {
+	public:
+		// Constructor, the file is created on the first write
+		explicit CheckpointWriter(char const * const path);
+
+		// Destructor closes the file
+		~CheckpointWriter();
+
+		// The writer owns the file, it can not be copied
+		CheckpointWriter(CheckpointWriter const &) = delete;
+		CheckpointWriter & operator=(CheckpointWriter const &) = delete;
+
+		// Write a checkpoint of the system, return false on I/O errors
+		bool write(System const & system);
+
+	private:
+		// Create the file with the description of the bodies and empty slots
+		bool writeDescription(System const & system);
+
+		// Write the state of the bodies to the oldest slot
+		bool writeSlot(System const & system);
+
+		// Path of the file
+		std::string path;
+		// File, open from the first write
+		std::FILE * file;
+		// Revision of the bodies of the system described in the file
+		size_t bodies_revision;
+		// Sequence number of the last slot written
+		std::uint64_t sequence;
+		// Offset and size of the slots
+		std::uint64_t slot_offset[2];
+		std::uint64_t slot_size;
+		// Scratch buffer
+		std::vector<unsigned char> buffer;
+	};
+
+	// Bodies, discretisations and system recreated from a checkpoint, owned by this structure
+	struct RestartedSystem {
+		std::vector<std::unique_ptr<Body> > bodies;
+		std::vector<std::unique_ptr<BodyParticlesDiscretisation> > discretisations;
+		std::unique_ptr<System> system;
+	};
+
+	// Define class that restarts a system from a checkpoint file
+	class CheckpointReader {
+	public:
+		// Map the file and recreate the system, the continued trajectory is bit identical to
+		// the one of the system that wrote the checkpoint. Return false if the file is invalid
+		static bool restart(char const * const path, RestartedSystem * const restarted);
+	};
+
+} // pb namespace
\ No newline at end of file
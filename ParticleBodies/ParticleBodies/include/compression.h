@@ -0,0 +1,25 @@
+#pragma once
+
+// Includes
+#include <cstddef>
+#include <vector>
+
+namespace pb {
+
+	// Define class implementing a byte oriented LZ77 block compressor. A block is a list of
+	// sequences, each one made of a token (literal length in the high nibble, match length - 4 in
+	// the low nibble, 15 meaning that more length bytes follow), the literals and the 16 bit offset
+	// of the match. The last sequence only holds literals. Matches are searched with a single
+	// entry hash table so that compression runs at memory speed on the delta encoded frames
+	class BlockCompressor {
+	public:
+		// Compress a block and append it to the output buffer, return the compressed size
+		static size_t compress(unsigned char const * const src, size_t const size,
+							   std::vector<unsigned char> & dst);
+
+		// Decompress a block of known raw size, return false if the block is corrupted
+		static bool decompress(unsigned char const * const src, size_t const size,
+							   unsigned char * const dst, size_t const raw_size);
+	};
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+// Includes
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace pb {
+
+	// Define bounded lock free queue for any number of producer and consumer threads. Every cell
+	// has a sequence number telling if it is ready to be written or read for the current turn, so
+	// producers only contend on the enqueue position and consumers on the dequeue position
+	template <typename T>
+	class ConcurrentQueue {
+	public:
+		// Constructor, the capacity is rounded up to a power of two
+		explicit ConcurrentQueue(size_t const capacity)
+			: mask(0), enqueue_position(0), dequeue_position(0) {
+			size_t size = 2;
+			while (size < capacity) {
+				size *= 2;
+			}
+			cells.reset(new Cell[size]);
+			mask = size - 1;
+			for (size_t c = 0; c < size; c++) {
+				cells[c].sequence.store(c, std::memory_order_relaxed);
+			}
+		}
+
+		// The queue can not be copied
+		ConcurrentQueue(ConcurrentQueue const &) = delete;
+		ConcurrentQueue & operator=(ConcurrentQueue const &) = delete;
+
+		// Push an element, return false if the queue is full
+		bool push(T const & value) {
+			size_t position = enqueue_position.load(std::memory_order_relaxed);
+			Cell * cell;
+			while (true) {
+				cell = &cells[position & mask];
+				size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t const difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+				if (difference == 0) {
+					// The cell is free for this turn, claim it
+					if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						break;
+					}
+				} else if (difference < 0) {
+					// The cell still holds the element of the previous turn
+					return false;
+				} else {
+					// Another producer claimed the position
+					position = enqueue_position.load(std::memory_order_relaxed);
+				}
+			}
+			cell->value = value;
+			cell->sequence.store(position + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		// Pop an element, return false if the queue is empty
+		bool pop(T & value) {
+			size_t position = dequeue_position.load(std::memory_order_relaxed);
+			Cell * cell;
+			while (true) {
+				cell = &cells[position & mask];
+				size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t const difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+				if (difference == 0) {
+					// The cell was written in this turn, claim it
+					if (dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						break;
+					}
+				} else if (difference < 0) {
+					// Nothing written yet
+					return false;
+				} else {
+					// Another consumer claimed the position
+					position = dequeue_position.load(std::memory_order_relaxed);
+				}
+			}
+			value = cell->value;
+			cell->sequence.store(position + mask + 1, std::memory_order_release);
+
+			return true;
+		}
+
+	private:
+		// Element and its sequence number
+		struct Cell {
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		// Cells and mask of the index
+		std::unique_ptr<Cell[]> cells;
+		size_t mask;
+		// Keep the positions on different cache lines
+		char padding_0[64];
+		std::atomic<size_t> enqueue_position;
+		char padding_1[64];
+		std::atomic<size_t> dequeue_position;
+		char padding_2[64];
+	};
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+// Includes
+#include "precision.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace pb {
+
+	// Particle of both bodies of a contact between their shapes, which has a point instead
+	std::uint32_t const POINT_CONTACT_PARTICLE = UINT32_MAX;
+
+	// Contacts between pairs of particles found by the detection stage and consumed by the
+	// response stage, stored as structure of arrays. The arrays keep their memory when the buffer
+	// is cleared, so after the first steps no allocation happens
+	struct ContactBuffer {
+		// Remove all the contacts
+		void clear();
+
+		// Get number of contacts
+		size_t size() const {
+			return first_body.size();
+		}
+
+		// Append a contact
+		void add(std::uint32_t const body_1, std::uint32_t const particle_1,
+				 std::uint32_t const body_2, std::uint32_t const particle_2, bool const update_2,
+				 contact_real const normal[3], contact_real const penetration,
+				 contact_real const relative_velocity[3]) {
+			first_body.push_back(body_1);
+			first_particle.push_back(particle_1);
+			second_body.push_back(body_2);
+			second_particle.push_back(particle_2);
+			update_second.push_back(update_2 ? 1 : 0);
+			nx.push_back(normal[0]);
+			ny.push_back(normal[1]);
+			nz.push_back(normal[2]);
+			depth.push_back(penetration);
+			vx.push_back(relative_velocity[0]);
+			vy.push_back(relative_velocity[1]);
+			vz.push_back(relative_velocity[2]);
+			age.push_back(0);
+			impulse.push_back(contact_real(0));
+			cx.push_back(contact_real(0));
+			cy.push_back(contact_real(0));
+			cz.push_back(contact_real(0));
+		}
+
+		// Append a contact between the shapes of two bodies at a point in world space
+		void addAtPoint(std::uint32_t const body_1, std::uint32_t const body_2, bool const update_2,
+						contact_real const normal[3], contact_real const penetration,
+						contact_real const relative_velocity[3], contact_real const point[3]) {
+			add(body_1, POINT_CONTACT_PARTICLE, body_2, POINT_CONTACT_PARTICLE, update_2, normal, penetration, relative_velocity);
+			cx.back() = point[0];
+			cy.back() = point[1];
+			cz.back() = point[2];
+		}
+
+		// Check if a contact is between shapes at a point rather than between particles
+		bool isAtPoint(size_t const c) const {
+			return (first_particle[c] == POINT_CONTACT_PARTICLE);
+		}
+
+		// Print the contacts in [begin, end), one per line
+		void print(FILE * const file, size_t const begin, size_t const end) const;
+
+		// Bodies and particles in contact, the second particle only gets a force if its flag is set.
+		// Contacts between shapes have POINT_CONTACT_PARTICLE for both particles
+		std::vector<std::uint32_t> first_body, first_particle;
+		std::vector<std::uint32_t> second_body, second_particle;
+		std::vector<std::uint8_t> update_second;
+		// Unit vector from the first to the second particle, or the normal of the surface of the
+		// field body pointing to the other one for a particle against a distance field
+		std::vector<contact_real> nx, ny, nz;
+		// Sum of the radii minus the distance of the particles, or radius minus distance to the
+		// surface for a particle against a distance field
+		std::vector<contact_real> depth;
+		// Velocity of the second particle relative to the first one, or of the second body relative
+		// to the first one at the point for contacts between shapes
+		std::vector<contact_real> vx, vy, vz;
+		// History of the contact from the previous steps, filled by the system from its contact
+		// cache before the response and stored back after it. Steps the contact already existed and
+		// normal impulse of the impulse solver, both zero for new contacts
+		std::vector<std::uint32_t> age;
+		std::vector<contact_real> impulse;
+		// World point of the contacts between shapes, the lever arm of both bodies instead of
+		// their particles. Zero for the contacts between particles
+		std::vector<contact_real> cx, cy, cz;
+	};
+
+	// Contacts [begin, end) of a buffer
+	struct ContactRange {
+		ContactBuffer * contacts;
+		size_t begin;
+		size_t end;
+	};
+
+} // pb namespace
\ No newline at end of file
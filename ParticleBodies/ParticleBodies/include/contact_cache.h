@@ -0,0 +1,74 @@
+#pragma once
+
+// Includes
+#include "precision.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Key of a contact, the first body has the smaller id. Body ids must not change between
+	// steps nor be reused, the system combines the slot and the generation of the body handles
+	struct ContactKey {
+		std::uint64_t body_1;
+		std::uint64_t body_2;
+		std::uint32_t particle_1;
+		std::uint32_t particle_2;
+	};
+
+	// History of a contact carried from one step to the next
+	struct ContactHistory {
+		// Number of consecutive steps the contact existed before the current one
+		std::uint32_t age;
+		// Normal impulse of the impulse solver, the same for both orders of the bodies
+		contact_real normal_impulse;
+	};
+
+	// Define class that remembers the contacts between particles of the previous step. The contacts
+	// of the current step are recorded in a second hash table, at the end of the step the tables are
+	// swapped so the contacts that were not found again expire. Both tables use open addressing
+	// with linear probing and are cleared in time proportional to the number of contacts
+	class ContactCache {
+	public:
+		// Constructor
+		ContactCache();
+
+		// Find the history of a contact of the previous step, nullptr if the contact is new. Can be
+		// called from many threads at the same time
+		ContactHistory const * find(ContactKey const & key) const;
+
+		// Start recording the contacts of a step, at most num_contacts of them
+		void beginStep(size_t const num_contacts);
+
+		// Record a contact of the current step
+		void insert(ContactKey const & key, ContactHistory const & history);
+
+		// The contacts of the current step become the previous ones
+		void endStep();
+
+		// Get number of contacts of the previous step
+		size_t size() const;
+
+	private:
+		// Entry of a table, the first body of an empty entry is NO_BODY
+		struct Entry {
+			ContactKey key;
+			ContactHistory history;
+		};
+
+		// Table of entries, the capacity is a power of two
+		struct Table {
+			std::vector<Entry> entries;
+			size_t size;
+		};
+
+		// Hash of a key
+		static size_t hash(ContactKey const & key);
+
+		// Tables of the previous and of the current step
+		Table tables[2];
+		size_t previous;
+	};
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+// Includes
+#include "contact_islands.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Define class that colours the pairs of bodies of an island so that no two pairs of the same
+	// colour share a dynamic body. The contacts of a colour batch write the particle forces of
+	// different bodies and can run in parallel without atomics. Static bodies never collect
+	// contact forces and do not constrain the colours. The colouring is greedy, every pair takes
+	// the first colour free at both bodies in the order the pairs are given, so it is the same
+	// whatever the number of threads
+	class ContactColouring {
+	public:
+		// Colour the pairs of bodies, the flags of static bodies are indexed by body
+		void build(size_t const num_bodies, std::vector<std::uint8_t> const & is_static,
+				   BodyPair const * const pairs, size_t const num_pairs);
+
+		// Get number of colour batches
+		size_t getNumBatches() const;
+
+		// Get pairs of a batch, in the order they were given
+		BodyPair const * getBatch(size_t const batch) const;
+		size_t getBatchSize(size_t const batch) const;
+
+	private:
+		// Colours used by every body, as a mask of the first 64 and the first colour after them
+		// that is free for the body
+		std::vector<std::uint64_t> used_colours;
+		std::vector<std::uint32_t> next_wide_colour;
+		// Colour of every pair
+		std::vector<std::uint32_t> pair_colours;
+		// Pairs grouped by colour
+		std::vector<BodyPair> batch_pairs;
+		std::vector<size_t> batch_offsets;
+	};
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+// Includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Pair of bodies whose particles may touch, first < second
+	struct BodyPair {
+		std::uint32_t first;
+		std::uint32_t second;
+	};
+
+	// Define class that splits the bodies of a system in islands, the connected components of the
+	// graph of the pairs of bodies in contact. Static bodies do not connect the bodies touching
+	// them and form islands of their own, a pair with a static body belongs to the island of the
+	// dynamic one and pairs of two static bodies are dropped. Islands are merged with union-find,
+	// then sorted by decreasing cost and packed in tasks of similar cost
+	class ContactIslands {
+	public:
+		// Build the islands of num_bodies bodies. The pairs must be sorted, their order is kept in
+		// every island. The cost of a body and of a pair is used to balance the tasks
+		void build(size_t const num_bodies, std::vector<std::uint8_t> const & is_static,
+				   std::vector<BodyPair> const & pairs, std::vector<std::uint32_t> const & body_cost,
+				   size_t const min_task_cost);
+
+		// Get number of islands
+		size_t getNumIslands() const;
+
+		// Get number of tasks, the islands of a task are contiguous and tasks go from the most to
+		// the least expensive
+		size_t getNumTasks() const;
+
+		// Get range of islands of a task
+		size_t getTaskBegin(size_t const task) const;
+		size_t getTaskEnd(size_t const task) const;
+
+		// Get bodies of an island, in increasing index order
+		std::uint32_t const * getBodies(size_t const island) const;
+		size_t getNumBodies(size_t const island) const;
+
+		// Get cost of an island, the islands are sorted by decreasing cost
+		std::uint64_t getCost(size_t const island) const;
+
+		// Get pairs of an island, in the order they were given
+		BodyPair const * getPairs(size_t const island) const;
+		size_t getNumPairs(size_t const island) const;
+
+	private:
+		// Find root of a body, halving the path
+		std::uint32_t find(std::uint32_t body);
+
+		// Merge the islands of two bodies, the smaller one joins the larger one
+		void merge(std::uint32_t const a, std::uint32_t const b);
+
+		// Union-find forest and size of the trees
+		std::vector<std::uint32_t> parent;
+		std::vector<std::uint32_t> tree_size;
+		// Island of every body and of every pair, rank of every island in cost order
+		std::vector<std::uint32_t> body_island;
+		std::vector<std::uint32_t> pair_island;
+		std::vector<std::uint32_t> island_rank;
+		// Cost of the islands and islands sorted by decreasing cost
+		std::vector<std::uint64_t> island_cost;
+		std::vector<std::uint32_t> island_order;
+		// Bodies and pairs of the islands, grouped by island in cost order
+		std::vector<std::uint32_t> bodies;
+		std::vector<size_t> body_offsets;
+		std::vector<BodyPair> island_pairs;
+		std::vector<size_t> pair_offsets;
+		// First island of every task, plus the end
+		std::vector<size_t> task_offsets;
+	};
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+// Includes
+#include "body.h"
+#include "contact_buffer.h"
+#include <cstdint>
+
+namespace pb {
+
+	// Classes forward declaration
+	class BodyParticlesDiscretisation;
+
+	// Stiffness of the spring on the penetration of a contact and damping on its relative velocity
+	struct ContactMaterial {
+		contact_real stiffness;
+		contact_real damping;
+	};
+
+	// Material of the contacts of a new system
+	ContactMaterial const DEFAULT_CONTACT_MATERIAL = { contact_real(10), contact_real(0.5) };
+
+	// Detection stage, append the contacts between the particles of two bodies to the buffer and
+	// return their number. The world particles of both bodies must be up to date. The second body
+	// only gets forces if update_2 is set
+	typedef size_t (*ContactDetector)(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									  BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									  bool const update_2, ContactBuffer & contacts);
+
+	// Response stage, add the forces of the contacts in [begin, end) to the particles, or to the
+	// point of the contacts between shapes. The bodies are indexed by the ids given to the
+	// detection stage
+	typedef void (*ContactResponder)(ContactBuffer const & contacts, size_t const begin, size_t const end,
+									 ContactMaterial const & material, BodyParticlesDiscretisation * const * const bodies);
+
+	// Brute force check between all the pairs of particles of the two bodies
+	size_t detectContactsBruteForce(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									bool const update_2, ContactBuffer & contacts);
+
+	// Check of the particles of one body against a hierarchical hash grid of the particles of the
+	// other one, linear in the number of particles. Finds the same contacts in the same order as
+	// the brute force check
+	size_t detectContactsHashGrid(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+								  BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+								  bool const update_2, ContactBuffer & contacts);
+
+	// Check of the bounding sphere hierarchies of the particles of the two bodies against each
+	// other, only the particles of the leaves whose spheres overlap are checked. Two large bodies
+	// touching at one point cost about the logarithm of their particles plus the contacts. Finds
+	// the same contacts in the same order as the brute force check
+	size_t detectContactsSphereTree(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									bool const update_2, ContactBuffer & contacts);
+
+	// Check of the coarser discretisations of the two bodies against each other, starting from the
+	// coarsest levels and refining only the cells whose spheres overlap down to the particles. A
+	// distant pair is rejected by a few coarse cells and a touching pair costs about the particles
+	// near the contact. Finds the same contacts in the same order as the brute force check
+	size_t detectContactsParticleLevels(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+										BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+										bool const update_2, ContactBuffer & contacts);
+
+	// Check of the particles of the body with the finer ones against the signed distance field of
+	// the other body, linear in the number of particles. A contact is a particle closer to the
+	// surface than its radius, its normal is the gradient of the field and its reaction goes to
+	// the particle of the other body nearest to it. The contacts of the two bodies are found on
+	// one side only, so the particles of the sampled side must be fine enough to follow the surface.
+	// The field of a body is built on request, bodies without one fall back to the sphere trees
+	size_t detectContactsDistanceField(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									   BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									   bool const update_2, ContactBuffer & contacts);
+
+	// Analytic checks of pairs of shapes with a closed form, one contact per pair of bodies at the
+	// point halfway between the two surfaces, added with ContactBuffer::addAtPoint. The depth is
+	// the penetration of the shapes and the normal their exact normal. Spheres are checked by
+	// their centers, a sphere against a plane by the point of its box nearest to the center, or
+	// the nearest face if the center is inside
+	size_t detectContactsSphereSphere(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									  BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									  bool const update_2, ContactBuffer & contacts);
+	size_t detectContactsSpherePlane(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									 BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									 bool const update_2, ContactBuffer & contacts);
+	size_t detectContactsPlaneSphere(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									 BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									 bool const update_2, ContactBuffer & contacts);
+
+	// Get analytic check of a first body of one shape against a second body of another shape,
+	// nullptr if the pair has no closed form and needs the particles
+	ContactDetector getAnalyticContactDetector(ShapeType const shape_1, ShapeType const shape_2);
+
+	// Linear spring on the penetration plus damping on the relative velocity, applied in contact order
+	void respondContactsSpringDamper(ContactBuffer const & contacts, size_t const begin, size_t const end,
+									 ContactMaterial const & material, BodyParticlesDiscretisation * const * const bodies);
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+// Includes
+#include "particle.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Classes forward declaration
+	class Body;
+
+	// Define signed distance field of a body sampled in body space, negative inside. The nodes of
+	// the grid are the lattice of the particles of the body extended by MARGIN_CELLS on every side.
+	// The distance of a node comes from the shape if it has a closed form, otherwise it is
+	// estimated from the particles, which lie inside the surface at half a spacing, and the side
+	// given by Body::pointInside. Every node also keeps the particle nearest to it, which takes the
+	// reaction of a contact against the field. The nearest particles are found by a forward and a
+	// backward sweep over the grid, each node taking the nearest particle of its 13 neighbours
+	// already swept. This is linear in the nodes and can leave a node with a particle slightly
+	// farther than the nearest one
+	class SignedDistanceField {
+	public:
+		// Cells of the grid around the particles
+		static size_t const MARGIN_CELLS = 2;
+
+		// Sample the field of a body from its particles
+		void build(Body const & body, Particle const * const particles, size_t const num_particles,
+				   contact_real const origin[3], contact_real const spacing);
+
+		// Check if the field has no nodes
+		bool empty() const;
+
+		// Interpolate the distance and its gradient at a point in body space and find the particle
+		// of the nearest node. Return false if the point is outside the grid
+		bool sample(contact_real const point[3], contact_real & distance, contact_real gradient[3],
+					std::uint32_t & nearest) const;
+
+	private:
+		// Index of a node
+		size_t nodeIndex(size_t const x, size_t const y, size_t const z) const;
+
+		// Take for a node the nearest particle of its neighbour at an offset if it is nearer
+		void propagateNearest(Particle const * const particles, size_t const x, size_t const y, size_t const z,
+							  int const dx, int const dy, int const dz);
+
+		// Voxel and position of the first node, side of the cells and number of nodes along every axis
+		std::int32_t first_voxel[3];
+		contact_real grid_origin[3];
+		contact_real cell;
+		contact_real inv_cell;
+		size_t dims[3];
+		// Distance and nearest particle of every node, x fastest
+		std::vector<contact_real> distances;
+		std::vector<std::uint32_t> nearest_particles;
+	};
+
+} // pb namespace
\ No newline at end of file
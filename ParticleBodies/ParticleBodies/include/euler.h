@@ -6,8 +6,9 @@
 class EulerSolver {
 public:
 	// Solve onestep of ODE using Euler method
-	static inline void odeStep(float const y0[], float const ydot[], float yend[],
-							   size_t const len, float const t0, float const t1) {
+	template <typename T>
+	static inline void odeStep(T const y0[], T const ydot[], T yend[],
+							   size_t const len, T const t0, T const t1) {
 		for (size_t i = 0; i < len; i++) {
 			yend[i] = y0[i] + (t1 - t0) * ydot[i];
 			//std::cout << yend[i] << " " << y0[i] << " " << (t1 - t0) << " " << ydot[i] << std::endl;
@@ -0,0 +1,107 @@
+#pragma once
+
+// Includes
+#include "precision.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Define hierarchical spatial hash of spheres. Level k of the hierarchy has cubic cells of
+	// side 2^k and a sphere is stored at the smallest level whose cells are at least as wide as
+	// its diameter, in the cell holding its center. The cells of all the levels share one hash
+	// table, so the grid has no bounds and only pays for the occupied cells. A query of a sphere
+	// visits the 27 cells or fewer of every level around it where an overlapping sphere of that
+	// level can be stored. Levels are clamped to [MIN_LEVEL, MAX_LEVEL], the cell coordinates
+	// must fit 62 bits at the level of every sphere
+	class HierarchicalHashGrid {
+	public:
+		// Range of the levels of the spheres
+		static int const MIN_LEVEL = -32;
+		static int const MAX_LEVEL = 32;
+
+		// Get level of a sphere of given radius
+		static int getLevel(contact_real const radius);
+
+		// Remove all the spheres, the grid keeps its memory
+		void clear();
+
+		// Add a sphere with an id given back by the queries
+		void insert(std::uint32_t const id, contact_real const center[3], contact_real const radius);
+
+		// Sort the spheres in the hash table, called after the insertions and before the queries
+		void build();
+
+		// Get number of spheres
+		size_t size() const;
+
+		// Get number of levels holding spheres
+		size_t getNumLevels() const;
+
+		// Call visit(id) for the spheres of level min_level or above stored in a cell near the
+		// sphere of the query, every sphere at most once. The visited spheres include all the
+		// ones overlapping the query, the caller checks the actual overlap
+		template <typename VISITOR>
+		void query(contact_real const center[3], contact_real const radius, int const min_level, VISITOR && visit) const;
+
+	private:
+		// Sphere of the grid and its cell
+		struct Entry {
+			std::int64_t cell[3];
+			std::int32_t level;
+			std::uint32_t id;
+		};
+
+		// Get bucket of the hash table of a cell
+		size_t getBucket(int const level, std::int64_t const x, std::int64_t const y, std::int64_t const z) const;
+
+		// Spheres in insertion order
+		std::vector<Entry> entries;
+		// Spheres grouped by bucket, the ones of bucket b are in [bucket_start[b], bucket_start[b + 1])
+		std::vector<std::uint32_t> bucket_start;
+		std::vector<std::uint32_t> bucket_entries;
+		// Occupied levels in increasing order
+		std::vector<std::int32_t> levels;
+	};
+
+	// HierarchicalHashGrid class template methods implementation
+
+	template <typename VISITOR>
+	void HierarchicalHashGrid::query(contact_real const center[3], contact_real const radius, int const min_level,
+									 VISITOR && visit) const {
+		for (size_t l = 0; l < levels.size(); l++) {
+			int const level = levels[l];
+			if (level < min_level) {
+				continue;
+			}
+
+			// A sphere of this level is at most half a cell wide, its cell is within the reach
+			// of the query
+			contact_real const inv_cell = std::ldexp(contact_real(1), -level);
+			contact_real const reach = radius + std::ldexp(contact_real(0.5), level);
+			std::int64_t low[3];
+			std::int64_t high[3];
+			for (size_t a = 0; a < 3; a++) {
+				low[a] = static_cast<std::int64_t>(std::floor((center[a] - reach) * inv_cell));
+				high[a] = static_cast<std::int64_t>(std::floor((center[a] + reach) * inv_cell));
+			}
+			for (std::int64_t x = low[0]; x <= high[0]; x++) {
+				for (std::int64_t y = low[1]; y <= high[1]; y++) {
+					for (std::int64_t z = low[2]; z <= high[2]; z++) {
+						// Different cells can share a bucket, only the spheres of the cell are visited
+						size_t const bucket = getBucket(level, x, y, z);
+						for (std::uint32_t e = bucket_start[bucket]; e < bucket_start[bucket + 1]; e++) {
+							Entry const & entry = entries[bucket_entries[e]];
+							if (entry.level == level && entry.cell[0] == x && entry.cell[1] == y && entry.cell[2] == z) {
+								visit(entry.id);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+} // pb namespace
\ No newline at end of file
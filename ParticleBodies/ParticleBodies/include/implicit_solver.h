@@ -0,0 +1,71 @@
+#pragma once
+
+// Includes
+#include "contact_buffer.h"
+#include "contact_stages.h"
+#include "matrix_include.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Classes forward declaration
+	class BodyParticlesDiscretisation;
+	class BodyStateStore;
+
+	// Define linearly implicit Euler step of the bodies of an island. The spring and the damper of
+	// every contact are linearised around the start of the step, so the new linear and angular
+	// velocities u' of the dynamic bodies solve
+	//
+	//   (M + h * sum_c G_c^T A_c G_c) u' = M u + h * (f_ext + sum_c G_c^T f_c)
+	//
+	// where G_c maps the body velocities to the relative velocity of the particles of contact c,
+	// A_c = damping * I + h * stiffness * n n^T is the Jacobian of its force with respect to the
+	// relative velocity and f_c the spring force at the start of the step. The system is symmetric
+	// positive definite and is solved by conjugate gradient with a Jacobi preconditioner, without
+	// building the matrix. The positions are then moved with the new velocities
+	class ImplicitContactSolver {
+	public:
+		// Maximum number of conjugate gradient iterations and relative residual of the solution
+		static size_t const MAX_ITERATIONS = 200;
+		static real const TOLERANCE;
+
+		// Step the bodies of an island by h, the static bodies do not move. The contacts must have
+		// been found on the world particles of the start of the step. Return the number of
+		// conjugate gradient iterations
+		size_t step(BodyStateStore & states, BodyParticlesDiscretisation * const * const bodies,
+					std::vector<std::uint8_t> const & is_static, std::uint32_t const * const island_bodies,
+					size_t const num_bodies, ContactRange const * const ranges, size_t const num_ranges,
+					ContactMaterial const & material, math::vec3r const & gravity, real const h);
+
+	private:
+		// Compute y = H * x, six components per unknown
+		void multiply(std::vector<real> const & x, std::vector<real> & y) const;
+
+		// Unknown of every body of the store, NO_UNKNOWN outside the island and for static bodies
+		std::vector<std::uint32_t> unknowns;
+		// Mass and world inertia tensor of the unknowns
+		std::vector<real> masses;
+		std::vector<math::mat3x3r> inertias;
+		// Unknowns, arms from the center of mass and normal of the contacts
+		std::vector<std::uint32_t> contact_first;
+		std::vector<std::uint32_t> contact_second;
+		std::vector<math::vec3r> first_arms;
+		std::vector<math::vec3r> second_arms;
+		std::vector<math::vec3r> normals;
+		// Conjugate gradient vectors
+		std::vector<real> velocities;
+		std::vector<real> rhs;
+		std::vector<real> residual;
+		std::vector<real> preconditioned;
+		std::vector<real> direction;
+		std::vector<real> product;
+		std::vector<real> inv_diagonal;
+		// Coefficients of A_c of the current step
+		real damping;
+		real stiffness_step;
+		real h_step;
+	};
+
+} // pb namespace
\ No newline at end of file
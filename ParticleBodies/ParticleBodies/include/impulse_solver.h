@@ -0,0 +1,89 @@
+#pragma once
+
+// Includes
+#include "contact_buffer.h"
+#include "matrix_include.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Classes forward declaration
+	class BodyParticlesDiscretisation;
+	class BodyStateStore;
+	class ThreadPool;
+
+	// Sweep of the impulse solver over the contacts. Gauss-Seidel applies every impulse before
+	// the next contact is solved, Jacobi solves all the contacts from the same velocities and can
+	// run them in parallel, but needs more iterations
+	enum ImpulseIteration {
+		IMPULSE_GAUSS_SEIDEL = 0,
+		IMPULSE_JACOBI
+	};
+
+	// Settings of the impulse solver
+	struct ImpulseSettings {
+		// Sweep and number of sweeps of every step
+		ImpulseIteration iteration;
+		size_t iterations;
+		// Fraction of the penetration beyond the slop removed in one step
+		real position_correction;
+		real penetration_slop;
+		// Start from the impulses of the contacts in the previous step
+		bool warm_start;
+	};
+
+	// Settings of a new system
+	ImpulseSettings const DEFAULT_IMPULSE_SETTINGS = { IMPULSE_GAUSS_SEIDEL, 10, real(0.2), real(0.01), true };
+
+	// Define velocity level solver of the contacts of an island. Every contact between particles
+	// is a non-penetration constraint on the velocity of its particles along the normal, solved
+	// for a non negative impulse by projected Gauss-Seidel or Jacobi sweeps. Penetration beyond a
+	// slop is removed over a few steps by asking for a separating velocity. The bodies are then
+	// moved with their new velocities
+	class ImpulseContactSolver {
+	public:
+		// Step the bodies of an island by h, the static bodies do not move. The impulses of the
+		// contacts are read to warm start the solver and replaced by the new ones. The Jacobi
+		// sweeps run on the pool if it is not null. Return the number of sweeps
+		size_t step(BodyStateStore & states, BodyParticlesDiscretisation * const * const bodies,
+					std::vector<std::uint8_t> const & is_static, std::uint32_t const * const island_bodies,
+					size_t const num_bodies, ContactRange const * const ranges, size_t const num_ranges,
+					ImpulseSettings const & settings, math::vec3r const & gravity, real const h,
+					ThreadPool * const pool);
+
+	private:
+		// Change of the impulse of contact c toward the velocity target, from the current velocities
+		real solveContact(size_t const c) const;
+
+		// Apply a change of impulse of contact c to the velocities of its bodies
+		void applyImpulse(size_t const c, real const impulse);
+
+		// Unknown of every body of the store, NO_UNKNOWN outside the island and for static bodies
+		std::vector<std::uint32_t> unknowns;
+		// Inverse mass, world inverse inertia and velocities of the unknowns
+		std::vector<real> inv_masses;
+		std::vector<math::mat3x3r> inv_inertias;
+		std::vector<math::vec3r> linear_velocities;
+		std::vector<math::vec3r> angular_velocities;
+		// Unknowns, normal, arm cross normal of both bodies, their angular response, effective
+		// mass, target velocity and accumulated impulse of the contacts
+		std::vector<std::uint32_t> contact_first;
+		std::vector<std::uint32_t> contact_second;
+		std::vector<math::vec3r> normals;
+		std::vector<math::vec3r> first_torques;
+		std::vector<math::vec3r> second_torques;
+		std::vector<math::vec3r> first_responses;
+		std::vector<math::vec3r> second_responses;
+		std::vector<real> effective_masses;
+		std::vector<real> targets;
+		std::vector<real> impulses;
+		// Changes of impulse of a Jacobi sweep and their relaxation, one over the largest number of
+		// contacts of the two bodies
+		std::vector<real> changes;
+		std::vector<std::uint32_t> contact_counts;
+		std::vector<real> relaxations;
+	};
+
+} // pb namespace
\ No newline at end of file
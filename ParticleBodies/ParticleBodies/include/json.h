@@ -0,0 +1,72 @@
+#pragma once
+
+// Includes
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pb {
+
+	// Define class holding a parsed JSON value
+	class JsonValue {
+	public:
+		// Type of the value
+		enum Type {
+			JSON_NULL = 0,
+			JSON_BOOL,
+			JSON_NUMBER,
+			JSON_STRING,
+			JSON_ARRAY,
+			JSON_OBJECT
+		};
+
+		// Constructor, a null value
+		JsonValue();
+
+		// Parse a document, return false and set a message with the line of the error if the text
+		// is not valid JSON
+		static bool parse(char const * const text, size_t const size, JsonValue * const value,
+						  std::string * const error);
+
+		// Get type of the value
+		Type getType() const;
+
+		// Check type of the value
+		bool isNumber() const;
+		bool isString() const;
+		bool isArray() const;
+		bool isObject() const;
+
+		// Get scalar values, the default value is returned if the type does not match
+		bool getBool(bool const default_value) const;
+		double getNumber(double const default_value) const;
+		std::string const & getString() const;
+
+		// Get number of elements of an array or of members of an object
+		size_t size() const;
+
+		// Get element of an array
+		JsonValue const & operator[](size_t const index) const;
+
+		// Get member of an object, nullptr if the value is not an object or has no such member
+		JsonValue const * find(char const * const key) const;
+
+		// Get key and value of a member of an object
+		std::string const & getKey(size_t const index) const;
+		JsonValue const & getMember(size_t const index) const;
+
+	private:
+		// Recursive descent parser
+		class Parser;
+
+		// Type and content
+		Type type;
+		bool boolean;
+		double number;
+		std::string string;
+		std::vector<JsonValue> elements;
+		std::vector<std::string> keys;
+	};
+
+} // pb namespace
\ No newline at end of file
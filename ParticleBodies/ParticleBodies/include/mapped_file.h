@@ -0,0 +1,46 @@
+#pragma once
+
+// Includes
+#include <cstddef>
+
+namespace pb {
+
+	// Define class that maps a whole file read only in memory
+	class MappedFile {
+	public:
+		// Constructor
+		MappedFile();
+
+		// Destructor unmaps the file
+		~MappedFile();
+
+		// The mapping can not be copied
+		MappedFile(MappedFile const &) = delete;
+		MappedFile & operator=(MappedFile const &) = delete;
+
+		// Map a file, return false if the file can not be opened or mapped
+		bool open(char const * const path);
+
+		// Unmap the file
+		void close();
+
+		// Get mapped memory
+		unsigned char const * data() const;
+
+		// Get size of the file
+		size_t size() const;
+
+	private:
+		// Platform handles
+#ifdef _WIN32
+		void * file_handle;
+		void * mapping_handle;
+#else
+		int file_descriptor;
+#endif
+		// Mapped memory and its size
+		unsigned char const * address;
+		size_t length;
+	};
+
+} // pb namespace
\ No newline at end of file
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "matrix_storage.h"
+#include "matrix_evaluator.h"
 
 namespace pb {
 	namespace math {
@@ -27,21 +27,13 @@ namespace pb {
 			template <typename T2, typename EXPR2>
 			Matrix(Matrix<T2, ROWS, COLS, EXPR2> const & other)
 				: expression() {
-				for (size_t r = 0; r < ROWS; r++) {
-					for (size_t c = 0; c < COLS; c++) {
-						expression(r, c) = other(r, c);
-					}
-				}
+				MatrixEvaluator<T, T2, ROWS, COLS>::evaluate(expression, other.expr());
 			}
 
 			// Assignment operator
 			template <typename T2, typename EXPR2>
-			Matrix & operator= (Matrix<T2, ROWS, COLS, EXPR> const & other) {
-				for (size_t r = 0; r < ROWS; r++) {
-					for (size_t c = 0; c < COLS; c++) {
-						expression(r, c) = other(r, c);
-					}
-				}
+			Matrix & operator= (Matrix<T2, ROWS, COLS, EXPR2> const & other) {
+				MatrixEvaluator<T, T2, ROWS, COLS>::evaluate(expression, other.expr());
 
 				return (*this);
 			}
@@ -102,17 +94,13 @@ namespace pb {
 			template <typename T2, typename EXPR2>
 			Matrix(Matrix<T2, ROWS, 1, EXPR2> const & other)
 				: expression() {
-				for (size_t r = 0; r < ROWS; r++) {
-					expression(r, 0) = other(r);
-				}
+				MatrixEvaluator<T, T2, ROWS, 1>::evaluate(expression, other.expr());
 			}
 
 			// Assignment operator
 			template <typename T2, typename EXPR2>
-			Matrix & operator= (Matrix<T2, ROWS, 1, EXPR> const & other) {
-				for (size_t r = 0; r < ROWS; r++) {
-					expression(r, 0) = other(r);
-				}
+			Matrix & operator= (Matrix<T2, ROWS, 1, EXPR2> const & other) {
+				MatrixEvaluator<T, T2, ROWS, 1>::evaluate(expression, other.expr());
 
 				return (*this);
 			}
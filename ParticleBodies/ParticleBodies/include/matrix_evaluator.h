@@ -0,0 +1,188 @@
+#pragma once
+
+#include "matrix_storage.h"
+
+namespace pb {
+	namespace math {
+
+		// Unrolled element by element evaluation, I is the linear index of the element
+		template <size_t I, size_t SIZE, size_t COLS>
+		struct meta_evaluate {
+			template <typename T, typename DST, typename SRC>
+			static inline void f(DST & dst, SRC const & src) {
+				dst(I / COLS, I % COLS) = static_cast<T>(src(I / COLS, I % COLS));
+				meta_evaluate<I + 1, SIZE, COLS>::template f<T>(dst, src);
+			}
+		};
+
+		template <size_t SIZE, size_t COLS>
+		struct meta_evaluate<SIZE, SIZE, COLS> {
+			template <typename T, typename DST, typename SRC>
+			static inline void f(DST &, SRC const &) {}
+		};
+
+		// Unrolled packet by packet evaluation
+		template <size_t P, size_t PACKETS>
+		struct meta_evaluate_packet {
+			template <typename DST, typename SRC>
+			static inline void f(DST & dst, SRC const & src) {
+				dst.setPacket(P, src.packet(P));
+				meta_evaluate_packet<P + 1, PACKETS>::f(dst, src);
+			}
+		};
+
+		template <size_t PACKETS>
+		struct meta_evaluate_packet<PACKETS, PACKETS> {
+			template <typename DST, typename SRC>
+			static inline void f(DST &, SRC const &) {}
+		};
+
+		// Evaluate an expression into a storage, packets are used when source and destination share
+		// the scalar type and the shape supports them
+		template <typename T, typename T2, size_t ROWS, size_t COLS,
+			bool PACKET = PacketTraits<T, ROWS, COLS>::enabled>
+		struct MatrixEvaluator {
+			template <typename SRC>
+			static inline void evaluate(MatrixStorage<T, ROWS, COLS> & dst, SRC const & src) {
+				meta_evaluate<0, ROWS * COLS, COLS>::template f<T>(dst, src);
+			}
+		};
+
+		template <typename T, size_t ROWS, size_t COLS>
+		struct MatrixEvaluator<T, T, ROWS, COLS, true> {
+			template <typename SRC>
+			static inline void evaluate(MatrixStorage<T, ROWS, COLS> & dst, SRC const & src) {
+				meta_evaluate_packet<0, PacketTraits<T, ROWS, COLS>::packets>::f(dst, src);
+			}
+		};
+
+		// Unrolled inner product between row I of the first operand and column J of the second
+		template <size_t K, size_t SIZE>
+		struct meta_inner_product {
+			template <typename T, typename OP1, typename OP2>
+			static inline T f(OP1 const & op1, OP2 const & op2, size_t const i, size_t const j) {
+				return (op1(i, K) * op2(K, j) + meta_inner_product<K + 1, SIZE>::template f<T>(op1, op2, i, j));
+			}
+		};
+
+		template <size_t SIZE>
+		struct meta_inner_product<SIZE, SIZE> {
+			template <typename T, typename OP1, typename OP2>
+			static inline T f(OP1 const &, OP2 const &, size_t const, size_t const) {
+				return T(0);
+			}
+		};
+
+		// Unrolled evaluation of all the elements of a product
+		template <size_t I, size_t ELEMENTS, size_t SIZE, size_t COLS>
+		struct meta_product {
+			template <typename T, typename DST, typename OP1, typename OP2>
+			static inline void f(DST & dst, OP1 const & op1, OP2 const & op2) {
+				dst(I / COLS, I % COLS) = meta_inner_product<0, SIZE>::template f<T>(op1, op2, I / COLS, I % COLS);
+				meta_product<I + 1, ELEMENTS, SIZE, COLS>::template f<T>(dst, op1, op2);
+			}
+		};
+
+		template <size_t ELEMENTS, size_t SIZE, size_t COLS>
+		struct meta_product<ELEMENTS, ELEMENTS, SIZE, COLS> {
+			template <typename T, typename DST, typename OP1, typename OP2>
+			static inline void f(DST &, OP1 const &, OP2 const &) {}
+		};
+
+		// Check if a product can be computed row by row with packets: both the second operand
+		// and the result must be packet matrices (not vectors)
+		template <typename T, size_t ROWS, size_t SIZE, size_t COLS>
+		struct ProductPacket {
+			static bool const value = COLS > 1 &&
+				PacketTraits<T, SIZE, COLS>::enabled &&
+				PacketTraits<T, ROWS, COLS>::enabled;
+		};
+
+		// Evaluate the product of two expressions into a storage
+		template <typename T, size_t ROWS, size_t SIZE, size_t COLS,
+			bool PACKET = ProductPacket<T, ROWS, SIZE, COLS>::value>
+		struct MatrixProduct {
+			template <typename OP1, typename OP2>
+			static inline void evaluate(MatrixStorage<T, ROWS, COLS> & dst, OP1 const & op1, OP2 const & op2) {
+				meta_product<0, ROWS * COLS, SIZE, COLS>::template f<T>(dst, op1, op2);
+			}
+		};
+
+#ifdef PB_MATRIX_PACKETS
+		// Row I of the result is the sum of the rows of the second operand scaled by row I of the first one
+		template <size_t K, size_t SIZE>
+		struct meta_packet_row_product {
+			template <typename OP1, typename OP2>
+			static inline Packet f(OP1 const & op1, OP2 const & op2, size_t const i) {
+				return (_mm_add_ps(_mm_mul_ps(_mm_set1_ps(op1(i, K)), op2.packet(K)),
+								   meta_packet_row_product<K + 1, SIZE>::f(op1, op2, i)));
+			}
+		};
+
+		template <size_t SIZE>
+		struct meta_packet_row_product<SIZE, SIZE> {
+			template <typename OP1, typename OP2>
+			static inline Packet f(OP1 const &, OP2 const &, size_t const) {
+				return (_mm_setzero_ps());
+			}
+		};
+
+		template <size_t I, size_t ROWS, size_t SIZE>
+		struct meta_packet_product {
+			template <typename DST, typename OP1, typename OP2>
+			static inline void f(DST & dst, OP1 const & op1, OP2 const & op2) {
+				dst.setPacket(I, meta_packet_row_product<0, SIZE>::f(op1, op2, I));
+				meta_packet_product<I + 1, ROWS, SIZE>::f(dst, op1, op2);
+			}
+		};
+
+		template <size_t ROWS, size_t SIZE>
+		struct meta_packet_product<ROWS, ROWS, SIZE> {
+			template <typename DST, typename OP1, typename OP2>
+			static inline void f(DST &, OP1 const &, OP2 const &) {}
+		};
+
+		template <typename T, size_t ROWS, size_t SIZE, size_t COLS>
+		struct MatrixProduct<T, ROWS, SIZE, COLS, true> {
+			template <typename OP1, typename OP2>
+			static inline void evaluate(MatrixStorage<T, ROWS, COLS> & dst, OP1 const & op1, OP2 const & op2) {
+				meta_packet_product<0, ROWS, SIZE>::f(dst, op1, op2);
+			}
+		};
+#endif
+
+		// Transpose an expression into a storage
+		template <typename T, size_t ROWS, size_t COLS,
+			bool PACKET = (ROWS == COLS && COLS > 1 && PacketTraits<T, ROWS, COLS>::enabled)>
+		struct MatrixTranspose {
+			template <typename SRC>
+			static inline void evaluate(MatrixStorage<T, COLS, ROWS> & dst, SRC const & src) {
+				for (size_t r = 0; r < ROWS; r++) {
+					for (size_t c = 0; c < COLS; c++) {
+						dst(c, r) = src(r, c);
+					}
+				}
+			}
+		};
+
+#ifdef PB_MATRIX_PACKETS
+		// Square packet matrices are transposed in registers, the missing row of a 3x3 matrix is
+		// zero so that the padding of the result stays zero
+		template <typename T, size_t SIZE>
+		struct MatrixTranspose<T, SIZE, SIZE, true> {
+			template <typename SRC>
+			static inline void evaluate(MatrixStorage<T, SIZE, SIZE> & dst, SRC const & src) {
+				Packet rows[4];
+				for (size_t r = 0; r < 4; r++) {
+					rows[r] = r < SIZE ? src.packet(r) : _mm_setzero_ps();
+				}
+				_MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+				for (size_t r = 0; r < SIZE; r++) {
+					dst.setPacket(r, rows[r]);
+				}
+			}
+		};
+#endif
+
+	} // math namespace
+} // pb namespace
\ No newline at end of file
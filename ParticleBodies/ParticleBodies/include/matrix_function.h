@@ -118,12 +118,7 @@ namespace pb {
 		template <typename T, size_t ROWS, size_t COLS, typename EXPR>
 		Matrix<T, COLS, ROWS> transpose(Matrix<T, ROWS, COLS, EXPR> const & m) {
 			Matrix<T, COLS, ROWS> transpose;
-
-			for (size_t r = 0; r < ROWS; r++) {
-				for (size_t c = 0; c < COLS; c++) {
-					transpose(c, r) = m(r, c);
-				}
-			}
+			MatrixTranspose<T, ROWS, COLS>::evaluate(transpose.expr(), m.expr());
 
 			return (transpose);
 		}
@@ -24,6 +24,13 @@ namespace pb {
 			T operator() (size_t const i, size_t const j) const {
 				return (op1(i, j) + op2(i, j));
 			}
+
+#ifdef PB_MATRIX_PACKETS
+			// Packet sum
+			Packet packet(size_t const p) const {
+				return (_mm_add_ps(op1.packet(p), op2.packet(p)));
+			}
+#endif
 		};
 
 		// Matrix sub
@@ -42,48 +49,65 @@ namespace pb {
 			T operator() (size_t const i, size_t const j) const {
 				return (op1(i, j) - op2(i, j));
 			}
+
+#ifdef PB_MATRIX_PACKETS
+			// Packet sub
+			Packet packet(size_t const p) const {
+				return (_mm_sub_ps(op1.packet(p), op2.packet(p)));
+			}
+#endif
 		};
 
-		// Matrix - Matrix Multiplication
-		template <typename T, typename OP1, typename OP2, size_t SIZE = 0>
+		// Matrix - Matrix Multiplication, the product is evaluated once when the node is created
+		// so that chained products and repeated accesses do not recompute the inner products
+		template <typename T, typename OP1, typename OP2, size_t ROWS, size_t SIZE, size_t COLS>
 		class OPMatrixMult {
 		private:
-			typename ExprTraits<OP1>::ExprReference op1;
-			typename ExprTraits<OP2>::ExprReference op2;
+			MatrixStorage<T, ROWS, COLS> result;
 
 		public:
 			// Constructor
 			OPMatrixMult(OP1 const & o1, OP2 const & o2)
-				: op1(o1), op2(o2) {}
+				: result() {
+				MatrixProduct<T, ROWS, SIZE, COLS>::evaluate(result, o1, o2);
+			}
 
 			// Access operator returns multiplication
 			T operator() (size_t const i, size_t const j) const {
-				T sum = 0;
-
-				for (size_t k = 0; k < SIZE; k++) {
-					sum += op1(i, k) * op2(k, j);
-				}
+				return (result(i, j));
+			}
 
-				return (sum);
+#ifdef PB_MATRIX_PACKETS
+			// Packet of the product
+			Packet packet(size_t const p) const {
+				return (result.packet(p));
 			}
+#endif
 		};
 
-		// Specialization for scalars
+		// Scalar - Matrix multiplication
 		template <typename T, typename OP>
-		class OPMatrixMult<T, Scalar<T>, OP> {
+		class OPMatrixScale {
 		private:
 			typename ExprTraits<Scalar<T> >::ExprReference s;
 			typename ExprTraits<OP>::ExprReference op;
 
 		public:
 			// Constructor
-			OPMatrixMult(Scalar<T> const & s, OP const & op)
+			OPMatrixScale(Scalar<T> const & s, OP const & op)
 				: s(s), op(op) {}
 
 			// Access operator returns element value
 			T operator() (size_t const i, size_t const j) const {
 				return (s(i, j) * op(i, j));
 			}
+
+#ifdef PB_MATRIX_PACKETS
+			// Packet scaling
+			Packet packet(size_t const p) const {
+				return (_mm_mul_ps(s.packet(p), op.packet(p)));
+			}
+#endif
 		};
 
 		// Negate Matrix
@@ -101,6 +125,13 @@ namespace pb {
 			T operator() (size_t const i, size_t const j) const {
 				return (-op(i, j));
 			}
+
+#ifdef PB_MATRIX_PACKETS
+			// Flip sign bit of the packet
+			Packet packet(size_t const p) const {
+				return (_mm_xor_ps(op.packet(p), _mm_set1_ps(-0.f)));
+			}
+#endif
 		};
 
 		// Define the operators returning the lightweight objects representing operations
@@ -123,25 +154,25 @@ namespace pb {
 
 		// Scalar - Matrix multiplication
 		template <typename T, size_t ROWS, size_t COLS, typename EXPR>
-		Matrix<T, ROWS, COLS, OPMatrixMult<T, Scalar<T>, EXPR> >
+		Matrix<T, ROWS, COLS, OPMatrixScale<T, EXPR> >
 			operator* (T const & s, Matrix<T, ROWS, COLS, EXPR> const & e) {
-			return (Matrix<T, ROWS, COLS, OPMatrixMult<T, Scalar<T>, EXPR> >
-				(OPMatrixMult<T, Scalar<T>, EXPR>(Scalar<T>(s), e.expr())));
+			return (Matrix<T, ROWS, COLS, OPMatrixScale<T, EXPR> >
+				(OPMatrixScale<T, EXPR>(Scalar<T>(s), e.expr())));
 		}
 
 		template <typename T, size_t ROWS, size_t COLS, typename EXPR>
-		Matrix<T, ROWS, COLS, OPMatrixMult<T, Scalar<T>, EXPR> >
+		Matrix<T, ROWS, COLS, OPMatrixScale<T, EXPR> >
 			operator* (Matrix<T, ROWS, COLS, EXPR> const & e, T const & s) {
-			return (Matrix<T, ROWS, COLS, OPMatrixMult<T, Scalar<T>, EXPR> >
-				(OPMatrixMult<T, Scalar<T>, EXPR>(Scalar<T>(s), e.expr())));
+			return (Matrix<T, ROWS, COLS, OPMatrixScale<T, EXPR> >
+				(OPMatrixScale<T, EXPR>(Scalar<T>(s), e.expr())));
 		}
 
 		// Matrix - matrix multiplication
 		template <typename T, size_t ROWS, size_t SIZE, size_t COLS, typename EXPR1, typename EXPR2>
-		Matrix<T, ROWS, COLS, OPMatrixMult<T, EXPR1, EXPR2, SIZE> >
+		Matrix<T, ROWS, COLS, OPMatrixMult<T, EXPR1, EXPR2, ROWS, SIZE, COLS> >
 			operator* (Matrix<T, ROWS, SIZE, EXPR1> const & e1, Matrix<T, SIZE, COLS, EXPR2> const & e2) {
-			return (Matrix<T, ROWS, COLS, OPMatrixMult<T, EXPR1, EXPR2, SIZE> >
-				(OPMatrixMult<T, EXPR1, EXPR2, SIZE>(e1.expr(), e2.expr())));
+			return (Matrix<T, ROWS, COLS, OPMatrixMult<T, EXPR1, EXPR2, ROWS, SIZE, COLS> >
+				(OPMatrixMult<T, EXPR1, EXPR2, ROWS, SIZE, COLS>(e1.expr(), e2.expr())));
 		}
 
 		// Negation of Matrix
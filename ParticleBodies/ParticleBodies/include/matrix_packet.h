@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+
+// 4 wide float packets are used when SSE2 is available (always true on x64)
+#if !defined(PB_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PB_MATRIX_PACKETS 1
+#include <emmintrin.h>
+#endif
+
+namespace pb {
+	namespace math {
+
+		// Storage layout of a matrix: number of stored elements, distance between two rows and
+		// number of packets. Float vectors and matrices with 3 or 4 columns are padded so that
+		// each vector (each matrix row) fills exactly one 4 wide packet
+		template <typename T, size_t ROWS, size_t COLS>
+		struct PacketTraits {
+			static bool const enabled = false;
+			static size_t const stride = COLS;
+			static size_t const size = ROWS * COLS;
+			static size_t const packets = 0;
+		};
+
+#ifdef PB_MATRIX_PACKETS
+		// Packet type
+		typedef __m128 Packet;
+
+		// Vectors, a single packet
+		template <size_t ROWS>
+		struct PacketTraitsVector {
+			static bool const enabled = true;
+			static size_t const stride = 1;
+			static size_t const size = 4;
+			static size_t const packets = 1;
+		};
+
+		// Matrices, one packet per row
+		template <size_t ROWS>
+		struct PacketTraitsMatrix {
+			static bool const enabled = true;
+			static size_t const stride = 4;
+			static size_t const size = ROWS * 4;
+			static size_t const packets = ROWS;
+		};
+
+		template <> struct PacketTraits<float, 3, 1> : public PacketTraitsVector<3> {};
+		template <> struct PacketTraits<float, 4, 1> : public PacketTraitsVector<4> {};
+		template <> struct PacketTraits<float, 3, 3> : public PacketTraitsMatrix<3> {};
+		template <> struct PacketTraits<float, 4, 4> : public PacketTraitsMatrix<4> {};
+#endif
+
+	} // math namespace
+} // pb namespace
\ No newline at end of file
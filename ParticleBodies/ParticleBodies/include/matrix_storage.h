@@ -3,19 +3,23 @@
 #include <cstring>
 #include <initializer_list>
 #include <cassert>
+#include "matrix_packet.h"
 
 namespace pb {
 	namespace math {
 
+		// Matrix elements are stored inline, row major, using the layout given by PacketTraits
 		template <typename T, size_t ROWS, size_t COLS>
 		class MatrixStorage {
+		private:
+			// Storage layout
+			typedef PacketTraits<T, ROWS, COLS> Layout;
+
 		public:
 			// Constructors
 			explicit MatrixStorage() {
-				e = new T[ROWS * COLS];
-
 				// Set all values to zero
-				for (size_t i = 0; i < ROWS * COLS; i++) {
+				for (size_t i = 0; i < Layout::size; i++) {
 					e[i] = T(0);
 				}
 			}
@@ -24,15 +28,17 @@ namespace pb {
 #ifdef _DEBUG
 				assert(args.size() == ROWS && args.begin()->size() == COLS);
 #endif
-				// Allocate memory
-				e = new T[ROWS * COLS];
+				// Set padding to zero
+				for (size_t i = 0; i < Layout::size; i++) {
+					e[i] = T(0);
+				}
 
 				size_t row = 0;
-				size_t col = 0;
 
 				for (auto row_it = args.begin(); row_it != args.end(); row_it++) {
+					size_t col = 0;
 					for (auto col_it = row_it->begin(); col_it != row_it->end(); col_it++) {
-						e[row * COLS + col] = *col_it;
+						e[row * Layout::stride + col] = *col_it;
 						col++;
 					}
 					row++;
@@ -43,14 +49,16 @@ namespace pb {
 #ifdef _DEBUG
 				assert(args.size() == ROWS * COLS);
 #endif
-				// Allocate memory
-				e = new T[ROWS * COLS];
+				// Set padding to zero
+				for (size_t i = 0; i < Layout::size; i++) {
+					e[i] = T(0);
+				}
 
 				size_t row = 0;
 				size_t col = 0;
 
 				for (auto elem_it = args.begin(); elem_it != args.end(); elem_it++) {
-					e[row * COLS + col] = *elem_it;
+					e[row * Layout::stride + col] = *elem_it;
 					col++;
 					if (col == COLS) {
 						col = 0;
@@ -59,61 +67,6 @@ namespace pb {
 				}
 			}
 
-			// Destructor
-			~MatrixStorage() {
-				delete[] e;
-			}
-
-			// Copy constructor
-			MatrixStorage(MatrixStorage const & orig) {
-				// Allocate memory
-				e = new T[ROWS * COLS];
-
-				for (size_t r = 0; r < ROWS; r++) {
-					for (size_t c = 0; c < COLS; c++) {
-						e[r * COLS + c] = orig.e[r * COLS + c];
-					}
-				}
-			}
-
-			// Move constructor
-			MatrixStorage(MatrixStorage && src) {
-				// Set pointer to src memory
-				e = src.e;
-
-				// Set src memory pointer to null
-				src.e = nullptr;
-			}
-
-			// Assignment operator
-			MatrixStorage & operator= (MatrixStorage const & other) {
-				if (&other != this) {
-					for (size_t r = 0; r < ROWS; r++) {
-						for (size_t c = 0; c < COLS; c++) {
-							e[r * COLS + c] = other.e[r * COLS + c];
-						}
-					}
-				}
-
-				return (*this);
-			}
-
-			// Move assignment operator
-			MatrixStorage& operator= (MatrixStorage && rhs) {
-				if (&rhs != this) {
-					// Free memory for this matrix
-					delete[] e;
-
-					// Set pointer to src memory
-					e = rhs.e;
-
-					// Set rhs memory pointer to null
-					rhs.e = nullptr;
-				}
-
-				return (*this);
-			}
-
 			// Index operator
 			T operator() (size_t const row, size_t const col) const {
 #ifdef _DEBUG
@@ -121,7 +74,7 @@ namespace pb {
 				assert(col >= 0 && col < COLS);
 #endif
 
-				return e[row * COLS + col];
+				return e[row * Layout::stride + col];
 			}
 
 			T & operator() (size_t const row, size_t const col) {
@@ -130,24 +83,38 @@ namespace pb {
 				assert(col >= 0 && col < COLS);
 #endif
 
-				return e[row * COLS + col];
+				return e[row * Layout::stride + col];
 			}
 
+#ifdef PB_MATRIX_PACKETS
+			// Load packet, a row for matrices or the whole vector
+			Packet packet(size_t const p) const {
+				return _mm_loadu_ps(&e[p * 4]);
+			}
+
+			// Store packet
+			void setPacket(size_t const p, Packet const v) {
+				_mm_storeu_ps(&e[p * 4], v);
+			}
+#endif
+
 		private:
 			// Matrix data
-			T* e;
+			T e[Layout::size];
 		};
 
 		// Column vector specialization
 		template <typename T, size_t ROWS>
 		class MatrixStorage<T, ROWS, 1> {
+		private:
+			// Storage layout
+			typedef PacketTraits<T, ROWS, 1> Layout;
+
 		public:
 			// Constructors
 			explicit MatrixStorage() {
-				e = new T[ROWS];
-
 				// Set all values to zero
-				for (size_t i = 0; i < ROWS; i++) {
+				for (size_t i = 0; i < Layout::size; i++) {
 					e[i] = T(0);
 				}
 			}
@@ -156,8 +123,10 @@ namespace pb {
 #ifdef _DEBUG
 				assert(args.size() == ROWS);
 #endif
-				// Allocate memory
-				e = new T[ROWS];
+				// Set padding to zero
+				for (size_t i = 0; i < Layout::size; i++) {
+					e[i] = T(0);
+				}
 
 				size_t row = 0;
 				for (auto elem_it = args.begin(); elem_it != args.end(); elem_it++) {
@@ -166,57 +135,6 @@ namespace pb {
 				}
 			}
 
-			// Destructor
-			~MatrixStorage() {
-				delete[] e;
-			}
-
-			// Copy constructor
-			MatrixStorage(MatrixStorage const & orig) {
-				// Allocate memory
-				e = new T[ROWS];
-
-				for (size_t r = 0; r < ROWS; r++) {
-					e[r] = orig.e[r];
-				}
-			}
-
-			// Move constructor
-			MatrixStorage(MatrixStorage && src) {
-				// Set pointer to src memory
-				e = src.e;
-
-				// Set src memory pointer to null
-				src.e = nullptr;
-			}
-
-			// Assignment operator
-			MatrixStorage & operator= (MatrixStorage const & other) {
-				if (&other != this) {
-					for (size_t r = 0; r < ROWS; r++) {
-						e[r] = other.e[r];
-					}
-				}
-
-				return (*this);
-			}
-
-			// Move assignment operator
-			MatrixStorage& operator= (MatrixStorage && rhs) {
-				if (&rhs != this) {
-					// Free memory for this matrix
-					delete[] e;
-
-					// Set pointer to src memory
-					e = rhs.e;
-
-					// Set rhs memory pointer to null
-					rhs.e = nullptr;
-				}
-
-				return (*this);
-			}
-
 			// Index operator
 			T operator() (size_t const row, size_t const) const {
 #ifdef _DEBUG
@@ -234,9 +152,21 @@ namespace pb {
 				return e[row];
 			}
 
+#ifdef PB_MATRIX_PACKETS
+			// Load the vector as a packet
+			Packet packet(size_t const) const {
+				return _mm_loadu_ps(e);
+			}
+
+			// Store packet
+			void setPacket(size_t const, Packet const v) {
+				_mm_storeu_ps(e, v);
+			}
+#endif
+
 		private:
-			// Matrix data
-			T* e;
+			// Vector data
+			T e[Layout::size];
 		};
 
 	} // math namespace
@@ -0,0 +1,43 @@
+#pragma once
+
+// Includes
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace pb {
+
+	// Run f(i) for every i in [begin, end) on all the hardware threads. The range is split in
+	// contiguous blocks of at least min_block indices, one per thread, the calling thread works
+	// on the first block. Iterations must be independent
+	template <typename FUNCTION>
+	void parallelFor(size_t const begin, size_t const end, size_t const min_block, FUNCTION const & f) {
+		if (end <= begin) {
+			return;
+		}
+		size_t const count = end - begin;
+		size_t const hardware_threads = std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+		size_t const num_blocks = std::min(hardware_threads, std::max(count / std::max(min_block, static_cast<size_t>(1)), static_cast<size_t>(1)));
+		size_t const block = (count + num_blocks - 1) / num_blocks;
+
+		// Run a block of indices
+		auto const run = [&f, begin, end, block](size_t const b) {
+			size_t const block_end = std::min(begin + (b + 1) * block, end);
+			for (size_t i = begin + b * block; i < block_end; i++) {
+				f(i);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(num_blocks - 1);
+		for (size_t b = 1; b < num_blocks; b++) {
+			threads.push_back(std::thread(run, b));
+		}
+		run(0);
+		for (auto thread = threads.begin(); thread != threads.end(); thread++) {
+			thread->join();
+		}
+	}
+
+} // pb namespace
\ No newline at end of file
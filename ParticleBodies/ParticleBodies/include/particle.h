@@ -1,31 +1,58 @@
 #pragma once
 
-#include "matrix_include.h"
+#include "simd.h"
+#include <cstdint>
 
 namespace pb {
 
-	// Define particle class
+	// Define particle class, the position of the particle is not stored explicitly but as the
+	// integer voxel coordinates of the particle in the discretisation grid of his body
 	class Particle {
 	public:
 		// Constructor
-		Particle(pb::math::vec3f const & p, float const radius);
+		Particle(std::int16_t const i, std::int16_t const j, std::int16_t const k);
 
 		// Add force to particle
-		void addForce(pb::math::vec3f const & f);
+		void addForce(pb::math::vec3c const & f);
 
 		// Reset particle forces
 		void resetForce();
 
+		// Get voxel coordinates of the particle
+		std::int16_t const * getVoxel() const {
+			return voxel;
+		}
+
 		// Friend declaration
 		friend class BodyParticlesDiscretisation;
 
 	protected:
-		// Particle position
-		pb::math::vec3f position;
-		// Particle radius
-		float const radius;
+		// Voxel coordinates of the particle, the last entry is padding so that the
+		// coordinates can be loaded as a single 64 bit word
+		std::int16_t voxel[4];
 		// Particle sum of forces
-		pb::math::vec3f force;
+		contact_real force[3];
 	};
 
+	// Decode the voxel coordinates of the particle into the position in body space
+	// as origin + spacing * voxel
+	inline void decodeParticleOffset(std::int16_t const voxel[4], contact_real const origin[3],
+									 contact_real const spacing, contact_real offset[3]) {
+		offset[0] = origin[0] + spacing * static_cast<contact_real>(voxel[0]);
+		offset[1] = origin[1] + spacing * static_cast<contact_real>(voxel[1]);
+		offset[2] = origin[2] + spacing * static_cast<contact_real>(voxel[2]);
+	}
+
+#ifdef PB_SIMD_SSE
+	// Decode the voxel coordinates directly into a SIMD register, lane 3 is undefined
+	inline __m128 decodeParticleOffset(std::int16_t const voxel[4], __m128 const origin, __m128 const spacing) {
+		// Load the four 16 bit coordinates
+		__m128i const v16 = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(voxel));
+		// Sign extend to 32 bit
+		__m128i const v32 = _mm_srai_epi32(_mm_unpacklo_epi16(v16, v16), 16);
+		// Convert to float and scale
+		return (_mm_add_ps(origin, _mm_mul_ps(spacing, _mm_cvtepi32_ps(v32))));
+	}
+#endif
+
 } // pb namespace
\ No newline at end of file
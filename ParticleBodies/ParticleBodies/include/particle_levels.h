@@ -0,0 +1,62 @@
+#pragma once
+
+// Includes
+#include "particle.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Define hierarchy of coarser discretisations of the particles of a body, built once in body
+	// space. Level k groups the particles by the cells of side 2^k spacings of their lattice, every
+	// cell is a coarse particle at its center holding the cells of the level below inside it, so
+	// the levels nest exactly without sampling the shape again. Levels are added until the coarsest
+	// one has at most ROOT_CELLS cells. A coarse particle bounds the particles below it, a contact
+	// check can start at the coarsest level and refine only the cells that overlap the other body
+	class ParticleLevels {
+	public:
+		// Maximum number of cells of the coarsest level
+		static size_t const ROOT_CELLS = 8;
+
+		// Cell of a level
+		struct Cell {
+			// Center in body space
+			contact_real center[3];
+			// Range of the cells of the level below, or of the particle order for the first level
+			std::uint32_t begin;
+			std::uint32_t end;
+		};
+
+		// Build the levels of the particles decoded as origin + spacing * voxel, all of given radius
+		void build(Particle const * const particles, size_t const num_particles,
+				   contact_real const origin[3], contact_real const spacing, contact_real const particle_radius);
+
+		// Check if there are no levels, the body has no particles
+		bool empty() const;
+
+		// Get number of levels above the particles
+		size_t getNumLevels() const;
+
+		// Get cells of a level, from 1 just above the particles to getNumLevels
+		std::vector<Cell> const & getCells(size_t const level) const;
+
+		// Get radius of the spheres around the cells of a level enclosing their particles
+		contact_real getCellRadius(size_t const level) const;
+
+		// Get particles in the order of the cells of the first level
+		std::uint32_t const * getOrder() const;
+
+	private:
+		// Cells of a level and radius of their spheres
+		struct Level {
+			std::vector<Cell> cells;
+			contact_real radius;
+		};
+
+		// Levels from the finest one and particle order
+		std::vector<Level> levels;
+		std::vector<std::uint32_t> order;
+	};
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+// Includes
+#include "particle.h"
+#include <vector>
+
+namespace pb {
+
+	// Pose and velocity of a body converted to contact precision, input of the transform kernels
+	struct BodyTransform {
+		// Orientation matrix, row major
+		contact_real R[9];
+		// Center of mass
+		contact_real x[3];
+		// Linear velocity
+		contact_real v[3];
+		// Angular velocity
+		contact_real omega[3];
+	};
+
+	// World space position and velocity of the particles of a body, stored as structure of arrays
+	struct ParticleWorldBuffer {
+		// Resize all the arrays
+		void resize(size_t const num_particles);
+
+		// Free the memory of all the arrays
+		void release();
+
+		// Get number of bytes held by the arrays
+		size_t getNumBytes() const;
+
+		// Positions
+		std::vector<contact_real> px, py, pz;
+		// Velocities
+		std::vector<contact_real> vx, vy, vz;
+	};
+
+	// Compute world position x + R * r and, if requested, world velocity v + omega x (R * r) for all
+	// the particles of a body, the local offsets r are decoded from the quantised particles.
+	// The buffer must already have the size of the particles array
+	void transformParticlesScalar(BodyTransform const & transform,
+								  Particle const * particles, size_t const num_particles,
+								  contact_real const origin[3], contact_real const spacing,
+								  ParticleWorldBuffer & world, bool const velocities);
+
+#ifdef PB_SIMD_SSE
+	// SSE2 version, processes four particles per iteration
+	void transformParticlesSSE(BodyTransform const & transform,
+							   Particle const * particles, size_t const num_particles,
+							   contact_real const origin[3], contact_real const spacing,
+							   ParticleWorldBuffer & world, bool const velocities);
+#endif
+
+#ifdef PB_SIMD_AVX2
+	// AVX2 version, processes eight particles per iteration
+	void transformParticlesAVX2(BodyTransform const & transform,
+								Particle const * particles, size_t const num_particles,
+								contact_real const origin[3], contact_real const spacing,
+								ParticleWorldBuffer & world, bool const velocities);
+#endif
+
+	// Use the widest kernel available in the build
+	inline void transformParticles(BodyTransform const & transform,
+								   Particle const * particles, size_t const num_particles,
+								   contact_real const origin[3], contact_real const spacing,
+								   ParticleWorldBuffer & world, bool const velocities) {
+#if defined(PB_SIMD_AVX2)
+		transformParticlesAVX2(transform, particles, num_particles, origin, spacing, world, velocities);
+#elif defined(PB_SIMD_SSE)
+		transformParticlesSSE(transform, particles, num_particles, origin, spacing, world, velocities);
+#else
+		transformParticlesScalar(transform, particles, num_particles, origin, spacing, world, velocities);
+#endif
+	}
+
+} // pb namespace
\ No newline at end of file
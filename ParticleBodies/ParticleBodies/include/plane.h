@@ -0,0 +1,56 @@
+#pragma once
+
+// Includes
+#include "body.h"
+
+namespace pb {
+
+	// Bounded plane, a thin box centered on the body whose top face, at half the thickness along
+	// the body y axis, is the plane. Used as ground or walls, usually static
+	class Plane : public Body {
+	public:
+		// Constructor
+		Plane();
+
+		Plane(math::vec3r const & cm, real const mass,
+			  math::quaternionr const & orientation, real const half_width, real const half_depth,
+			  real const half_thickness, BodyStateStore * const store = nullptr);
+
+		// Generate BBOX of the object
+		void generateBBOX(math::vec3r * min, math::vec3r * max) const override;
+
+		// Check if voxel is inside the body
+		bool pointInside(math::vec3r const & p) const override;
+
+		// Distance to the box
+		bool signedDistance(math::vec3r const & p, real & distance) const override;
+
+		// Get the shape of the body
+		ShapeType getShapeType() const override;
+
+		// Get the parameters of the plane, the half extents along x, z and y
+		void getShapeParameters(real parameters[MAX_SHAPE_PARAMETERS]) const override;
+
+		// Get half extents of the box along the body axes
+		math::vec3r getHalfExtents() const;
+
+	private:
+		// Preprocessing needed for drawing
+		void drawPreprocess() const override;
+
+		// Postprocessing after drawing
+		void drawPostprocess() const override;
+
+		// Draw the box the plane collides as instead of the sphere mesh
+		void drawShape(GLuint const num_elements) const override;
+
+		// Compute inertia tensor of the body
+		void computeInertiaTensor() override;
+
+		// Half extents along the body x, y and z axes
+		real const half_width;
+		real const half_thickness;
+		real const half_depth;
+	};
+
+} // pb namespace
\ No newline at end of file
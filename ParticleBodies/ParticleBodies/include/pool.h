@@ -0,0 +1,89 @@
+#pragma once
+
+// Includes
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace pb {
+
+	// Define class that allocates objects of one type from chunks of contiguous slots. Freed slots
+	// are kept in a list and reused first, so creating and destroying objects in any order costs
+	// O(1), never fragments the heap and keeps the objects packed in the chunks. The objects do
+	// not move, pointers to them stay valid until they are destroyed
+	template <typename T, size_t CHUNK_SIZE = 256>
+	class Pool {
+	public:
+		// Constructor
+		Pool()
+			: free_list(nullptr), live(0) {}
+
+		// Destructor frees the chunks, the owner must destroy the objects still alive
+		~Pool() {
+#ifdef _DEBUG
+			assert(live == 0);
+#endif
+		}
+
+		// The pool owns its chunks, it can not be copied
+		Pool(Pool const &) = delete;
+		Pool & operator=(Pool const &) = delete;
+
+		// Create an object in a free slot
+		template <typename... ARGS>
+		T * create(ARGS &&... args) {
+			if (free_list == nullptr) {
+				grow();
+			}
+			Slot * const slot = free_list;
+			free_list = slot->next;
+			T * const object = new (&slot->storage) T(std::forward<ARGS>(args)...);
+			live++;
+
+			return object;
+		}
+
+		// Destroy an object and release its slot
+		void destroy(T * const object) {
+			object->~T();
+			Slot * const slot = reinterpret_cast<Slot *>(object);
+			slot->next = free_list;
+			free_list = slot;
+			live--;
+		}
+
+		// Number of objects alive
+		size_t size() const {
+			return live;
+		}
+
+	private:
+		// Slot holding an object or the link to the next free slot
+		union Slot {
+			Slot * next;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+		};
+
+		// Add a chunk of free slots, the first slot of the chunk is used first
+		void grow() {
+			chunks.push_back(std::unique_ptr<Slot[]>(new Slot[CHUNK_SIZE]));
+			Slot * const chunk = chunks.back().get();
+			for (size_t s = CHUNK_SIZE; s > 0; s--) {
+				chunk[s - 1].next = free_list;
+				free_list = &chunk[s - 1];
+			}
+		}
+
+		// Chunks of slots
+		std::vector<std::unique_ptr<Slot[]> > chunks;
+		// First free slot
+		Slot * free_list;
+		// Number of objects alive
+		size_t live;
+	};
+
+} // pb namespace
\ No newline at end of file
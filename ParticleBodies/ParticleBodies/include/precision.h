@@ -0,0 +1,64 @@
+#pragma once
+
+// Includes
+#include "matrix_include.h"
+#include "quaternion.h"
+
+// The precision of the simulation core is selected at build time by defining one of
+//	PB_PRECISION_FLOAT	: float state, float contact kernels (default)
+//	PB_PRECISION_DOUBLE	: double state, double contact kernels
+//	PB_PRECISION_MIXED	: double state, float contact kernels
+// The project sets it from the PbPrecision property, e.g. msbuild /p:PbPrecision=Double, and
+// builds the non float policies in their own output directories
+#if (defined(PB_PRECISION_FLOAT) + defined(PB_PRECISION_DOUBLE) + defined(PB_PRECISION_MIXED)) > 1
+#error "Only one of PB_PRECISION_FLOAT, PB_PRECISION_DOUBLE, PB_PRECISION_MIXED can be defined"
+#endif
+
+namespace pb {
+
+	// Precision policy, defines the scalar used to accumulate the bodies state and
+	// the scalar used by the particle contact kernels
+	template <typename STATE, typename CONTACT>
+	struct PrecisionPolicy {
+		typedef STATE StateType;
+		typedef CONTACT ContactType;
+	};
+
+	// Available policies
+	typedef PrecisionPolicy<float, float> FloatPrecision;
+	typedef PrecisionPolicy<double, double> DoublePrecision;
+	typedef PrecisionPolicy<double, float> MixedPrecision;
+
+	// Select policy
+#if defined(PB_PRECISION_DOUBLE)
+	typedef DoublePrecision Precision;
+#define PB_PRECISION_NAME "double"
+#elif defined(PB_PRECISION_MIXED)
+	typedef MixedPrecision Precision;
+#define PB_PRECISION_NAME "mixed"
+#define PB_CONTACT_FLOAT 1
+#else
+	typedef FloatPrecision Precision;
+#define PB_PRECISION_NAME "float"
+#define PB_CONTACT_FLOAT 1
+#endif
+
+	// Scalar used for the state of the bodies
+	typedef Precision::StateType real;
+	// Scalar used for the particle contact kernels
+	typedef Precision::ContactType contact_real;
+
+	namespace math {
+
+		// State precision types
+		typedef Matrix<real, 4, 4> mat4x4r;
+		typedef Matrix<real, 3, 3> mat3x3r;
+		typedef Matrix<real, 4, 1> vec4r;
+		typedef Matrix<real, 3, 1> vec3r;
+		typedef Quaternion<real> quaternionr;
+
+		// Contact precision types
+		typedef Matrix<contact_real, 3, 1> vec3c;
+
+	} // math namespace
+} // pb namespace
\ No newline at end of file
@@ -59,6 +59,9 @@ namespace pb {
 			Quaternion(Quaternion const & other)
 				: real(other.real), immaginary(other.immaginary) {}
 
+			// Assignment, declared since the copy constructor is
+			Quaternion & operator=(Quaternion const & other) = default;
+
 			// Quaternion product
 			Quaternion operator*(Quaternion const & other) const {
 				Quaternion result;
@@ -115,29 +118,29 @@ namespace pb {
 			}
 
 			// Friend functions
-			template <typename T>
-			friend T magnitude(Quaternion<T> const & q);
+			template <typename U>
+			friend U magnitude(Quaternion<U> const & q);
 
-			template <typename T>
-			friend T extractAngle(Quaternion<T> const & q);
+			template <typename U>
+			friend U extractAngle(Quaternion<U> const & q);
 
-			template <typename T>
-			friend Matrix<T, 3, 1> extractAxis(Quaternion<T> const & q);
+			template <typename U>
+			friend Matrix<U, 3, 1> extractAxis(Quaternion<U> const & q);
 
-			template <typename T>
-			friend Matrix<T, 4, 4> createRotationMatrix(Quaternion<T> const & q);
+			template <typename U>
+			friend Matrix<U, 4, 4> createRotationMatrix(Quaternion<U> const & q);
 
-			template <typename T>
-			friend Matrix<T, 3, 3> createMatrix(Quaternion<T> const & q);
+			template <typename U>
+			friend Matrix<U, 3, 3> createMatrix(Quaternion<U> const & q);
 
-			template <typename T>
-			friend Quaternion<T> normalize(Quaternion<T> const & q);
+			template <typename U>
+			friend Quaternion<U> normalize(Quaternion<U> const & q);
 
-			template <typename T>
-			friend Quaternion<T> conjugate(Quaternion<T> const & q);
+			template <typename U>
+			friend Quaternion<U> conjugate(Quaternion<U> const & q);
 
-			template <typename T>
-			friend Matrix<T, 3, 1> transformVectorByQuaternion(Quaternion<T> const & q, Matrix<T, 3, 1> const & v);
+			template <typename U>
+			friend Matrix<U, 3, 1> transformVectorByQuaternion(Quaternion<U> const & q, Matrix<U, 3, 1> const & v);
 
 		private:
 			// Real part
@@ -234,8 +237,8 @@ namespace pb {
 		// Create Quaternion from angle and axis
 		template <typename T>
 		Quaternion<T> quaternionFromAngleAxis(T const & angle, Matrix<T, 3, 1> const & axis) {
-			return Quaternion<T>(static_cast<float>(cos(degToRad(angle / 2.0))),
-								 static_cast<float>(sin(degToRad(angle / 2.0))) * axis);
+			return Quaternion<T>(static_cast<T>(cos(degToRad(angle / 2.0))),
+								 static_cast<T>(sin(degToRad(angle / 2.0))) * axis);
 		}
 
 		template <typename T>
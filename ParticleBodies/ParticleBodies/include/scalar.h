@@ -1,5 +1,7 @@
 #pragma once
 
+#include "matrix_packet.h"
+
 namespace pb {
 	namespace math {
 
@@ -7,7 +9,7 @@ namespace pb {
 		class Scalar {
 		private:
 			// Value of the scalar
-			T const & s;
+			T const s;
 
 		public:
 			// Constructor
@@ -22,7 +24,14 @@ namespace pb {
 			T operator() (size_t const, size_t const) const {
 				return (s);
 			}
+
+#ifdef PB_MATRIX_PACKETS
+			// Broadcast scalar to packet
+			Packet packet(size_t const) const {
+				return (_mm_set1_ps(s));
+			}
+#endif
 		};
 
 	} // math namespace
-} // pb namespace
+} // pb namespace
\ No newline at end of file
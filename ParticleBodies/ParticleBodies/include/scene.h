@@ -0,0 +1,48 @@
+#pragma once
+
+// Includes
+#include "arena.h"
+#include "system.h"
+#include <memory>
+
+namespace pb {
+
+	// Scene file layout, a JSON document
+	//
+	// {
+	//   "time": 0, "time_step": 0.0333, "analytic_contacts": false,
+	//   "materials": { "<name>": { "density": 1 } },
+	//   "bodies": [ { <body> } ],
+	//   "generators": [
+	//     { "type": "grid", "count": [nx, ny, nz], "origin": [x, y, z], "spacing": [x, y, z], <body> },
+	//     { "type": "random", "count": n, "min": [x, y, z], "max": [x, y, z],
+	//       "min_radius": r, "max_radius": r, "seed": s, "random_orientation": true, <body> }
+	//   ]
+	// }
+	//
+	// A <body> has "shape" ("sphere" or "plane"), "radius" of a sphere or "half_extents" along the
+	// body axes of a plane, whose top face is the plane, "position", "orientation" (quaternion, real
+	// part first), "velocity", "particle_diameter", "static" and the mass given either as "mass",
+	// "density" or "material". Missing members take the defaults of the hard coded scenes. Bodies
+	// placed by the random generator are spheres and do not overlap each other. The pairs of shapes
+	// with a closed form are checked analytically if "analytic_contacts" is set
+	//
+	// Bodies, discretisations and system created from a scene, owned by this structure
+	struct LoadedScene {
+		Arena arena;
+		std::unique_ptr<System> system;
+	};
+
+	// Define class that creates a system from a scene file. The storage of the system is reserved
+	// up front, bodies and discretisations are allocated from an arena, identical shapes are
+	// discretised once and the discretisation runs on all the hardware threads
+	class SceneLoader {
+	public:
+		// Load a scene file, return false and print the reason if it is invalid
+		static bool load(char const * const path, LoadedScene * const scene);
+
+		// Load a scene from a JSON document in memory
+		static bool parse(char const * const text, size_t const size, LoadedScene * const scene);
+	};
+
+} // pb namespace
\ No newline at end of file
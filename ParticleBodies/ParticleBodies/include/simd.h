@@ -0,0 +1,18 @@
+#pragma once
+
+// Includes
+#include "precision.h"
+
+// SIMD kernels are only used when the contact kernels run in single precision
+// PB_SIMD_SSE	: SSE2 is available (always true on x64)
+// PB_SIMD_AVX2	: AVX2 is available (/arch:AVX2 or -mavx2)
+#if defined(PB_CONTACT_FLOAT) && !defined(PB_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PB_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+#if defined(PB_SIMD_SSE) && defined(__AVX2__)
+#define PB_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
\ No newline at end of file
@@ -10,14 +10,24 @@ namespace pb {
 		// Constructor
 		Sphere();
 
-		Sphere(math::vec3f const & cm, float const mass,
-			   math::quaternionf const & orientation, float const radius);
+		Sphere(math::vec3r const & cm, real const mass,
+			   math::quaternionr const & orientation, real const radius,
+			   BodyStateStore * const store = nullptr);
 
 		// Generate BBOX of the object
-		void generateBBOX(math::vec3f * min, math::vec3f * max) const override;
+		void generateBBOX(math::vec3r * min, math::vec3r * max) const override;
 
 		// Check if voxel is inside the body
-		bool pointInside(math::vec3f const & p) const override;
+		bool pointInside(math::vec3r const & p) const override;
+
+		// Distance to the center minus the radius
+		bool signedDistance(math::vec3r const & p, real & distance) const override;
+
+		// Get the shape of the body
+		ShapeType getShapeType() const override;
+
+		// Get the parameters of the sphere, the radius
+		void getShapeParameters(real parameters[MAX_SHAPE_PARAMETERS]) const override;
 
 	private:
 		// Preprocessing needed for drawing
@@ -30,7 +40,7 @@ namespace pb {
 		void computeInertiaTensor() override;
 
 		// Sphere radius
-		float const radius;
+		real const radius;
 	};
 
 } // pb namespace
\ No newline at end of file
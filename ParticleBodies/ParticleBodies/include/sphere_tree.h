@@ -0,0 +1,58 @@
+#pragma once
+
+// Includes
+#include "particle.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Define bounding sphere hierarchy over the particles of a body, built once in body space. The
+	// particles are split top down at the median of the longest axis of their box until a leaf has
+	// at most LEAF_SIZE of them, every node holds a sphere enclosing the particle spheres below it.
+	// A rigid motion moves the spheres without changing their radius, so the tree of two bodies can
+	// be traversed in world space from their pose alone
+	class ParticleSphereTree {
+	public:
+		// Maximum number of particles of a leaf
+		static size_t const LEAF_SIZE = 8;
+
+		// Node of the tree
+		struct Node {
+			// Center in body space and radius of the sphere
+			contact_real center[3];
+			contact_real radius;
+			// Range of the node in the particle order
+			std::uint32_t begin;
+			std::uint32_t end;
+			// Children, zero for a leaf since the root is never a child
+			std::uint32_t left;
+			std::uint32_t right;
+		};
+
+		// Build the tree of the particles decoded as origin + spacing * voxel, all of given radius
+		void build(Particle const * const particles, size_t const num_particles,
+				   contact_real const origin[3], contact_real const spacing, contact_real const particle_radius);
+
+		// Check if the tree has no nodes
+		bool empty() const;
+
+		// Get nodes, the root is the first one
+		std::vector<Node> const & getNodes() const;
+
+		// Get particles in the order of the leaves
+		std::uint32_t const * getOrder() const;
+
+	private:
+		// Build the subtree of the particles in [begin, end) of the order, return its node
+		std::uint32_t buildNode(std::uint32_t const begin, std::uint32_t const end, contact_real const particle_radius);
+
+		// Nodes and particle order
+		std::vector<Node> nodes;
+		std::vector<std::uint32_t> order;
+		// Body space positions of the particles, only used by the build
+		std::vector<contact_real> positions;
+	};
+
+} // pb namespace
\ No newline at end of file
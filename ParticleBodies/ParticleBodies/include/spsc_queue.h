@@ -0,0 +1,64 @@
+#pragma once
+
+// Includes
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace pb {
+
+	// Define bounded lock free queue with a single producer and a single consumer thread. One
+	// slot is kept empty to tell a full queue from an empty one
+	template <typename T>
+	class SPSCQueue {
+	public:
+		// Constructor, the queue can hold up to capacity elements
+		explicit SPSCQueue(size_t const capacity)
+			: slots(capacity + 1), head(0), tail(0) {}
+
+		// The queue can not be copied
+		SPSCQueue(SPSCQueue const &) = delete;
+		SPSCQueue & operator=(SPSCQueue const &) = delete;
+
+		// Push an element, called only by the producer. Return false if the queue is full
+		bool push(T const & value) {
+			size_t const t = tail.load(std::memory_order_relaxed);
+			size_t const next = (t + 1) % slots.size();
+			if (next == head.load(std::memory_order_acquire)) {
+				return false;
+			}
+			slots[t] = value;
+			tail.store(next, std::memory_order_release);
+
+			return true;
+		}
+
+		// Pop an element, called only by the consumer. Return false if the queue is empty
+		bool pop(T & value) {
+			size_t const h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire)) {
+				return false;
+			}
+			value = slots[h];
+			head.store((h + 1) % slots.size(), std::memory_order_release);
+
+			return true;
+		}
+
+		// Check if the queue is empty, only exact when called by the consumer
+		bool empty() const {
+			return (head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire));
+		}
+
+	private:
+		// Elements
+		std::vector<T> slots;
+		// Index of the next element to pop, written by the consumer
+		std::atomic<size_t> head;
+		// Keep the two indices on different cache lines
+		char padding[64];
+		// Index of the next free slot, written by the producer
+		std::atomic<size_t> tail;
+	};
+
+} // pb namespace
\ No newline at end of file
@@ -1,35 +1,416 @@
 #pragma once
 
 // Includes
+#include "body.h"
 #include "body_particles.h"
+#include "body_state_store.h"
+#include "concurrent_queue.h"
+#include "contact_cache.h"
+#include "contact_colouring.h"
+#include "contact_islands.h"
+#include "contact_stages.h"
+#include "hash_grid.h"
+#include "implicit_solver.h"
+#include "impulse_solver.h"
+#include "plane.h"
+#include "pool.h"
+#include "sphere.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 
 namespace pb {
 
+	// Handle to a body of a system. It stays valid while the body is in the system, once the body
+	// is removed the handle is stale even if its slot is reused
+	struct BodyHandle {
+		std::uint32_t slot;
+		std::uint32_t generation;
+	};
+
+	// Statistics of the last step of a system
+	struct StepStatistics {
+		// Number of bodies, of pairs of bodies with overlapping boxes and of pairs in contact
+		size_t num_bodies;
+		size_t num_pairs;
+		size_t num_contacts;
+		// Number of contacts between particles and how many of them existed in the previous step
+		size_t num_particle_contacts;
+		size_t num_persistent_contacts;
+		// Number of particles that got a contact force, the only ones whose force is transferred
+		size_t num_active_particles;
+		// Number of islands and of tasks they were packed in
+		size_t num_islands;
+		size_t num_tasks;
+		// Number of islands split in colour batches and total number of batches
+		size_t num_coloured_islands;
+		size_t num_colour_batches;
+		// Conjugate gradient iterations or impulse sweeps of the velocity solvers of all the islands
+		size_t num_solver_iterations;
+		// Fraction of the threads busy during the colour batches, 1 if there are none
+		double colour_efficiency;
+		// Duration of the step in seconds
+		double step_time;
+	};
+
 	// Define class that olds the object running in the simulation
 	class System {
 	public:
+		// Components of the state overridden by a command
+		enum StateField {
+			FIELD_POSITION = 1,
+			FIELD_ORIENTATION = 2,
+			FIELD_LINEAR_VELOCITY = 4,
+			FIELD_ANGULAR_VELOCITY = 8
+		};
+
+		// Integration of the bodies. The explicit Euler step applies the contact forces of the
+		// start of the step, stiff contacts need a small step to stay stable. The linearly implicit
+		// step solves for the velocities at the end of the step with the contact springs and
+		// dampers linearised, so it stays stable with much larger steps and stiffer materials. The
+		// contact impulses step replaces the springs by non-penetration constraints solved for
+		// impulses, rigid contacts at the rate of a frame
+		enum IntegrationMode {
+			INTEGRATION_EXPLICIT_EULER = 0,
+			INTEGRATION_LINEARLY_IMPLICIT_EULER,
+			INTEGRATION_CONTACT_IMPULSES
+		};
+
+		// Search of the pairs of bodies whose boxes overlap. Sweep and prune sorts the boxes along
+		// x, a few large bodies spanning the scene make it check most pairs. The hierarchical hash
+		// grid buckets the bounding sphere of every box at the level of its size, bodies of very
+		// different sizes only meet at the level of the larger one. Both find the same pairs
+		enum BroadPhase {
+			BROAD_PHASE_SWEEP_AND_PRUNE = 0,
+			BROAD_PHASE_HASH_GRID
+		};
+
 		// Constructor
-		System(float const t0, float const dt);
+		System(real const t0, real const dt);
+
+		// Destructor destroys the bodies owned by the system
+		~System();
+
+		// The bodies point to the store of the system, it can not be copied
+		System(System const &) = delete;
+		System & operator=(System const &) = delete;
+
+		// Create a body owned by the system and its discretisation, objects of the same shape are
+		// allocated from the same pool. Return a handle with generation 0 if the type is unknown
+		BodyHandle createBody(ShapeType const type, real const parameters[Body::MAX_SHAPE_PARAMETERS],
+							  math::vec3r const & cm, real const mass, math::quaternionr const & orientation,
+							  real const particle_diameter);
+
+		// Add body owned by the caller to the system, the state of the body is moved to the system store
+		BodyHandle addBody(BodyParticlesDiscretisation * body);
+
+		// Reserve storage for a number of bodies, bodies created directly in the store of the
+		// system do not move their state when added
+		void reserve(size_t const num_bodies);
+
+		// Add many bodies owned by the caller at once, the set of bodies changes once
+		void addBodies(BodyParticlesDiscretisation * const * const new_bodies, size_t const count);
+
+		// Remove a body in O(1), the last body takes its index. Bodies owned by the system are
+		// destroyed, the other ones get back their state. Return false if the handle is stale
+		bool removeBody(BodyHandle const handle);
+
+		// Queue the creation of a body owned by the system, it is added at the start of the next
+		// step. The shape is discretised on the calling thread, the returned handle becomes valid
+		// when the command is applied. Return a handle with generation 0 if the type is unknown or
+		// the queue is full. These functions can be called from any thread
+		BodyHandle enqueueCreateBody(ShapeType const type, real const parameters[Body::MAX_SHAPE_PARAMETERS],
+									 math::vec3r const & cm, real const mass, math::quaternionr const & orientation,
+									 real const particle_diameter);
+
+		// Queue the removal of a body, return false if the queue is full
+		bool enqueueRemoveBody(BodyHandle const handle);
+
+		// Queue a linear impulse applied at a point in world space, return false if the queue is full
+		bool enqueueApplyImpulse(BodyHandle const handle, math::vec3r const & impulse, math::vec3r const & point);
+
+		// Queue an override of the components of the state selected by a combination of StateField
+		// values, the velocities set the momenta. Return false if the queue is full
+		bool enqueueSetState(BodyHandle const handle, unsigned int const fields,
+							 math::vec3r const & x, math::quaternionr const & q,
+							 math::vec3r const & v, math::vec3r const & omega);
 
-		// Add body to the system
-		void addBody(BodyParticlesDiscretisation * body);
+		// Apply the queued commands in the order they were queued, commands on stale handles are
+		// dropped. Called at the start of computeStep
+		void applyCommands();
 
-		// Compute forces and torque of the system
-		void computeForceAndTorque(float const time) const;
+		// Check if a handle refers to a body of the system
+		bool isValid(BodyHandle const handle) const;
 
-		// Compute one step of the system
+		// Get body of a handle, nullptr if the handle is stale
+		BodyParticlesDiscretisation * getBody(BodyHandle const handle) const;
+
+		// Get handle of the body at an index of getBodies()
+		BodyHandle getHandle(size_t const index) const;
+
+		// Compute forces and torque of all the bodies from the current state, the bodies do not
+		// move and the contact history is left for the next step
+		void computeForceAndTorque();
+
+		// Compute one step of the system. The bodies are split in contact islands, the forces and
+		// the integration of every island run as a task of the thread pool
 		void computeStep();
 
+		// Set number of threads used by the steps, zero uses all the hardware threads
+		void setNumThreads(size_t const num_threads);
+
+		// Get number of threads used by the steps
+		size_t getNumThreads() const;
+
+		// Get the islands of the last step
+		ContactIslands const & getIslands() const;
+
+		// Get statistics of the last step
+		StepStatistics const & getStepStatistics() const;
+
+		// Set the detection and response stages of the contacts between particles
+		void setContactStages(ContactDetector const detector, ContactResponder const responder);
+
+		// Check the pairs of shapes with a closed form, such as two spheres or a sphere and a plane,
+		// with the analytic detection of getAnalyticContactDetector instead of the particles. The
+		// other pairs keep the detection stage. Off by default, a pair then gets one contact
+		// instead of one per pair of particles and rests at a different depth
+		void setAnalyticContacts(bool const enabled);
+
+		// Check if the pairs of shapes with a closed form are checked analytically
+		bool getAnalyticContacts() const;
+
+		// Set the integration of the steps
+		void setIntegrationMode(IntegrationMode const mode);
+
+		// Get the integration of the steps
+		IntegrationMode getIntegrationMode() const;
+
+		// Set the search of the pairs of bodies
+		void setBroadPhase(BroadPhase const phase);
+
+		// Get the search of the pairs of bodies
+		BroadPhase getBroadPhase() const;
+
+		// Set stiffness and damping of the contacts between particles
+		void setContactMaterial(ContactMaterial const & material);
+
+		// Get stiffness and damping of the contacts between particles
+		ContactMaterial const & getContactMaterial() const;
+
+		// Set sweeps, iteration count, position correction and warm starting of the contact impulses
+		void setImpulseSettings(ImpulseSettings const & settings);
+
+		// Get settings of the contact impulses
+		ImpulseSettings const & getImpulseSettings() const;
+
+		// Get the contacts of the last step, one buffer per thread
+		std::vector<ContactBuffer> const & getContactBuffers() const;
+
+		// Get the contacts between particles remembered from the last step
+		ContactCache const & getContactCache() const;
+
+		// Get current time
+		real getTime() const;
+
+		// Get time step
+		real getTimeStep() const;
+
+		// Get bodies of the system
+		std::vector<BodyParticlesDiscretisation *> const & getBodies() const;
+
+		// Get the store holding the state of all the bodies
+		BodyStateStore & getStateStore();
+		BodyStateStore const & getStateStore() const;
+
+		// Get a counter incremented every time the set of bodies changes
+		size_t getBodiesRevision() const;
+
 		// Draw system
 		void draw(GLuint const v_p, GLuint const i_p, GLuint const n_p,
 				  GLuint const v_s, GLuint const i_s, GLuint const n_s) const;
 
 	private:
-		// List of bodies stored using their particle representation
+		// Slot of a handle
+		struct BodySlot {
+			// Generation of the slot, incremented when its body is removed
+			std::uint32_t generation;
+			// Index of the body, NO_INDEX if the slot has no body
+			std::uint32_t index;
+			// The body is owned by the system
+			bool owned;
+		};
+
+		// Body discretised in body space by the thread that queued its creation
+		struct PreparedBody;
+
+		// Command queued for the next step
+		struct Command {
+			// Type of the command
+			enum Type {
+				COMMAND_CREATE_BODY = 0,
+				COMMAND_REMOVE_BODY,
+				COMMAND_APPLY_IMPULSE,
+				COMMAND_SET_STATE
+			};
+
+			Type type;
+			BodyHandle handle;
+			// Shape, parameters and mass of a created body
+			ShapeType shape;
+			real parameters[Body::MAX_SHAPE_PARAMETERS];
+			real mass;
+			PreparedBody * prepared;
+			// Fields of the state set by the command
+			unsigned int fields;
+			// Position of a created body or of the state, point of an impulse
+			math::vec3r x;
+			// Orientation of a created body or of the state
+			math::quaternionr q;
+			// Linear velocity of the state or impulse
+			math::vec3r v;
+			// Angular velocity of the state
+			math::vec3r omega;
+		};
+
+		// Take a free handle or a new slot, safe on any thread
+		BodyHandle reserveHandle();
+
+		// Give back the handle of a free slot for reuse
+		void releaseHandle(BodyHandle const handle);
+
+		// Give back a reserved handle whose command could not be queued, safe on any thread
+		void returnHandle(BodyHandle const handle);
+
+		// Push a command, return false if the queue is full
+		bool pushCommand(Command const & command);
+
+		// Apply one command
+		void applyCommand(Command & command);
+
+		// Add a body to the dense arrays and bind it to a reserved handle
+		void insertBody(BodyParticlesDiscretisation * const body, bool const owned, BodyHandle const handle);
+
+		// Destroy a body owned by the system
+		void destroyBody(BodyParticlesDiscretisation * const body);
+
+		// Update the world particles, find the pairs of bodies whose boxes overlap and build the islands
+		void buildIslands();
+
+		// Find the pairs of bodies whose boxes overlap, in any order
+		void findPairsSweepAndPrune();
+		void findPairsHashGrid();
+
+		// Get detection of a pair of bodies, the analytic one of their shapes if enabled and available
+		ContactDetector getPairDetector(std::uint32_t const first, std::uint32_t const second) const;
+
+		// Find the contacts of pairs of bodies with their history, return the number of pairs in contact
+		size_t detectPairs(BodyPair const * const pairs, size_t const count);
+
+		// Compute the contact forces of pairs of bodies, return the number of pairs in contact
+		size_t collidePairs(BodyPair const * const pairs, size_t const count);
+
+		// Add gravity and the particle forces to the bodies of a list and, if step is not zero,
+		// integrate them
+		void updateBodies(std::uint32_t const * const indices, size_t const count, real const step);
+
+		// Compute the forces of the bodies of an island and, if step is not zero, integrate them
+		void processIsland(size_t const island, real const step);
+
+		// Step the bodies of an island from its contacts with the velocity solver of the integration
+		// mode, on the pool if it is not null. Return the iterations of the solver
+		size_t solveIsland(size_t const island, ContactRange const * const ranges, size_t const num_ranges,
+						   real const step, ThreadPool * const island_pool);
+
+		// Find the contacts of an island and step its bodies with the velocity solver
+		void processSolvedIsland(size_t const island, real const step);
+
+		// Get key of a contact in the cache
+		ContactKey getContactKey(ContactBuffer const & contacts, size_t const contact) const;
+
+		// Fill the history of the contacts in [begin, end) of a buffer from the cache
+		void restoreContacts(ContactBuffer & contacts, size_t const begin, size_t const end) const;
+
+		// Store all the contacts of the step in the cache, the other cached contacts expire
+		void rememberContacts();
+
+		// Process a large island one colour batch of pairs at a time, every batch runs on all the
+		// threads. The pairs processed and the pairs the threads could have processed are summed
+		void processColouredIsland(size_t const island, real const step, double & busy, double & available);
+
+		// Find the contacts of a large island on all the threads, then step its bodies with the
+		// velocity solver
+		void processLargeSolvedIsland(size_t const island, real const step);
+
+		// Compute forces of all the islands, then integrate them by step and remember their
+		// contacts if it is not zero
+		void processIslands(real const step);
+
+		// List of bodies stored using their particle representation, body i has state index i
 		std::vector<BodyParticlesDiscretisation *> bodies;
+		// Slot of every body
+		std::vector<std::uint32_t> body_slots;
+		// Slots of the handles, only touched by the simulation thread
+		std::vector<BodySlot> slots;
+		// Number of slots handed out, the slots vector grows to it when bodies are inserted
+		std::atomic<std::uint32_t> num_slots;
+		// Handles of free slots with their next generation, and the ones that did not fit
+		ConcurrentQueue<BodyHandle> free_handles;
+		std::vector<BodyHandle> retired_handles;
+		// Reserved handles given back by other threads when the free handles were full, moved to
+		// the retired ones by the next step
+		std::mutex returned_mutex;
+		std::vector<BodyHandle> returned_handles;
+		// Commands queued by any thread for the next step
+		ConcurrentQueue<Command> commands;
+		// Pools of the bodies owned by the system, one per shape, and of their discretisations
+		Pool<Sphere> spheres;
+		Pool<Plane> planes;
+		Pool<BodyParticlesDiscretisation> discretisations;
+		// State of all the bodies
+		std::unique_ptr<BodyStateStore> states;
+		// Threads running the islands
+		std::unique_ptr<ThreadPool> pool;
+		// Static flag, flag of the bodies in a pair and number of particles of every body, pairs of
+		// overlapping bodies and islands
+		std::vector<std::uint8_t> static_bodies;
+		std::vector<std::uint8_t> paired_bodies;
+		std::vector<std::uint32_t> body_costs;
+		std::vector<std::uint32_t> sweep_order;
+		std::vector<BodyPair> contact_pairs;
+		// Search of the pairs, grid of the bounding spheres of the boxes and level of every body
+		BroadPhase broad_phase;
+		HierarchicalHashGrid body_grid;
+		std::vector<std::int32_t> body_levels;
+		ContactIslands islands;
+		// Colour batches of the large islands
+		ContactColouring colouring;
+		// Contact stages and the contacts found by every thread
+		ContactDetector contact_detector;
+		ContactResponder contact_responder;
+		// Analytic detection of the pairs of shapes with a closed form
+		bool analytic_contacts;
+		std::vector<ContactBuffer> contact_buffers;
+		ContactCache contact_cache;
+		ContactMaterial contact_material;
+		// Integration of the steps and velocity solvers of every thread
+		IntegrationMode integration_mode;
+		ImpulseSettings impulse_settings;
+		std::vector<ImplicitContactSolver> implicit_solvers;
+		std::vector<ImpulseContactSolver> impulse_solvers;
+		std::vector<ContactRange> island_ranges;
+		// Statistics of the last step, the contacts are counted by all the tasks
+		StepStatistics statistics;
+		std::atomic<size_t> num_contacts;
+		std::atomic<size_t> num_active_particles;
+		std::atomic<size_t> num_solver_iterations;
+		// Revision of the set of bodies
+		size_t bodies_revision;
 		// Current time of the system
-		float t;
+		real t;
 		// Step for the simulation
-		float delta_t;
+		real delta_t;
 	};
 } // pb namespace
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+// Includes
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pb {
+
+	// Define pool of worker threads running batches of independent tasks. The tasks of a batch are
+	// dealt to one deque per thread, every thread takes tasks from the back of its own deque and,
+	// once it is empty, steals from the front of the deques of the other threads, so a few long
+	// tasks do not leave the other threads idle. The thread calling run works as well
+	class ThreadPool {
+	public:
+		// Constructor, zero threads uses all the hardware threads
+		explicit ThreadPool(size_t const num_threads = 0);
+
+		// Destructor stops the workers
+		~ThreadPool();
+
+		// The pool owns its threads, it can not be copied
+		ThreadPool(ThreadPool const &) = delete;
+		ThreadPool & operator=(ThreadPool const &) = delete;
+
+		// Get number of threads, the calling thread included
+		size_t getNumThreads() const;
+
+		// Get index of the thread running the current task, in [0, getNumThreads()). The thread
+		// calling run has index 0
+		static size_t getThreadIndex();
+
+		// Run task(i) for every i in [0, count) and wait for all of them. Tasks are dealt in index
+		// order, give the longest ones the smallest indices
+		void run(size_t const count, std::function<void(size_t)> const & task);
+
+	private:
+		// Tasks of a thread
+		struct TaskDeque {
+			std::mutex mutex;
+			std::deque<size_t> tasks;
+		};
+
+		// Loop of a worker thread
+		void workerLoop(size_t const worker);
+
+		// Run tasks of the current batch until there are none left to take
+		void work(size_t const worker);
+
+		// Take a task from the own deque or steal one, return false if all the deques are empty
+		bool takeTask(size_t const worker, size_t & task);
+
+		// Deque of every thread, the calling thread uses the first one
+		std::vector<std::unique_ptr<TaskDeque> > deques;
+		// Worker threads
+		std::vector<std::thread> workers;
+		// Task of the current batch and number of tasks not finished yet
+		std::function<void(size_t)> const * batch_task;
+		std::atomic<size_t> remaining;
+		// Batch counter and stop flag, the workers wait on the condition until one changes
+		std::mutex mutex;
+		std::condition_variable wake;
+		size_t batch;
+		bool stopping;
+	};
+
+} // pb namespace
\ No newline at end of file
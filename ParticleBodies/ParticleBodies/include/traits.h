@@ -1,23 +1,26 @@
 #pragma once
 
+#include <cstddef>
+
 namespace pb {
 
 	namespace math {
-		template <typename T> class Scalar;
+		template <typename T, size_t ROWS, size_t COLS> class MatrixStorage;
 	}
 
-	// Base template
+	// Base template, expression nodes are lightweight and often temporaries so they are
+	// kept by value, this way an expression never refers to a node that has been destroyed
 	template <typename T>
 	class ExprTraits {
 	public:
-		typedef T const & ExprReference;     // Refer as constant reference
+		typedef T const ExprReference;       // Refer as value
 	};
 
-	// Specialization for scalars
-	template <typename T>
-	class ExprTraits<pb::math::Scalar<T> > {
+	// Specialization for storage, matrices holding data are referred as constant reference
+	template <typename T, size_t ROWS, size_t COLS>
+	class ExprTraits<pb::math::MatrixStorage<T, ROWS, COLS> > {
 	public:
-		typedef pb::math::Scalar<T> ExprReference;  // Refer as value
+		typedef pb::math::MatrixStorage<T, ROWS, COLS> const & ExprReference;     // Refer as constant reference
 	};
 
-} // pb namespace
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+// Includes
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Trajectory file layout
+	//
+	// Header: magic "PBTJ", version, size of real, frames per chunk, position and orientation quantum.
+	// Records, each one starts with type, padding and payload size:
+	//  - description: number of bodies, shape type and parameters of every body
+	//  - chunk: offset of the description of its bodies, index of the first frame, number of
+	//    frames and bodies, raw and compressed size of the poses, index and time of every frame
+	//    and the compressed poses. The poses of a frame are the 7 components x, q of all the
+	//    bodies, component major, quantised and delta encoded against the previous frame of the
+	//    chunk as zigzag varints, the first frame of a chunk is a keyframe
+	//  - index: offset, first frame and number of frames of every chunk
+	// Trailer: offset of the index record, magic "PBTI" and version. A file without a trailer
+	// (e.g. the recording was interrupted) can still be read by scanning the records
+	struct TrajectoryFormat {
+		static std::uint32_t const MAGIC = 0x4a544250;
+		static std::uint32_t const INDEX_MAGIC = 0x49544250;
+		static std::uint32_t const VERSION = 1;
+
+		// Record types
+		static std::uint32_t const RECORD_DESCRIPTION = 1;
+		static std::uint32_t const RECORD_CHUNK = 2;
+		static std::uint32_t const RECORD_INDEX = 3;
+
+		// Components of the pose of a body
+		static size_t const POSE_SIZE = 7;
+
+		// Size of the file header, of a record header and of the trailer
+		static size_t const HEADER_SIZE = 32;
+		static size_t const RECORD_HEADER_SIZE = 16;
+		static size_t const TRAILER_SIZE = 16;
+		// Size of the fixed part of a chunk record payload
+		static size_t const CHUNK_HEADER_SIZE = 40;
+	};
+
+	// Map signed integers to unsigned ones so that small magnitudes give small values
+	inline std::uint64_t zigzagEncode(std::int64_t const value) {
+		return ((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+	}
+
+	inline std::int64_t zigzagDecode(std::uint64_t const value) {
+		return (static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1));
+	}
+
+	// Append a variable length integer, 7 bits per byte
+	inline void writeVarint(std::uint64_t value, std::vector<unsigned char> & dst) {
+		while (value >= 0x80) {
+			dst.push_back(static_cast<unsigned char>(value | 0x80));
+			value >>= 7;
+		}
+		dst.push_back(static_cast<unsigned char>(value));
+	}
+
+	// Read a variable length integer, return false if the data ends before the integer
+	inline bool readVarint(unsigned char const * & p, unsigned char const * const end, std::uint64_t & value) {
+		value = 0;
+		for (unsigned int shift = 0; shift < 64; shift += 7) {
+			if (p == end) {
+				return false;
+			}
+			unsigned char const byte = *p++;
+			value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+			if (byte < 0x80) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+} // pb namespace
\ No newline at end of file
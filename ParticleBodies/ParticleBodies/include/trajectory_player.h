@@ -0,0 +1,74 @@
+#pragma once
+
+// Includes
+#include "body_state_store.h"
+#include "trajectory_reader.h"
+#include <memory>
+#include <vector>
+
+namespace pb {
+
+	// Define class that plays back a recorded trajectory. Bodies are recreated from the
+	// descriptions of the file and bound to a state store, the decoded poses of a frame are copied
+	// in the store and the bodies are drawn with the same buffers as a live System. Only the
+	// frame being shown is decoded, so seeking in a long recording is bounded by I/O
+	class TrajectoryPlayer {
+	public:
+		// Constructor
+		TrajectoryPlayer();
+
+		// Open a trajectory file and show its first frame, return false if it can not be read
+		bool open(char const * const path);
+
+		// Number of frames and current frame
+		size_t getNumFrames() const;
+		size_t getFrame() const;
+
+		// Time of the current frame
+		double getTime() const;
+
+		// Playback speed, simulated seconds per second, negative values play backwards
+		double getSpeed() const;
+		void setSpeed(double const speed);
+
+		// Pause or resume the playback
+		bool isPaused() const;
+		void setPaused(bool const paused);
+
+		// Show a frame, the playback continues from its time
+		bool seek(size_t const frame);
+
+		// Move forward or backward by a number of frames
+		bool step(long long const frames);
+
+		// Advance the playback time by the elapsed real time and show the last frame at or
+		// before it
+		bool update(double const elapsed);
+
+		// Draw the bodies at the current frame
+		void draw(GLuint const v_s, GLuint const i_s, GLuint const n_s) const;
+
+	private:
+		// Decode a frame and move the bodies to its poses
+		bool showFrame(size_t const frame);
+
+		// Recreate the bodies from a description
+		bool createBodies(std::uint64_t const description_offset);
+
+		// Trajectory and decoded poses
+		TrajectoryReader reader;
+		TrajectoryPoses poses;
+
+		// Bodies of the current description and their states, the store outlives the bodies
+		std::uint64_t description_offset;
+		std::unique_ptr<BodyStateStore> states;
+		std::vector<std::unique_ptr<Body> > bodies;
+
+		// Playback state
+		size_t frame;
+		double time;
+		double speed;
+		bool paused;
+	};
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+// Includes
+#include "body.h"
+#include "mapped_file.h"
+#include <cstdint>
+#include <vector>
+
+namespace pb {
+
+	// Shape of a body of a recorded trajectory
+	struct TrajectoryBody {
+		ShapeType type;
+		real parameters[Body::MAX_SHAPE_PARAMETERS];
+	};
+
+	// Poses of the bodies at one recorded frame
+	struct TrajectoryPoses {
+		// Index of the frame in the simulation, recorded frames can have gaps
+		std::uint64_t index;
+		// Time of the system
+		double t;
+		// Offset of the description of the bodies, equal offsets mean identical bodies
+		std::uint64_t description_offset;
+		// Number of bodies
+		size_t num_bodies;
+		// Components x and q of all the bodies, component major as in BodyStateStore
+		std::vector<real> poses;
+	};
+
+	// Define class that reads a trajectory file written by TrajectoryRecorder. The file is mapped
+	// in memory and only the index is read when opening it, chunks are decompressed when one of
+	// their frames is requested and the last one is kept so that playing forward only decodes the
+	// deltas of the new frames. Recorded frames are addressed by their position in the file
+	class TrajectoryReader {
+	public:
+		// Constructor
+		TrajectoryReader();
+
+		// Open a file, return false if it is not a valid trajectory. Files without index (e.g.
+		// the recording was interrupted) are indexed by scanning their records
+		bool open(char const * const path);
+
+		// Close the file
+		void close();
+
+		// Number of recorded frames
+		size_t getNumFrames() const;
+
+		// Index in the simulation and time of a recorded frame
+		std::uint64_t getFrameIndex(size_t const frame) const;
+		double getFrameTime(size_t const frame) const;
+
+		// Find the last frame recorded at or before a time, the first one if none is
+		size_t findFrame(double const t) const;
+
+		// Decode the poses of a frame, return false if the chunk holding it is corrupted
+		bool readFrame(size_t const frame, TrajectoryPoses * const poses);
+
+		// Read the shapes of the bodies from a description
+		bool readDescription(std::uint64_t const offset, std::vector<TrajectoryBody> * const bodies) const;
+
+	private:
+		// Chunk of frames
+		struct Chunk {
+			// Offset of the record in the file
+			std::uint64_t offset;
+			// Position of the first frame of the chunk among all the recorded frames
+			size_t first_frame;
+			// Number of frames in the chunk
+			size_t num_frames;
+		};
+
+		// Get payload of a record of the given type, return nullptr if the record is invalid
+		unsigned char const * recordPayload(std::uint64_t const offset, std::uint32_t const type,
+											std::uint64_t * const size) const;
+
+		// Read the index written at the end of the file
+		bool readIndex();
+
+		// Build the index walking all the records
+		bool scanRecords();
+
+		// Find the chunk holding a frame
+		size_t findChunk(size_t const frame) const;
+
+		// Get index in the simulation and time of a frame of a chunk, records are not aligned
+		// in the file so the values are copied
+		std::uint64_t chunkFrameIndex(size_t const chunk, size_t const frame) const;
+		double chunkFrameTime(size_t const chunk, size_t const frame) const;
+
+		// Mapped file and quantisation of the poses
+		MappedFile file;
+		double position_quantum;
+		double orientation_quantum;
+
+		// Chunks and total number of frames
+		std::vector<Chunk> chunks;
+		size_t num_frames;
+
+		// Last decoded chunk, its decompressed poses, read position and the quantised poses of
+		// the last decoded frame
+		size_t decoded_chunk;
+		size_t decoded_frames;
+		std::vector<unsigned char> raw;
+		size_t raw_offset;
+		std::vector<std::int64_t> values;
+	};
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+// Includes
+#include "spsc_queue.h"
+#include "system.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace pb {
+
+	// Poses of the bodies at one step, passed from the simulation thread to the writer thread
+	struct TrajectoryFrame {
+		// Index of the frame, counting dropped frames too
+		std::uint64_t index;
+		// Time of the system
+		real t;
+		// Number of bodies
+		size_t num_bodies;
+		// Components x and q of all the bodies, component major
+		std::vector<real> poses;
+		// Shapes of the bodies, only set when the bodies of the system changed
+		std::vector<unsigned char> description;
+	};
+
+	// Define class that records the poses of the bodies of a system to a compressed trajectory
+	// file (see trajectory_format.h). The simulation thread only copies the poses to a frame of a
+	// preallocated pool and pushes it to a bounded lock free queue, a background thread quantises,
+	// delta encodes, compresses and writes them. If the writer falls behind and the pool is
+	// empty the frame is dropped instead of stalling the simulation
+	class TrajectoryRecorder {
+	public:
+		// Constructor, create the file and start the writer thread
+		TrajectoryRecorder(char const * const path,
+						   real const position_quantum = real(1e-4),
+						   real const orientation_quantum = real(1e-6),
+						   size_t const frames_per_chunk = 64,
+						   size_t const queue_capacity = 16);
+
+		// Destructor closes the recording
+		~TrajectoryRecorder();
+
+		// The recorder owns a thread, it can not be copied
+		TrajectoryRecorder(TrajectoryRecorder const &) = delete;
+		TrajectoryRecorder & operator=(TrajectoryRecorder const &) = delete;
+
+		// Check if the file was created
+		bool isOpen() const;
+
+		// Record the current poses of the bodies of the system, return false if the frame was dropped
+		bool record(System const & system);
+
+		// Write all the queued frames, the index and the trailer, then stop the writer thread
+		void close();
+
+		// Statistics
+		std::uint64_t getRecordedFrames() const;
+		std::uint64_t getDroppedFrames() const;
+		std::uint64_t getBytesWritten() const;
+
+	private:
+		// Chunk entry of the index
+		struct ChunkIndex {
+			std::uint64_t offset;
+			std::uint64_t first_frame;
+			std::uint32_t num_frames;
+		};
+
+		// Writer thread loop
+		void run();
+
+		// Encode a frame into the current chunk
+		void writeFrame(TrajectoryFrame const & frame);
+
+		// Compress and write the current chunk
+		void flushChunk();
+
+		// Write a record to the file
+		void writeRecord(std::uint32_t const type, unsigned char const * const payload, size_t const size);
+
+		// Write the index and the trailer
+		void writeIndex();
+
+		// File and quantisation parameters
+		std::FILE * file;
+		real const position_quantum;
+		real const orientation_quantum;
+		size_t const frames_per_chunk;
+
+		// Frames pool, free frames go from the writer to the simulation thread and recorded
+		// frames from the simulation to the writer thread
+		std::vector<TrajectoryFrame> frames;
+		SPSCQueue<TrajectoryFrame *> free_frames;
+		SPSCQueue<TrajectoryFrame *> recorded_frames;
+		std::thread writer_thread;
+		std::atomic<bool> stopping;
+
+		// Simulation thread state
+		size_t bodies_revision;
+		bool description_pending;
+		std::uint64_t next_frame;
+
+		// Writer thread state
+		std::uint64_t file_offset;
+		std::uint64_t description_offset;
+		std::vector<std::int64_t> previous;
+		std::vector<unsigned char> raw;
+		std::vector<unsigned char> compressed;
+		std::vector<std::uint64_t> chunk_frames;
+		std::vector<double> chunk_times;
+		size_t chunk_bodies;
+		std::vector<ChunkIndex> index;
+
+		// Statistics
+		std::atomic<std::uint64_t> recorded;
+		std::atomic<std::uint64_t> dropped;
+		std::atomic<std::uint64_t> bytes_written;
+	};
+
+} // pb namespace
\ No newline at end of file
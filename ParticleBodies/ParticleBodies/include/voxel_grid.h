@@ -1,7 +1,7 @@
 #pragma once
 
 // Includes
-#include "matrix_include.h"
+#include "precision.h"
 #include <vector>
 
 namespace pb {
@@ -22,7 +22,7 @@ namespace pb {
 	public:
 		// Constructor
 		VoxelGrid(size_t const x_dim, size_t const y_dim, size_t const z_dim,
-				  math::vec3f const & grid_min, math::vec3f const & grid_max);
+				  math::vec3r const & grid_min, math::vec3r const & grid_max);
 
 		// Destructor
 		~VoxelGrid();
@@ -41,7 +41,7 @@ namespace pb {
 		Voxel<ELEMENT> const * getElement(size_t const x, size_t const y, size_t const z) const;
 
 		// Get voxel center
-		math::vec3f getVoxelCenter(size_t const x, size_t const y, size_t const z) const;
+		math::vec3r getVoxelCenter(size_t const x, size_t const y, size_t const z) const;
 
 		// Get voxel grid dimensions
 		size_t getGridDimX() const;
@@ -62,12 +62,12 @@ namespace pb {
 		size_t const y_dim;
 		size_t const z_dim;
 		// Grid minimumm and maximum
-		math::vec3f const grid_min;
-		math::vec3f const grid_max;
+		math::vec3r const grid_min;
+		math::vec3r const grid_max;
 		// Size of each voxel in the grid
-		float const voxel_x;
-		float const voxel_y;
-		float const voxel_z;
+		real const voxel_x;
+		real const voxel_y;
+		real const voxel_z;
 		// List of voxels
 		std::vector<Voxel<ELEMENT> *> voxels;
 	};
@@ -75,12 +75,12 @@ namespace pb {
 	// VoxelGrid class methods implementation
 	template <typename ELEMENT>
 	VoxelGrid<ELEMENT>::VoxelGrid(size_t const x_dim, size_t const y_dim, size_t const z_dim,
-								  math::vec3f const & grid_min, math::vec3f const & grid_max)
+								  math::vec3r const & grid_min, math::vec3r const & grid_max)
 		: x_dim(x_dim), y_dim(y_dim), z_dim(z_dim),
 		grid_min(grid_min), grid_max(grid_max),
-		voxel_x((grid_max(0) - grid_min(0)) / static_cast<float>(x_dim)),
-		voxel_y((grid_max(1) - grid_min(1)) / static_cast<float>(y_dim)),
-		voxel_z((grid_max(2) - grid_min(2)) / static_cast<float>(z_dim)) {
+		voxel_x((grid_max(0) - grid_min(0)) / static_cast<real>(x_dim)),
+		voxel_y((grid_max(1) - grid_min(1)) / static_cast<real>(y_dim)),
+		voxel_z((grid_max(2) - grid_min(2)) / static_cast<real>(z_dim)) {
 		// Resize vector to old all voxels information
 		voxels.resize(x_dim * y_dim * z_dim);
 		// Set all voxels to null // TODO: CHECK IF WE NEED THIS
@@ -156,16 +156,16 @@ namespace pb {
 	}
 
 	template <typename ELEMENT>
-	math::vec3f VoxelGrid<ELEMENT>::getVoxelCenter(size_t const x, size_t const y, size_t const z) const {
+	math::vec3r VoxelGrid<ELEMENT>::getVoxelCenter(size_t const x, size_t const y, size_t const z) const {
 #ifdef  _DEBUG
 		assert(x >= 0 && x < x_dim);
 		assert(y >= 0 && y < y_dim);
 		assert(z >= 0 && z < z_dim);
 #endif //  _DEBUG
 		// Compute voxel center
-		return (grid_min + (x + 0.5f) * voxel_x * math::vec3f({ 1.f, 0.f, 0.f }) +
-			(y + 0.5f) * voxel_y * math::vec3f({ 0.f, 1.f, 0.f })) +
-			(z + 0.5f) * voxel_z * math::vec3f({ 0.f, 0.f, 1.f });
+		return (grid_min + (x + real(0.5)) * voxel_x * math::vec3r({ 1, 0, 0 }) +
+			(y + real(0.5)) * voxel_y * math::vec3r({ 0, 1, 0 })) +
+			(z + real(0.5)) * voxel_z * math::vec3r({ 0, 0, 1 });
 	}
 
 	template <typename ELEMENT>
@@ -0,0 +1,1322 @@
+#include "benchmark.h"
+#include "body_state_store.h"
+#include "checkpoint.h"
+#include "contact_stages.h"
+#include "scene.h"
+#include "trajectory_reader.h"
+#include "trajectory_recorder.h"
+#include "euler.h"
+#include "sphere.h"
+#include "system.h"
+#include "particle_transform.h"
+#include "matrix_include.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace pb {
+
+	// Number of self checks of the benchmarks that failed since the start of runAll
+	static size_t num_failed_checks = 0;
+
+	// Count a failed self check of a benchmark and report it on the standard error, return if it passed
+	static bool check(bool const passed, char const * benchmark, char const * what) {
+		if (!passed) {
+			fprintf(stderr, "Benchmark check failed: %s, %s\n", benchmark, what);
+			num_failed_checks++;
+		}
+		return (passed);
+	}
+
+	int Benchmark::runAll() {
+		num_failed_checks = 0;
+		std::cout << "Precision policy: " << PB_PRECISION_NAME
+			<< " (state " << sizeof(real) * 8 << " bit, contact " << sizeof(contact_real) * 8 << " bit)" << std::endl;
+
+		// Simulation step throughput
+		systemStep(1, real(0.5), 20);
+		systemStep(2, real(0.5), 5);
+
+		// Particle transform kernels
+		particleTransform(1 << 20, 20);
+		precisionPolicies(1 << 20, 1 << 16, 20);
+
+		// Checkpoint and restart
+		checkpointRestart(2, 40, 5);
+
+		// Trajectory recording
+		trajectoryRecording(100000, 60);
+
+		// Scene loading
+		sceneLoading(100, real(1));
+
+		// Body creation and removal
+		bodyChurn(10000, 100000);
+
+		// Commands queued from other threads
+		commandQueue(4, 10000);
+
+		// Contact islands on the thread pool
+		islandScaling(64, 4, 120);
+		colouredContacts(8, 10);
+
+		// Contact pipeline stages
+		contactStages(real(0.1), 20);
+
+		// Broad phases and detectors on bodies of different sizes
+		multiScaleContacts(16, 60);
+
+		// Detectors on two large bodies touching at one point
+		touchingBodies(real(0.04), 5);
+
+		// Particles against the distance field of the other body
+		distanceFieldContacts(real(0.04), 5);
+
+		// Analytic checks of the pairs of spheres and planes
+		analyticContacts(8, 60);
+
+		// Stiff contacts integrated explicitly and linearly implicitly
+		stiffContacts(real(1000), real(4));
+
+		// Piles on penalty springs and on contact impulses at 60 Hz
+		contactImpulses(8, real(10));
+
+		// Body state integration
+		stateIntegration(1 << 16, 100);
+		orientationIntegration(real(5), real(20));
+
+		// Matrix expression templates
+		matrixExpressions(1 << 22);
+
+		std::cout << "Failed checks: " << num_failed_checks << std::endl;
+
+		return (num_failed_checks == 0 ? 0 : 1);
+	}
+
+	// Create a grid of dynamic spheres above a static ground sphere
+	static void createScene(size_t const bodies_per_side, real const particle_diameter, System & system,
+							std::vector<Body *> & spheres, std::vector<BodyParticlesDiscretisation *> & discretisations) {
+		math::quaternionr const orientation = math::quaternionFromAngleAxis(real(0), math::vec3r({ 1, 0, 0 }));
+
+		// Static ground sphere
+		spheres.push_back(new Sphere(math::vec3r({ real(0), real(-4), real(0) }), real(INFINITY), orientation, real(4)));
+		// Grid of dynamic spheres resting above the ground
+		for (size_t i = 0; i < bodies_per_side; i++) {
+			for (size_t j = 0; j < bodies_per_side; j++) {
+				for (size_t k = 0; k < bodies_per_side; k++) {
+					math::vec3r const center = math::vec3r({ real(2.1) * i, real(1.05) + real(2.1) * j, real(2.1) * k });
+					spheres.push_back(new Sphere(center, real(1), orientation, real(1)));
+				}
+			}
+		}
+
+		// Add bodies to system
+		for (auto sphere = spheres.begin(); sphere != spheres.end(); sphere++) {
+			discretisations.push_back(new BodyParticlesDiscretisation(*sphere, particle_diameter));
+			system.addBody(discretisations.back());
+		}
+	}
+
+	// Free the bodies of a scene
+	static void destroyScene(std::vector<Body *> & spheres, std::vector<BodyParticlesDiscretisation *> & discretisations) {
+		for (size_t i = 0; i < spheres.size(); i++) {
+			delete discretisations[i];
+			delete spheres[i];
+		}
+		spheres.clear();
+		discretisations.clear();
+	}
+
+	void Benchmark::systemStep(size_t const bodies_per_side, real const particle_diameter, size_t const steps) {
+		std::vector<Body *> spheres;
+		std::vector<BodyParticlesDiscretisation *> discretisations;
+
+		// Create system
+		System system(real(0), real(1) / real(30));
+		createScene(bodies_per_side, particle_diameter, system, spheres, discretisations);
+		size_t num_particles = 0;
+		for (auto discretisation = discretisations.begin(); discretisation != discretisations.end(); discretisation++) {
+			num_particles += (*discretisation)->getNumParticles();
+		}
+
+		// Time the steps
+		auto const start = std::chrono::high_resolution_clock::now();
+		for (size_t s = 0; s < steps; s++) {
+			system.computeStep();
+		}
+		auto const end = std::chrono::high_resolution_clock::now();
+		double const seconds = std::chrono::duration<double>(end - start).count();
+
+		// Memory of the particles, quantised and in world space for the bodies that kept them
+		size_t world_bytes = 0;
+		for (auto discretisation = discretisations.begin(); discretisation != discretisations.end(); discretisation++) {
+			world_bytes += (*discretisation)->getWorldParticles().getNumBytes();
+		}
+
+		std::cout << "System::computeStep, bodies: " << spheres.size()
+			<< ", particles: " << num_particles << " (" << num_particles * sizeof(Particle) << " bytes"
+			<< " + " << world_bytes << " bytes in world space)"
+			<< ", steps: " << steps
+			<< ", time: " << seconds << " s"
+			<< ", steps/s: " << static_cast<double>(steps) / seconds << std::endl;
+
+		// Free memory
+		destroyScene(spheres, discretisations);
+	}
+
+	// Check if the states of two systems are bit identical
+	static bool identicalStates(System const & s1, System const & s2) {
+		BodyStateStore const & states1 = s1.getStateStore();
+		BodyStateStore const & states2 = s2.getStateStore();
+		if (states1.size() != states2.size() || s1.getTime() != s2.getTime()) {
+			return false;
+		}
+		for (size_t c = 0; c < BodyStateStore::STATE_SIZE; c++) {
+			if (std::memcmp(states1.state(c), states2.state(c), states1.size() * sizeof(real)) != 0) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void Benchmark::checkpointRestart(size_t const bodies_per_side, size_t const steps, size_t const interval) {
+		char const * const path = "benchmark_checkpoint.pbc";
+		std::vector<Body *> spheres;
+		std::vector<BodyParticlesDiscretisation *> discretisations;
+		System system(real(0), real(1) / real(30));
+		createScene(bodies_per_side, real(0.5), system, spheres, discretisations);
+
+		// Simulate writing a checkpoint every interval steps, the last one is written half way
+		CheckpointWriter writer(path);
+		double step_seconds = 0, checkpoint_seconds = 0;
+		size_t num_checkpoints = 0;
+		for (size_t s = 1; s <= steps; s++) {
+			auto const step_start = std::chrono::high_resolution_clock::now();
+			system.computeStep();
+			auto const step_end = std::chrono::high_resolution_clock::now();
+			step_seconds += std::chrono::duration<double>(step_end - step_start).count();
+
+			if (s % interval == 0 && s <= steps / 2) {
+				auto const checkpoint_start = std::chrono::high_resolution_clock::now();
+				writer.write(system);
+				auto const checkpoint_end = std::chrono::high_resolution_clock::now();
+				checkpoint_seconds += std::chrono::duration<double>(checkpoint_end - checkpoint_start).count();
+				num_checkpoints++;
+			}
+		}
+
+		// Restart from the last checkpoint and simulate up to the same time
+		auto const restart_start = std::chrono::high_resolution_clock::now();
+		RestartedSystem restarted;
+		bool const restart_ok = CheckpointReader::restart(path, &restarted);
+		auto const restart_end = std::chrono::high_resolution_clock::now();
+		bool identical = false;
+		if (restart_ok) {
+			size_t const restart_step = ((steps / 2) / interval) * interval;
+			for (size_t s = restart_step; s < steps; s++) {
+				restarted.system->computeStep();
+			}
+			identical = identicalStates(system, *restarted.system);
+		}
+
+		std::cout << "Checkpoint, bodies: " << spheres.size() << ", checkpoints: " << num_checkpoints
+			<< ", ms per checkpoint: " << checkpoint_seconds / num_checkpoints * 1e3
+			<< ", fraction of step time: " << checkpoint_seconds / step_seconds
+			<< ", restart ms: " << std::chrono::duration<double>(restart_end - restart_start).count() * 1e3
+			<< ", restarted trajectory: " << (!restart_ok ? "restart failed" : identical ? "bit identical" : "DIFFERENT") << std::endl;
+		check(restart_ok && identical, "checkpoint", "restarted trajectory is not bit identical");
+
+		// Free memory
+		restarted.system.reset();
+		destroyScene(spheres, discretisations);
+		std::remove(path);
+	}
+
+	// Signature shared by all the transform kernels
+	typedef void(*TransformKernel)(BodyTransform const &, Particle const *, size_t const,
+								   contact_real const *, contact_real const, ParticleWorldBuffer &, bool const);
+
+	// Time a transform kernel and return the maximum difference from the reference buffer
+	static contact_real timeTransformKernel(char const * name, TransformKernel kernel,
+											BodyTransform const & transform, std::vector<Particle> const & particles,
+											contact_real const origin[3], contact_real const spacing,
+											size_t const repetitions, ParticleWorldBuffer const * reference) {
+		ParticleWorldBuffer world;
+		world.resize(particles.size());
+
+		auto const start = std::chrono::high_resolution_clock::now();
+		for (size_t r = 0; r < repetitions; r++) {
+			kernel(transform, particles.data(), particles.size(), origin, spacing, world, true);
+		}
+		auto const end = std::chrono::high_resolution_clock::now();
+		double const seconds = std::chrono::duration<double>(end - start).count();
+
+		// Compare with reference
+		contact_real max_error = 0;
+		if (reference != nullptr) {
+			for (size_t p = 0; p < particles.size(); p++) {
+				max_error = std::max(max_error, std::abs(world.px[p] - reference->px[p]));
+				max_error = std::max(max_error, std::abs(world.vz[p] - reference->vz[p]));
+			}
+		}
+
+		std::cout << "Particle transform " << name << ", particles: " << particles.size()
+			<< ", Mparticles/s: " << static_cast<double>(particles.size() * repetitions) / seconds * 1e-6
+			<< ", max error: " << max_error << std::endl;
+
+		return (max_error);
+	}
+
+	void Benchmark::particleTransform(size_t const num_particles, size_t const repetitions) {
+		// Generate particles with pseudo random voxel coordinates
+		std::vector<Particle> particles;
+		particles.reserve(num_particles);
+		unsigned int seed = 12345;
+		for (size_t p = 0; p < num_particles; p++) {
+			std::int16_t voxel[3];
+			for (size_t c = 0; c < 3; c++) {
+				seed = seed * 1664525u + 1013904223u;
+				voxel[c] = static_cast<std::int16_t>((seed >> 16) % 256);
+			}
+			particles.push_back(Particle(voxel[0], voxel[1], voxel[2]));
+		}
+
+		// Rotated and moving body
+		BodyTransform transform;
+		math::mat3x3r const R = math::createMatrix(math::quaternionFromAngleAxis(real(30), math::normalize(math::vec3r({ 1, 2, 3 }))));
+		for (size_t r = 0; r < 3; r++) {
+			for (size_t c = 0; c < 3; c++) {
+				transform.R[r * 3 + c] = static_cast<contact_real>(R(r, c));
+			}
+			transform.x[r] = static_cast<contact_real>(r + 1);
+			transform.v[r] = static_cast<contact_real>(0.5 * r);
+			transform.omega[r] = static_cast<contact_real>(1.0 - 0.25 * r);
+		}
+		contact_real const origin[3] = { contact_real(-12.5), contact_real(-12.5), contact_real(-12.5) };
+		contact_real const spacing = contact_real(0.1);
+
+		// Reference result
+		ParticleWorldBuffer reference;
+		reference.resize(num_particles);
+		transformParticlesScalar(transform, particles.data(), num_particles, origin, spacing, reference, true);
+
+		timeTransformKernel("scalar", transformParticlesScalar, transform, particles, origin, spacing, repetitions, nullptr);
+		// The vector kernels only reorder the operations of the scalar one
+		contact_real const tolerance = contact_real(1e-4);
+#ifdef PB_SIMD_SSE
+		check(timeTransformKernel("SSE", transformParticlesSSE, transform, particles, origin, spacing, repetitions, &reference) <= tolerance,
+			  "particle transform", "SSE kernel differs from the scalar one");
+#endif
+#ifdef PB_SIMD_AVX2
+		check(timeTransformKernel("AVX2", transformParticlesAVX2, transform, particles, origin, spacing, repetitions, &reference) <= tolerance,
+			  "particle transform", "AVX2 kernel differs from the scalar one");
+#endif
+	}
+
+	// Time the scalar particle transform and an Euler step of free bodies in the scalars of a
+	// precision policy, the kernels follow transformParticlesScalar and integrateEuler. Return the
+	// particles and the bodies processed per second
+	template <typename POLICY>
+	static void timePrecisionPolicy(char const * name, std::vector<Particle> const & particles, size_t const num_bodies,
+									size_t const repetitions, double & particles_per_second, double & bodies_per_second) {
+		typedef typename POLICY::StateType S;
+		typedef typename POLICY::ContactType C;
+
+		// Pose of a rotated moving body in state precision, converted once to contact precision
+		S const angle = S(0.5);
+		S const pose_R[9] = { std::cos(angle), -std::sin(angle), S(0), std::sin(angle), std::cos(angle), S(0), S(0), S(0), S(1) };
+		C R[9], x[3], v[3], w[3];
+		for (size_t e = 0; e < 9; e++) {
+			R[e] = static_cast<C>(pose_R[e]);
+		}
+		for (size_t r = 0; r < 3; r++) {
+			x[r] = static_cast<C>(S(r + 1));
+			v[r] = static_cast<C>(S(0.5) * S(r));
+			w[r] = static_cast<C>(S(1) - S(0.25) * S(r));
+		}
+		C const origin = C(-12.5);
+		C const spacing = C(0.1);
+
+		// World particles
+		size_t const num_particles = particles.size();
+		std::vector<C> world(6 * num_particles);
+		C * const px = world.data();
+		C * const py = px + num_particles;
+		C * const pz = py + num_particles;
+		C * const vx = pz + num_particles;
+		C * const vy = vx + num_particles;
+		C * const vz = vy + num_particles;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t rep = 0; rep < repetitions; rep++) {
+			for (size_t p = 0; p < num_particles; p++) {
+				std::int16_t const * const voxel = particles[p].getVoxel();
+				C const lx = origin + spacing * static_cast<C>(voxel[0]);
+				C const ly = origin + spacing * static_cast<C>(voxel[1]);
+				C const lz = origin + spacing * static_cast<C>(voxel[2]);
+				C const rx = R[0] * lx + R[1] * ly + R[2] * lz;
+				C const ry = R[3] * lx + R[4] * ly + R[5] * lz;
+				C const rz = R[6] * lx + R[7] * ly + R[8] * lz;
+				px[p] = x[0] + rx;
+				py[p] = x[1] + ry;
+				pz[p] = x[2] + rz;
+				vx[p] = v[0] + w[1] * rz - w[2] * ry;
+				vy[p] = v[1] + w[2] * rx - w[0] * rz;
+				vz[p] = v[2] + w[0] * ry - w[1] * rx;
+			}
+		}
+		double const transform_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// Bodies as structure of arrays, position, orientation, linear and angular momentum
+		std::vector<S> state(13 * num_bodies, S(0));
+		for (size_t b = 0; b < num_bodies; b++) {
+			state[b] = S(b % 64);
+			state[3 * num_bodies + b] = S(1);
+			state[8 * num_bodies + b] = S(1);
+			state[10 * num_bodies + b] = S(0.1);
+			state[12 * num_bodies + b] = S(0.2);
+		}
+		S const inv_mass = S(1);
+		S const inv_inertia[3] = { S(2.5), S(1.25), S(0.8) };
+		S const step = S(1) / S(30);
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t rep = 0; rep < repetitions; rep++) {
+			S * const y = state.data();
+			size_t const n = num_bodies;
+			for (size_t i = 0; i < n; i++) {
+				S const qs = y[3 * n + i], qx = y[4 * n + i], qy = y[5 * n + i], qz = y[6 * n + i];
+				S const wx = inv_inertia[0] * y[10 * n + i];
+				S const wy = inv_inertia[1] * y[11 * n + i];
+				S const wz = inv_inertia[2] * y[12 * n + i];
+				for (size_t c = 0; c < 3; c++) {
+					y[c * n + i] += step * inv_mass * y[(7 + c) * n + i];
+				}
+				S const ns = qs + step * S(0.5) * -(wx * qx + wy * qy + wz * qz);
+				S const nx = qx + step * S(0.5) * (qs * wx + wy * qz - wz * qy);
+				S const ny = qy + step * S(0.5) * (qs * wy + wz * qx - wx * qz);
+				S const nz = qz + step * S(0.5) * (qs * wz + wx * qy - wy * qx);
+				S const inv_norm = S(1) / std::sqrt(ns * ns + nx * nx + ny * ny + nz * nz);
+				y[3 * n + i] = ns * inv_norm;
+				y[4 * n + i] = nx * inv_norm;
+				y[5 * n + i] = ny * inv_norm;
+				y[6 * n + i] = nz * inv_norm;
+			}
+		}
+		double const integration_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// Checksum of the results so that the loops are not removed
+		double checksum = 0.0;
+		for (size_t p = 0; p < num_particles; p += 97) {
+			checksum += static_cast<double>(px[p]) + static_cast<double>(vz[p]);
+		}
+		for (size_t b = 0; b < num_bodies; b += 97) {
+			checksum += static_cast<double>(state[b]) + static_cast<double>(state[4 * num_bodies + b]);
+		}
+
+		particles_per_second = static_cast<double>(num_particles * repetitions) / transform_seconds;
+		bodies_per_second = static_cast<double>(num_bodies * repetitions) / integration_seconds;
+		std::cout << "Precision policy " << name << " (state " << sizeof(S) * 8 << " bit, contact " << sizeof(C) * 8 << " bit)"
+			<< ", transform Mparticles/s: " << particles_per_second * 1e-6
+			<< ", Euler step Mbodies/s: " << bodies_per_second * 1e-6
+			<< " (checksum " << checksum << ")" << std::endl;
+	}
+
+	void Benchmark::precisionPolicies(size_t const num_particles, size_t const num_bodies, size_t const repetitions) {
+		// Particles with pseudo random voxel coordinates, as in particleTransform
+		std::vector<Particle> particles;
+		particles.reserve(num_particles);
+		unsigned int seed = 12345;
+		for (size_t p = 0; p < num_particles; p++) {
+			std::int16_t voxel[3];
+			for (size_t c = 0; c < 3; c++) {
+				seed = seed * 1664525u + 1013904223u;
+				voxel[c] = static_cast<std::int16_t>((seed >> 16) % 256);
+			}
+			particles.push_back(Particle(voxel[0], voxel[1], voxel[2]));
+		}
+
+		// All the policies in one binary, relative to float
+		double particle_rates[3], body_rates[3];
+		timePrecisionPolicy<FloatPrecision>("float", particles, num_bodies, repetitions, particle_rates[0], body_rates[0]);
+		timePrecisionPolicy<DoublePrecision>("double", particles, num_bodies, repetitions, particle_rates[1], body_rates[1]);
+		timePrecisionPolicy<MixedPrecision>("mixed", particles, num_bodies, repetitions, particle_rates[2], body_rates[2]);
+		std::cout << "Precision policies relative to float, transform double: " << particle_rates[1] / particle_rates[0]
+			<< ", mixed: " << particle_rates[2] / particle_rates[0]
+			<< ", Euler step double: " << body_rates[1] / body_rates[0]
+			<< ", mixed: " << body_rates[2] / body_rates[0]
+			<< " (this build: " << PB_PRECISION_NAME << ")" << std::endl;
+	}
+
+	void Benchmark::trajectoryRecording(size_t const num_bodies, size_t const frames) {
+		char const * const path = "benchmark_trajectory.pbt";
+
+		// Free flying spinning spheres, a coarse discretisation is enough since there are no contacts
+		std::vector<Body *> spheres;
+		std::vector<BodyParticlesDiscretisation *> discretisations;
+		System system(real(0), real(1) / real(30));
+		size_t const side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(num_bodies))));
+		for (size_t b = 0; b < num_bodies; b++) {
+			math::vec3r const center = math::vec3r({ real(3) * (b % side), real(0), real(3) * (b / side) });
+			spheres.push_back(new Sphere(center, real(1), math::quaternionFromAngleAxis(real(b % 360), math::normalize(math::vec3r({ 1, 2, 3 }))), real(1)));
+			discretisations.push_back(new BodyParticlesDiscretisation(spheres.back(), real(1)));
+			system.addBody(discretisations.back());
+		}
+		BodyStateStore & states = system.getStateStore();
+		for (size_t b = 0; b < num_bodies; b++) {
+			states.setLinearMomentum(b, math::vec3r({ real(0.1), real(1), real(0) }));
+			states.setAngularMomentum(b, math::vec3r({ real(0.1) * (b % 7), real(0), real(0.2) }));
+		}
+		states.computeDerivedQuantities();
+
+		// Integrate the free motion and record every frame
+		TrajectoryRecorder recorder(path);
+		real const delta_t = real(1) / real(30);
+		double step_seconds = 0, record_seconds = 0;
+		for (size_t f = 0; f < frames; f++) {
+			auto const step_start = std::chrono::high_resolution_clock::now();
+			states.computeStateDerivative();
+			real * const y = states.state(0);
+			EulerSolver::odeStep(y, states.ddtState(0), y, BodyStateStore::STATE_SIZE * states.capacity(), delta_t * f, delta_t * (f + 1));
+			states.computeDerivedQuantities();
+			auto const record_start = std::chrono::high_resolution_clock::now();
+			recorder.record(system);
+			auto const record_end = std::chrono::high_resolution_clock::now();
+			step_seconds += std::chrono::duration<double>(record_start - step_start).count();
+			record_seconds += std::chrono::duration<double>(record_end - record_start).count();
+		}
+		auto const close_start = std::chrono::high_resolution_clock::now();
+		recorder.close();
+		auto const close_end = std::chrono::high_resolution_clock::now();
+
+		double const raw_bytes = static_cast<double>(recorder.getRecordedFrames()) * num_bodies * 7 * sizeof(real);
+		std::cout << "Trajectory recording, bodies: " << num_bodies << ", frames: " << frames
+			<< ", dropped: " << recorder.getDroppedFrames()
+			<< ", record ms/frame: " << record_seconds / frames * 1e3
+			<< " (integration ms/frame: " << step_seconds / frames * 1e3 << ")"
+			<< ", close ms: " << std::chrono::duration<double>(close_end - close_start).count() * 1e3
+			<< ", bytes/body/frame: " << static_cast<double>(recorder.getBytesWritten()) / (recorder.getRecordedFrames() * num_bodies)
+			<< ", compression ratio: " << raw_bytes / recorder.getBytesWritten() << std::endl;
+
+		// Play the recording forward and seek to random frames
+		TrajectoryReader reader;
+		TrajectoryPoses poses;
+		bool const opened = reader.open(path);
+		check(opened && static_cast<std::uint64_t>(reader.getNumFrames()) == recorder.getRecordedFrames(), "trajectory recording", "recorded frames can not be read back");
+		if (opened && reader.getNumFrames() > 0) {
+			auto const forward_start = std::chrono::high_resolution_clock::now();
+			for (size_t f = 0; f < reader.getNumFrames(); f++) {
+				reader.readFrame(f, &poses);
+			}
+			auto const seek_start = std::chrono::high_resolution_clock::now();
+			size_t const seeks = 20;
+			std::mt19937 generator(7);
+			for (size_t s = 0; s < seeks; s++) {
+				reader.readFrame(generator() % reader.getNumFrames(), &poses);
+			}
+			auto const seek_end = std::chrono::high_resolution_clock::now();
+			std::cout << "Trajectory playback, forward ms/frame: "
+				<< std::chrono::duration<double>(seek_start - forward_start).count() / reader.getNumFrames() * 1e3
+				<< ", random seek ms: " << std::chrono::duration<double>(seek_end - seek_start).count() / seeks * 1e3 << std::endl;
+		}
+		reader.close();
+
+		destroyScene(spheres, discretisations);
+		std::remove(path);
+	}
+
+	void Benchmark::sceneLoading(size_t const bodies_per_side, real const particle_diameter) {
+		size_t const num_bodies = bodies_per_side * bodies_per_side * bodies_per_side;
+
+		// Bodies created and added one by one
+		auto const single_start = std::chrono::high_resolution_clock::now();
+		{
+			std::vector<Body *> spheres;
+			std::vector<BodyParticlesDiscretisation *> discretisations;
+			System system(real(0), real(1) / real(30));
+			math::quaternionr const orientation = math::quaternionr(real(1), real(0), real(0), real(0));
+			for (size_t k = 0; k < bodies_per_side; k++) {
+				for (size_t j = 0; j < bodies_per_side; j++) {
+					for (size_t i = 0; i < bodies_per_side; i++) {
+						math::vec3r const center = math::vec3r({ real(2.5) * i, real(2.5) * j, real(2.5) * k });
+						spheres.push_back(new Sphere(center, real(1), orientation, real(1)));
+						discretisations.push_back(new BodyParticlesDiscretisation(spheres.back(), particle_diameter));
+						system.addBody(discretisations.back());
+					}
+				}
+			}
+			destroyScene(spheres, discretisations);
+		}
+		auto const single_end = std::chrono::high_resolution_clock::now();
+
+		// Same bodies from a grid generator
+		char description[256];
+		snprintf(description, sizeof(description),
+				 "{ \"generators\": [ { \"type\": \"grid\", \"count\": [%zu, %zu, %zu], \"spacing\": [2.5, 2.5, 2.5], "
+				 "\"particle_diameter\": %g } ] }",
+				 bodies_per_side, bodies_per_side, bodies_per_side, static_cast<double>(particle_diameter));
+		auto const bulk_start = std::chrono::high_resolution_clock::now();
+		size_t loaded_bodies = 0;
+		{
+			LoadedScene scene;
+			if (SceneLoader::parse(description, std::strlen(description), &scene)) {
+				loaded_bodies = scene.system->getBodies().size();
+			}
+		}
+		auto const bulk_end = std::chrono::high_resolution_clock::now();
+
+		double const single_seconds = std::chrono::duration<double>(single_end - single_start).count();
+		double const bulk_seconds = std::chrono::duration<double>(bulk_end - bulk_start).count();
+		std::cout << "Scene loading, bodies: " << num_bodies << " (loaded " << loaded_bodies << ")"
+			<< ", one by one s: " << single_seconds << ", scene loader s: " << bulk_seconds
+			<< ", speedup: " << single_seconds / bulk_seconds << std::endl;
+		check(loaded_bodies == num_bodies, "scene loading", "scene loader created a different number of bodies");
+	}
+
+	void Benchmark::bodyChurn(size_t const num_bodies, size_t const operations) {
+		System system(real(0), real(1) / real(30));
+		real const radius[Body::MAX_SHAPE_PARAMETERS] = { real(0.5), real(0), real(0), real(0) };
+		math::quaternionr const orientation = math::quaternionr(real(1), real(0), real(0), real(0));
+
+		// Resident bodies
+		for (size_t b = 0; b < num_bodies; b++) {
+			system.createBody(SHAPE_SPHERE, radius, math::vec3r({ real(b % 100), real(0), real(b / 100) }), real(1), orientation, real(0.5));
+		}
+
+		// Spawn projectiles and despawn random live ones
+		std::vector<BodyHandle> projectiles;
+		std::mt19937 generator(11);
+		size_t stale_handles = 0;
+		auto const start = std::chrono::high_resolution_clock::now();
+		for (size_t o = 0; o < operations; o++) {
+			if (projectiles.size() < 64 || generator() % 2 == 0) {
+				math::vec3r const x = math::vec3r({ real(o % 100), real(10), real(0) });
+				projectiles.push_back(system.createBody(SHAPE_SPHERE, radius, x, real(1), orientation, real(0.5)));
+			} else {
+				size_t const p = generator() % projectiles.size();
+				BodyHandle const removed = projectiles[p];
+				system.removeBody(removed);
+				stale_handles += system.isValid(removed) ? 1 : 0;
+				projectiles[p] = projectiles.back();
+				projectiles.pop_back();
+			}
+		}
+		auto const end = std::chrono::high_resolution_clock::now();
+
+		std::cout << "Body churn, resident bodies: " << num_bodies << ", operations: " << operations
+			<< ", ns/operation: " << std::chrono::duration<double>(end - start).count() / operations * 1e9
+			<< ", bodies: " << system.getBodies().size() << ", stale handles still valid: " << stale_handles << std::endl;
+		check(stale_handles == 0, "body churn", "handles of removed bodies are still valid");
+	}
+
+	void Benchmark::commandQueue(size_t const num_producers, size_t const bodies_per_producer) {
+		System system(real(0), real(1) / real(30));
+		real const radius[Body::MAX_SHAPE_PARAMETERS] = { real(0.5), real(0), real(0), real(0) };
+		math::quaternionr const orientation = math::quaternionr(real(1), real(0), real(0), real(0));
+
+		// Every producer creates bodies, pushes them and removes half of them, retrying while the queue is full
+		std::atomic<size_t> running(num_producers);
+		std::vector<std::thread> producers;
+		auto const start = std::chrono::high_resolution_clock::now();
+		for (size_t p = 0; p < num_producers; p++) {
+			producers.push_back(std::thread([&, p]() {
+				for (size_t b = 0; b < bodies_per_producer; b++) {
+					math::vec3r const x = math::vec3r({ real(b % 100), real(p), real(b / 100) });
+					BodyHandle handle;
+					while ((handle = system.enqueueCreateBody(SHAPE_SPHERE, radius, x, real(1), orientation, real(0.5))).generation == 0) {
+						std::this_thread::yield();
+					}
+					while (!system.enqueueApplyImpulse(handle, math::vec3r({ real(0), real(1), real(0) }), x)) {
+						std::this_thread::yield();
+					}
+					while (b % 2 == 1 && !system.enqueueRemoveBody(handle)) {
+						std::this_thread::yield();
+					}
+				}
+				running--;
+			}));
+		}
+
+		// Apply the commands while the producers run
+		double apply_time = 0.0;
+		size_t batches = 0;
+		while (running > 0) {
+			auto const apply_start = std::chrono::high_resolution_clock::now();
+			system.applyCommands();
+			apply_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - apply_start).count();
+			batches++;
+			std::this_thread::yield();
+		}
+		for (auto producer = producers.begin(); producer != producers.end(); producer++) {
+			producer->join();
+		}
+		auto const apply_start = std::chrono::high_resolution_clock::now();
+		system.applyCommands();
+		auto const end = std::chrono::high_resolution_clock::now();
+		apply_time += std::chrono::duration<double>(end - apply_start).count();
+
+		size_t const commands = num_producers * bodies_per_producer * 5 / 2;
+		std::cout << "Command queue, producers: " << num_producers << ", commands: " << commands
+			<< ", total ms: " << std::chrono::duration<double>(end - start).count() * 1e3
+			<< ", apply ns/command: " << apply_time / commands * 1e9 << ", batches: " << batches
+			<< ", bodies: " << system.getBodies().size() << std::endl;
+		check(system.getBodies().size() == num_producers * (bodies_per_producer - bodies_per_producer / 2),
+			  "command queue", "queued creations and removals were lost");
+	}
+
+	// Create piles of spheres, each one on its own static ground sphere
+	static void createPiles(size_t const num_piles, size_t const pile_height, System & system) {
+		math::quaternionr const orientation = math::quaternionr(real(1), real(0), real(0), real(0));
+		real const ground[Body::MAX_SHAPE_PARAMETERS] = { real(4), real(0), real(0), real(0) };
+		real const sphere[Body::MAX_SHAPE_PARAMETERS] = { real(1), real(0), real(0), real(0) };
+		for (size_t p = 0; p < num_piles; p++) {
+			real const x = real(10) * (p % 8);
+			real const z = real(10) * (p / 8);
+			system.createBody(SHAPE_SPHERE, ground, math::vec3r({ x, real(-4), z }), real(INFINITY), orientation, real(0.5));
+			for (size_t h = 0; h < pile_height; h++) {
+				system.createBody(SHAPE_SPHERE, sphere, math::vec3r({ x + real(0.1) * h, real(1.05) + real(2.1) * h, z }),
+								  real(1), orientation, real(0.5));
+			}
+		}
+	}
+
+	void Benchmark::islandScaling(size_t const num_piles, size_t const pile_height, size_t const steps) {
+		// Thread counts to compare, at least two so that the result is checked against the serial one
+		size_t const hardware_threads = std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(2));
+		std::vector<size_t> thread_counts;
+		for (size_t threads = 1; threads < hardware_threads; threads *= 2) {
+			thread_counts.push_back(threads);
+		}
+		thread_counts.push_back(hardware_threads);
+
+		System serial(real(0), real(1) / real(30));
+		double serial_seconds = 0.0;
+		for (auto threads = thread_counts.begin(); threads != thread_counts.end(); threads++) {
+			System parallel(real(0), real(1) / real(30));
+			System & system = *threads == 1 ? serial : parallel;
+			system.setNumThreads(*threads);
+			createPiles(num_piles, pile_height, system);
+
+			auto const start = std::chrono::high_resolution_clock::now();
+			for (size_t s = 0; s < steps; s++) {
+				system.computeStep();
+			}
+			double const seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			if (*threads == 1) {
+				serial_seconds = seconds;
+			}
+
+			std::cout << "Contact islands, piles: " << num_piles << ", bodies: " << system.getBodies().size()
+				<< ", islands: " << system.getIslands().getNumIslands() << ", threads: " << *threads
+				<< ", ms/step: " << seconds / steps * 1e3 << ", speedup: " << serial_seconds / seconds
+				<< ", identical to serial: " << (identicalStates(serial, system) ? "yes" : "NO") << std::endl;
+			check(identicalStates(serial, system), "contact islands", "parallel trajectory differs from the serial one");
+		}
+	}
+
+	void Benchmark::colouredContacts(size_t const bodies_per_side, size_t const steps) {
+		size_t const hardware_threads = std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(2));
+		math::quaternionr const orientation = math::quaternionr(real(1), real(0), real(0), real(0));
+		real const radius[Body::MAX_SHAPE_PARAMETERS] = { real(1), real(0), real(0), real(0) };
+
+		// The same block of slightly overlapping spheres on one thread and on all of them
+		System serial(real(0), real(1) / real(30));
+		System parallel(real(0), real(1) / real(30));
+		serial.setNumThreads(1);
+		parallel.setNumThreads(hardware_threads);
+		System * const systems[2] = { &serial, &parallel };
+		for (size_t s = 0; s < 2; s++) {
+			for (size_t i = 0; i < bodies_per_side; i++) {
+				for (size_t j = 0; j < bodies_per_side; j++) {
+					for (size_t k = 0; k < bodies_per_side; k++) {
+						math::vec3r const center = math::vec3r({ real(1.6) * i, real(1.6) * j, real(1.6) * k });
+						systems[s]->createBody(SHAPE_SPHERE, radius, center, real(1), orientation, real(0.5));
+					}
+				}
+			}
+
+			double seconds = 0.0;
+			for (size_t step = 0; step < steps; step++) {
+				systems[s]->computeStep();
+				seconds += systems[s]->getStepStatistics().step_time;
+			}
+
+			StepStatistics const & statistics = systems[s]->getStepStatistics();
+			std::cout << "Coloured contacts, bodies: " << statistics.num_bodies << ", pairs: " << statistics.num_pairs
+				<< ", contacts: " << statistics.num_contacts << ", particle contacts: " << statistics.num_particle_contacts
+				<< " (" << statistics.num_persistent_contacts << " persistent), active particles: " << statistics.num_active_particles
+				<< ", coloured islands: " << statistics.num_coloured_islands
+				<< ", batches: " << statistics.num_colour_batches << ", efficiency: " << statistics.colour_efficiency
+				<< ", threads: " << systems[s]->getNumThreads() << ", ms/step: " << seconds / steps * 1e3
+				<< ", identical to serial: " << (identicalStates(serial, *systems[s]) ? "yes" : "NO") << std::endl;
+			check(identicalStates(serial, *systems[s]), "coloured contacts", "parallel trajectory differs from the serial one");
+		}
+	}
+
+	void Benchmark::contactStages(real const particle_diameter, size_t const repetitions) {
+		math::quaternionr const orientation = math::quaternionr(real(1), real(0), real(0), real(0));
+		Sphere sphere_1(math::vec3r({ real(0), real(0), real(0) }), real(1), orientation, real(1));
+		Sphere sphere_2(math::vec3r({ real(1.8), real(0), real(0) }), real(1), orientation, real(1));
+		BodyParticlesDiscretisation body_1(&sphere_1, particle_diameter);
+		BodyParticlesDiscretisation body_2(&sphere_2, particle_diameter);
+		body_1.updateWorldParticles();
+		body_2.updateWorldParticles();
+		BodyParticlesDiscretisation * const bodies[2] = { &body_1, &body_2 };
+
+		// Detection only, the buffer keeps its memory between the repetitions
+		ContactBuffer contacts;
+		auto const detect_start = std::chrono::high_resolution_clock::now();
+		for (size_t r = 0; r < repetitions; r++) {
+			contacts.clear();
+			detectContactsBruteForce(body_1, 0, body_2, 1, true, contacts);
+		}
+		double const detect_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - detect_start).count();
+
+		// Response only, on the same contacts
+		auto const respond_start = std::chrono::high_resolution_clock::now();
+		for (size_t r = 0; r < repetitions; r++) {
+			respondContactsSpringDamper(contacts, 0, contacts.size(), DEFAULT_CONTACT_MATERIAL, bodies);
+		}
+		double const respond_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - respond_start).count();
+		body_1.transferForcesParticlesBody();
+		body_2.transferForcesParticlesBody();
+
+		double const pairs = static_cast<double>(body_1.getNumParticles()) * body_2.getNumParticles();
+		std::cout << "Contact stages, particles: " << body_1.getNumParticles() + body_2.getNumParticles()
+			<< ", contacts: " << contacts.size()
+			<< ", detection ns/particle pair: " << detect_seconds / repetitions / pairs * 1e9
+			<< ", response ns/contact: " << respond_seconds / repetitions / std::max(static_cast<double>(contacts.size()), 1.0) * 1e9
+			<< std::endl;
+		check(contacts.size() > 0, "contact stages", "overlapping spheres have no contacts");
+	}
+
+	void Benchmark::stiffContacts(real const stiffness, real const duration) {
+		System::IntegrationMode const modes[2] = { System::INTEGRATION_EXPLICIT_EULER, System::INTEGRATION_LINEARLY_IMPLICIT_EULER };
+		char const * const mode_names[2] = { "explicit", "implicit" };
+		ContactMaterial const material = { static_cast<contact_real>(stiffness), DEFAULT_CONTACT_MATERIAL.damping };
+
+		for (size_t m = 0; m < 2; m++) {
+			for (size_t steps_per_second = 30; steps_per_second <= 1920; steps_per_second *= 4) {
+				std::vector<Body *> spheres;
+				std::vector<BodyParticlesDiscretisation *> discretisations;
+
+				// One sphere falling on the static sphere
+				System system(real(0), real(1) / static_cast<real>(steps_per_second));
+				system.setIntegrationMode(modes[m]);
+				system.setContactMaterial(material);
+				createScene(1, real(0.5), system, spheres, discretisations);
+
+				// Contacts without friction can only take energy away, the run is unstable if the
+				// sphere bounces higher than it started
+				size_t const steps = static_cast<size_t>(duration * steps_per_second);
+				real const start_height = system.getStateStore().getPosition(1)(1);
+				real max_height = start_height;
+				size_t iterations = 0;
+				auto const start = std::chrono::high_resolution_clock::now();
+				for (size_t s = 0; s < steps; s++) {
+					system.computeStep();
+					iterations += system.getStepStatistics().num_solver_iterations;
+					real const height = system.getStateStore().getPosition(1)(1);
+					max_height = std::isfinite(height) ? std::max(max_height, height) : real(INFINITY);
+				}
+				double const seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+				bool const stable = max_height < start_height + real(0.01);
+				std::cout << "Stiff contacts, " << mode_names[m] << ", stiffness: " << stiffness
+					<< ", steps/s simulated: " << steps_per_second
+					<< ", " << (stable ? "stable" : "unstable")
+					<< ", max height: " << max_height
+					<< ", final height: " << system.getStateStore().getPosition(1)(1)
+					<< ", CG iterations/step: " << static_cast<double>(iterations) / steps
+					<< ", ms/step: " << seconds / steps * 1e3 << std::endl;
+				// Only the implicit integration has to stay stable at the low rates
+				check(modes[m] != System::INTEGRATION_LINEARLY_IMPLICIT_EULER || stable, "stiff contacts", "implicit integration is unstable");
+
+				destroyScene(spheres, discretisations);
+			}
+		}
+	}
+
+	void Benchmark::contactImpulses(size_t const pile_height, real const duration) {
+		struct Configuration {
+			char const * name;
+			System::IntegrationMode mode;
+			ImpulseIteration iteration;
+			size_t iterations;
+		};
+		Configuration const configurations[4] = {
+			{ "penalty explicit", System::INTEGRATION_EXPLICIT_EULER, IMPULSE_GAUSS_SEIDEL, 0 },
+			{ "penalty implicit", System::INTEGRATION_LINEARLY_IMPLICIT_EULER, IMPULSE_GAUSS_SEIDEL, 0 },
+			{ "impulses Gauss-Seidel", System::INTEGRATION_CONTACT_IMPULSES, IMPULSE_GAUSS_SEIDEL, 10 },
+			{ "impulses Jacobi", System::INTEGRATION_CONTACT_IMPULSES, IMPULSE_JACOBI, 30 }
+		};
+		size_t const steps_per_second = 60;
+		size_t const steps = static_cast<size_t>(duration * steps_per_second);
+
+		for (size_t c = 0; c < 4; c++) {
+			// A straight pile of spheres on a static sphere
+			System system(real(0), real(1) / static_cast<real>(steps_per_second));
+			system.setIntegrationMode(configurations[c].mode);
+			ImpulseSettings settings = DEFAULT_IMPULSE_SETTINGS;
+			settings.iteration = configurations[c].iteration;
+			settings.iterations = configurations[c].iterations;
+			system.setImpulseSettings(settings);
+			math::quaternionr const orientation = math::quaternionr(real(1), real(0), real(0), real(0));
+			real const ground[Body::MAX_SHAPE_PARAMETERS] = { real(4), real(0), real(0), real(0) };
+			real const sphere[Body::MAX_SHAPE_PARAMETERS] = { real(1), real(0), real(0), real(0) };
+			system.createBody(SHAPE_SPHERE, ground, math::vec3r({ real(0), real(-4), real(0) }), real(INFINITY), orientation, real(0.5));
+			for (size_t h = 0; h < pile_height; h++) {
+				system.createBody(SHAPE_SPHERE, sphere, math::vec3r({ real(0), real(1.05) + real(2.1) * h, real(0) }),
+								  real(1), orientation, real(0.5));
+			}
+
+			// The pile is stable if its top never rises. Without friction a straight pile is an
+			// unstable equilibrium, the sideways drift of the top shows when it starts to fall
+			real const start_height = system.getStateStore().getPosition(pile_height)(1);
+			real max_height = start_height;
+			auto const start = std::chrono::high_resolution_clock::now();
+			for (size_t s = 0; s < steps; s++) {
+				system.computeStep();
+				real const height = system.getStateStore().getPosition(pile_height)(1);
+				max_height = std::isfinite(height) ? std::max(max_height, height) : real(INFINITY);
+			}
+			double const seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			math::vec3r const top = system.getStateStore().getPosition(pile_height);
+			contact_real max_depth = contact_real(0);
+			std::vector<ContactBuffer> const & buffers = system.getContactBuffers();
+			for (auto contacts = buffers.begin(); contacts != buffers.end(); contacts++) {
+				for (size_t contact = 0; contact < contacts->size(); contact++) {
+					max_depth = std::max(max_depth, contacts->depth[contact]);
+				}
+			}
+
+			bool const stable = max_height < start_height + real(0.01);
+			std::cout << "Contact impulses, " << configurations[c].name << ", pile: " << pile_height
+				<< ", steps/s simulated: " << steps_per_second
+				<< ", " << (stable ? "stable" : "unstable")
+				<< ", top height: " << system.getStateStore().getPosition(pile_height)(1) << " (start " << start_height << ")"
+				<< ", top drift: " << std::sqrt(top(0) * top(0) + top(2) * top(2))
+				<< ", max particle penetration: " << max_depth
+				<< ", ms/step: " << seconds / steps * 1e3 << std::endl;
+			check(stable, "contact impulses", "pile is unstable");
+		}
+	}
+
+	void Benchmark::touchingBodies(real const particle_diameter, size_t const repetitions) {
+		struct Configuration {
+			char const * name;
+			ContactDetector detector;
+		};
+		Configuration const configurations[4] = {
+			{ "brute force", detectContactsBruteForce },
+			{ "hash grid", detectContactsHashGrid },
+			{ "sphere tree", detectContactsSphereTree },
+			{ "particle levels", detectContactsParticleLevels }
+		};
+
+		// Two large finely discretised spheres whose surfaces overlap by half a particle
+		math::quaternionr const orientation = math::quaternionFromAngleAxis(real(0.3), math::normalize(math::vec3r({ 1, 2, 3 })));
+		Sphere sphere_1(math::vec3r({ real(0), real(0), real(0) }), real(1), orientation, real(1));
+		Sphere sphere_2(math::vec3r({ real(2) - real(0.5) * particle_diameter, real(0), real(0) }), real(1), orientation, real(1));
+		BodyParticlesDiscretisation body_1(&sphere_1, particle_diameter);
+		BodyParticlesDiscretisation body_2(&sphere_2, particle_diameter);
+		body_1.updateWorldParticles();
+		body_2.updateWorldParticles();
+
+		std::vector<std::uint32_t> reference;
+		for (size_t c = 0; c < 4; c++) {
+			ContactBuffer contacts;
+			auto const start = std::chrono::high_resolution_clock::now();
+			for (size_t r = 0; r < repetitions; r++) {
+				contacts.clear();
+				configurations[c].detector(body_1, 0, body_2, 1, true, contacts);
+			}
+			double const seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+			// Every detector finds the same contacts in the same order
+			std::vector<std::uint32_t> found;
+			for (size_t contact = 0; contact < contacts.size(); contact++) {
+				found.push_back(contacts.first_particle[contact]);
+				found.push_back(contacts.second_particle[contact]);
+			}
+			if (c == 0) {
+				reference = found;
+			}
+
+			std::cout << "Touching bodies, " << configurations[c].name
+				<< ", particles: " << body_1.getNumParticles() + body_2.getNumParticles()
+				<< ", contacts: " << contacts.size()
+				<< ", same contacts: " << (found == reference ? "yes" : "no")
+				<< ", ms/detection: " << seconds / repetitions * 1e3 << std::endl;
+			check(found == reference, "touching bodies", "detector finds different contacts than brute force");
+		}
+	}
+
+	void Benchmark::distanceFieldContacts(real const particle_diameter, size_t const repetitions) {
+		struct Configuration {
+			char const * name;
+			ContactDetector detector;
+		};
+		Configuration const configurations[2] = {
+			{ "particles, sphere tree", detectContactsSphereTree },
+			{ "distance field", detectContactsDistanceField }
+		};
+
+		// Two spheres whose surfaces overlap by half a particle, the first one samples the field
+		// of the second one. The normals of the particle pairs depend on how the two lattices
+		// meet, the errors are summed over several orientations of the pair
+		size_t const num_orientations = 8;
+		size_t num_particles = 0;
+		size_t num_contacts[2] = { 0, 0 };
+		double angle_sums[2] = { 0.0, 0.0 };
+		double detection_seconds[2] = { 0.0, 0.0 };
+		double build_seconds = 0.0;
+		double field_seconds = 0.0;
+		for (size_t o = 0; o < num_orientations; o++) {
+			real const angle = real(7) + real(45) * static_cast<real>(o);
+			math::quaternionr const orientation = math::quaternionFromAngleAxis(angle, math::normalize(math::vec3r({ 1, 2, 3 })));
+			Sphere sphere_1(math::vec3r({ real(0), real(0), real(0) }), real(1), orientation, real(1));
+			Sphere sphere_2(math::vec3r({ real(2) - real(0.5) * particle_diameter, real(0), real(0) }), real(1), orientation, real(1));
+			auto const build_start = std::chrono::high_resolution_clock::now();
+			BodyParticlesDiscretisation body_1(&sphere_1, particle_diameter);
+			BodyParticlesDiscretisation body_2(&sphere_2, particle_diameter);
+			build_seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - build_start).count();
+			auto const field_start = std::chrono::high_resolution_clock::now();
+			body_2.buildDistanceField();
+			field_seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - field_start).count();
+			body_1.updateWorldParticles();
+			body_2.updateWorldParticles();
+			math::vec3r const center_2 = sphere_2.getCenterOfMass();
+			num_particles = body_1.getNumParticles() + body_2.getNumParticles();
+
+			for (size_t c = 0; c < 2; c++) {
+				ContactBuffer contacts;
+				auto const start = std::chrono::high_resolution_clock::now();
+				for (size_t r = 0; r < repetitions; r++) {
+					contacts.clear();
+					configurations[c].detector(body_1, 0, body_2, 1, true, contacts);
+				}
+				detection_seconds[c] += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+				// Angle between the contact normals and the normal of the second sphere at the
+				// particles of the first one
+				ParticleWorldBuffer const & world = body_1.getWorldParticles();
+				for (size_t contact = 0; contact < contacts.size(); contact++) {
+					size_t const p = contacts.first_particle[contact];
+					math::vec3r const inward = math::normalize(center_2 - math::vec3r({ static_cast<real>(world.px[p]),
+																						static_cast<real>(world.py[p]),
+																						static_cast<real>(world.pz[p]) }));
+					real const cosine = inward(0) * contacts.nx[contact] + inward(1) * contacts.ny[contact] + inward(2) * contacts.nz[contact];
+					angle_sums[c] += std::acos(std::min(std::max(static_cast<double>(cosine), -1.0), 1.0)) * 180.0 / 3.14159265358979;
+				}
+				num_contacts[c] += contacts.size();
+			}
+		}
+
+		double mean_errors[2];
+		for (size_t c = 0; c < 2; c++) {
+			mean_errors[c] = angle_sums[c] / std::max(static_cast<double>(num_contacts[c]), 1.0);
+			std::cout << "Distance field contacts, " << configurations[c].name
+				<< ", particles: " << num_particles
+				<< ", orientations: " << num_orientations
+				<< ", contacts: " << num_contacts[c]
+				<< ", mean normal error deg: " << mean_errors[c]
+				<< ", ms/detection: " << detection_seconds[c] / (repetitions * num_orientations) * 1e3
+				<< ", ms to build both bodies: " << build_seconds / num_orientations * 1e3
+				<< ", ms to build the field: " << field_seconds / num_orientations * 1e3 << std::endl;
+		}
+		check(num_contacts[1] > 0 && mean_errors[1] < 5.0 && mean_errors[1] < mean_errors[0],
+			  "distance field contacts", "field normals are not more accurate than the particle normals");
+	}
+
+	void Benchmark::multiScaleContacts(size_t const bodies_per_side, size_t const steps) {
+		struct Configuration {
+			char const * name;
+			System::BroadPhase broad_phase;
+			ContactDetector detector;
+		};
+		Configuration const configurations[5] = {
+			{ "sweep and prune, brute force", System::BROAD_PHASE_SWEEP_AND_PRUNE, detectContactsBruteForce },
+			{ "sweep and prune, hash grid", System::BROAD_PHASE_SWEEP_AND_PRUNE, detectContactsHashGrid },
+			{ "hash grid, brute force", System::BROAD_PHASE_HASH_GRID, detectContactsBruteForce },
+			{ "hash grid, hash grid", System::BROAD_PHASE_HASH_GRID, detectContactsHashGrid },
+			{ "hash grid, particle levels", System::BROAD_PHASE_HASH_GRID, detectContactsParticleLevels }
+		};
+
+		std::vector<real> reference;
+		for (size_t c = 0; c < 5; c++) {
+			// A layer of small finely discretised spheres falling on a large coarse static sphere
+			System system(real(0), real(1) / real(60));
+			system.setBroadPhase(configurations[c].broad_phase);
+			system.setContactStages(configurations[c].detector, respondContactsSpringDamper);
+			math::quaternionr const orientation = math::quaternionr(real(1), real(0), real(0), real(0));
+			real const ground[Body::MAX_SHAPE_PARAMETERS] = { real(20), real(0), real(0), real(0) };
+			real const sphere[Body::MAX_SHAPE_PARAMETERS] = { real(0.25), real(0), real(0), real(0) };
+			system.createBody(SHAPE_SPHERE, ground, math::vec3r({ real(0), real(-20), real(0) }), real(INFINITY), orientation, real(1));
+			real const half_side = real(0.3) * static_cast<real>(bodies_per_side);
+			for (size_t i = 0; i < bodies_per_side; i++) {
+				for (size_t k = 0; k < bodies_per_side; k++) {
+					math::vec3r const cm = math::vec3r({ real(0.6) * i - half_side, real(0.2), real(0.6) * k - half_side });
+					system.createBody(SHAPE_SPHERE, sphere, cm, real(1), orientation, real(0.1));
+				}
+			}
+
+			size_t pairs = 0;
+			size_t particle_contacts = 0;
+			auto const start = std::chrono::high_resolution_clock::now();
+			for (size_t s = 0; s < steps; s++) {
+				system.computeStep();
+				pairs += system.getStepStatistics().num_pairs;
+				particle_contacts += system.getStepStatistics().num_particle_contacts;
+			}
+			double const seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+			// The broad phases find the same pairs and the detectors the same contacts in the
+			// same order, the trajectories are identical
+			std::vector<real> positions;
+			for (size_t b = 0; b < system.getBodies().size(); b++) {
+				math::vec3r const x = system.getStateStore().getPosition(b);
+				positions.insert(positions.end(), { x(0), x(1), x(2) });
+			}
+			if (c == 0) {
+				reference = positions;
+			}
+
+			std::cout << "Multi-scale contacts, " << configurations[c].name
+				<< ", bodies: " << system.getBodies().size()
+				<< ", pairs/step: " << static_cast<double>(pairs) / steps
+				<< ", particle contacts/step: " << static_cast<double>(particle_contacts) / steps
+				<< ", same trajectory: " << (positions == reference ? "yes" : "no")
+				<< ", ms/step: " << seconds / steps * 1e3 << std::endl;
+			check(positions == reference, "multi-scale contacts", "trajectory differs from sweep and prune with brute force");
+		}
+	}
+
+	void Benchmark::analyticContacts(size_t const bodies_per_side, size_t const steps) {
+		for (size_t c = 0; c < 2; c++) {
+			// Two layers of spheres, one in the gaps of the other, falling on a static plane
+			System system(real(0), real(1) / real(60));
+			system.setContactStages(detectContactsSphereTree, respondContactsSpringDamper);
+			system.setAnalyticContacts(c == 1);
+			math::quaternionr const orientation = math::quaternionr(real(1), real(0), real(0), real(0));
+			real const ground[Body::MAX_SHAPE_PARAMETERS] = { real(20), real(20), real(0.5), real(0) };
+			real const sphere[Body::MAX_SHAPE_PARAMETERS] = { real(0.5), real(0), real(0), real(0) };
+			system.createBody(SHAPE_PLANE, ground, math::vec3r({ real(0), real(-0.5), real(0) }), real(INFINITY), orientation, real(0.25));
+			real const half_side = real(0.55) * static_cast<real>(bodies_per_side);
+			for (size_t layer = 0; layer < 2; layer++) {
+				for (size_t i = 0; i < bodies_per_side; i++) {
+					for (size_t k = 0; k < bodies_per_side; k++) {
+						math::vec3r const cm = math::vec3r({ real(1.1) * i - half_side + real(0.55) * layer, real(0.52) + real(0.8) * layer,
+															 real(1.1) * k - half_side + real(0.55) * layer });
+						system.createBody(SHAPE_SPHERE, sphere, cm, real(1), orientation, real(0.1));
+					}
+				}
+			}
+
+			size_t particle_contacts = 0;
+			auto const start = std::chrono::high_resolution_clock::now();
+			for (size_t s = 0; s < steps; s++) {
+				system.computeStep();
+				particle_contacts += system.getStepStatistics().num_particle_contacts;
+			}
+			double const seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+			// Height of the bottom layer, the spheres rest at their radius minus the depth
+			real bottom_height = real(0);
+			for (size_t b = 1; b <= bodies_per_side * bodies_per_side; b++) {
+				bottom_height += system.getStateStore().getPosition(b)(1);
+			}
+			bottom_height /= static_cast<real>(bodies_per_side * bodies_per_side);
+
+			std::cout << "Analytic contacts, " << (c == 1 ? "analytic" : "particles, sphere tree")
+				<< ", bodies: " << system.getBodies().size()
+				<< ", contacts/step: " << static_cast<double>(particle_contacts) / steps
+				<< ", bottom layer height: " << bottom_height
+				<< ", ms/step: " << seconds / steps * 1e3 << std::endl;
+			// The plane surface is at zero, the bottom layer rests about one radius above it
+			check(std::abs(bottom_height - real(0.5)) < real(0.05), "analytic contacts", "bottom layer does not rest on the plane");
+		}
+	}
+
+	void Benchmark::stateIntegration(size_t const num_bodies, size_t const steps) {
+		// Spinning and moving bodies
+		BodyStateStore states;
+		math::mat3x3r inertia, inv_inertia;
+		for (size_t i = 0; i < 3; i++) {
+			inertia(i, i) = real(0.4) * (i + 1);
+			inv_inertia(i, i) = real(1) / inertia(i, i);
+		}
+		for (size_t b = 0; b < num_bodies; b++) {
+			size_t const index = states.add(real(1), math::vec3r({ real(b % 64), real(b / 64), real(0) }),
+											math::quaternionFromAngleAxis(real(b % 360), math::normalize(math::vec3r({ 1, 2, 3 }))));
+			states.setInertiaTensorBody(index, inertia, inv_inertia);
+			states.setLinearMomentum(index, math::vec3r({ real(0), real(1), real(0) }));
+			states.setAngularMomentum(index, math::vec3r({ real(0.1), real(0), real(0.2) }));
+		}
+		states.computeDerivedQuantities();
+
+		// Time the integration sweeps, forces are left to zero
+		real const delta_t = real(1) / real(30);
+		auto const start = std::chrono::high_resolution_clock::now();
+		for (size_t s = 0; s < steps; s++) {
+			states.computeStateDerivative();
+			real * const y = states.state(0);
+			EulerSolver::odeStep(y, states.ddtState(0), y, BodyStateStore::STATE_SIZE * states.capacity(), delta_t * s, delta_t * (s + 1));
+			states.computeDerivedQuantities();
+		}
+		auto const end = std::chrono::high_resolution_clock::now();
+		double const seconds = std::chrono::duration<double>(end - start).count();
+
+		// Same steps through the index list of an island holding all the bodies
+		std::vector<std::uint32_t> indices(num_bodies);
+		for (size_t b = 0; b < num_bodies; b++) {
+			indices[b] = static_cast<std::uint32_t>(b);
+		}
+		auto const list_start = std::chrono::high_resolution_clock::now();
+		for (size_t s = 0; s < steps; s++) {
+			states.integrateEuler(indices.data(), num_bodies, delta_t);
+		}
+		double const list_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - list_start).count();
+
+		std::cout << "Body state integration, bodies: " << num_bodies << ", steps: " << steps
+			<< ", Mbodies/s: " << static_cast<double>(num_bodies * steps) / seconds * 1e-6
+			<< ", index list Mbodies/s: " << static_cast<double>(num_bodies * steps) / list_seconds * 1e-6 << std::endl;
+	}
+
+	void Benchmark::orientationIntegration(real const spin, real const duration) {
+		BodyStateStore::OrientationIntegration const integrations[3] = {
+			BodyStateStore::ORIENTATION_LINEAR, BodyStateStore::ORIENTATION_EXPONENTIAL, BodyStateStore::ORIENTATION_GYROSCOPIC
+		};
+		char const * const names[3] = { "linear", "exponential", "gyroscopic" };
+		math::mat3x3r inertia, inv_inertia;
+		for (size_t i = 0; i < 3; i++) {
+			inertia(i, i) = real(i + 1);
+			inv_inertia(i, i) = real(1) / inertia(i, i);
+		}
+
+		for (size_t m = 0; m < 3; m++) {
+			for (size_t steps_per_second = 30; steps_per_second <= 480; steps_per_second *= 4) {
+				// Body spinning close to its intermediate axis, without torque it tumbles. The angular
+				// momentum is kept exactly, so the error of the orientation shows in the energy
+				BodyStateStore states;
+				states.setOrientationIntegration(integrations[m]);
+				size_t const index = states.add(real(1), math::vec3r({ real(0), real(0), real(0) }),
+												math::quaternionr(real(1), real(0), real(0), real(0)));
+				states.setInertiaTensorBody(index, inertia, inv_inertia);
+				states.setAngularMomentum(index, real(2) * spin * math::vec3r({ real(0.01), real(1), real(0.01) }));
+				states.computeDerivedQuantities();
+				real const energy = real(0.5) * math::dotProduct(states.getAngularMomentum(index), states.getAngularVelocity(index));
+
+				real const delta_t = real(1) / static_cast<real>(steps_per_second);
+				size_t const steps = static_cast<size_t>(duration * steps_per_second);
+				std::uint32_t const indices[1] = { static_cast<std::uint32_t>(index) };
+				real max_energy_error = real(0);
+				real max_norm_error = real(0);
+				for (size_t s = 0; s < steps; s++) {
+					states.resetForce(index);
+					states.resetTorque(index);
+					states.integrateEuler(indices, 1, delta_t);
+					real const step_energy = real(0.5) * math::dotProduct(states.getAngularMomentum(index), states.getAngularVelocity(index));
+					max_energy_error = std::max(max_energy_error, std::abs(step_energy / energy - real(1)));
+					max_norm_error = std::max(max_norm_error, std::abs(math::magnitude(states.getOrientation(index)) - real(1)));
+				}
+
+				std::cout << "Orientation integration, " << names[m] << ", spin: " << spin << " rad/s"
+					<< ", steps/s simulated: " << steps_per_second
+					<< ", max energy error: " << max_energy_error
+					<< ", max quaternion norm error: " << max_norm_error << std::endl;
+				// Only the linear update lets the norm drift, only the gyroscopic one keeps the energy
+				if (integrations[m] != BodyStateStore::ORIENTATION_LINEAR) {
+					check(max_norm_error < real(1e-4), "orientation integration", "quaternion norm drifts");
+				}
+				if (integrations[m] == BodyStateStore::ORIENTATION_GYROSCOPIC) {
+					check(max_energy_error < real(0.01), "orientation integration", "gyroscopic update does not keep the energy");
+				}
+			}
+		}
+	}
+
+	// Lazy evaluation of R * I^-1 * R^T where every element recomputes the inner products of the
+	// nested product, this is how the expression templates behaved before products were materialised
+	template <typename T>
+	static void lazyWorldInertia(T const R[9], T const I[9], T result[9]) {
+		for (size_t i = 0; i < 3; i++) {
+			for (size_t j = 0; j < 3; j++) {
+				T sum = T(0);
+				for (size_t k = 0; k < 3; k++) {
+					T inner = T(0);
+					for (size_t l = 0; l < 3; l++) {
+						inner += I[k * 3 + l] * R[j * 3 + l];
+					}
+					sum += R[i * 3 + k] * inner;
+				}
+				result[i * 3 + j] = sum;
+			}
+		}
+	}
+
+	void Benchmark::matrixExpressions(size_t const repetitions) {
+		// Cycle through a set of orientations so that the product can not be hoisted out of the loop
+		size_t const num_orientations = 64;
+		std::vector<math::mat3x3r> R;
+		std::vector<real> R_arrays(num_orientations * 9);
+		for (size_t o = 0; o < num_orientations; o++) {
+			R.push_back(math::createMatrix(math::quaternionFromAngleAxis(real(5.625) * o, math::normalize(math::vec3r({ 1, 2, 3 })))));
+			for (size_t i = 0; i < 9; i++) {
+				R_arrays[o * 9 + i] = R.back()(i / 3, i % 3);
+			}
+		}
+		math::mat3x3r inv_I;
+		math::setToIdentity(inv_I);
+		inv_I(0, 0) = real(2.5);
+		inv_I(1, 1) = real(1.5);
+		inv_I(2, 2) = real(0.5);
+		real inv_I_array[9];
+		for (size_t i = 0; i < 9; i++) {
+			inv_I_array[i] = inv_I(i / 3, i % 3);
+		}
+
+		// Expression templates
+		math::mat3x3r world_inertia;
+		real checksum = real(0);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t r = 0; r < repetitions; r++) {
+			math::mat3x3r const & orientation = R[r % num_orientations];
+			world_inertia = orientation * inv_I * math::transpose(orientation);
+			checksum += world_inertia(1, 2);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		double const expression_seconds = std::chrono::duration<double>(end - start).count();
+
+		// Lazy per element evaluation on plain arrays
+		real lazy[9];
+		real lazy_checksum = real(0);
+		start = std::chrono::high_resolution_clock::now();
+		for (size_t r = 0; r < repetitions; r++) {
+			lazyWorldInertia(&R_arrays[(r % num_orientations) * 9], inv_I_array, lazy);
+			lazy_checksum += lazy[5];
+		}
+		end = std::chrono::high_resolution_clock::now();
+		double const lazy_seconds = std::chrono::duration<double>(end - start).count();
+
+		// Compare the last results
+		real max_error = real(0);
+		for (size_t i = 0; i < 9; i++) {
+			max_error = std::max(max_error, std::abs(world_inertia(i / 3, i % 3) - lazy[i]));
+		}
+
+		std::cout << "R * I^-1 * R^T, repetitions: " << repetitions
+			<< ", expression Mops/s: " << static_cast<double>(repetitions) / expression_seconds * 1e-6
+			<< ", lazy Mops/s: " << static_cast<double>(repetitions) / lazy_seconds * 1e-6
+			<< ", max error: " << max_error
+			<< " (checksums " << checksum << " / " << lazy_checksum << ")" << std::endl;
+		check(max_error < real(1e-5), "matrix expressions", "expression templates differ from the lazy evaluation");
+	}
+
+} // pb namespace
\ No newline at end of file
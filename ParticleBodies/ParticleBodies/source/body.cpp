@@ -1,68 +1,147 @@
 #include "body.h"
+#include "arena.h"
+#include "constants.h"
+#include "plane.h"
+#include "sphere.h"
 #include "sphere_graphics.h"
 
 namespace pb {
 
-	Body::Body() {}
+	Body::Body()
+		: states(nullptr), state_index(0), local_states(new BodyStateStore()) {
+		states = local_states.get();
+		state_index = states->add(real(1), math::vec3r({ real(0), real(0), real(0) }), math::quaternionr(real(1), real(0), real(0), real(0)));
+	}
 
-	Body::Body(math::vec3f const & cm, float const mass,
-			   math::quaternionf const & orientation) {
-		// Set mass
-		physical_properties.mass = mass;
-		// Set body center of mass
-		physical_properties.x = cm;
-		// Set body orientation
-		physical_properties.q = orientation;
+	Body::Body(math::vec3r const & cm, real const mass,
+			   math::quaternionr const & orientation, BodyStateStore * const store)
+		: states(store), state_index(0), local_states(store == nullptr ? new BodyStateStore() : nullptr) {
+		// Set mass, center of mass and orientation of the body
+		if (store == nullptr) {
+			states = local_states.get();
+		}
+		state_index = states->add(mass, cm, orientation);
 	}
 
 	Body::~Body() {}
 
-	void Body::addForce(math::vec3f const & f) {
-		physical_properties.force = physical_properties.force + f;
+	Body * Body::create(ShapeType const type, real const parameters[MAX_SHAPE_PARAMETERS],
+						math::vec3r const & cm, real const mass,
+						math::quaternionr const & orientation,
+						BodyStateStore * const store, Arena * const arena) {
+		switch (type) {
+		case SHAPE_SPHERE:
+			if (arena != nullptr) {
+				return arena->create<Sphere>(cm, mass, orientation, parameters[0], store);
+			}
+			return new Sphere(cm, mass, orientation, parameters[0], store);
+		case SHAPE_PLANE:
+			if (arena != nullptr) {
+				return arena->create<Plane>(cm, mass, orientation, parameters[0], parameters[1], parameters[2], store);
+			}
+			return new Plane(cm, mass, orientation, parameters[0], parameters[1], parameters[2], store);
+		default:
+			return nullptr;
+		}
+	}
+
+	real Body::getShapeVolume(ShapeType const type, real const parameters[MAX_SHAPE_PARAMETERS]) {
+		switch (type) {
+		case SHAPE_SPHERE:
+			return (real(4) / real(3) * real(PI) * parameters[0] * parameters[0] * parameters[0]);
+		case SHAPE_PLANE:
+			return (real(8) * parameters[0] * parameters[1] * parameters[2]);
+		default:
+			return real(0);
+		}
+	}
+
+	void Body::bindStateStore(BodyStateStore * const store) {
+		if (store == states) {
+			return;
+		}
+		// Copy the body to the new store and release the local one
+		state_index = store->add(*states, state_index);
+		states = store;
+		local_states.reset();
+	}
+
+	void Body::releaseStateStore() {
+		if (local_states) {
+			return;
+		}
+		std::unique_ptr<BodyStateStore> store(new BodyStateStore());
+		state_index = store->add(*states, state_index);
+		local_states.swap(store);
+		states = local_states.get();
+	}
+
+	BodyStateStore * Body::getStateStore() const {
+		return states;
+	}
+
+	size_t Body::getStateIndex() const {
+		return state_index;
+	}
+
+	void Body::setStateIndex(size_t const index) {
+		state_index = index;
+	}
+
+	void Body::addForce(math::vec3r const & f) {
+		states->addForce(state_index, f);
 	}
 
 	void Body::resetForce() {
-		physical_properties.force(0) = 0;
-		physical_properties.force(1) = 0;
-		physical_properties.force(2) = 0;
+		states->resetForce(state_index);
 	}
 
-	void Body::addForceAsTorque(math::vec3f const & f, math::vec3f const & p) {
-		physical_properties.torque = physical_properties.torque + math::crossProduct(f, p);
+	void Body::addForceAsTorque(math::vec3r const & f, math::vec3r const & p) {
+		states->addTorque(state_index, math::crossProduct(p, f));
 	}
 
 	void Body::resetTorque() {
-		physical_properties.torque(0) = 0;
-		physical_properties.torque(1) = 0;
-		physical_properties.torque(2) = 0;
+		states->resetTorque(state_index);
 	}
 
-	math::vec3f const & Body::getCenterOfMass() const {
-		return physical_properties.x;
+	bool Body::signedDistance(math::vec3r const & /* p */, real & /* distance */) const {
+		return false;
 	}
 
-	math::mat4x4f Body::getOrientationMatrix() const {
-		return math::createRotationMatrix(math::normalize(physical_properties.q));
+	real Body::getMass() const {
+		return states->getMass(state_index);
 	}
 
-	math::vec3f Body::pointVelocityWorld(math::vec3f const & p) const {
-		return (physical_properties.v + math::crossProduct(physical_properties.omega, p - physical_properties.x));
+	math::vec3r Body::getCenterOfMass() const {
+		return states->getPosition(state_index);
 	}
 
-	math::vec3f Body::pointVelocityLocal(math::vec3f const & p) const {
-		return (math::crossProduct(physical_properties.omega, p));
+	math::mat4x4r const & Body::getOrientationMatrix() const {
+		return states->getOrientationMatrix(state_index);
 	}
 
-	void Body::bodyStateToArray(float y[]) const {
-		stateToArray(&physical_properties, y);
+	math::mat4x4r const & Body::getModelMatrix() const {
+		return states->getModelMatrix(state_index);
 	}
 
-	void Body::arrayToBodyState(float const y[]) {
-		arrayToState(&physical_properties, y);
+	math::mat3x3r const & Body::getRotationMatrix() const {
+		return states->getRotationMatrix(state_index);
 	}
 
-	void Body::ddtBodyStateToArray(float y_dot[]) const {
-		ddtStateToArray(&physical_properties, y_dot);
+	math::vec3r Body::getLinearVelocity() const {
+		return states->getLinearVelocity(state_index);
+	}
+
+	math::vec3r Body::getAngularVelocity() const {
+		return states->getAngularVelocity(state_index);
+	}
+
+	math::vec3r Body::pointVelocityWorld(math::vec3r const & p) const {
+		return (getLinearVelocity() + math::crossProduct(getAngularVelocity(), p - getCenterOfMass()));
+	}
+
+	math::vec3r Body::pointVelocityLocal(math::vec3r const & p) const {
+		return (math::crossProduct(getAngularVelocity(), p));
 	}
 
 	void Body::drawBody(GLuint const v_buff,
@@ -81,9 +160,7 @@ namespace pb {
 		// Preprocess
 		drawPreprocess();
 
-		//glPolygonMode(GL_FRONT, GL_LINE);
-		glDrawElements(GL_TRIANGLES, num_elements, GL_UNSIGNED_SHORT, (GLvoid*)0);
-		glPolygonMode(GL_FRONT, GL_FILL);
+		drawShape(num_elements);
 
 		// Postprocess
 		drawPostprocess();
@@ -97,4 +174,10 @@ namespace pb {
 		glDisableClientState(GL_NORMAL_ARRAY);
 	}
 
+	void Body::drawShape(GLuint const num_elements) const {
+		//glPolygonMode(GL_FRONT, GL_LINE);
+		glDrawElements(GL_TRIANGLES, num_elements, GL_UNSIGNED_SHORT, (GLvoid*)0);
+		glPolygonMode(GL_FRONT, GL_FILL);
+	}
+
 } // pb namespace
\ No newline at end of file
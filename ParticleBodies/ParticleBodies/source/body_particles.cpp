@@ -1,48 +1,115 @@
 #include "body_particles.h"
 #include "body.h"
 #include "voxel_grid.h"
-
-// DEBUG
-#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace pb {
 
-	BodyParticlesDiscretisation::BodyParticlesDiscretisation(Body * const body, float const particle_diameter)
+	BodyParticlesDiscretisation::BodyParticlesDiscretisation(Body * const body, real const particle_diameter)
 		: body(body) {
-		// Generate particles
-		generateParticles(particle_diameter, true);
+		// Generate particles, they can be larger than requested
+		real const effective_diameter = generateParticles(particle_diameter, true);
+		spacing = static_cast<contact_real>(effective_diameter);
+		particle_radius = static_cast<contact_real>(effective_diameter / 2);
+		computeLocalBounds();
+		particle_tree.build(particles.data(), particles.size(), origin, spacing, particle_radius);
+		particle_levels.build(particles.data(), particles.size(), origin, spacing, particle_radius);
+		particle_active.assign(particles.size(), 0);
+	}
+
+	BodyParticlesDiscretisation::BodyParticlesDiscretisation(Body * const body, contact_real const origin[3],
+															 contact_real const spacing, contact_real const particle_radius,
+															 std::vector<Particle> const & particles)
+		: body(body), spacing(spacing), particle_radius(particle_radius), particles(particles) {
+		this->origin[0] = origin[0];
+		this->origin[1] = origin[1];
+		this->origin[2] = origin[2];
+		computeLocalBounds();
+		particle_tree.build(this->particles.data(), this->particles.size(), this->origin, spacing, particle_radius);
+		particle_levels.build(this->particles.data(), this->particles.size(), this->origin, spacing, particle_radius);
+		particle_active.assign(particles.size(), 0);
 	}
 
-	void BodyParticlesDiscretisation::generateParticles(float const particle_diameter,
+	BodyParticlesDiscretisation::BodyParticlesDiscretisation(Body * const body, BodyParticlesDiscretisation const & shape)
+		: body(body), spacing(shape.spacing), particle_radius(shape.particle_radius), particles(shape.particles),
+		particle_tree(shape.particle_tree), particle_levels(shape.particle_levels), distance_field(shape.distance_field) {
+		origin[0] = shape.origin[0];
+		origin[1] = shape.origin[1];
+		origin[2] = shape.origin[2];
+		for (size_t c = 0; c < 3; c++) {
+			local_min[c] = shape.local_min[c];
+			local_max[c] = shape.local_max[c];
+		}
+		particle_active.assign(particles.size(), 0);
+	}
+
+	real BodyParticlesDiscretisation::generateParticles(real const requested_diameter,
 														bool const process_interior) {
 		// Request to body BBOX 
-		math::vec3f min, max;
+		math::vec3r min, max;
 		body->generateBBOX(&min, &max);
+		// The particles are offsets in body space, a rotated body is sampled through its rotation
+		// in a box around the center of mass enclosing the world box in body space
+		math::quaternionr const orientation = body->getStateStore()->getUnitOrientation(body->getStateIndex());
+		math::vec3r const imaginary = orientation.getImmaginary();
+		bool const rotated = imaginary(0) != real(0) || imaginary(1) != real(0) || imaginary(2) != real(0);
+		math::mat3x3r const & R = body->getRotationMatrix();
+		math::vec3r const cm = body->getCenterOfMass();
+		if (rotated) {
+			math::vec3r const half_extents = real(0.5) * (max - min);
+			math::vec3r const center = real(0.5) * (max + min) - cm;
+			for (size_t c = 0; c < 3; c++) {
+				real extent = real(0);
+				for (size_t r = 0; r < 3; r++) {
+					extent += std::abs(R(r, c)) * (half_extents(r) + std::abs(center(r)));
+				}
+				min(c) = cm(c) - extent;
+				max(c) = cm(c) + extent;
+			}
+		}
 		// Compute BBOX dims
-		math::vec3f dim = max - min;
+		math::vec3r dim = max - min;
+		// Particles are stored as 16 bit voxel coordinates, a body needing more voxels along an
+		// axis gets larger particles instead of wrapping them
+		real particle_diameter = requested_diameter;
+		real const max_dim = std::max(dim(0), std::max(dim(1), dim(2)));
+		if (ceil(max_dim / particle_diameter) > real(INT16_MAX)) {
+			particle_diameter = max_dim / real(INT16_MAX - 1);
+		}
 		// Find how many particle's boxes we have in each direction
 		size_t const part_x = static_cast<size_t>(ceil(dim(0) / particle_diameter));
 		size_t const part_y = static_cast<size_t>(ceil(dim(1) / particle_diameter));
 		size_t const part_z = static_cast<size_t>(ceil(dim(2) / particle_diameter));
 		// Check how much we are outside of the BBOX limits
-		math::vec3f offset = math::vec3f({ part_x * particle_diameter,
+		math::vec3r offset = math::vec3r({ part_x * particle_diameter,
 										 part_y  * particle_diameter,
 										 part_z * particle_diameter });
 		// Subtract BBOX dimensions
 		offset = offset - dim;
 		// Compute boxes minimum and maximum
-		math::vec3f const box_min = min - (0.5f * offset);
-		math::vec3f const box_max = max + (0.5f * offset);
+		math::vec3r const box_min = min - (real(0.5) * offset);
+		math::vec3r const box_max = max + (real(0.5) * offset);
 
 		// Create voxel grid
 		VoxelGrid<bool> voxel_grid = VoxelGrid<bool>(part_x, part_y, part_z, box_min, box_max);
 
+		// Set the origin of the particles grid, the center of the first voxel in body space
+		math::vec3r const grid_origin = voxel_grid.getVoxelCenter(0, 0, 0) - cm;
+		origin[0] = static_cast<contact_real>(grid_origin(0));
+		origin[1] = static_cast<contact_real>(grid_origin(1));
+		origin[2] = static_cast<contact_real>(grid_origin(2));
+
 		// Loop over all voxels and set voxel to true if inside the object
 		for (size_t voxel_y = 0; voxel_y < part_y; voxel_y++) {
 			for (size_t voxel_z = 0; voxel_z < part_z; voxel_z++) {
 				for (size_t voxel_x = 0; voxel_x < part_x; voxel_x++) {
 					// Get voxel center
-					math::vec3f voxel_center = voxel_grid.getVoxelCenter(voxel_x, voxel_y, voxel_z);
+					math::vec3r voxel_center = voxel_grid.getVoxelCenter(voxel_x, voxel_y, voxel_z);
+					if (rotated) {
+						voxel_center = cm + R * (voxel_center - cm);
+					}
 					// Check if voxel is inside
 					if (body->pointInside(voxel_center)) {
 						voxel_grid.setElement(voxel_x, voxel_y, voxel_z, true);
@@ -62,18 +129,118 @@ namespace pb {
 				for (size_t voxel_x = 0; voxel_x < part_x; voxel_x++) {
 					// Check if voxel is inside object
 					if (voxel_grid.getElement(voxel_x, voxel_y, voxel_z)) {
-						// Compute voxel center
-						math::vec3f voxel_center = voxel_grid.getVoxelCenter(voxel_x, voxel_y, voxel_z);
 						// Add particle
-						particles.push_back(Particle(voxel_center - body->getCenterOfMass(), particle_diameter / 2.f));
+						particles.push_back(Particle(static_cast<std::int16_t>(voxel_x),
+													 static_cast<std::int16_t>(voxel_y),
+													 static_cast<std::int16_t>(voxel_z)));
 					}
 				}
 			}
 		}
+
+		return (particle_diameter);
+	}
+
+	void BodyParticlesDiscretisation::buildDistanceField() {
+		std::shared_ptr<SignedDistanceField> const field = std::make_shared<SignedDistanceField>();
+		field->build(*body, particles.data(), particles.size(), origin, spacing);
+		distance_field = field;
+	}
+
+	void BodyParticlesDiscretisation::computeLocalBounds() {
+		for (size_t c = 0; c < 3; c++) {
+			local_min[c] = std::numeric_limits<contact_real>::infinity();
+			local_max[c] = -std::numeric_limits<contact_real>::infinity();
+		}
+		for (auto particle = particles.begin(); particle != particles.end(); particle++) {
+			math::vec3c const position = particlePositionLocal(*particle);
+			for (size_t c = 0; c < 3; c++) {
+				local_min[c] = std::min(local_min[c], position(c));
+				local_max[c] = std::max(local_max[c], position(c));
+			}
+		}
+	}
+
+	math::vec3c BodyParticlesDiscretisation::particlePositionLocal(Particle const & particle) const {
+		math::vec3c position;
+		decodeParticleOffset(particle.voxel, origin, spacing, &position(0));
+
+		return (position);
+	}
+
+	math::vec3c BodyParticlesDiscretisation::particlePositionWorld(Particle const & particle) const {
+		return (math::vec3c(body->getCenterOfMass() + body->getRotationMatrix() * math::vec3r(particlePositionLocal(particle))));
+	}
+
+	void BodyParticlesDiscretisation::updateWorldTransform() {
+		// Convert body pose to contact precision
+		BodyTransform & transform = world_transform;
+		math::mat3x3r const & R = body->getRotationMatrix();
+		for (size_t r = 0; r < 3; r++) {
+			for (size_t c = 0; c < 3; c++) {
+				transform.R[r * 3 + c] = static_cast<contact_real>(R(r, c));
+			}
+			transform.x[r] = static_cast<contact_real>(body->getCenterOfMass()(r));
+			transform.v[r] = static_cast<contact_real>(body->getLinearVelocity()(r));
+			transform.omega[r] = static_cast<contact_real>(body->getAngularVelocity()(r));
+		}
+
+		// World box enclosing the rotated box of the particles, grown by the radius and a small
+		// margin so that it contains every contact
+		if (particles.empty()) {
+			for (size_t r = 0; r < 3; r++) {
+				world_min[r] = std::numeric_limits<contact_real>::infinity();
+				world_max[r] = -std::numeric_limits<contact_real>::infinity();
+			}
+			return;
+		}
+		contact_real const extent = particle_radius * contact_real(1.001);
+		for (size_t r = 0; r < 3; r++) {
+			contact_real center = transform.x[r];
+			contact_real half = extent;
+			for (size_t c = 0; c < 3; c++) {
+				center += transform.R[r * 3 + c] * contact_real(0.5) * (local_min[c] + local_max[c]);
+				half += std::abs(transform.R[r * 3 + c]) * contact_real(0.5) * (local_max[c] - local_min[c]);
+			}
+			world_min[r] = center - half;
+			world_max[r] = center + half;
+		}
 	}
 
-	math::vec3f BodyParticlesDiscretisation::particlePositionWorld(Particle const & particle) const {
-		return (body->getCenterOfMass() + math::transformLocation(body->getOrientationMatrix(), particle.position));
+	void BodyParticlesDiscretisation::updateWorldParticles() {
+		updateWorldTransform();
+
+		// Transform all particles in one pass
+		world.resize(particles.size());
+		transformParticles(world_transform, particles.data(), particles.size(), origin, spacing, world, true);
+	}
+
+	void BodyParticlesDiscretisation::releaseWorldParticles() {
+		world.release();
+	}
+
+	BodyTransform const & BodyParticlesDiscretisation::getWorldTransform() const {
+		return world_transform;
+	}
+
+	ParticleSphereTree const & BodyParticlesDiscretisation::getParticleTree() const {
+		return particle_tree;
+	}
+
+	ParticleLevels const & BodyParticlesDiscretisation::getParticleLevels() const {
+		return particle_levels;
+	}
+
+	SignedDistanceField const * BodyParticlesDiscretisation::getDistanceField() const {
+		return distance_field.get();
+	}
+
+	contact_real const * BodyParticlesDiscretisation::getWorldBoundsMin() const {
+		return world_min;
+	}
+
+	contact_real const * BodyParticlesDiscretisation::getWorldBoundsMax() const {
+		return world_max;
 	}
 
 	void BodyParticlesDiscretisation::drawParticles(GLuint const sphere_v_buff,
@@ -102,9 +269,9 @@ namespace pb {
 		for (auto p = particles.begin(); p != particles.end(); p++) {
 			// Translate to particle position, wrt. center of mass
 			glPushMatrix();
-			math::vec3f particle_position = particlePositionWorld(*p);
+			math::vec3c particle_position = particlePositionWorld(*p);
 			glTranslatef(particle_position(0), particle_position(1), particle_position(2));
-			glScalef(p->radius, p->radius, p->radius);
+			glScalef(particle_radius, particle_radius, particle_radius);
 
 			// glPolygonMode(GL_FRONT, GL_LINE);
 			glDrawElements(GL_TRIANGLES, num_elements, GL_UNSIGNED_SHORT, (GLvoid*)0);
@@ -125,60 +292,78 @@ namespace pb {
 		glPopMatrix();
 	}
 
+	ParticleWorldBuffer const & BodyParticlesDiscretisation::getWorldParticles() const {
+		return world;
+	}
+
+	void BodyParticlesDiscretisation::addContactForce(size_t const particle, math::vec3c const & f) {
+		particles[particle].addForce(f);
+		if (!particle_active[particle]) {
+			particle_active[particle] = 1;
+			active_particles.push_back(static_cast<std::uint32_t>(particle));
+		}
+	}
+
+	void BodyParticlesDiscretisation::addContactForceAtPoint(contact_real const point[3], math::vec3c const & f) {
+		// Arm of the force from the center of mass in world space, as for the particle forces
+		math::vec3r const arm = math::vec3r({ static_cast<real>(point[0]), static_cast<real>(point[1]),
+											  static_cast<real>(point[2]) }) - body->getCenterOfMass();
+		PointForce const point_force = { math::vec3r(f), arm };
+		point_forces.push_back(point_force);
+	}
+
 	void BodyParticlesDiscretisation::transferForcesParticlesBody() {
-		// Loop over all particles
-		for (auto particle = particles.begin(); particle != particles.end(); particle++) {
+		// The other particles have no force, visiting the active ones in index order gives the
+		// same sums as a loop over all particles
+		std::sort(active_particles.begin(), active_particles.end());
+		math::mat3x3r const & R = body->getRotationMatrix();
+		for (auto active = active_particles.begin(); active != active_particles.end(); active++) {
+			Particle * const particle = &particles[*active];
+			math::vec3r const force = math::vec3r({ particle->force[0], particle->force[1], particle->force[2] });
 			// Apply force
-			body->addForce(particle->force);
-			// Apply torque
-			body->addForceAsTorque(particle->force, particle->position);
+			body->addForce(force);
+			// Apply torque, the arm is the particle offset rotated to world space
+			body->addForceAsTorque(force, R * math::vec3r(particlePositionLocal(*particle)));
 			// Reset particle force
 			particle->resetForce();
+			particle_active[*active] = 0;
 		}
+		active_particles.clear();
+
+		// Forces at points in the order they were added
+		for (auto point_force = point_forces.begin(); point_force != point_forces.end(); point_force++) {
+			body->addForce(point_force->force);
+			body->addForceAsTorque(point_force->force, point_force->arm);
+		}
+		point_forces.clear();
+	}
+
+	size_t BodyParticlesDiscretisation::getNumActiveParticles() const {
+		return active_particles.size();
 	}
 
 	Body * const BodyParticlesDiscretisation::getBody() const {
 		return body;
 	}
 
-	void BodyParticlesDiscretisation::colliding(BodyParticlesDiscretisation & other) {
-		// Very dumb algorithm for the moment, brute force check between all particles
-		for (auto body_1_particle = particles.begin(); body_1_particle != particles.end(); body_1_particle++) {
-			for (auto body_2_particle = other.particles.begin(); body_2_particle != other.particles.end(); body_2_particle++) {
-				// Compute particles global position
-				math::vec3f const p1_world_pos = particlePositionWorld(*body_1_particle);
-				math::vec3f const p2_world_pos = other.particlePositionWorld(*body_2_particle);
-				// Check if the two particle are collding
-				if (math::magnitude(p2_world_pos - p1_world_pos) <= body_1_particle->radius + body_2_particle->radius) {
-					// Compute particles world speed
-					math::vec3f const p1_world_speed = body->pointVelocityWorld(body_1_particle->position);
-					math::vec3f const p2_world_speed = other.body->pointVelocityWorld(body_2_particle->position);
-					// Solve collision
-					solveContact(*body_1_particle, p1_world_pos, p1_world_speed,
-								 *body_2_particle, p2_world_pos, p2_world_speed);
-				}
-			}
-		}
+	size_t BodyParticlesDiscretisation::getNumParticles() const {
+		return particles.size();
+	}
+
+	std::vector<Particle> const & BodyParticlesDiscretisation::getParticles() const {
+		return particles;
+	}
+
+	contact_real const * BodyParticlesDiscretisation::getOrigin() const {
+		return origin;
+	}
+
+	contact_real BodyParticlesDiscretisation::getSpacing() const {
+		return spacing;
 	}
 
-	void BodyParticlesDiscretisation::solveContact(Particle & p1, math::vec3f const & p1_world_position, math::vec3f const & p1_world_speed,
-												   Particle & p2, math::vec3f const & p2_world_position, math::vec3f const & p2_world_speed) {
-		// Compute relative position
-		math::vec3f const rel_position = p2_world_position - p1_world_position;
-		// Compute relative speed
-		math::vec3f const rel_speed = p2_world_speed - p1_world_speed;
-		
-		// Compute repulsive force
-		math::vec3f f_rep_12 = (-10.f * (p1.radius + p2.radius - math::magnitude(rel_position))) * math::normalize(rel_position);
-		// Add repulsive forces
-		p1.addForce(f_rep_12);
-		p2.addForce(-f_rep_12);
-
-		// Compute dumping force
-		math::vec3f f_dump_12 = 0.5f * rel_speed;
-		// Add dumping force
-		p1.addForce(f_dump_12);
-		p2.addForce(-f_dump_12);
+	contact_real BodyParticlesDiscretisation::getParticleRadius() const {
+		return particle_radius;
 	}
 
 } // pb namespace
\ No newline at end of file
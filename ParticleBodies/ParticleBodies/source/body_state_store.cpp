@@ -0,0 +1,557 @@
+#include "body_state_store.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace pb {
+
+	// Alignment in bytes of the arrays, the capacity is a multiple of ARRAY_GRANULARITY so that
+	// all the arrays start aligned as well
+	static size_t const ARRAY_ALIGNMENT = 32;
+	static size_t const ARRAY_GRANULARITY = 8;
+	static size_t const ARRAY_SKEW_PERIOD = 1024;
+	// Squared half angle of rotation below which its sine and cosine use their series
+	static real const SMALL_HALF_ANGLE_SQR = real(1e-4);
+
+	// Rotate a quaternion by a constant angular velocity over a step, exp(0.5 * omega * step) * q.
+	// The quaternion is normalised so the result stays unit length
+	static math::quaternionr rotateExponential(math::quaternionr const & q, math::vec3r const & omega, real const step) {
+		real const wx = omega(0), wy = omega(1), wz = omega(2);
+		real const speed_sqr = wx * wx + wy * wy + wz * wz;
+		real const half_angle_sqr = real(0.25) * step * step * speed_sqr;
+
+		// Rotation exp(0.5 * omega * step) = (cos(half_angle), sin(half_angle) * omega / |omega|)
+		real c, s;
+		if (half_angle_sqr < SMALL_HALF_ANGLE_SQR) {
+			c = real(1) - real(0.5) * half_angle_sqr + half_angle_sqr * half_angle_sqr / real(24);
+			s = real(0.5) * step * (real(1) - half_angle_sqr / real(6));
+		} else {
+			real const speed = std::sqrt(speed_sqr);
+			real const half_angle = real(0.5) * step * speed;
+			c = std::cos(half_angle);
+			s = std::sin(half_angle) / speed;
+		}
+
+		math::quaternionr const unit = math::normalize(q);
+		real const qs = unit.getReal();
+		real const qx = unit.getImmaginary()(0), qy = unit.getImmaginary()(1), qz = unit.getImmaginary()(2);
+
+		return math::quaternionr(c * qs - s * (wx * qx + wy * qy + wz * qz),
+								 c * qx + s * (qs * wx + wy * qz - wz * qy),
+								 c * qy + s * (qs * wy + wz * qx - wx * qz),
+								 c * qz + s * (qs * wz + wx * qy - wy * qx));
+	}
+
+	BodyStateStore::BodyStateStore()
+		: orientation_integration(ORIENTATION_LINEAR), num_bodies(0), array_capacity(0), base(nullptr) {}
+
+	size_t BodyStateStore::add(real const mass, math::vec3r const & x, math::quaternionr const & q) {
+		if (num_bodies == array_capacity) {
+			reserve(std::max(ARRAY_GRANULARITY, 2 * array_capacity));
+		}
+		size_t const index = num_bodies++;
+
+		// Set constant quantities, the inertia tensor is set by the body
+		array(ARRAY_MASS)[index] = mass;
+		array(ARRAY_INV_MASS)[index] = real(1) / mass;
+
+		// Set state, the body starts at rest
+		setPosition(index, x);
+		setOrientation(index, q);
+		setLinearMomentum(index, math::vec3r({ real(0), real(0), real(0) }));
+		setAngularMomentum(index, math::vec3r({ real(0), real(0), real(0) }));
+
+		return (index);
+	}
+
+	size_t BodyStateStore::add(BodyStateStore const & other, size_t const other_index) {
+#ifdef _DEBUG
+		assert(other_index < other.num_bodies);
+#endif
+		if (num_bodies == array_capacity) {
+			reserve(std::max(ARRAY_GRANULARITY, 2 * array_capacity));
+		}
+		size_t const index = num_bodies++;
+
+		// Copy all the quantities of the body
+		for (size_t a = 0; a < NUM_ARRAYS; a++) {
+			array(a)[index] = other.array(a)[other_index];
+		}
+		matrices[index] = other.matrices[other_index];
+
+		return (index);
+	}
+
+	size_t BodyStateStore::remove(size_t const index) {
+#ifdef _DEBUG
+		assert(index < num_bodies);
+#endif
+		size_t const last = --num_bodies;
+
+		// Move the last body to the free slot and clear the slot left at the end, the sweeps run
+		// on the padding as well
+		for (size_t a = 0; a < NUM_ARRAYS; a++) {
+			real * const values = array(a);
+			values[index] = values[last];
+			values[last] = real(0);
+		}
+		matrices[index] = matrices[last];
+		matrices[last] = BodyMatrices();
+
+		return (last);
+	}
+
+	size_t BodyStateStore::size() const {
+		return num_bodies;
+	}
+
+	size_t BodyStateStore::capacity() const {
+		return array_capacity;
+	}
+
+	real * BodyStateStore::array(size_t const a) {
+		return (base + a * array_capacity);
+	}
+
+	real const * BodyStateStore::array(size_t const a) const {
+		return (base + a * array_capacity);
+	}
+
+	real * BodyStateStore::state(size_t const component) {
+		return array(ARRAY_STATE + component);
+	}
+
+	real const * BodyStateStore::state(size_t const component) const {
+		return array(ARRAY_STATE + component);
+	}
+
+	real * BodyStateStore::ddtState(size_t const component) {
+		return array(ARRAY_DDT_STATE + component);
+	}
+
+	real const * BodyStateStore::ddtState(size_t const component) const {
+		return array(ARRAY_DDT_STATE + component);
+	}
+
+	void BodyStateStore::reserve(size_t const new_capacity) {
+		// Round capacity so that every array starts aligned. Large power of two strides would map
+		// the same body of all the arrays to the same cache sets, skew them by one cache line
+		size_t capacity = ((new_capacity + ARRAY_GRANULARITY - 1) / ARRAY_GRANULARITY) * ARRAY_GRANULARITY;
+		if (capacity % ARRAY_SKEW_PERIOD == 0) {
+			capacity += 64 / sizeof(real);
+		}
+		if (capacity <= array_capacity) {
+			return;
+		}
+
+		// Allocate new memory, padding elements are zero so the sweeps can run on the full arrays
+		std::vector<real> new_buffer(NUM_ARRAYS * capacity + ARRAY_ALIGNMENT / sizeof(real), real(0));
+		std::uintptr_t const address = reinterpret_cast<std::uintptr_t>(new_buffer.data());
+		size_t const misalignment = address % ARRAY_ALIGNMENT;
+		real * const new_base = new_buffer.data() + (misalignment == 0 ? 0 : (ARRAY_ALIGNMENT - misalignment) / sizeof(real));
+
+		// Copy the arrays with the new stride
+		for (size_t a = 0; a < NUM_ARRAYS; a++) {
+			std::copy(array(a), array(a) + num_bodies, new_base + a * capacity);
+		}
+
+		buffer.swap(new_buffer);
+		base = new_base;
+		array_capacity = capacity;
+		matrices.resize(capacity);
+	}
+
+	void BodyStateStore::setInertiaTensorBody(size_t const index, math::mat3x3r const & inertia,
+											  math::mat3x3r const & inv_inertia) {
+		for (size_t r = 0; r < 3; r++) {
+			for (size_t c = 0; c < 3; c++) {
+				array(ARRAY_INERTIA_BODY + r * 3 + c)[index] = inertia(r, c);
+				array(ARRAY_INV_INERTIA_BODY + r * 3 + c)[index] = inv_inertia(r, c);
+			}
+		}
+	}
+
+	// Gather a 3 components vector
+	static math::vec3r gatherVector(real const * const a0, size_t const stride, size_t const index) {
+		return (math::vec3r({ a0[index], a0[stride + index], a0[2 * stride + index] }));
+	}
+
+	// Gather a 3x3 matrix, row major
+	static math::mat3x3r gatherMatrix(real const * const a0, size_t const stride, size_t const index) {
+		math::mat3x3r m;
+		for (size_t e = 0; e < 9; e++) {
+			m(e / 3, e % 3) = a0[e * stride + index];
+		}
+
+		return (m);
+	}
+
+	// Scatter a 3 components vector
+	static void scatterVector(real * const a0, size_t const stride, size_t const index, math::vec3r const & v) {
+		a0[index] = v(0);
+		a0[stride + index] = v(1);
+		a0[2 * stride + index] = v(2);
+	}
+
+	real BodyStateStore::getMass(size_t const index) const {
+		return array(ARRAY_MASS)[index];
+	}
+
+	math::mat3x3r BodyStateStore::getInertiaTensorBody(size_t const index) const {
+		return gatherMatrix(array(ARRAY_INERTIA_BODY), array_capacity, index);
+	}
+
+	math::mat3x3r BodyStateStore::getInverseInertiaTensorBody(size_t const index) const {
+		return gatherMatrix(array(ARRAY_INV_INERTIA_BODY), array_capacity, index);
+	}
+
+	math::vec3r BodyStateStore::getPosition(size_t const index) const {
+		return gatherVector(state(STATE_X), array_capacity, index);
+	}
+
+	math::quaternionr BodyStateStore::getOrientation(size_t const index) const {
+		real const * const q = state(STATE_Q);
+		return (math::quaternionr(q[index], q[array_capacity + index],
+								  q[2 * array_capacity + index], q[3 * array_capacity + index]));
+	}
+
+	math::vec3r BodyStateStore::getLinearMomentum(size_t const index) const {
+		return gatherVector(state(STATE_P), array_capacity, index);
+	}
+
+	math::vec3r BodyStateStore::getAngularMomentum(size_t const index) const {
+		return gatherVector(state(STATE_L), array_capacity, index);
+	}
+
+	math::quaternionr BodyStateStore::getUnitOrientation(size_t const index) const {
+		real const * const q = array(ARRAY_Q_UNIT);
+		size_t const n = array_capacity;
+
+		return math::quaternionr(q[index], q[n + index], q[2 * n + index], q[3 * n + index]);
+	}
+
+	math::mat3x3r BodyStateStore::getInverseInertiaTensor(size_t const index) const {
+		return gatherMatrix(array(ARRAY_INV_INERTIA), array_capacity, index);
+	}
+
+	math::vec3r BodyStateStore::getLinearVelocity(size_t const index) const {
+		return gatherVector(array(ARRAY_V), array_capacity, index);
+	}
+
+	math::vec3r BodyStateStore::getAngularVelocity(size_t const index) const {
+		return gatherVector(array(ARRAY_OMEGA), array_capacity, index);
+	}
+
+	math::vec3r BodyStateStore::getForce(size_t const index) const {
+		return gatherVector(array(ARRAY_FORCE), array_capacity, index);
+	}
+
+	math::vec3r BodyStateStore::getTorque(size_t const index) const {
+		return gatherVector(array(ARRAY_TORQUE), array_capacity, index);
+	}
+
+	math::mat3x3r const & BodyStateStore::getRotationMatrix(size_t const index) const {
+		return matrices[index].rotation;
+	}
+
+	math::mat4x4r const & BodyStateStore::getOrientationMatrix(size_t const index) const {
+		return matrices[index].orientation;
+	}
+
+	math::mat4x4r const & BodyStateStore::getModelMatrix(size_t const index) const {
+		return matrices[index].model;
+	}
+
+	void BodyStateStore::setPosition(size_t const index, math::vec3r const & x) {
+		scatterVector(state(STATE_X), array_capacity, index, x);
+	}
+
+	void BodyStateStore::setOrientation(size_t const index, math::quaternionr const & q) {
+		real * const q0 = state(STATE_Q);
+		q0[index] = q.getReal();
+		q0[array_capacity + index] = q.getImmaginary()(0);
+		q0[2 * array_capacity + index] = q.getImmaginary()(1);
+		q0[3 * array_capacity + index] = q.getImmaginary()(2);
+	}
+
+	void BodyStateStore::setLinearMomentum(size_t const index, math::vec3r const & P) {
+		scatterVector(state(STATE_P), array_capacity, index, P);
+	}
+
+	void BodyStateStore::setAngularMomentum(size_t const index, math::vec3r const & L) {
+		scatterVector(state(STATE_L), array_capacity, index, L);
+	}
+
+	void BodyStateStore::addForce(size_t const index, math::vec3r const & f) {
+		real * const force = array(ARRAY_FORCE);
+		force[index] += f(0);
+		force[array_capacity + index] += f(1);
+		force[2 * array_capacity + index] += f(2);
+	}
+
+	void BodyStateStore::addTorque(size_t const index, math::vec3r const & t) {
+		real * const torque = array(ARRAY_TORQUE);
+		torque[index] += t(0);
+		torque[array_capacity + index] += t(1);
+		torque[2 * array_capacity + index] += t(2);
+	}
+
+	void BodyStateStore::resetForce(size_t const index) {
+		scatterVector(array(ARRAY_FORCE), array_capacity, index, math::vec3r({ real(0), real(0), real(0) }));
+	}
+
+	void BodyStateStore::resetTorque(size_t const index) {
+		scatterVector(array(ARRAY_TORQUE), array_capacity, index, math::vec3r({ real(0), real(0), real(0) }));
+	}
+
+	void BodyStateStore::resetForces() {
+		// Force and torque arrays are contiguous
+		std::fill(array(ARRAY_FORCE), array(ARRAY_TORQUE + 3), real(0));
+	}
+
+	void BodyStateStore::computeDerivedQuantities() {
+		computeDerivedQuantities(0, num_bodies);
+	}
+
+	void BodyStateStore::computeDerivedQuantities(size_t const index) {
+#ifdef _DEBUG
+		assert(index < num_bodies);
+#endif
+		computeDerivedQuantities(index, index + 1);
+	}
+
+	void BodyStateStore::computeDerivedQuantities(size_t const begin, size_t const end) {
+		size_t const n = array_capacity;
+		real const * const qs = state(STATE_Q);
+		real const * const qx = qs + n;
+		real const * const qy = qs + 2 * n;
+		real const * const qz = qs + 3 * n;
+		real const * const X = state(STATE_X);
+		real const * const P = state(STATE_P);
+		real const * const L = state(STATE_L);
+		real const * const inv_mass = array(ARRAY_INV_MASS);
+		real const * const Ib = array(ARRAY_INV_INERTIA_BODY);
+		real * const q_unit = array(ARRAY_Q_UNIT);
+		real * const I = array(ARRAY_INV_INERTIA);
+		real * const v = array(ARRAY_V);
+		real * const omega = array(ARRAY_OMEGA);
+
+		// The loop body only contains straight line code on scalars and fixed size loops so that the
+		// compiler can vectorise it across bodies
+		for (size_t i = begin; i < end; i++) {
+			// Orientation matrix from the normalised quaternion
+			real const inv_norm = real(1) / std::sqrt(qs[i] * qs[i] + qx[i] * qx[i] + qy[i] * qy[i] + qz[i] * qz[i]);
+			real const s = qs[i] * inv_norm;
+			real const x = qx[i] * inv_norm;
+			real const y = qy[i] * inv_norm;
+			real const z = qz[i] * inv_norm;
+			real const r00 = real(1) - real(2) * y * y - real(2) * z * z;
+			real const r01 = real(2) * x * y - real(2) * s * z;
+			real const r02 = real(2) * x * z + real(2) * s * y;
+			real const r10 = real(2) * x * y + real(2) * s * z;
+			real const r11 = real(1) - real(2) * x * x - real(2) * z * z;
+			real const r12 = real(2) * y * z - real(2) * s * x;
+			real const r20 = real(2) * x * z - real(2) * s * y;
+			real const r21 = real(2) * y * z + real(2) * s * x;
+			real const r22 = real(1) - real(2) * x * x - real(2) * y * y;
+
+			// A = R * I_body^-1
+			real const b00 = Ib[i], b01 = Ib[n + i], b02 = Ib[2 * n + i];
+			real const b10 = Ib[3 * n + i], b11 = Ib[4 * n + i], b12 = Ib[5 * n + i];
+			real const b20 = Ib[6 * n + i], b21 = Ib[7 * n + i], b22 = Ib[8 * n + i];
+			real const a00 = r00 * b00 + r01 * b10 + r02 * b20;
+			real const a01 = r00 * b01 + r01 * b11 + r02 * b21;
+			real const a02 = r00 * b02 + r01 * b12 + r02 * b22;
+			real const a10 = r10 * b00 + r11 * b10 + r12 * b20;
+			real const a11 = r10 * b01 + r11 * b11 + r12 * b21;
+			real const a12 = r10 * b02 + r11 * b12 + r12 * b22;
+			real const a20 = r20 * b00 + r21 * b10 + r22 * b20;
+			real const a21 = r20 * b01 + r21 * b11 + r22 * b21;
+			real const a22 = r20 * b02 + r21 * b12 + r22 * b22;
+
+			// World inverse inertia tensor A * R^T
+			real const i00 = a00 * r00 + a01 * r01 + a02 * r02;
+			real const i01 = a00 * r10 + a01 * r11 + a02 * r12;
+			real const i02 = a00 * r20 + a01 * r21 + a02 * r22;
+			real const i10 = a10 * r00 + a11 * r01 + a12 * r02;
+			real const i11 = a10 * r10 + a11 * r11 + a12 * r12;
+			real const i12 = a10 * r20 + a11 * r21 + a12 * r22;
+			real const i20 = a20 * r00 + a21 * r01 + a22 * r02;
+			real const i21 = a20 * r10 + a21 * r11 + a22 * r12;
+			real const i22 = a20 * r20 + a21 * r21 + a22 * r22;
+
+			q_unit[i] = s; q_unit[n + i] = x; q_unit[2 * n + i] = y; q_unit[3 * n + i] = z;
+			I[i] = i00; I[n + i] = i01; I[2 * n + i] = i02;
+			I[3 * n + i] = i10; I[4 * n + i] = i11; I[5 * n + i] = i12;
+			I[6 * n + i] = i20; I[7 * n + i] = i21; I[8 * n + i] = i22;
+
+			// Linear and angular velocity
+			v[i] = P[i] * inv_mass[i];
+			v[n + i] = P[n + i] * inv_mass[i];
+			v[2 * n + i] = P[2 * n + i] * inv_mass[i];
+			omega[i] = i00 * L[i] + i01 * L[n + i] + i02 * L[2 * n + i];
+			omega[n + i] = i10 * L[i] + i11 * L[n + i] + i12 * L[2 * n + i];
+			omega[2 * n + i] = i20 * L[i] + i21 * L[n + i] + i22 * L[2 * n + i];
+
+			// Matrices of the body, the orientation and model matrices only differ in the translation
+			BodyMatrices & m = matrices[i];
+			m.rotation(0, 0) = r00; m.rotation(0, 1) = r01; m.rotation(0, 2) = r02;
+			m.rotation(1, 0) = r10; m.rotation(1, 1) = r11; m.rotation(1, 2) = r12;
+			m.rotation(2, 0) = r20; m.rotation(2, 1) = r21; m.rotation(2, 2) = r22;
+			for (size_t r = 0; r < 3; r++) {
+				for (size_t c = 0; c < 3; c++) {
+					m.orientation(r, c) = m.rotation(r, c);
+					m.model(r, c) = m.rotation(r, c);
+				}
+				m.orientation(r, 3) = real(0);
+				m.model(r, 3) = X[r * n + i];
+			}
+			m.orientation(3, 3) = real(1);
+			m.model(3, 3) = real(1);
+		}
+	}
+
+	void BodyStateStore::computeStateDerivative() {
+		size_t const n = array_capacity;
+		real const * const qs = state(STATE_Q);
+		real const * const qx = qs + n;
+		real const * const qy = qs + 2 * n;
+		real const * const qz = qs + 3 * n;
+		real const * const v = array(ARRAY_V);
+		real const * const wx = array(ARRAY_OMEGA);
+		real const * const wy = wx + n;
+		real const * const wz = wx + 2 * n;
+		real * const dx = ddtState(STATE_X);
+		real * const dq = ddtState(STATE_Q);
+
+		// Position derivative is the velocity, momentum derivatives are force and torque
+		std::copy(v, v + 3 * n, dx);
+		std::copy(array(ARRAY_FORCE), array(ARRAY_FORCE) + 3 * n, ddtState(STATE_P));
+		std::copy(array(ARRAY_TORQUE), array(ARRAY_TORQUE) + 3 * n, ddtState(STATE_L));
+
+		// Orientation derivative 0.5 * (0, omega) * q
+		for (size_t i = 0; i < num_bodies; i++) {
+			dq[i] = real(0.5) * -(wx[i] * qx[i] + wy[i] * qy[i] + wz[i] * qz[i]);
+			dq[n + i] = real(0.5) * (qs[i] * wx[i] + wy[i] * qz[i] - wz[i] * qy[i]);
+			dq[2 * n + i] = real(0.5) * (qs[i] * wy[i] + wz[i] * qx[i] - wx[i] * qz[i]);
+			dq[3 * n + i] = real(0.5) * (qs[i] * wz[i] + wx[i] * qy[i] - wy[i] * qx[i]);
+		}
+	}
+
+	void BodyStateStore::integrateEuler(std::uint32_t const * const indices, size_t const count, real const step) {
+		// Split the list into runs of consecutive bodies, island lists are sorted so bodies added
+		// together mostly end up in the same run
+		size_t b = 0;
+		while (b < count) {
+			size_t const begin = indices[b];
+			size_t end = begin + 1;
+			for (b++; b < count && indices[b] == end; b++) {
+				end++;
+			}
+			integrateEuler(begin, end, step);
+		}
+	}
+
+	void BodyStateStore::integrateEuler(size_t const begin, size_t const end, real const step) {
+		size_t const n = array_capacity;
+		real * const y = state(0);
+		real * const dy = ddtState(0);
+		real const * const qs = y + STATE_Q * n;
+		real const * const qx = qs + n;
+		real const * const qy = qs + 2 * n;
+		real const * const qz = qs + 3 * n;
+		real const * const wx = array(ARRAY_OMEGA);
+		real const * const wy = wx + n;
+		real const * const wz = wx + 2 * n;
+		real * const dq = dy + STATE_Q * n;
+
+		// State derivative, as in computeStateDerivative
+		for (size_t c = 0; c < 3; c++) {
+			std::copy(array(ARRAY_V) + c * n + begin, array(ARRAY_V) + c * n + end, dy + (STATE_X + c) * n + begin);
+			std::copy(array(ARRAY_FORCE) + c * n + begin, array(ARRAY_FORCE) + c * n + end, dy + (STATE_P + c) * n + begin);
+			std::copy(array(ARRAY_TORQUE) + c * n + begin, array(ARRAY_TORQUE) + c * n + end, dy + (STATE_L + c) * n + begin);
+		}
+		for (size_t i = begin; i < end; i++) {
+			dq[i] = real(0.5) * -(wx[i] * qx[i] + wy[i] * qy[i] + wz[i] * qz[i]);
+			dq[n + i] = real(0.5) * (qs[i] * wx[i] + wy[i] * qz[i] - wz[i] * qy[i]);
+			dq[2 * n + i] = real(0.5) * (qs[i] * wy[i] + wz[i] * qx[i] - wx[i] * qz[i]);
+			dq[3 * n + i] = real(0.5) * (qs[i] * wz[i] + wx[i] * qy[i] - wy[i] * qx[i]);
+		}
+
+		// Euler step, the non linear orientation updates replace the one of the quaternion and
+		// need it at the start of the step
+		bool const linear = orientation_integration == ORIENTATION_LINEAR;
+		for (size_t c = 0; c < STATE_SIZE; c++) {
+			if (linear || c < STATE_Q || c >= STATE_Q + 4) {
+				real * const yc = y + c * n;
+				real const * const dyc = dy + c * n;
+				for (size_t i = begin; i < end; i++) {
+					yc[i] = yc[i] + step * dyc[i];
+				}
+			}
+		}
+		if (!linear) {
+			for (size_t i = begin; i < end; i++) {
+				math::quaternionr const q = rotateOrientation(i, math::quaternionr(qs[i], qx[i], qy[i], qz[i]),
+															  math::vec3r({ wx[i], wy[i], wz[i] }), getAngularMomentum(i), step);
+				setOrientation(i, q);
+			}
+		}
+
+		computeDerivedQuantities(begin, end);
+	}
+
+	void BodyStateStore::integrateVelocity(size_t const index, math::vec3r const & v, math::vec3r const & omega,
+										   real const step) {
+#ifdef _DEBUG
+		assert(index < num_bodies);
+#endif
+		math::mat3x3r const R = getRotationMatrix(index);
+		math::vec3r const P = getMass(index) * v;
+		math::vec3r const L = R * getInertiaTensorBody(index) * math::transpose(R) * omega;
+		resetForce(index);
+		resetTorque(index);
+		addForce(index, (real(1) / step) * (P - getLinearMomentum(index)));
+		addTorque(index, (real(1) / step) * (L - getAngularMomentum(index)));
+
+		// Same orientation update as the explicit step, with the new angular velocity
+		math::quaternionr const q = getOrientation(index);
+		setPosition(index, getPosition(index) + step * v);
+		if (orientation_integration == ORIENTATION_LINEAR) {
+			real const qs = q.getReal(), qx = q.getImmaginary()(0), qy = q.getImmaginary()(1), qz = q.getImmaginary()(2);
+			real const wx = omega(0), wy = omega(1), wz = omega(2);
+			setOrientation(index, math::quaternionr(qs + step * real(0.5) * -(wx * qx + wy * qy + wz * qz),
+													qx + step * real(0.5) * (qs * wx + wy * qz - wz * qy),
+													qy + step * real(0.5) * (qs * wy + wz * qx - wx * qz),
+													qz + step * real(0.5) * (qs * wz + wx * qy - wy * qx)));
+		} else {
+			setOrientation(index, rotateOrientation(index, q, omega, L, step));
+		}
+		setLinearMomentum(index, P);
+		setAngularMomentum(index, L);
+		computeDerivedQuantities(index, index + 1);
+	}
+
+	void BodyStateStore::setOrientationIntegration(OrientationIntegration const integration) {
+		orientation_integration = integration;
+	}
+
+	BodyStateStore::OrientationIntegration BodyStateStore::getOrientationIntegration() const {
+		return orientation_integration;
+	}
+
+	math::quaternionr BodyStateStore::rotateOrientation(size_t const index, math::quaternionr const & q,
+														 math::vec3r const & omega, math::vec3r const & L,
+														 real const step) const {
+		if (orientation_integration == ORIENTATION_EXPONENTIAL) {
+			return rotateExponential(q, omega, step);
+		}
+
+		// Angular velocity of L at the orientation reached half way through the step
+		math::mat3x3r const R = math::createMatrix(rotateExponential(q, omega, real(0.5) * step));
+		math::vec3r const omega_half = R * getInverseInertiaTensorBody(index) * math::transpose(R) * L;
+
+		return rotateExponential(q, omega_half, step);
+	}
+
+} // pb namespace
\ No newline at end of file
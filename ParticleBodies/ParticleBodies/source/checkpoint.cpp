@@ -0,0 +1,333 @@
+#include "checkpoint.h"
+#include "binary_io.h"
+#include "body.h"
+#include "mapped_file.h"
+#include <map>
+
+namespace pb {
+
+	// Seek with 64 bit offsets
+	static bool seekFile(std::FILE * const file, std::uint64_t const offset) {
+#ifdef _WIN32
+		return (_fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0);
+#else
+		return (fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0);
+#endif
+	}
+
+	// Size of the header
+	static size_t const HEADER_SIZE = 4 * sizeof(std::uint32_t) + 5 * sizeof(std::uint64_t);
+
+	// Size of a slot holding the state of the given number of bodies
+	static std::uint64_t slotSize(size_t const num_bodies) {
+		return (2 * sizeof(std::uint64_t) + 2 * sizeof(real) + BodyStateStore::STATE_SIZE * num_bodies * sizeof(real));
+	}
+
+	// Check if two discretisations share the same particle set
+	static bool sameParticleSet(BodyParticlesDiscretisation const & d1, BodyParticlesDiscretisation const & d2) {
+		if (d1.getNumParticles() != d2.getNumParticles() || d1.getSpacing() != d2.getSpacing() ||
+			d1.getParticleRadius() != d2.getParticleRadius() ||
+			std::memcmp(d1.getOrigin(), d2.getOrigin(), 3 * sizeof(contact_real)) != 0) {
+			return false;
+		}
+		for (size_t p = 0; p < d1.getNumParticles(); p++) {
+			if (std::memcmp(d1.getParticles()[p].getVoxel(), d2.getParticles()[p].getVoxel(), 3 * sizeof(std::int16_t)) != 0) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	CheckpointWriter::CheckpointWriter(char const * const path)
+		: path(path), file(nullptr), bodies_revision(0), sequence(0), slot_size(0) {
+		slot_offset[0] = 0;
+		slot_offset[1] = 0;
+	}
+
+	CheckpointWriter::~CheckpointWriter() {
+		if (file != nullptr) {
+			std::fclose(file);
+		}
+	}
+
+	bool CheckpointWriter::write(System const & system) {
+		if (file == nullptr || bodies_revision != system.getBodiesRevision()) {
+			if (!writeDescription(system)) {
+				return false;
+			}
+		}
+
+		return writeSlot(system);
+	}
+
+	bool CheckpointWriter::writeDescription(System const & system) {
+		std::vector<BodyParticlesDiscretisation *> const & bodies = system.getBodies();
+		BodyStateStore const & states = system.getStateStore();
+
+		// Find the distinct particle sets, keyed by a hash of their voxels
+		std::vector<std::uint64_t> body_particle_set(bodies.size());
+		std::vector<BodyParticlesDiscretisation const *> particle_sets;
+		std::multimap<std::uint64_t, std::uint64_t> particle_sets_by_hash;
+		for (size_t b = 0; b < bodies.size(); b++) {
+			BodyParticlesDiscretisation const & discretisation = *bodies[b];
+			std::uint64_t hash = hashBytes(discretisation.getOrigin(), 3 * sizeof(contact_real));
+			for (auto particle = discretisation.getParticles().begin(); particle != discretisation.getParticles().end(); particle++) {
+				hash = hashBytes(particle->getVoxel(), 3 * sizeof(std::int16_t), hash);
+			}
+			body_particle_set[b] = particle_sets.size();
+			auto const range = particle_sets_by_hash.equal_range(hash);
+			for (auto set = range.first; set != range.second; set++) {
+				if (sameParticleSet(*particle_sets[set->second], discretisation)) {
+					body_particle_set[b] = set->second;
+					break;
+				}
+			}
+			if (body_particle_set[b] == particle_sets.size()) {
+				particle_sets_by_hash.insert(std::make_pair(hash, static_cast<std::uint64_t>(particle_sets.size())));
+				particle_sets.push_back(&discretisation);
+			}
+		}
+
+		// Description of particle sets and bodies
+		buffer.assign(HEADER_SIZE, 0);
+		BinaryWriter writer(buffer);
+		for (auto set = particle_sets.begin(); set != particle_sets.end(); set++) {
+			writer.write((*set)->getOrigin(), 3);
+			writer.write((*set)->getSpacing());
+			writer.write((*set)->getParticleRadius());
+			writer.write(static_cast<std::uint64_t>((*set)->getNumParticles()));
+			for (auto particle = (*set)->getParticles().begin(); particle != (*set)->getParticles().end(); particle++) {
+				writer.write(particle->getVoxel(), 3);
+			}
+			writer.align(8);
+		}
+		for (size_t b = 0; b < bodies.size(); b++) {
+			Body const * const body = bodies[b]->getBody();
+			size_t const index = body->getStateIndex();
+			real parameters[Body::MAX_SHAPE_PARAMETERS];
+			body->getShapeParameters(parameters);
+			math::mat3x3r const inertia = states.getInertiaTensorBody(index);
+			math::mat3x3r const inv_inertia = states.getInverseInertiaTensorBody(index);
+
+			writer.write(static_cast<std::uint32_t>(body->getShapeType()));
+			writer.write(parameters, Body::MAX_SHAPE_PARAMETERS);
+			writer.write(states.getMass(index));
+			for (size_t e = 0; e < 9; e++) {
+				writer.write(inertia(e / 3, e % 3));
+			}
+			for (size_t e = 0; e < 9; e++) {
+				writer.write(inv_inertia(e / 3, e % 3));
+			}
+			writer.write(body_particle_set[b]);
+		}
+		writer.align(8);
+
+		// Two empty slots
+		slot_size = slotSize(bodies.size());
+		slot_offset[0] = writer.size();
+		slot_offset[1] = slot_offset[0] + slot_size;
+		buffer.resize(static_cast<size_t>(slot_offset[1] + slot_size), 0);
+
+		// Header
+		std::vector<unsigned char> header;
+		BinaryWriter header_writer(header);
+		header_writer.write(static_cast<std::uint32_t>(CheckpointFormat::MAGIC));
+		header_writer.write(static_cast<std::uint32_t>(CheckpointFormat::VERSION));
+		header_writer.write(static_cast<std::uint32_t>(sizeof(real)));
+		header_writer.write(static_cast<std::uint32_t>(sizeof(contact_real)));
+		header_writer.write(static_cast<std::uint64_t>(bodies.size()));
+		header_writer.write(static_cast<std::uint64_t>(particle_sets.size()));
+		header_writer.write(slot_offset, 2);
+		header_writer.write(slot_size);
+		std::memcpy(buffer.data(), header.data(), HEADER_SIZE);
+
+		// Write the whole file
+		if (file != nullptr) {
+			std::fclose(file);
+		}
+		file = std::fopen(path.c_str(), "wb+");
+		if (file == nullptr) {
+			return false;
+		}
+		if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+			return false;
+		}
+		bodies_revision = system.getBodiesRevision();
+
+		return true;
+	}
+
+	bool CheckpointWriter::writeSlot(System const & system) {
+		BodyStateStore const & states = system.getStateStore();
+		size_t const num_bodies = states.size();
+
+		// Fill slot
+		buffer.clear();
+		BinaryWriter writer(buffer);
+		writer.write(++sequence);
+		writer.write(system.getTime());
+		writer.write(system.getTimeStep());
+		for (size_t c = 0; c < BodyStateStore::STATE_SIZE; c++) {
+			writer.write(states.state(c), num_bodies);
+		}
+		writer.write(hashBytes(buffer.data(), buffer.size()));
+
+		// Overwrite the oldest slot
+		if (!seekFile(file, slot_offset[sequence % 2])) {
+			return false;
+		}
+		if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+			return false;
+		}
+
+		return (std::fflush(file) == 0);
+	}
+
+	// Particle set read from a checkpoint
+	struct CheckpointParticleSet {
+		contact_real origin[3];
+		contact_real spacing;
+		contact_real radius;
+		std::vector<Particle> particles;
+	};
+
+	bool CheckpointReader::restart(char const * const path, RestartedSystem * const restarted) {
+		MappedFile mapped_file;
+		if (!mapped_file.open(path)) {
+			return false;
+		}
+		BinaryReader reader(mapped_file.data(), mapped_file.size());
+
+		// Check header
+		std::uint32_t magic, version, real_size, contact_real_size;
+		std::uint64_t num_bodies, num_particle_sets, slot_offset[2], slot_size;
+		if (!reader.read(&magic) || !reader.read(&version) ||
+			!reader.read(&real_size) || !reader.read(&contact_real_size) ||
+			!reader.read(&num_bodies) || !reader.read(&num_particle_sets) ||
+			!reader.read(slot_offset, 2) || !reader.read(&slot_size)) {
+			return false;
+		}
+		if (magic != CheckpointFormat::MAGIC || version != CheckpointFormat::VERSION ||
+			real_size != sizeof(real) || contact_real_size != sizeof(contact_real) ||
+			slot_size != slotSize(static_cast<size_t>(num_bodies))) {
+			return false;
+		}
+
+		// Read particle sets
+		std::vector<CheckpointParticleSet> particle_sets(static_cast<size_t>(num_particle_sets));
+		for (auto set = particle_sets.begin(); set != particle_sets.end(); set++) {
+			std::uint64_t num_particles;
+			if (!reader.read(set->origin, 3) || !reader.read(&set->spacing) ||
+				!reader.read(&set->radius) || !reader.read(&num_particles)) {
+				return false;
+			}
+			set->particles.reserve(static_cast<size_t>(num_particles));
+			for (std::uint64_t p = 0; p < num_particles; p++) {
+				std::int16_t voxel[3];
+				if (!reader.read(voxel, 3)) {
+					return false;
+				}
+				set->particles.push_back(Particle(voxel[0], voxel[1], voxel[2]));
+			}
+			if (!reader.align(8)) {
+				return false;
+			}
+		}
+		size_t const bodies_offset = reader.tell();
+
+		// Select the valid slot with the highest sequence number
+		std::uint64_t best_sequence = 0;
+		size_t best_slot = 2;
+		for (size_t s = 0; s < 2; s++) {
+			std::uint64_t sequence, hash;
+			if (!reader.seek(static_cast<size_t>(slot_offset[s])) || !reader.read(&sequence) ||
+				!reader.seek(static_cast<size_t>(slot_offset[s] + slot_size - sizeof(std::uint64_t))) || !reader.read(&hash)) {
+				return false;
+			}
+			if (sequence > best_sequence &&
+				hashBytes(mapped_file.data() + slot_offset[s], static_cast<size_t>(slot_size - sizeof(std::uint64_t))) == hash) {
+				best_sequence = sequence;
+				best_slot = s;
+			}
+		}
+		if (best_slot == 2) {
+			return false;
+		}
+
+		// Read time and states, the state arrays are read in place from the mapping
+		real t, delta_t;
+		reader.seek(static_cast<size_t>(slot_offset[best_slot] + sizeof(std::uint64_t)));
+		reader.read(&t);
+		reader.read(&delta_t);
+		size_t const states_offset = reader.tell();
+
+		// Recreate bodies
+		restarted->system.reset(new System(t, delta_t));
+		restarted->bodies.clear();
+		restarted->discretisations.clear();
+		reader.seek(bodies_offset);
+		for (size_t b = 0; b < num_bodies; b++) {
+			std::uint32_t shape;
+			real parameters[Body::MAX_SHAPE_PARAMETERS];
+			real mass;
+			math::mat3x3r inertia, inv_inertia;
+			std::uint64_t particle_set;
+			if (!reader.read(&shape) || !reader.read(parameters, Body::MAX_SHAPE_PARAMETERS) || !reader.read(&mass)) {
+				return false;
+			}
+			for (size_t e = 0; e < 9; e++) {
+				if (!reader.read(&inertia(e / 3, e % 3))) {
+					return false;
+				}
+			}
+			for (size_t e = 0; e < 9; e++) {
+				if (!reader.read(&inv_inertia(e / 3, e % 3))) {
+					return false;
+				}
+			}
+			if (!reader.read(&particle_set) || particle_set >= num_particle_sets) {
+				return false;
+			}
+
+			// Create body in its stored pose
+			BinaryReader state_reader(mapped_file.data() + states_offset, static_cast<size_t>(slot_size));
+			real x[3], q[4];
+			for (size_t c = 0; c < 3; c++) {
+				state_reader.seek(((BodyStateStore::STATE_X + c) * num_bodies + b) * sizeof(real));
+				state_reader.read(&x[c]);
+			}
+			for (size_t c = 0; c < 4; c++) {
+				state_reader.seek(((BodyStateStore::STATE_Q + c) * num_bodies + b) * sizeof(real));
+				state_reader.read(&q[c]);
+			}
+			Body * const body = Body::create(static_cast<ShapeType>(shape), parameters,
+											 math::vec3r({ x[0], x[1], x[2] }), mass,
+											 math::quaternionr(q[0], q[1], q[2], q[3]));
+			if (body == nullptr) {
+				return false;
+			}
+			restarted->bodies.push_back(std::unique_ptr<Body>(body));
+
+			// Create discretisation from the stored particle set
+			CheckpointParticleSet const & set = particle_sets[static_cast<size_t>(particle_set)];
+			restarted->discretisations.push_back(std::unique_ptr<BodyParticlesDiscretisation>(
+				new BodyParticlesDiscretisation(body, set.origin, set.spacing, set.radius, set.particles)));
+			restarted->system->addBody(restarted->discretisations.back().get());
+
+			// Restore the exact inertia tensor
+			restarted->system->getStateStore().setInertiaTensorBody(body->getStateIndex(), inertia, inv_inertia);
+		}
+
+		// Restore the exact state of all the bodies and recompute the derived quantities
+		BodyStateStore & states = restarted->system->getStateStore();
+		BinaryReader state_reader(mapped_file.data() + states_offset, static_cast<size_t>(slot_size));
+		for (size_t c = 0; c < BodyStateStore::STATE_SIZE; c++) {
+			state_reader.read(states.state(c), static_cast<size_t>(num_bodies));
+		}
+		states.computeDerivedQuantities();
+
+		return true;
+	}
+
+} // pb namespace
\ No newline at end of file
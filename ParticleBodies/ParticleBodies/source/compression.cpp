@@ -0,0 +1,154 @@
+#include "compression.h"
+#include <cstdint>
+#include <cstring>
+
+namespace pb {
+
+	// Minimum length of a match
+	static size_t const MIN_MATCH = 4;
+	// Maximum distance of a match
+	static size_t const MAX_OFFSET = 65535;
+	// Bits of the hash table
+	static unsigned int const HASH_BITS = 14;
+
+	// Read four bytes
+	static inline std::uint32_t read32(unsigned char const * const p) {
+		std::uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+
+		return value;
+	}
+
+	// Hash of four bytes
+	static inline std::uint32_t hash32(std::uint32_t const value) {
+		return ((value * 2654435761u) >> (32 - HASH_BITS));
+	}
+
+	// Write the extra bytes of a length that does not fit in a token nibble
+	static inline void writeLength(size_t length, std::vector<unsigned char> & dst) {
+		while (length >= 255) {
+			dst.push_back(255);
+			length -= 255;
+		}
+		dst.push_back(static_cast<unsigned char>(length));
+	}
+
+	// Write a sequence, a match length of zero marks the last sequence
+	static void writeSequence(unsigned char const * const literals, size_t const literal_length,
+							  size_t const offset, size_t const match_length, std::vector<unsigned char> & dst) {
+		size_t const match_code = match_length == 0 ? 0 : match_length - MIN_MATCH;
+		dst.push_back(static_cast<unsigned char>(((literal_length < 15 ? literal_length : 15) << 4) |
+												 (match_code < 15 ? match_code : 15)));
+		if (literal_length >= 15) {
+			writeLength(literal_length - 15, dst);
+		}
+		dst.insert(dst.end(), literals, literals + literal_length);
+		if (match_length != 0) {
+			dst.push_back(static_cast<unsigned char>(offset & 0xff));
+			dst.push_back(static_cast<unsigned char>(offset >> 8));
+			if (match_code >= 15) {
+				writeLength(match_code - 15, dst);
+			}
+		}
+	}
+
+	size_t BlockCompressor::compress(unsigned char const * const src, size_t const size,
+									 std::vector<unsigned char> & dst) {
+		size_t const start_size = dst.size();
+		std::vector<std::uint32_t> table(size_t(1) << HASH_BITS, 0);
+
+		size_t anchor = 0;
+		size_t i = 0;
+		while (size >= MIN_MATCH && i <= size - MIN_MATCH) {
+			std::uint32_t const sequence = read32(src + i);
+			std::uint32_t const h = hash32(sequence);
+			// Positions are stored + 1 so that zero marks an empty entry
+			size_t const candidate = table[h];
+			table[h] = static_cast<std::uint32_t>(i + 1);
+
+			if (candidate != 0 && i - (candidate - 1) <= MAX_OFFSET && read32(src + candidate - 1) == sequence) {
+				size_t const reference = candidate - 1;
+				// Extend match
+				size_t length = MIN_MATCH;
+				while (i + length < size && src[reference + length] == src[i + length]) {
+					length++;
+				}
+				writeSequence(src + anchor, i - anchor, i - reference, length, dst);
+				i += length;
+				anchor = i;
+			} else {
+				i++;
+			}
+		}
+
+		// Remaining literals
+		writeSequence(src + anchor, size - anchor, 0, 0, dst);
+
+		return (dst.size() - start_size);
+	}
+
+	// Read the extra bytes of a length
+	static inline bool readLength(unsigned char const * & ip, unsigned char const * const end, size_t & length) {
+		unsigned char byte;
+		do {
+			if (ip == end) {
+				return false;
+			}
+			byte = *ip++;
+			length += byte;
+		} while (byte == 255);
+
+		return true;
+	}
+
+	bool BlockCompressor::decompress(unsigned char const * const src, size_t const size,
+									 unsigned char * const dst, size_t const raw_size) {
+		unsigned char const * ip = src;
+		unsigned char const * const end = src + size;
+		size_t op = 0;
+
+		while (ip < end) {
+			unsigned char const token = *ip++;
+
+			// Literals
+			size_t literal_length = token >> 4;
+			if (literal_length == 15 && !readLength(ip, end, literal_length)) {
+				return false;
+			}
+			if (literal_length > static_cast<size_t>(end - ip) || literal_length > raw_size - op) {
+				return false;
+			}
+			std::memcpy(dst + op, ip, literal_length);
+			ip += literal_length;
+			op += literal_length;
+
+			// The last sequence has no match
+			if (ip == end) {
+				break;
+			}
+
+			// Match
+			if (end - ip < 2) {
+				return false;
+			}
+			size_t const offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+			ip += 2;
+			size_t match_length = token & 15;
+			if (match_length == 15 && !readLength(ip, end, match_length)) {
+				return false;
+			}
+			match_length += MIN_MATCH;
+			if (offset == 0 || offset > op || match_length > raw_size - op) {
+				return false;
+			}
+			// Byte by byte copy, the match can overlap the output
+			for (size_t k = 0; k < match_length; k++) {
+				dst[op + k] = dst[op - offset + k];
+			}
+			op += match_length;
+		}
+
+		return (op == raw_size);
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,36 @@
+#include "contact_buffer.h"
+
+namespace pb {
+
+	void ContactBuffer::clear() {
+		first_body.clear();
+		first_particle.clear();
+		second_body.clear();
+		second_particle.clear();
+		update_second.clear();
+		nx.clear();
+		ny.clear();
+		nz.clear();
+		depth.clear();
+		vx.clear();
+		vy.clear();
+		vz.clear();
+		age.clear();
+		impulse.clear();
+		cx.clear();
+		cy.clear();
+		cz.clear();
+	}
+
+	void ContactBuffer::print(FILE * const file, size_t const begin, size_t const end) const {
+		for (size_t c = begin; c < end && c < size(); c++) {
+			fprintf(file, "%zu: body %u particle %u - body %u particle %u%s, normal (%g %g %g), depth %g, velocity (%g %g %g), age %u\n",
+					c, first_body[c], first_particle[c], second_body[c], second_particle[c],
+					update_second[c] ? "" : " (static)",
+					static_cast<double>(nx[c]), static_cast<double>(ny[c]), static_cast<double>(nz[c]),
+					static_cast<double>(depth[c]),
+					static_cast<double>(vx[c]), static_cast<double>(vy[c]), static_cast<double>(vz[c]), age[c]);
+		}
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "contact_cache.h"
+
+namespace pb {
+
+	// Body of the empty entries
+	static std::uint64_t const NO_BODY = UINT64_MAX;
+
+	// Check if two keys are equal
+	static bool sameKey(ContactKey const & a, ContactKey const & b) {
+		return (a.body_1 == b.body_1 && a.particle_1 == b.particle_1 &&
+				a.body_2 == b.body_2 && a.particle_2 == b.particle_2);
+	}
+
+	ContactCache::ContactCache()
+		: previous(0) {
+		tables[0].size = 0;
+		tables[1].size = 0;
+	}
+
+	size_t ContactCache::hash(ContactKey const & key) {
+		// Mix the bodies and the particles
+		std::uint64_t const particles = (static_cast<std::uint64_t>(key.particle_1) << 32) | key.particle_2;
+		std::uint64_t h = (key.body_1 * 0x9E3779B97F4A7C15ull + key.body_2) * 0xC2B2AE3D27D4EB4Full ^ particles;
+		h ^= h >> 31;
+		h *= 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 27;
+
+		return static_cast<size_t>(h);
+	}
+
+	ContactHistory const * ContactCache::find(ContactKey const & key) const {
+		Table const & table = tables[previous];
+		if (table.size == 0) {
+			return nullptr;
+		}
+		size_t const mask = table.entries.size() - 1;
+		for (size_t e = hash(key) & mask; table.entries[e].key.body_1 != NO_BODY; e = (e + 1) & mask) {
+			if (sameKey(table.entries[e].key, key)) {
+				return &table.entries[e].history;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void ContactCache::beginStep(size_t const num_contacts) {
+		// Keep the load below one half
+		Table & table = tables[1 - previous];
+		size_t capacity = 16;
+		while (capacity < 2 * num_contacts) {
+			capacity *= 2;
+		}
+		Entry empty;
+		empty.key.body_1 = NO_BODY;
+		table.entries.assign(capacity, empty);
+		table.size = 0;
+	}
+
+	void ContactCache::insert(ContactKey const & key, ContactHistory const & history) {
+		Table & table = tables[1 - previous];
+		size_t const mask = table.entries.size() - 1;
+		size_t e = hash(key) & mask;
+		while (table.entries[e].key.body_1 != NO_BODY) {
+			if (sameKey(table.entries[e].key, key)) {
+				table.entries[e].history = history;
+				return;
+			}
+			e = (e + 1) & mask;
+		}
+		table.entries[e].key = key;
+		table.entries[e].history = history;
+		table.size++;
+	}
+
+	void ContactCache::endStep() {
+		previous = 1 - previous;
+	}
+
+	size_t ContactCache::size() const {
+		return tables[previous].size;
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "contact_colouring.h"
+#include <algorithm>
+#include <initializer_list>
+
+namespace pb {
+
+	// Number of colours tracked by the masks
+	static std::uint32_t const MASK_COLOURS = 64;
+
+	// First colour not set in a mask, MASK_COLOURS if all are set
+	static std::uint32_t firstFreeColour(std::uint64_t const used) {
+		std::uint64_t const free = ~used;
+		if (free == 0) {
+			return MASK_COLOURS;
+		}
+		std::uint32_t colour = 0;
+		while (((free >> colour) & 1) == 0) {
+			colour++;
+		}
+
+		return colour;
+	}
+
+	void ContactColouring::build(size_t const num_bodies, std::vector<std::uint8_t> const & is_static,
+								 BodyPair const * const pairs, size_t const num_pairs) {
+		used_colours.resize(num_bodies, 0);
+		next_wide_colour.resize(num_bodies, MASK_COLOURS);
+		pair_colours.resize(num_pairs);
+
+		// Give every pair the first colour free at its dynamic bodies
+		std::uint32_t num_colours = 0;
+		for (size_t p = 0; p < num_pairs; p++) {
+			std::uint32_t const a = pairs[p].first;
+			std::uint32_t const b = pairs[p].second;
+			std::uint64_t const used = (is_static[a] ? 0 : used_colours[a]) | (is_static[b] ? 0 : used_colours[b]);
+			std::uint32_t colour = firstFreeColour(used);
+			if (colour == MASK_COLOURS) {
+				// Very crowded bodies, take the colours after the mask one after the other
+				colour = std::max(is_static[a] ? MASK_COLOURS : next_wide_colour[a],
+								  is_static[b] ? MASK_COLOURS : next_wide_colour[b]);
+			}
+			for (std::uint32_t const body : { a, b }) {
+				if (is_static[body]) {
+					continue;
+				}
+				if (colour < MASK_COLOURS) {
+					used_colours[body] |= std::uint64_t(1) << colour;
+				} else {
+					next_wide_colour[body] = colour + 1;
+				}
+			}
+			pair_colours[p] = colour;
+			num_colours = std::max(num_colours, colour + 1);
+		}
+
+		// Group the pairs by colour with a counting sort, keeping their order
+		batch_offsets.assign(num_colours + 1, 0);
+		for (size_t p = 0; p < num_pairs; p++) {
+			batch_offsets[pair_colours[p] + 1]++;
+		}
+		for (size_t c = 0; c < num_colours; c++) {
+			batch_offsets[c + 1] += batch_offsets[c];
+		}
+		batch_pairs.resize(num_pairs);
+		for (size_t p = 0; p < num_pairs; p++) {
+			batch_pairs[batch_offsets[pair_colours[p]]++] = pairs[p];
+		}
+		for (size_t c = num_colours; c > 0; c--) {
+			batch_offsets[c] = batch_offsets[c - 1];
+		}
+		batch_offsets[0] = 0;
+
+		// Clear the colours of the bodies for the next island
+		for (size_t p = 0; p < num_pairs; p++) {
+			for (std::uint32_t const body : { pairs[p].first, pairs[p].second }) {
+				used_colours[body] = 0;
+				next_wide_colour[body] = MASK_COLOURS;
+			}
+		}
+	}
+
+	size_t ContactColouring::getNumBatches() const {
+		return (batch_offsets.empty() ? 0 : batch_offsets.size() - 1);
+	}
+
+	BodyPair const * ContactColouring::getBatch(size_t const batch) const {
+		return batch_pairs.data() + batch_offsets[batch];
+	}
+
+	size_t ContactColouring::getBatchSize(size_t const batch) const {
+		return batch_offsets[batch + 1] - batch_offsets[batch];
+	}
+
+} // pb namespace
\ No newline at end of file
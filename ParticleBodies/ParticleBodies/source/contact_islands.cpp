@@ -0,0 +1,169 @@
+#include "contact_islands.h"
+#include <algorithm>
+
+namespace pb {
+
+	// Body not assigned to an island yet
+	static std::uint32_t const NO_ISLAND = UINT32_MAX;
+
+	void ContactIslands::build(size_t const num_bodies, std::vector<std::uint8_t> const & is_static,
+							   std::vector<BodyPair> const & pairs, std::vector<std::uint32_t> const & body_cost,
+							   size_t const min_task_cost) {
+		// Every body starts in its own tree, pairs of dynamic bodies merge their trees
+		parent.resize(num_bodies);
+		tree_size.assign(num_bodies, 1);
+		for (size_t b = 0; b < num_bodies; b++) {
+			parent[b] = static_cast<std::uint32_t>(b);
+		}
+		for (auto pair = pairs.begin(); pair != pairs.end(); pair++) {
+			if (!is_static[pair->first] && !is_static[pair->second]) {
+				merge(pair->first, pair->second);
+			}
+		}
+
+		// Number the islands in order of their first body and sum the cost of their bodies
+		body_island.assign(num_bodies, NO_ISLAND);
+		island_cost.clear();
+		for (size_t b = 0; b < num_bodies; b++) {
+			std::uint32_t const root = find(static_cast<std::uint32_t>(b));
+			if (body_island[root] == NO_ISLAND) {
+				body_island[root] = static_cast<std::uint32_t>(island_cost.size());
+				island_cost.push_back(0);
+			}
+			body_island[b] = body_island[root];
+			island_cost[body_island[b]] += body_cost[b];
+		}
+
+		// A pair belongs to the island of its dynamic body, pairs of two static bodies have no effect
+		pair_island.resize(pairs.size());
+		for (size_t p = 0; p < pairs.size(); p++) {
+			BodyPair const & pair = pairs[p];
+			if (is_static[pair.first] && is_static[pair.second]) {
+				pair_island[p] = NO_ISLAND;
+				continue;
+			}
+			pair_island[p] = body_island[is_static[pair.first] ? pair.second : pair.first];
+			island_cost[pair_island[p]] += static_cast<std::uint64_t>(body_cost[pair.first]) * body_cost[pair.second];
+		}
+
+		// Sort the islands by decreasing cost
+		size_t const num_islands = island_cost.size();
+		island_order.resize(num_islands);
+		for (size_t i = 0; i < num_islands; i++) {
+			island_order[i] = static_cast<std::uint32_t>(i);
+		}
+		std::stable_sort(island_order.begin(), island_order.end(), [this](std::uint32_t const a, std::uint32_t const b) {
+			return island_cost[a] > island_cost[b];
+		});
+		island_rank.resize(num_islands);
+		for (size_t r = 0; r < num_islands; r++) {
+			island_rank[island_order[r]] = static_cast<std::uint32_t>(r);
+		}
+
+		// Group bodies and pairs by island with a counting sort, keeping their order
+		body_offsets.assign(num_islands + 1, 0);
+		pair_offsets.assign(num_islands + 1, 0);
+		for (size_t b = 0; b < num_bodies; b++) {
+			body_offsets[island_rank[body_island[b]] + 1]++;
+		}
+		for (size_t p = 0; p < pairs.size(); p++) {
+			if (pair_island[p] != NO_ISLAND) {
+				pair_offsets[island_rank[pair_island[p]] + 1]++;
+			}
+		}
+		for (size_t r = 0; r < num_islands; r++) {
+			body_offsets[r + 1] += body_offsets[r];
+			pair_offsets[r + 1] += pair_offsets[r];
+		}
+		bodies.resize(num_bodies);
+		island_pairs.resize(pair_offsets[num_islands]);
+		for (size_t b = 0; b < num_bodies; b++) {
+			bodies[body_offsets[island_rank[body_island[b]]]++] = static_cast<std::uint32_t>(b);
+		}
+		for (size_t p = 0; p < pairs.size(); p++) {
+			if (pair_island[p] != NO_ISLAND) {
+				island_pairs[pair_offsets[island_rank[pair_island[p]]]++] = pairs[p];
+			}
+		}
+		// The offsets were moved to the end of every island, shift them back
+		for (size_t r = num_islands; r > 0; r--) {
+			body_offsets[r] = body_offsets[r - 1];
+			pair_offsets[r] = pair_offsets[r - 1];
+		}
+		body_offsets[0] = 0;
+		pair_offsets[0] = 0;
+
+		// Pack consecutive islands in tasks of at least the minimum cost
+		task_offsets.clear();
+		std::uint64_t task_cost = 0;
+		for (size_t r = 0; r < num_islands; r++) {
+			if (task_cost == 0) {
+				task_offsets.push_back(r);
+			}
+			task_cost += island_cost[island_order[r]];
+			if (task_cost >= min_task_cost) {
+				task_cost = 0;
+			}
+		}
+		task_offsets.push_back(num_islands);
+	}
+
+	size_t ContactIslands::getNumIslands() const {
+		return (body_offsets.empty() ? 0 : body_offsets.size() - 1);
+	}
+
+	size_t ContactIslands::getNumTasks() const {
+		return (task_offsets.empty() ? 0 : task_offsets.size() - 1);
+	}
+
+	size_t ContactIslands::getTaskBegin(size_t const task) const {
+		return task_offsets[task];
+	}
+
+	size_t ContactIslands::getTaskEnd(size_t const task) const {
+		return task_offsets[task + 1];
+	}
+
+	std::uint32_t const * ContactIslands::getBodies(size_t const island) const {
+		return bodies.data() + body_offsets[island];
+	}
+
+	size_t ContactIslands::getNumBodies(size_t const island) const {
+		return body_offsets[island + 1] - body_offsets[island];
+	}
+
+	std::uint64_t ContactIslands::getCost(size_t const island) const {
+		return island_cost[island_order[island]];
+	}
+
+	BodyPair const * ContactIslands::getPairs(size_t const island) const {
+		return island_pairs.data() + pair_offsets[island];
+	}
+
+	size_t ContactIslands::getNumPairs(size_t const island) const {
+		return pair_offsets[island + 1] - pair_offsets[island];
+	}
+
+	std::uint32_t ContactIslands::find(std::uint32_t body) {
+		while (parent[body] != body) {
+			parent[body] = parent[parent[body]];
+			body = parent[body];
+		}
+
+		return body;
+	}
+
+	void ContactIslands::merge(std::uint32_t const a, std::uint32_t const b) {
+		std::uint32_t root_a = find(a);
+		std::uint32_t root_b = find(b);
+		if (root_a == root_b) {
+			return;
+		}
+		if (tree_size[root_a] < tree_size[root_b]) {
+			std::swap(root_a, root_b);
+		}
+		parent[root_b] = root_a;
+		tree_size[root_a] += tree_size[root_b];
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,591 @@
+#include "contact_stages.h"
+#include "body.h"
+#include "body_particles.h"
+#include "hash_grid.h"
+#include "matrix_include.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace pb {
+
+	// Grid of the particles, stack of pairs of tree nodes and pairs of particles in contact of the
+	// hash grid and sphere tree checks, one per thread so that the islands can be checked in parallel
+	static thread_local HierarchicalHashGrid particle_grid;
+	static thread_local std::vector<std::uint64_t> node_stack;
+	static thread_local std::vector<std::uint64_t> particle_pairs;
+
+	// Pair of a cell of the first body and one of the second body, by level and index
+	struct LevelPair {
+		std::uint32_t level_1;
+		std::uint32_t index_1;
+		std::uint32_t level_2;
+		std::uint32_t index_2;
+	};
+
+	// Stack of pairs of the multi-resolution check, one per thread
+	static thread_local std::vector<LevelPair> level_stack;
+
+	// Check if a point is within a distance of the world box of a body
+	static bool nearBox(contact_real const point[3], BodyParticlesDiscretisation const & body, contact_real const distance) {
+		contact_real const * const min = body.getWorldBoundsMin();
+		contact_real const * const max = body.getWorldBoundsMax();
+
+		return (point[0] >= min[0] - distance && point[0] <= max[0] + distance &&
+				point[1] >= min[1] - distance && point[1] <= max[1] + distance &&
+				point[2] >= min[2] - distance && point[2] <= max[2] + distance);
+	}
+
+	// World position of a point in body space, the center of a tree node or of a cell
+	static void transformBodyPoint(BodyTransform const & transform, contact_real const local[3], contact_real world[3]) {
+		for (size_t r = 0; r < 3; r++) {
+			world[r] = transform.x[r] + transform.R[3 * r] * local[0] + transform.R[3 * r + 1] * local[1] +
+				transform.R[3 * r + 2] * local[2];
+		}
+	}
+
+	// Append the contact between particle p1 of the first body and particle p2 of the second one
+	static void addParticleContact(ParticleWorldBuffer const & world_1, std::uint32_t const id_1, size_t const p1,
+								   ParticleWorldBuffer const & world_2, std::uint32_t const id_2, size_t const p2,
+								   contact_real const contact_distance, bool const update_2, ContactBuffer & contacts) {
+		// Relative position and velocity
+		math::vec3c const rel_position = math::vec3c({ world_2.px[p2], world_2.py[p2], world_2.pz[p2] }) -
+			math::vec3c({ world_1.px[p1], world_1.py[p1], world_1.pz[p1] });
+		math::vec3c const rel_speed = math::vec3c({ world_2.vx[p2], world_2.vy[p2], world_2.vz[p2] }) -
+			math::vec3c({ world_1.vx[p1], world_1.vy[p1], world_1.vz[p1] });
+		math::vec3c const normal = math::normalize(rel_position);
+
+		contact_real const n[3] = { normal(0), normal(1), normal(2) };
+		contact_real const v[3] = { rel_speed(0), rel_speed(1), rel_speed(2) };
+		contacts.add(id_1, static_cast<std::uint32_t>(p1), id_2, static_cast<std::uint32_t>(p2), update_2,
+					 n, contact_distance - math::magnitude(rel_position), v);
+	}
+
+	// Append the contacts of the pairs of particles keyed by the particle of the first body then
+	// the one of the second body, in the order of the brute force check
+	static void addSortedContacts(ParticleWorldBuffer const & world_1, std::uint32_t const id_1,
+								  ParticleWorldBuffer const & world_2, std::uint32_t const id_2,
+								  contact_real const contact_distance, bool const update_2,
+								  std::vector<std::uint64_t> & pairs, ContactBuffer & contacts) {
+		std::sort(pairs.begin(), pairs.end());
+		for (size_t c = 0; c < pairs.size(); c++) {
+			addParticleContact(world_1, id_1, static_cast<size_t>(pairs[c] >> 32),
+							   world_2, id_2, static_cast<size_t>(pairs[c] & 0xFFFFFFFFu),
+							   contact_distance, update_2, contacts);
+		}
+	}
+
+	// Append a contact between the shapes of two bodies at a world point, with the velocity of the
+	// second body relative to the first one at the point
+	static void addShapeContact(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+								BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+								bool const update_2, contact_real const normal[3], contact_real const depth,
+								contact_real const point[3], ContactBuffer & contacts) {
+		BodyTransform const & transform_1 = body_1.getWorldTransform();
+		BodyTransform const & transform_2 = body_2.getWorldTransform();
+		contact_real const arm_1[3] = { point[0] - transform_1.x[0], point[1] - transform_1.x[1], point[2] - transform_1.x[2] };
+		contact_real const arm_2[3] = { point[0] - transform_2.x[0], point[1] - transform_2.x[1], point[2] - transform_2.x[2] };
+		contact_real const * const w1 = transform_1.omega;
+		contact_real const * const w2 = transform_2.omega;
+		contact_real const v[3] = {
+			(transform_2.v[0] + w2[1] * arm_2[2] - w2[2] * arm_2[1]) - (transform_1.v[0] + w1[1] * arm_1[2] - w1[2] * arm_1[1]),
+			(transform_2.v[1] + w2[2] * arm_2[0] - w2[0] * arm_2[2]) - (transform_1.v[1] + w1[2] * arm_1[0] - w1[0] * arm_1[2]),
+			(transform_2.v[2] + w2[0] * arm_2[1] - w2[1] * arm_2[0]) - (transform_1.v[2] + w1[0] * arm_1[1] - w1[1] * arm_1[0])
+		};
+		contacts.addAtPoint(id_1, id_2, update_2, normal, depth, v, point);
+	}
+
+	// Radius of a sphere body
+	static contact_real getSphereRadius(BodyParticlesDiscretisation const & sphere) {
+		real parameters[Body::MAX_SHAPE_PARAMETERS];
+		sphere.getBody()->getShapeParameters(parameters);
+
+		return static_cast<contact_real>(parameters[0]);
+	}
+
+	// Contact of a sphere with the box of a plane, the normal goes from the first body to the second one
+	static size_t detectSpherePlane(BodyParticlesDiscretisation const & sphere, BodyParticlesDiscretisation const & plane,
+									bool const sphere_first, std::uint32_t const id_1, std::uint32_t const id_2,
+									bool const update_2, ContactBuffer & contacts) {
+		contact_real const radius = getSphereRadius(sphere);
+		real parameters[Body::MAX_SHAPE_PARAMETERS];
+		plane.getBody()->getShapeParameters(parameters);
+		contact_real const half_extents[3] = { static_cast<contact_real>(parameters[0]), static_cast<contact_real>(parameters[2]),
+											   static_cast<contact_real>(parameters[1]) };
+		BodyTransform const & transform = plane.getWorldTransform();
+		contact_real const * const center = sphere.getWorldTransform().x;
+
+		// Center of the sphere in body space of the plane and the point of the box nearest to it
+		contact_real const offset[3] = { center[0] - transform.x[0], center[1] - transform.x[1], center[2] - transform.x[2] };
+		contact_real local[3], nearest[3];
+		contact_real distance_sqr = contact_real(0);
+		for (size_t c = 0; c < 3; c++) {
+			local[c] = transform.R[c] * offset[0] + transform.R[3 + c] * offset[1] + transform.R[6 + c] * offset[2];
+			nearest[c] = std::min(std::max(local[c], -half_extents[c]), half_extents[c]);
+			distance_sqr += (local[c] - nearest[c]) * (local[c] - nearest[c]);
+		}
+
+		// Normal from the box to the sphere and depth, through the nearest face if the center is inside
+		contact_real normal_local[3];
+		contact_real depth;
+		if (distance_sqr > contact_real(0)) {
+			contact_real const distance = std::sqrt(distance_sqr);
+			if (distance >= radius) {
+				return 0;
+			}
+			for (size_t c = 0; c < 3; c++) {
+				normal_local[c] = (local[c] - nearest[c]) / distance;
+			}
+			depth = radius - distance;
+		} else {
+			size_t axis = 0;
+			for (size_t c = 1; c < 3; c++) {
+				if (half_extents[c] - std::abs(local[c]) < half_extents[axis] - std::abs(local[axis])) {
+					axis = c;
+				}
+			}
+			contact_real const side = local[axis] >= contact_real(0) ? contact_real(1) : contact_real(-1);
+			for (size_t c = 0; c < 3; c++) {
+				normal_local[c] = c == axis ? side : contact_real(0);
+			}
+			depth = radius + half_extents[axis] - std::abs(local[axis]);
+			nearest[axis] = side * half_extents[axis];
+		}
+
+		// World normal and point halfway between the surface of the box and the deepest point of the sphere
+		contact_real normal[3], point[3];
+		for (size_t r = 0; r < 3; r++) {
+			normal[r] = transform.R[3 * r] * normal_local[0] + transform.R[3 * r + 1] * normal_local[1] +
+				transform.R[3 * r + 2] * normal_local[2];
+			contact_real const surface = transform.x[r] + transform.R[3 * r] * nearest[0] + transform.R[3 * r + 1] * nearest[1] +
+				transform.R[3 * r + 2] * nearest[2];
+			point[r] = contact_real(0.5) * (surface + center[r] - radius * normal[r]);
+		}
+		if (sphere_first) {
+			contact_real const n[3] = { -normal[0], -normal[1], -normal[2] };
+			addShapeContact(sphere, id_1, plane, id_2, update_2, n, depth, point, contacts);
+		} else {
+			addShapeContact(plane, id_1, sphere, id_2, update_2, normal, depth, point, contacts);
+		}
+
+		return 1;
+	}
+
+	size_t detectContactsBruteForce(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									bool const update_2, ContactBuffer & contacts) {
+		ParticleWorldBuffer const & world_1 = body_1.getWorldParticles();
+		ParticleWorldBuffer const & world_2 = body_2.getWorldParticles();
+		contact_real const radius_1 = body_1.getParticleRadius();
+		contact_real const radius_2 = body_2.getParticleRadius();
+
+		// Squared distance below which two particles are in contact
+		contact_real const contact_distance = radius_1 + radius_2;
+		contact_real const contact_distance_sqr = contact_distance * contact_distance;
+
+		size_t found = 0;
+		for (size_t p1 = 0; p1 < body_1.getNumParticles(); p1++) {
+			for (size_t p2 = 0; p2 < body_2.getNumParticles(); p2++) {
+				// Check if the two particle are collding
+				contact_real const dx = world_2.px[p2] - world_1.px[p1];
+				contact_real const dy = world_2.py[p2] - world_1.py[p1];
+				contact_real const dz = world_2.pz[p2] - world_1.pz[p1];
+				if (dx * dx + dy * dy + dz * dz <= contact_distance_sqr) {
+					addParticleContact(world_1, id_1, p1, world_2, id_2, p2, contact_distance, update_2, contacts);
+					found++;
+				}
+			}
+		}
+
+		return found;
+	}
+
+	size_t detectContactsHashGrid(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+								  BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+								  bool const update_2, ContactBuffer & contacts) {
+		ParticleWorldBuffer const & world_1 = body_1.getWorldParticles();
+		ParticleWorldBuffer const & world_2 = body_2.getWorldParticles();
+		contact_real const radius_1 = body_1.getParticleRadius();
+		contact_real const radius_2 = body_2.getParticleRadius();
+		contact_real const contact_distance = radius_1 + radius_2;
+		contact_real const contact_distance_sqr = contact_distance * contact_distance;
+
+		// The particles of the body with the larger ones go in the grid, so that the queries of
+		// the smaller ones only visit the cells next to them
+		bool const grid_first = radius_1 > radius_2;
+		BodyParticlesDiscretisation const & grid_body = grid_first ? body_1 : body_2;
+		BodyParticlesDiscretisation const & query_body = grid_first ? body_2 : body_1;
+		ParticleWorldBuffer const & grid_world = grid_body.getWorldParticles();
+		ParticleWorldBuffer const & query_world = query_body.getWorldParticles();
+		HierarchicalHashGrid & grid = particle_grid;
+		std::vector<std::uint64_t> & pairs = particle_pairs;
+		// Only the particles within the contact distance of the box of the other body can touch
+		grid.clear();
+		for (size_t p = 0; p < grid_body.getNumParticles(); p++) {
+			contact_real const center[3] = { grid_world.px[p], grid_world.py[p], grid_world.pz[p] };
+			if (nearBox(center, query_body, contact_distance)) {
+				grid.insert(static_cast<std::uint32_t>(p), center, grid_body.getParticleRadius());
+			}
+		}
+		grid.build();
+
+		// Pairs of particles in contact, keyed by the particle of the first body then the one of
+		// the second body
+		pairs.clear();
+		for (size_t q = 0; q < query_body.getNumParticles(); q++) {
+			contact_real const center[3] = { query_world.px[q], query_world.py[q], query_world.pz[q] };
+			if (!nearBox(center, grid_body, contact_distance)) {
+				continue;
+			}
+			grid.query(center, query_body.getParticleRadius(), HierarchicalHashGrid::MIN_LEVEL,
+					   [&](std::uint32_t const g) {
+				std::uint64_t const p1 = grid_first ? g : q;
+				std::uint64_t const p2 = grid_first ? q : g;
+				contact_real const dx = world_2.px[p2] - world_1.px[p1];
+				contact_real const dy = world_2.py[p2] - world_1.py[p1];
+				contact_real const dz = world_2.pz[p2] - world_1.pz[p1];
+				if (dx * dx + dy * dy + dz * dz <= contact_distance_sqr) {
+					pairs.push_back((p1 << 32) | p2);
+				}
+			});
+		}
+
+		addSortedContacts(world_1, id_1, world_2, id_2, contact_distance, update_2, pairs, contacts);
+
+		return pairs.size();
+	}
+
+	size_t detectContactsSphereTree(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									bool const update_2, ContactBuffer & contacts) {
+		ParticleSphereTree const & tree_1 = body_1.getParticleTree();
+		ParticleSphereTree const & tree_2 = body_2.getParticleTree();
+		if (tree_1.empty() || tree_2.empty()) {
+			return 0;
+		}
+		ParticleWorldBuffer const & world_1 = body_1.getWorldParticles();
+		ParticleWorldBuffer const & world_2 = body_2.getWorldParticles();
+		contact_real const contact_distance = body_1.getParticleRadius() + body_2.getParticleRadius();
+		contact_real const contact_distance_sqr = contact_distance * contact_distance;
+		std::vector<ParticleSphereTree::Node> const & nodes_1 = tree_1.getNodes();
+		std::vector<ParticleSphereTree::Node> const & nodes_2 = tree_2.getNodes();
+		std::uint32_t const * const order_1 = tree_1.getOrder();
+		std::uint32_t const * const order_2 = tree_2.getOrder();
+		BodyTransform const & transform_1 = body_1.getWorldTransform();
+		BodyTransform const & transform_2 = body_2.getWorldTransform();
+
+		// The world particles and the world node centers are rounded differently, by about the
+		// epsilon of the largest coordinate involved
+		contact_real scale = nodes_1[0].radius + nodes_2[0].radius;
+		for (size_t c = 0; c < 3; c++) {
+			scale += std::abs(transform_1.x[c]) + std::abs(transform_2.x[c]);
+		}
+		contact_real const tolerance = contact_real(16) * std::numeric_limits<contact_real>::epsilon() * scale;
+
+		// Descend the pairs of nodes whose spheres overlap, splitting the larger sphere first
+		std::vector<std::uint64_t> & stack = node_stack;
+		std::vector<std::uint64_t> & pairs = particle_pairs;
+		stack.clear();
+		pairs.clear();
+		stack.push_back(0);
+		while (!stack.empty()) {
+			std::uint32_t const n1 = static_cast<std::uint32_t>(stack.back() >> 32);
+			std::uint32_t const n2 = static_cast<std::uint32_t>(stack.back() & 0xFFFFFFFFu);
+			stack.pop_back();
+			ParticleSphereTree::Node const & node_1 = nodes_1[n1];
+			ParticleSphereTree::Node const & node_2 = nodes_2[n2];
+			contact_real center_1[3], center_2[3];
+			transformBodyPoint(transform_1, node_1.center, center_1);
+			transformBodyPoint(transform_2, node_2.center, center_2);
+			contact_real const dx = center_2[0] - center_1[0];
+			contact_real const dy = center_2[1] - center_1[1];
+			contact_real const dz = center_2[2] - center_1[2];
+			contact_real const reach = node_1.radius + node_2.radius + tolerance;
+			if (dx * dx + dy * dy + dz * dz > reach * reach) {
+				continue;
+			}
+
+			bool const leaf_1 = node_1.left == 0;
+			bool const leaf_2 = node_2.left == 0;
+			if (leaf_1 && leaf_2) {
+				// Same check of the particles as the brute force one
+				for (std::uint32_t i = node_1.begin; i < node_1.end; i++) {
+					std::uint64_t const p1 = order_1[i];
+					for (std::uint32_t j = node_2.begin; j < node_2.end; j++) {
+						std::uint64_t const p2 = order_2[j];
+						contact_real const px = world_2.px[p2] - world_1.px[p1];
+						contact_real const py = world_2.py[p2] - world_1.py[p1];
+						contact_real const pz = world_2.pz[p2] - world_1.pz[p1];
+						if (px * px + py * py + pz * pz <= contact_distance_sqr) {
+							pairs.push_back((p1 << 32) | p2);
+						}
+					}
+				}
+			} else if (leaf_2 || (!leaf_1 && node_1.radius >= node_2.radius)) {
+				stack.push_back((static_cast<std::uint64_t>(node_1.right) << 32) | n2);
+				stack.push_back((static_cast<std::uint64_t>(node_1.left) << 32) | n2);
+			} else {
+				stack.push_back((static_cast<std::uint64_t>(n1) << 32) | node_2.right);
+				stack.push_back((static_cast<std::uint64_t>(n1) << 32) | node_2.left);
+			}
+		}
+		addSortedContacts(world_1, id_1, world_2, id_2, contact_distance, update_2, pairs, contacts);
+
+		return pairs.size();
+	}
+
+	// World center of a cell of a body and radius of its sphere
+	static contact_real transformCell(BodyParticlesDiscretisation const & body, std::uint32_t const level, std::uint32_t const index,
+									  contact_real center[3]) {
+		ParticleLevels const & levels = body.getParticleLevels();
+		transformBodyPoint(body.getWorldTransform(), levels.getCells(level)[index].center, center);
+
+		return levels.getCellRadius(level);
+	}
+
+	size_t detectContactsParticleLevels(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+										BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+										bool const update_2, ContactBuffer & contacts) {
+		ParticleLevels const & levels_1 = body_1.getParticleLevels();
+		ParticleLevels const & levels_2 = body_2.getParticleLevels();
+		if (levels_1.empty() || levels_2.empty()) {
+			return 0;
+		}
+		ParticleWorldBuffer const & world_1 = body_1.getWorldParticles();
+		ParticleWorldBuffer const & world_2 = body_2.getWorldParticles();
+		contact_real const contact_distance = body_1.getParticleRadius() + body_2.getParticleRadius();
+		contact_real const contact_distance_sqr = contact_distance * contact_distance;
+		std::uint32_t const * const order_1 = levels_1.getOrder();
+		std::uint32_t const * const order_2 = levels_2.getOrder();
+		std::uint32_t const top_1 = static_cast<std::uint32_t>(levels_1.getNumLevels());
+		std::uint32_t const top_2 = static_cast<std::uint32_t>(levels_2.getNumLevels());
+
+		// The world particles and the world cell centers are rounded differently, by about the
+		// epsilon of the largest coordinate involved
+		contact_real scale = levels_1.getCellRadius(top_1) + levels_2.getCellRadius(top_2);
+		for (size_t c = 0; c < 3; c++) {
+			scale += std::abs(body_1.getWorldTransform().x[c]) + std::abs(body_2.getWorldTransform().x[c]);
+		}
+		contact_real const tolerance = contact_real(16) * std::numeric_limits<contact_real>::epsilon() * scale;
+
+		// Start from the pairs of cells of the coarsest levels and refine the pairs whose spheres
+		// overlap, the coarser cell first
+		std::vector<LevelPair> & stack = level_stack;
+		std::vector<std::uint64_t> & pairs = particle_pairs;
+		stack.clear();
+		pairs.clear();
+		for (std::uint32_t i = 0; i < levels_1.getCells(top_1).size(); i++) {
+			for (std::uint32_t j = 0; j < levels_2.getCells(top_2).size(); j++) {
+				LevelPair const pair = { top_1, i, top_2, j };
+				stack.push_back(pair);
+			}
+		}
+		while (!stack.empty()) {
+			LevelPair const pair = stack.back();
+			stack.pop_back();
+			contact_real center_1[3], center_2[3];
+			contact_real const radius_1 = transformCell(body_1, pair.level_1, pair.index_1, center_1);
+			contact_real const radius_2 = transformCell(body_2, pair.level_2, pair.index_2, center_2);
+			contact_real const dx = center_2[0] - center_1[0];
+			contact_real const dy = center_2[1] - center_1[1];
+			contact_real const dz = center_2[2] - center_1[2];
+			contact_real const reach = radius_1 + radius_2 + tolerance;
+			if (dx * dx + dy * dy + dz * dz > reach * reach) {
+				continue;
+			}
+
+			if (pair.level_1 == 1 && pair.level_2 == 1) {
+				// Same check of the particles as the brute force one, a cell of the first level
+				// holds at most 8 of them
+				ParticleLevels::Cell const & cell_1 = levels_1.getCells(1)[pair.index_1];
+				ParticleLevels::Cell const & cell_2 = levels_2.getCells(1)[pair.index_2];
+				for (std::uint32_t i = cell_1.begin; i < cell_1.end; i++) {
+					std::uint64_t const p1 = order_1[i];
+					for (std::uint32_t j = cell_2.begin; j < cell_2.end; j++) {
+						std::uint64_t const p2 = order_2[j];
+						contact_real const px = world_2.px[p2] - world_1.px[p1];
+						contact_real const py = world_2.py[p2] - world_1.py[p1];
+						contact_real const pz = world_2.pz[p2] - world_1.pz[p1];
+						if (px * px + py * py + pz * pz <= contact_distance_sqr) {
+							pairs.push_back((p1 << 32) | p2);
+						}
+					}
+				}
+			} else if (pair.level_2 == 1 || (pair.level_1 > 1 && radius_1 >= radius_2)) {
+				ParticleLevels::Cell const & cell = levels_1.getCells(pair.level_1)[pair.index_1];
+				for (std::uint32_t i = cell.begin; i < cell.end; i++) {
+					LevelPair const child = { pair.level_1 - 1, i, pair.level_2, pair.index_2 };
+					stack.push_back(child);
+				}
+			} else {
+				ParticleLevels::Cell const & cell = levels_2.getCells(pair.level_2)[pair.index_2];
+				for (std::uint32_t j = cell.begin; j < cell.end; j++) {
+					LevelPair const child = { pair.level_1, pair.index_1, pair.level_2 - 1, j };
+					stack.push_back(child);
+				}
+			}
+		}
+		addSortedContacts(world_1, id_1, world_2, id_2, contact_distance, update_2, pairs, contacts);
+
+		return pairs.size();
+	}
+
+	size_t detectContactsDistanceField(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									   BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									   bool const update_2, ContactBuffer & contacts) {
+		// The body with the finer particles samples the field of the other one, or the body with
+		// a field if only one has it. Without fields the particles are checked against each other
+		bool sample_first = body_1.getParticleRadius() <= body_2.getParticleRadius();
+		if ((sample_first ? body_2 : body_1).getDistanceField() == nullptr) {
+			sample_first = !sample_first;
+		}
+		BodyParticlesDiscretisation const & sampler = sample_first ? body_1 : body_2;
+		BodyParticlesDiscretisation const & field_body = sample_first ? body_2 : body_1;
+		if (field_body.getDistanceField() == nullptr) {
+			return detectContactsSphereTree(body_1, id_1, body_2, id_2, update_2, contacts);
+		}
+		SignedDistanceField const & field = *field_body.getDistanceField();
+		if (field.empty()) {
+			return 0;
+		}
+		ParticleWorldBuffer const & sampler_world = sampler.getWorldParticles();
+		ParticleWorldBuffer const & field_world = field_body.getWorldParticles();
+		BodyTransform const & transform = field_body.getWorldTransform();
+		contact_real const radius = sampler.getParticleRadius();
+
+		size_t found = 0;
+		for (size_t p = 0; p < sampler.getNumParticles(); p++) {
+			contact_real const position[3] = { sampler_world.px[p], sampler_world.py[p], sampler_world.pz[p] };
+			if (!nearBox(position, field_body, radius)) {
+				continue;
+			}
+
+			// Distance of the particle center to the surface, in body space of the field
+			contact_real const offset[3] = { position[0] - transform.x[0], position[1] - transform.x[1],
+											 position[2] - transform.x[2] };
+			contact_real local[3];
+			for (size_t c = 0; c < 3; c++) {
+				local[c] = transform.R[c] * offset[0] + transform.R[3 + c] * offset[1] + transform.R[6 + c] * offset[2];
+			}
+			contact_real distance;
+			contact_real gradient[3];
+			std::uint32_t nearest;
+			if (!field.sample(local, distance, gradient, nearest) || distance >= radius) {
+				continue;
+			}
+			contact_real const gradient_norm = std::sqrt(gradient[0] * gradient[0] + gradient[1] * gradient[1] +
+														 gradient[2] * gradient[2]);
+			if (!(gradient_norm > contact_real(0))) {
+				continue;
+			}
+
+			// Outward normal of the field body in world space, the contact normal goes from the
+			// first body to the second one
+			contact_real normal[3];
+			for (size_t r = 0; r < 3; r++) {
+				normal[r] = (transform.R[3 * r] * gradient[0] + transform.R[3 * r + 1] * gradient[1] +
+							 transform.R[3 * r + 2] * gradient[2]) / gradient_norm;
+			}
+			std::uint32_t const p1 = sample_first ? static_cast<std::uint32_t>(p) : nearest;
+			std::uint32_t const p2 = sample_first ? nearest : static_cast<std::uint32_t>(p);
+			ParticleWorldBuffer const & world_1 = sample_first ? sampler_world : field_world;
+			ParticleWorldBuffer const & world_2 = sample_first ? field_world : sampler_world;
+			contact_real const sign = sample_first ? contact_real(-1) : contact_real(1);
+			contact_real const n[3] = { sign * normal[0], sign * normal[1], sign * normal[2] };
+			contact_real const v[3] = { world_2.vx[p2] - world_1.vx[p1], world_2.vy[p2] - world_1.vy[p1],
+										world_2.vz[p2] - world_1.vz[p1] };
+			contacts.add(id_1, p1, id_2, p2, update_2, n, radius - distance, v);
+			found++;
+		}
+
+		return found;
+	}
+
+	size_t detectContactsSphereSphere(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									  BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									  bool const update_2, ContactBuffer & contacts) {
+		contact_real const radius_1 = getSphereRadius(body_1);
+		contact_real const radius_2 = getSphereRadius(body_2);
+		contact_real const * const center_1 = body_1.getWorldTransform().x;
+		contact_real const * const center_2 = body_2.getWorldTransform().x;
+		contact_real const d[3] = { center_2[0] - center_1[0], center_2[1] - center_1[1], center_2[2] - center_1[2] };
+		contact_real const distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+		contact_real const depth = radius_1 + radius_2 - distance;
+		// Concentric spheres have no normal
+		if (!(depth > contact_real(0)) || !(distance > contact_real(0))) {
+			return 0;
+		}
+
+		// Point halfway between the deepest points of the two spheres
+		contact_real const n[3] = { d[0] / distance, d[1] / distance, d[2] / distance };
+		contact_real const reach = radius_1 - contact_real(0.5) * depth;
+		contact_real const point[3] = { center_1[0] + reach * n[0], center_1[1] + reach * n[1], center_1[2] + reach * n[2] };
+
+		addShapeContact(body_1, id_1, body_2, id_2, update_2, n, depth, point, contacts);
+
+		return 1;
+	}
+
+	size_t detectContactsSpherePlane(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									 BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									 bool const update_2, ContactBuffer & contacts) {
+		return detectSpherePlane(body_1, body_2, true, id_1, id_2, update_2, contacts);
+	}
+
+	size_t detectContactsPlaneSphere(BodyParticlesDiscretisation const & body_1, std::uint32_t const id_1,
+									 BodyParticlesDiscretisation const & body_2, std::uint32_t const id_2,
+									 bool const update_2, ContactBuffer & contacts) {
+		return detectSpherePlane(body_2, body_1, false, id_1, id_2, update_2, contacts);
+	}
+
+	ContactDetector getAnalyticContactDetector(ShapeType const shape_1, ShapeType const shape_2) {
+		// Closed forms of the pairs of shapes, by the shape of the first body then of the second one
+		static ContactDetector const detectors[NUM_SHAPE_TYPES][NUM_SHAPE_TYPES] = {
+			{ detectContactsSphereSphere, detectContactsSpherePlane },
+			{ detectContactsPlaneSphere, nullptr }
+		};
+		if (shape_1 >= NUM_SHAPE_TYPES || shape_2 >= NUM_SHAPE_TYPES) {
+			return nullptr;
+		}
+
+		return detectors[shape_1][shape_2];
+	}
+
+	void respondContactsSpringDamper(ContactBuffer const & contacts, size_t const begin, size_t const end,
+									 ContactMaterial const & material, BodyParticlesDiscretisation * const * const bodies) {
+		for (size_t c = begin; c < end; c++) {
+			BodyParticlesDiscretisation * const body_1 = bodies[contacts.first_body[c]];
+			BodyParticlesDiscretisation * const body_2 = bodies[contacts.second_body[c]];
+			bool const update_2 = contacts.update_second[c] != 0;
+
+			// Compute repulsive and dumping forces
+			math::vec3c const normal = math::vec3c({ contacts.nx[c], contacts.ny[c], contacts.nz[c] });
+			math::vec3c const f_rep_12 = (-material.stiffness * contacts.depth[c]) * normal;
+			math::vec3c const f_dump_12 = material.damping * math::vec3c({ contacts.vx[c], contacts.vy[c], contacts.vz[c] });
+
+			// Contacts between shapes push at their point
+			if (contacts.isAtPoint(c)) {
+				contact_real const point[3] = { contacts.cx[c], contacts.cy[c], contacts.cz[c] };
+				body_1->addContactForceAtPoint(point, f_rep_12 + f_dump_12);
+				if (update_2) {
+					body_2->addContactForceAtPoint(point, -(f_rep_12 + f_dump_12));
+				}
+				continue;
+			}
+
+			// Add repulsive forces
+			body_1->addContactForce(contacts.first_particle[c], f_rep_12);
+			if (update_2) {
+				body_2->addContactForce(contacts.second_particle[c], -f_rep_12);
+			}
+
+			// Add dumping force
+			body_1->addContactForce(contacts.first_particle[c], f_dump_12);
+			if (update_2) {
+				body_2->addContactForce(contacts.second_particle[c], -f_dump_12);
+			}
+		}
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "distance_field.h"
+#include "body.h"
+#include <algorithm>
+#include <cmath>
+
+namespace pb {
+
+	// Node without a nearest particle yet
+	static std::uint32_t const NO_PARTICLE = UINT32_MAX;
+	// Neighbours checked by a node in the two sweeps, bodies with fewer particles skip the sweeps
+	static size_t const NEIGHBOURS_PER_NODE = 26;
+
+	// Squared distance in voxels between a node and a particle
+	static std::int64_t voxelDistanceSqr(std::int32_t const node[3], Particle const & particle) {
+		std::int64_t const dx = node[0] - particle.getVoxel()[0];
+		std::int64_t const dy = node[1] - particle.getVoxel()[1];
+		std::int64_t const dz = node[2] - particle.getVoxel()[2];
+
+		return (dx * dx + dy * dy + dz * dz);
+	}
+
+	void SignedDistanceField::build(Body const & body, Particle const * const particles, size_t const num_particles,
+									contact_real const origin[3], contact_real const spacing) {
+		distances.clear();
+		nearest_particles.clear();
+		if (num_particles == 0) {
+			return;
+		}
+
+		// Lattice of the particles grown by the margin
+		std::int32_t lower[3], upper[3];
+		for (size_t c = 0; c < 3; c++) {
+			lower[c] = particles[0].getVoxel()[c];
+			upper[c] = particles[0].getVoxel()[c];
+		}
+		for (size_t p = 1; p < num_particles; p++) {
+			for (size_t c = 0; c < 3; c++) {
+				lower[c] = std::min<std::int32_t>(lower[c], particles[p].getVoxel()[c]);
+				upper[c] = std::max<std::int32_t>(upper[c], particles[p].getVoxel()[c]);
+			}
+		}
+		cell = spacing;
+		inv_cell = contact_real(1) / spacing;
+		for (size_t c = 0; c < 3; c++) {
+			first_voxel[c] = lower[c] - static_cast<std::int32_t>(MARGIN_CELLS);
+			grid_origin[c] = origin[c] + spacing * static_cast<contact_real>(first_voxel[c]);
+			dims[c] = static_cast<size_t>(upper[c] - lower[c]) + 1 + 2 * MARGIN_CELLS;
+		}
+
+		distances.resize(dims[0] * dims[1] * dims[2]);
+		if (num_particles <= NEIGHBOURS_PER_NODE) {
+			// Few particles, every node checks all of them
+			nearest_particles.resize(distances.size());
+			for (size_t z = 0; z < dims[2]; z++) {
+				for (size_t y = 0; y < dims[1]; y++) {
+					for (size_t x = 0; x < dims[0]; x++) {
+						std::int32_t const node[3] = { first_voxel[0] + static_cast<std::int32_t>(x), first_voxel[1] + static_cast<std::int32_t>(y),
+													   first_voxel[2] + static_cast<std::int32_t>(z) };
+						std::uint32_t nearest = 0;
+						std::int64_t nearest_sqr = voxelDistanceSqr(node, particles[0]);
+						for (size_t p = 1; p < num_particles; p++) {
+							std::int64_t const distance_sqr = voxelDistanceSqr(node, particles[p]);
+							if (distance_sqr < nearest_sqr) {
+								nearest_sqr = distance_sqr;
+								nearest = static_cast<std::uint32_t>(p);
+							}
+						}
+						nearest_particles[nodeIndex(x, y, z)] = nearest;
+					}
+				}
+			}
+		} else {
+			// Every particle is the nearest one of its node, the sweeps spread them to the other nodes
+			nearest_particles.assign(distances.size(), NO_PARTICLE);
+			for (size_t p = 0; p < num_particles; p++) {
+				std::int16_t const * const voxel = particles[p].getVoxel();
+				nearest_particles[nodeIndex(static_cast<size_t>(voxel[0] - first_voxel[0]), static_cast<size_t>(voxel[1] - first_voxel[1]),
+											static_cast<size_t>(voxel[2] - first_voxel[2]))] = static_cast<std::uint32_t>(p);
+			}
+			for (size_t z = 0; z < dims[2]; z++) {
+				for (size_t y = 0; y < dims[1]; y++) {
+					for (size_t x = 0; x < dims[0]; x++) {
+						for (int dz = -1; dz <= 0; dz++) {
+							for (int dy = -1; dy <= (dz < 0 ? 1 : 0); dy++) {
+								for (int dx = -1; dx <= (dz < 0 || dy < 0 ? 1 : -1); dx++) {
+									propagateNearest(particles, x, y, z, dx, dy, dz);
+								}
+							}
+						}
+					}
+				}
+			}
+			for (size_t z = dims[2]; z-- > 0;) {
+				for (size_t y = dims[1]; y-- > 0;) {
+					for (size_t x = dims[0]; x-- > 0;) {
+						for (int dz = 1; dz >= 0; dz--) {
+							for (int dy = 1; dy >= (dz > 0 ? -1 : 0); dy--) {
+								for (int dx = 1; dx >= (dz > 0 || dy > 0 ? -1 : 1); dx--) {
+									propagateNearest(particles, x, y, z, dx, dy, dz);
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+
+		// Distance of every node, the particles are offsets from the center of mass in body space
+		math::vec3r const cm = body.getCenterOfMass();
+		math::mat3x3r const & R = body.getRotationMatrix();
+		for (size_t z = 0; z < dims[2]; z++) {
+			for (size_t y = 0; y < dims[1]; y++) {
+				for (size_t x = 0; x < dims[0]; x++) {
+					size_t const index = nodeIndex(x, y, z);
+					math::vec3r const point = cm + R * math::vec3r({ static_cast<real>(grid_origin[0] + cell * static_cast<contact_real>(x)),
+																 static_cast<real>(grid_origin[1] + cell * static_cast<contact_real>(y)),
+																 static_cast<real>(grid_origin[2] + cell * static_cast<contact_real>(z)) });
+					real shape_distance;
+					if (body.signedDistance(point, shape_distance)) {
+						distances[index] = static_cast<contact_real>(shape_distance);
+						continue;
+					}
+					std::int32_t const node[3] = { first_voxel[0] + static_cast<std::int32_t>(x), first_voxel[1] + static_cast<std::int32_t>(y),
+												   first_voxel[2] + static_cast<std::int32_t>(z) };
+					contact_real const particle_distance = spacing *
+						std::sqrt(static_cast<contact_real>(voxelDistanceSqr(node, particles[nearest_particles[index]])));
+					if (body.pointInside(point)) {
+						distances[index] = -(particle_distance + contact_real(0.5) * spacing);
+					} else {
+						distances[index] = particle_distance - contact_real(0.5) * spacing;
+					}
+				}
+			}
+		}
+	}
+
+	bool SignedDistanceField::empty() const {
+		return distances.empty();
+	}
+
+	bool SignedDistanceField::sample(contact_real const point[3], contact_real & distance, contact_real gradient[3],
+									 std::uint32_t & nearest) const {
+		if (distances.empty()) {
+			return false;
+		}
+
+		// Cell holding the point and position inside it
+		size_t cell_index[3];
+		contact_real f[3];
+		for (size_t c = 0; c < 3; c++) {
+			contact_real const u = (point[c] - grid_origin[c]) * inv_cell;
+			if (!(u >= contact_real(0)) || u >= static_cast<contact_real>(dims[c] - 1)) {
+				return false;
+			}
+			cell_index[c] = static_cast<size_t>(u);
+			f[c] = u - static_cast<contact_real>(cell_index[c]);
+		}
+		size_t const x = cell_index[0], y = cell_index[1], z = cell_index[2];
+		contact_real const d000 = distances[nodeIndex(x, y, z)];
+		contact_real const d100 = distances[nodeIndex(x + 1, y, z)];
+		contact_real const d010 = distances[nodeIndex(x, y + 1, z)];
+		contact_real const d110 = distances[nodeIndex(x + 1, y + 1, z)];
+		contact_real const d001 = distances[nodeIndex(x, y, z + 1)];
+		contact_real const d101 = distances[nodeIndex(x + 1, y, z + 1)];
+		contact_real const d011 = distances[nodeIndex(x, y + 1, z + 1)];
+		contact_real const d111 = distances[nodeIndex(x + 1, y + 1, z + 1)];
+
+		// Trilinear interpolation, continuous across the cells, and its gradient inside the cell
+		contact_real const gx = contact_real(1) - f[0], gy = contact_real(1) - f[1], gz = contact_real(1) - f[2];
+		distance = gz * (gy * (gx * d000 + f[0] * d100) + f[1] * (gx * d010 + f[0] * d110)) +
+			f[2] * (gy * (gx * d001 + f[0] * d101) + f[1] * (gx * d011 + f[0] * d111));
+		gradient[0] = (gz * (gy * (d100 - d000) + f[1] * (d110 - d010)) + f[2] * (gy * (d101 - d001) + f[1] * (d111 - d011))) * inv_cell;
+		gradient[1] = (gz * (gx * (d010 - d000) + f[0] * (d110 - d100)) + f[2] * (gx * (d011 - d001) + f[0] * (d111 - d101))) * inv_cell;
+		gradient[2] = (gy * (gx * (d001 - d000) + f[0] * (d101 - d100)) + f[1] * (gx * (d011 - d010) + f[0] * (d111 - d110))) * inv_cell;
+
+		// Particle of the nearest node
+		size_t const nx = x + (f[0] >= contact_real(0.5) ? 1 : 0);
+		size_t const ny = y + (f[1] >= contact_real(0.5) ? 1 : 0);
+		size_t const nz = z + (f[2] >= contact_real(0.5) ? 1 : 0);
+		nearest = nearest_particles[nodeIndex(nx, ny, nz)];
+
+		return true;
+	}
+
+	void SignedDistanceField::propagateNearest(Particle const * const particles, size_t const x, size_t const y, size_t const z,
+											   int const dx, int const dy, int const dz) {
+		// Neighbour inside the grid with a particle
+		size_t const nx = x + dx, ny = y + dy, nz = z + dz;
+		if (nx >= dims[0] || ny >= dims[1] || nz >= dims[2]) {
+			return;
+		}
+		std::uint32_t const candidate = nearest_particles[nodeIndex(nx, ny, nz)];
+		if (candidate == NO_PARTICLE) {
+			return;
+		}
+
+		// Nearer particle, ties go to the lower index
+		size_t const index = nodeIndex(x, y, z);
+		std::uint32_t const current = nearest_particles[index];
+		std::int32_t const node[3] = { first_voxel[0] + static_cast<std::int32_t>(x), first_voxel[1] + static_cast<std::int32_t>(y),
+									   first_voxel[2] + static_cast<std::int32_t>(z) };
+		if (current == NO_PARTICLE) {
+			nearest_particles[index] = candidate;
+			return;
+		}
+		std::int64_t const candidate_sqr = voxelDistanceSqr(node, particles[candidate]);
+		std::int64_t const current_sqr = voxelDistanceSqr(node, particles[current]);
+		if (candidate_sqr < current_sqr || (candidate_sqr == current_sqr && candidate < current)) {
+			nearest_particles[index] = candidate;
+		}
+	}
+
+	size_t SignedDistanceField::nodeIndex(size_t const x, size_t const y, size_t const z) const {
+		return ((z * dims[1] + y) * dims[0] + x);
+	}
+
+} // pb namespace
\ No newline at end of file
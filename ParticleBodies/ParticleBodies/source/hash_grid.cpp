@@ -0,0 +1,87 @@
+#include "hash_grid.h"
+#include <algorithm>
+
+namespace pb {
+
+	int HierarchicalHashGrid::getLevel(contact_real const radius) {
+		// Smallest k with 2^k >= diameter, 2 * radius = m * 2^e with m in [0.5, 1)
+		int exponent;
+		contact_real const mantissa = std::frexp(contact_real(2) * radius, &exponent);
+		if (!(mantissa > contact_real(0))) {
+			return int(MIN_LEVEL);
+		}
+		int const level = mantissa == contact_real(0.5) ? exponent - 1 : exponent;
+
+		return std::min(std::max(level, int(MIN_LEVEL)), int(MAX_LEVEL));
+	}
+
+	void HierarchicalHashGrid::clear() {
+		entries.clear();
+		levels.clear();
+	}
+
+	void HierarchicalHashGrid::insert(std::uint32_t const id, contact_real const center[3], contact_real const radius) {
+		Entry entry;
+		entry.level = getLevel(radius);
+		contact_real const inv_cell = std::ldexp(contact_real(1), -entry.level);
+		for (size_t a = 0; a < 3; a++) {
+			entry.cell[a] = static_cast<std::int64_t>(std::floor(center[a] * inv_cell));
+		}
+		entry.id = id;
+		entries.push_back(entry);
+	}
+
+	void HierarchicalHashGrid::build() {
+		// Twice as many buckets as spheres, a power of two
+		size_t num_buckets = 1;
+		while (num_buckets < 2 * entries.size()) {
+			num_buckets *= 2;
+		}
+
+		// Counting sort of the spheres by bucket, stable so the visits follow the insertion order
+		// inside a cell
+		bucket_start.assign(num_buckets + 1, 0);
+		levels.clear();
+		for (size_t e = 0; e < entries.size(); e++) {
+			Entry const & entry = entries[e];
+			bucket_start[getBucket(entry.level, entry.cell[0], entry.cell[1], entry.cell[2]) + 1]++;
+			if (std::find(levels.begin(), levels.end(), entry.level) == levels.end()) {
+				levels.push_back(entry.level);
+			}
+		}
+		std::sort(levels.begin(), levels.end());
+		for (size_t b = 0; b < num_buckets; b++) {
+			bucket_start[b + 1] += bucket_start[b];
+		}
+		bucket_entries.resize(entries.size());
+		for (size_t e = 0; e < entries.size(); e++) {
+			Entry const & entry = entries[e];
+			size_t const bucket = getBucket(entry.level, entry.cell[0], entry.cell[1], entry.cell[2]);
+			bucket_entries[bucket_start[bucket]++] = static_cast<std::uint32_t>(e);
+		}
+		// The fill moved every start to the start of the next bucket
+		for (size_t b = num_buckets; b > 0; b--) {
+			bucket_start[b] = bucket_start[b - 1];
+		}
+		bucket_start[0] = 0;
+	}
+
+	size_t HierarchicalHashGrid::size() const {
+		return entries.size();
+	}
+
+	size_t HierarchicalHashGrid::getNumLevels() const {
+		return levels.size();
+	}
+
+	size_t HierarchicalHashGrid::getBucket(int const level, std::int64_t const x, std::int64_t const y,
+										   std::int64_t const z) const {
+		// Large primes on every coordinate, then the high bits of a multiplicative hash
+		std::uint64_t h = static_cast<std::uint64_t>(x) * 73856093u ^ static_cast<std::uint64_t>(y) * 19349663u ^
+			static_cast<std::uint64_t>(z) * 83492791u ^ static_cast<std::uint64_t>(static_cast<std::int64_t>(level)) * 2654435761u;
+		h *= 0x9E3779B97F4A7C15ull;
+
+		return static_cast<size_t>(h >> 32) & (bucket_start.size() - 2);
+	}
+
+} // pb namespace
\ No newline at end of file
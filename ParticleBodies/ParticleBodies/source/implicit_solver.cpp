@@ -0,0 +1,237 @@
+#include "implicit_solver.h"
+#include "body_particles.h"
+#include "body_state_store.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace pb {
+
+	// Unknown of the bodies whose velocity is not solved for
+	static std::uint32_t const NO_UNKNOWN = UINT32_MAX;
+
+	real const ImplicitContactSolver::TOLERANCE = std::sqrt(std::numeric_limits<real>::epsilon());
+
+	// Load and store the linear or angular part of an unknown
+	static math::vec3r loadVector(std::vector<real> const & x, size_t const offset) {
+		return math::vec3r({ x[offset], x[offset + 1], x[offset + 2] });
+	}
+	static void addVector(std::vector<real> & x, size_t const offset, math::vec3r const & v) {
+		x[offset] += v(0);
+		x[offset + 1] += v(1);
+		x[offset + 2] += v(2);
+	}
+
+	// Dot product of two vectors of unknowns
+	static real dot(std::vector<real> const & a, std::vector<real> const & b) {
+		real sum = real(0);
+		for (size_t i = 0; i < a.size(); i++) {
+			sum += a[i] * b[i];
+		}
+
+		return sum;
+	}
+
+	size_t ImplicitContactSolver::step(BodyStateStore & states, BodyParticlesDiscretisation * const * const bodies,
+									   std::vector<std::uint8_t> const & is_static, std::uint32_t const * const island_bodies,
+									   size_t const num_bodies, ContactRange const * const ranges, size_t const num_ranges,
+									   ContactMaterial const & material, math::vec3r const & gravity, real const h) {
+		damping = static_cast<real>(material.damping);
+		stiffness_step = h * static_cast<real>(material.stiffness);
+		h_step = h;
+
+		// Number the dynamic bodies of the island
+		if (unknowns.size() < states.size()) {
+			unknowns.resize(states.size(), NO_UNKNOWN);
+		}
+		masses.clear();
+		inertias.clear();
+		for (size_t b = 0; b < num_bodies; b++) {
+			std::uint32_t const index = island_bodies[b];
+			if (!is_static[index]) {
+				unknowns[index] = static_cast<std::uint32_t>(masses.size());
+				masses.push_back(states.getMass(index));
+				math::mat3x3r const & R = states.getRotationMatrix(index);
+				inertias.push_back(R * states.getInertiaTensorBody(index) * math::transpose(R));
+			}
+		}
+		size_t const num_unknowns = masses.size();
+		if (num_unknowns == 0) {
+			return 0;
+		}
+
+		// Start from the current velocities, the right hand side holds the momenta plus the
+		// impulse of gravity
+		size_t const size = 6 * num_unknowns;
+		velocities.assign(size, real(0));
+		rhs.assign(size, real(0));
+		inv_diagonal.assign(size, real(0));
+		for (size_t b = 0; b < num_bodies; b++) {
+			std::uint32_t const index = island_bodies[b];
+			if (is_static[index]) {
+				continue;
+			}
+			size_t const offset = 6 * unknowns[index];
+			addVector(velocities, offset, states.getLinearVelocity(index));
+			addVector(velocities, offset + 3, states.getAngularVelocity(index));
+			addVector(rhs, offset, states.getLinearMomentum(index) + h * gravity);
+			addVector(rhs, offset + 3, states.getAngularMomentum(index));
+			real const mass = masses[unknowns[index]];
+			math::mat3x3r const & inertia = inertias[unknowns[index]];
+			for (size_t c = 0; c < 3; c++) {
+				inv_diagonal[offset + c] = mass;
+				inv_diagonal[offset + 3 + c] = inertia(c, c);
+			}
+		}
+
+		// Arms and normals of the contacts, their spring impulse and their part of the diagonal
+		contact_first.clear();
+		contact_second.clear();
+		first_arms.clear();
+		second_arms.clear();
+		normals.clear();
+		for (size_t r = 0; r < num_ranges; r++) {
+			ContactBuffer const & contacts = *ranges[r].contacts;
+			for (size_t c = ranges[r].begin; c < ranges[r].end; c++) {
+				std::uint32_t const body_1 = contacts.first_body[c];
+				std::uint32_t const body_2 = contacts.second_body[c];
+				ParticleWorldBuffer const & world_1 = bodies[body_1]->getWorldParticles();
+				ParticleWorldBuffer const & world_2 = bodies[body_2]->getWorldParticles();
+				std::uint32_t const p1 = contacts.first_particle[c];
+				std::uint32_t const p2 = contacts.second_particle[c];
+				// Contacts between shapes act at their point
+				bool const at_point = contacts.isAtPoint(c);
+				math::vec3r const point = math::vec3r({ static_cast<real>(contacts.cx[c]), static_cast<real>(contacts.cy[c]),
+														static_cast<real>(contacts.cz[c]) });
+				math::vec3r const arm_1 = (at_point ? point : math::vec3r({ static_cast<real>(world_1.px[p1]), static_cast<real>(world_1.py[p1]),
+																			static_cast<real>(world_1.pz[p1]) })) - states.getPosition(body_1);
+				math::vec3r const arm_2 = (at_point ? point : math::vec3r({ static_cast<real>(world_2.px[p2]), static_cast<real>(world_2.py[p2]),
+																			static_cast<real>(world_2.pz[p2]) })) - states.getPosition(body_2);
+				math::vec3r const normal = math::vec3r({ static_cast<real>(contacts.nx[c]), static_cast<real>(contacts.ny[c]),
+														 static_cast<real>(contacts.nz[c]) });
+				std::uint32_t const unknown_1 = unknowns[body_1];
+				std::uint32_t const unknown_2 = unknowns[body_2];
+				contact_first.push_back(unknown_1);
+				contact_second.push_back(unknown_2);
+				first_arms.push_back(arm_1);
+				second_arms.push_back(arm_2);
+				normals.push_back(normal);
+
+				// Spring force on the first particle at the start of the step
+				math::vec3r const force = (-static_cast<real>(material.stiffness) * static_cast<real>(contacts.depth[c])) * normal;
+				// Diagonal of h * J^T A J, with J u = v + omega x arm, for both bodies
+				math::vec3r const arms[2] = { arm_1, arm_2 };
+				std::uint32_t const contact_unknowns[2] = { unknown_1, unknown_2 };
+				real const signs[2] = { real(1), real(-1) };
+				for (size_t side = 0; side < 2; side++) {
+					if (contact_unknowns[side] == NO_UNKNOWN) {
+						continue;
+					}
+					size_t const offset = 6 * contact_unknowns[side];
+					math::vec3r const & arm = arms[side];
+					addVector(rhs, offset, (signs[side] * h) * force);
+					addVector(rhs, offset + 3, (signs[side] * h) * math::crossProduct(arm, force));
+					math::vec3r const normal_arm = math::crossProduct(normal, arm);
+					real const arm_sqr = math::dotProduct(arm, arm);
+					for (size_t k = 0; k < 3; k++) {
+						inv_diagonal[offset + k] += h * (damping + stiffness_step * normal(k) * normal(k));
+						inv_diagonal[offset + 3 + k] += h * (damping * (arm_sqr - arm(k) * arm(k)) +
+															 stiffness_step * normal_arm(k) * normal_arm(k));
+					}
+				}
+			}
+		}
+		for (size_t i = 0; i < size; i++) {
+			inv_diagonal[i] = real(1) / inv_diagonal[i];
+		}
+
+		// Preconditioned conjugate gradient
+		residual.resize(size);
+		preconditioned.resize(size);
+		direction.resize(size);
+		product.resize(size);
+		multiply(velocities, product);
+		for (size_t i = 0; i < size; i++) {
+			residual[i] = rhs[i] - product[i];
+			preconditioned[i] = inv_diagonal[i] * residual[i];
+			direction[i] = preconditioned[i];
+		}
+		real const tolerance_sqr = TOLERANCE * TOLERANCE * dot(rhs, rhs);
+		real residual_preconditioned = dot(residual, preconditioned);
+		size_t iterations = 0;
+		while (iterations < MAX_ITERATIONS && dot(residual, residual) > tolerance_sqr) {
+			multiply(direction, product);
+			real const curvature = dot(direction, product);
+			if (!(curvature > real(0))) {
+				break;
+			}
+			real const alpha = residual_preconditioned / curvature;
+			for (size_t i = 0; i < size; i++) {
+				velocities[i] += alpha * direction[i];
+				residual[i] -= alpha * product[i];
+				preconditioned[i] = inv_diagonal[i] * residual[i];
+			}
+			real const next_residual_preconditioned = dot(residual, preconditioned);
+			real const beta = next_residual_preconditioned / residual_preconditioned;
+			residual_preconditioned = next_residual_preconditioned;
+			for (size_t i = 0; i < size; i++) {
+				direction[i] = preconditioned[i] + beta * direction[i];
+			}
+			iterations++;
+		}
+
+		// Momenta from the new velocities, positions and orientations moved with them
+		for (size_t b = 0; b < num_bodies; b++) {
+			std::uint32_t const index = island_bodies[b];
+			if (is_static[index]) {
+				continue;
+			}
+			size_t const unknown = unknowns[index];
+			states.integrateVelocity(index, loadVector(velocities, 6 * unknown), loadVector(velocities, 6 * unknown + 3), h);
+
+			// The table of unknowns is clean for the next island
+			unknowns[index] = NO_UNKNOWN;
+		}
+
+		return iterations;
+	}
+
+	void ImplicitContactSolver::multiply(std::vector<real> const & x, std::vector<real> & y) const {
+		// Mass matrix
+		for (size_t u = 0; u < masses.size(); u++) {
+			size_t const offset = 6 * u;
+			math::vec3r const w = inertias[u] * loadVector(x, offset + 3);
+			for (size_t c = 0; c < 3; c++) {
+				y[offset + c] = masses[u] * x[offset + c];
+				y[offset + 3 + c] = w(c);
+			}
+		}
+
+		// Every contact adds h * G^T A G, G u is the relative velocity of its second particle
+		for (size_t c = 0; c < normals.size(); c++) {
+			std::uint32_t const first = contact_first[c];
+			std::uint32_t const second = contact_second[c];
+			math::vec3r relative_velocity = math::vec3r({ real(0), real(0), real(0) });
+			if (first != NO_UNKNOWN) {
+				relative_velocity = relative_velocity - loadVector(x, 6 * first) -
+					math::crossProduct(loadVector(x, 6 * first + 3), first_arms[c]);
+			}
+			if (second != NO_UNKNOWN) {
+				relative_velocity = relative_velocity + loadVector(x, 6 * second) +
+					math::crossProduct(loadVector(x, 6 * second + 3), second_arms[c]);
+			}
+			math::vec3r const & normal = normals[c];
+			math::vec3r const impulse = h_step * (damping * relative_velocity +
+												  (stiffness_step * math::dotProduct(normal, relative_velocity)) * normal);
+			if (first != NO_UNKNOWN) {
+				addVector(y, 6 * first, -impulse);
+				addVector(y, 6 * first + 3, -math::crossProduct(first_arms[c], impulse));
+			}
+			if (second != NO_UNKNOWN) {
+				addVector(y, 6 * second, impulse);
+				addVector(y, 6 * second + 3, math::crossProduct(second_arms[c], impulse));
+			}
+		}
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "impulse_solver.h"
+#include "body_particles.h"
+#include "body_state_store.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace pb {
+
+	// Unknown of the bodies whose velocity is not solved for
+	static std::uint32_t const NO_UNKNOWN = UINT32_MAX;
+	// Contacts solved by one task of a parallel Jacobi sweep
+	static size_t const JACOBI_TASK_CONTACTS = 1024;
+
+	size_t ImpulseContactSolver::step(BodyStateStore & states, BodyParticlesDiscretisation * const * const bodies,
+									  std::vector<std::uint8_t> const & is_static, std::uint32_t const * const island_bodies,
+									  size_t const num_bodies, ContactRange const * const ranges, size_t const num_ranges,
+									  ImpulseSettings const & settings, math::vec3r const & gravity, real const h,
+									  ThreadPool * const pool) {
+		// Number the dynamic bodies of the island, their velocities get the impulse of gravity
+		if (unknowns.size() < states.size()) {
+			unknowns.resize(states.size(), NO_UNKNOWN);
+		}
+		inv_masses.clear();
+		inv_inertias.clear();
+		linear_velocities.clear();
+		angular_velocities.clear();
+		for (size_t b = 0; b < num_bodies; b++) {
+			std::uint32_t const index = island_bodies[b];
+			if (!is_static[index]) {
+				unknowns[index] = static_cast<std::uint32_t>(inv_masses.size());
+				real const inv_mass = real(1) / states.getMass(index);
+				inv_masses.push_back(inv_mass);
+				inv_inertias.push_back(states.getInverseInertiaTensor(index));
+				linear_velocities.push_back(states.getLinearVelocity(index) + (h * inv_mass) * gravity);
+				angular_velocities.push_back(states.getAngularVelocity(index));
+			}
+		}
+		if (inv_masses.empty()) {
+			return 0;
+		}
+
+		// Constraint of every contact
+		contact_first.clear();
+		contact_second.clear();
+		normals.clear();
+		first_torques.clear();
+		second_torques.clear();
+		first_responses.clear();
+		second_responses.clear();
+		effective_masses.clear();
+		targets.clear();
+		impulses.clear();
+		contact_counts.assign(inv_masses.size(), 0);
+		math::vec3r const zero = math::vec3r({ real(0), real(0), real(0) });
+		for (size_t r = 0; r < num_ranges; r++) {
+			ContactBuffer const & contacts = *ranges[r].contacts;
+			for (size_t c = ranges[r].begin; c < ranges[r].end; c++) {
+				std::uint32_t const body_ids[2] = { contacts.first_body[c], contacts.second_body[c] };
+				std::uint32_t const particles[2] = { contacts.first_particle[c], contacts.second_particle[c] };
+				math::vec3r const normal = math::vec3r({ static_cast<real>(contacts.nx[c]), static_cast<real>(contacts.ny[c]),
+														 static_cast<real>(contacts.nz[c]) });
+
+				// Arm cross normal and angular velocity change per unit impulse of both bodies
+				std::uint32_t contact_unknowns[2];
+				math::vec3r torques[2] = { zero, zero };
+				math::vec3r responses[2] = { zero, zero };
+				real inv_effective_mass = real(0);
+				for (size_t side = 0; side < 2; side++) {
+					contact_unknowns[side] = unknowns[body_ids[side]];
+					if (contact_unknowns[side] == NO_UNKNOWN) {
+						continue;
+					}
+					// Contacts between shapes act at their point
+					ParticleWorldBuffer const & world = bodies[body_ids[side]]->getWorldParticles();
+					math::vec3r const position = contacts.isAtPoint(c) ?
+						math::vec3r({ static_cast<real>(contacts.cx[c]), static_cast<real>(contacts.cy[c]), static_cast<real>(contacts.cz[c]) }) :
+						math::vec3r({ static_cast<real>(world.px[particles[side]]), static_cast<real>(world.py[particles[side]]),
+									  static_cast<real>(world.pz[particles[side]]) });
+					math::vec3r const arm = position - states.getPosition(body_ids[side]);
+					torques[side] = math::crossProduct(arm, normal);
+					responses[side] = inv_inertias[contact_unknowns[side]] * torques[side];
+					inv_effective_mass += inv_masses[contact_unknowns[side]] + math::dotProduct(torques[side], responses[side]);
+					contact_counts[contact_unknowns[side]]++;
+				}
+				contact_first.push_back(contact_unknowns[0]);
+				contact_second.push_back(contact_unknowns[1]);
+				normals.push_back(normal);
+				first_torques.push_back(torques[0]);
+				second_torques.push_back(torques[1]);
+				first_responses.push_back(responses[0]);
+				second_responses.push_back(responses[1]);
+				effective_masses.push_back(real(1) / inv_effective_mass);
+
+				// Separating velocity asked for by the penetration beyond the slop
+				real const penetration = static_cast<real>(contacts.depth[c]) - settings.penetration_slop;
+				targets.push_back(penetration > real(0) ? settings.position_correction / h * penetration : real(0));
+				impulses.push_back(settings.warm_start ? static_cast<real>(contacts.impulse[c]) : real(0));
+			}
+		}
+		size_t const num_contacts = normals.size();
+
+		// Warm start with the impulses of the previous step
+		for (size_t c = 0; c < num_contacts; c++) {
+			if (impulses[c] != real(0)) {
+				applyImpulse(c, impulses[c]);
+			}
+		}
+
+		// Sweeps, the accumulated impulse of a contact never pulls
+		if (settings.iteration == IMPULSE_GAUSS_SEIDEL) {
+			// Sweeps alternate their direction, so that the order of the contacts does not push
+			// symmetric piles to one side
+			for (size_t i = 0; i < settings.iterations; i++) {
+				for (size_t s = 0; s < num_contacts; s++) {
+					size_t const c = i % 2 == 0 ? s : num_contacts - 1 - s;
+					real const impulse = std::max(impulses[c] + solveContact(c), real(0));
+					applyImpulse(c, impulse - impulses[c]);
+					impulses[c] = impulse;
+				}
+			}
+		} else {
+			relaxations.resize(num_contacts);
+			for (size_t c = 0; c < num_contacts; c++) {
+				std::uint32_t const count_1 = contact_first[c] != NO_UNKNOWN ? contact_counts[contact_first[c]] : 0;
+				std::uint32_t const count_2 = contact_second[c] != NO_UNKNOWN ? contact_counts[contact_second[c]] : 0;
+				relaxations[c] = real(1) / static_cast<real>(std::max(count_1, count_2));
+			}
+			changes.resize(num_contacts);
+			size_t const num_tasks = (num_contacts + JACOBI_TASK_CONTACTS - 1) / JACOBI_TASK_CONTACTS;
+			auto const solve_task = [this, num_contacts](size_t const task) {
+				size_t const end = std::min((task + 1) * JACOBI_TASK_CONTACTS, num_contacts);
+				for (size_t c = task * JACOBI_TASK_CONTACTS; c < end; c++) {
+					changes[c] = std::max(impulses[c] + relaxations[c] * solveContact(c), real(0)) - impulses[c];
+				}
+			};
+			for (size_t i = 0; i < settings.iterations; i++) {
+				// The changes only read the velocities, they are applied in contact order
+				if (pool != nullptr && num_tasks > 1) {
+					pool->run(num_tasks, solve_task);
+				} else {
+					for (size_t task = 0; task < num_tasks; task++) {
+						solve_task(task);
+					}
+				}
+				for (size_t c = 0; c < num_contacts; c++) {
+					applyImpulse(c, changes[c]);
+					impulses[c] += changes[c];
+				}
+			}
+		}
+
+		// Keep the impulses for the next step
+		size_t c = 0;
+		for (size_t r = 0; r < num_ranges; r++) {
+			ContactBuffer & contacts = *ranges[r].contacts;
+			for (size_t contact = ranges[r].begin; contact < ranges[r].end; contact++) {
+				contacts.impulse[contact] = static_cast<contact_real>(impulses[c++]);
+			}
+		}
+
+		// Move the bodies with their new velocities
+		for (size_t b = 0; b < num_bodies; b++) {
+			std::uint32_t const index = island_bodies[b];
+			if (is_static[index]) {
+				continue;
+			}
+			states.integrateVelocity(index, linear_velocities[unknowns[index]], angular_velocities[unknowns[index]], h);
+
+			// The table of unknowns is clean for the next island
+			unknowns[index] = NO_UNKNOWN;
+		}
+
+		return settings.iterations;
+	}
+
+	real ImpulseContactSolver::solveContact(size_t const c) const {
+		// Velocity of the second particle relative to the first one along the normal
+		real normal_velocity = real(0);
+		if (contact_first[c] != NO_UNKNOWN) {
+			normal_velocity -= math::dotProduct(normals[c], linear_velocities[contact_first[c]]) +
+				math::dotProduct(first_torques[c], angular_velocities[contact_first[c]]);
+		}
+		if (contact_second[c] != NO_UNKNOWN) {
+			normal_velocity += math::dotProduct(normals[c], linear_velocities[contact_second[c]]) +
+				math::dotProduct(second_torques[c], angular_velocities[contact_second[c]]);
+		}
+
+		return effective_masses[c] * (targets[c] - normal_velocity);
+	}
+
+	void ImpulseContactSolver::applyImpulse(size_t const c, real const impulse) {
+		// The impulse pushes the second particle along the normal and the first one against it
+		if (contact_first[c] != NO_UNKNOWN) {
+			std::uint32_t const u = contact_first[c];
+			linear_velocities[u] = linear_velocities[u] - (impulse * inv_masses[u]) * normals[c];
+			angular_velocities[u] = angular_velocities[u] - impulse * first_responses[c];
+		}
+		if (contact_second[c] != NO_UNKNOWN) {
+			std::uint32_t const u = contact_second[c];
+			linear_velocities[u] = linear_velocities[u] + (impulse * inv_masses[u]) * normals[c];
+			angular_velocities[u] = angular_velocities[u] + impulse * second_responses[c];
+		}
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include "json.h"
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+namespace pb {
+
+	// Maximum nesting of arrays and objects
+	static size_t const MAX_DEPTH = 64;
+
+	// Define class implementing a recursive descent JSON parser
+	class JsonValue::Parser {
+	public:
+		Parser(char const * const text, size_t const size)
+			: p(text), begin(text), end(text + size) {}
+
+		// Parse the whole document
+		bool parseDocument(JsonValue * const value, std::string * const error) {
+			bool const valid = parseValue(value, 0) && (skipSpaces(), p == end);
+			if (!valid && error != nullptr) {
+				// Line of the error
+				size_t line = 1;
+				for (char const * c = begin; c < p && c < end; c++) {
+					line += (*c == '\n') ? 1 : 0;
+				}
+				*error = "invalid JSON at line " + std::to_string(line) + (message.empty() ? "" : ": " + message);
+			}
+
+			return valid;
+		}
+
+	private:
+		// Skip white spaces
+		void skipSpaces() {
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+				p++;
+			}
+		}
+
+		// Consume a literal
+		bool consume(char const * const literal) {
+			size_t const length = std::strlen(literal);
+			if (static_cast<size_t>(end - p) < length || std::strncmp(p, literal, length) != 0) {
+				return false;
+			}
+			p += length;
+
+			return true;
+		}
+
+		// Fail with a message
+		bool fail(char const * const what) {
+			message = what;
+			return false;
+		}
+
+		// Parse any value
+		bool parseValue(JsonValue * const value, size_t const depth) {
+			if (depth > MAX_DEPTH) {
+				return fail("nesting too deep");
+			}
+			skipSpaces();
+			if (p == end) {
+				return fail("unexpected end of the document");
+			}
+			switch (*p) {
+			case '{':
+				return parseObject(value, depth);
+			case '[':
+				return parseArray(value, depth);
+			case '"':
+				value->type = JSON_STRING;
+				return parseString(&value->string);
+			case 't':
+				value->type = JSON_BOOL;
+				value->boolean = true;
+				return consume("true") || fail("invalid literal");
+			case 'f':
+				value->type = JSON_BOOL;
+				value->boolean = false;
+				return consume("false") || fail("invalid literal");
+			case 'n':
+				value->type = JSON_NULL;
+				return consume("null") || fail("invalid literal");
+			default:
+				return parseNumber(value);
+			}
+		}
+
+		// Parse a number
+		bool parseNumber(JsonValue * const value) {
+			// Copy the token so that strtod does not read past the end of the text
+			char token[64];
+			size_t length = 0;
+			while (p + length < end && length + 1 < sizeof(token) &&
+				   std::strchr("+-0123456789.eE", p[length]) != nullptr) {
+				token[length] = p[length];
+				length++;
+			}
+			token[length] = '\0';
+			char * token_end;
+			value->number = std::strtod(token, &token_end);
+			if (length == 0 || token_end != token + length) {
+				return fail("invalid number");
+			}
+			value->type = JSON_NUMBER;
+			p += length;
+
+			return true;
+		}
+
+		// Parse a string, escaped unicode characters are stored as UTF-8
+		bool parseString(std::string * const string) {
+			p++;
+			string->clear();
+			while (p < end && *p != '"') {
+				if (*p != '\\') {
+					string->push_back(*p++);
+					continue;
+				}
+				if (++p == end) {
+					break;
+				}
+				char const escaped = *p++;
+				switch (escaped) {
+				case '"': case '\\': case '/':
+					string->push_back(escaped);
+					break;
+				case 'b':
+					string->push_back('\b');
+					break;
+				case 'f':
+					string->push_back('\f');
+					break;
+				case 'n':
+					string->push_back('\n');
+					break;
+				case 'r':
+					string->push_back('\r');
+					break;
+				case 't':
+					string->push_back('\t');
+					break;
+				case 'u': {
+					if (end - p < 4) {
+						return fail("invalid escape sequence");
+					}
+					char hex[5] = { p[0], p[1], p[2], p[3], '\0' };
+					char * hex_end;
+					unsigned long const code = std::strtoul(hex, &hex_end, 16);
+					if (hex_end != hex + 4) {
+						return fail("invalid escape sequence");
+					}
+					p += 4;
+					if (code < 0x80) {
+						string->push_back(static_cast<char>(code));
+					} else if (code < 0x800) {
+						string->push_back(static_cast<char>(0xc0 | (code >> 6)));
+						string->push_back(static_cast<char>(0x80 | (code & 0x3f)));
+					} else {
+						string->push_back(static_cast<char>(0xe0 | (code >> 12)));
+						string->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+						string->push_back(static_cast<char>(0x80 | (code & 0x3f)));
+					}
+					break;
+				}
+				default:
+					return fail("invalid escape sequence");
+				}
+			}
+			if (p == end) {
+				return fail("unterminated string");
+			}
+			p++;
+
+			return true;
+		}
+
+		// Parse an array
+		bool parseArray(JsonValue * const value, size_t const depth) {
+			value->type = JSON_ARRAY;
+			p++;
+			skipSpaces();
+			if (p < end && *p == ']') {
+				p++;
+				return true;
+			}
+			while (true) {
+				value->elements.push_back(JsonValue());
+				if (!parseValue(&value->elements.back(), depth + 1)) {
+					return false;
+				}
+				skipSpaces();
+				if (p < end && *p == ',') {
+					p++;
+				} else if (p < end && *p == ']') {
+					p++;
+					return true;
+				} else {
+					return fail("expected ',' or ']'");
+				}
+			}
+		}
+
+		// Parse an object
+		bool parseObject(JsonValue * const value, size_t const depth) {
+			value->type = JSON_OBJECT;
+			p++;
+			skipSpaces();
+			if (p < end && *p == '}') {
+				p++;
+				return true;
+			}
+			while (true) {
+				skipSpaces();
+				if (p == end || *p != '"') {
+					return fail("expected a key");
+				}
+				value->keys.push_back(std::string());
+				if (!parseString(&value->keys.back())) {
+					return false;
+				}
+				skipSpaces();
+				if (p == end || *p != ':') {
+					return fail("expected ':'");
+				}
+				p++;
+				value->elements.push_back(JsonValue());
+				if (!parseValue(&value->elements.back(), depth + 1)) {
+					return false;
+				}
+				skipSpaces();
+				if (p < end && *p == ',') {
+					p++;
+				} else if (p < end && *p == '}') {
+					p++;
+					return true;
+				} else {
+					return fail("expected ',' or '}'");
+				}
+			}
+		}
+
+		// Current position, begin and end of the text
+		char const * p;
+		char const * const begin;
+		char const * const end;
+		// Description of the error
+		std::string message;
+	};
+
+	JsonValue::JsonValue()
+		: type(JSON_NULL), boolean(false), number(0) {}
+
+	bool JsonValue::parse(char const * const text, size_t const size, JsonValue * const value,
+						  std::string * const error) {
+		*value = JsonValue();
+		Parser parser(text, size);
+
+		return parser.parseDocument(value, error);
+	}
+
+	JsonValue::Type JsonValue::getType() const {
+		return type;
+	}
+
+	bool JsonValue::isNumber() const {
+		return (type == JSON_NUMBER);
+	}
+
+	bool JsonValue::isString() const {
+		return (type == JSON_STRING);
+	}
+
+	bool JsonValue::isArray() const {
+		return (type == JSON_ARRAY);
+	}
+
+	bool JsonValue::isObject() const {
+		return (type == JSON_OBJECT);
+	}
+
+	bool JsonValue::getBool(bool const default_value) const {
+		return (type == JSON_BOOL ? boolean : default_value);
+	}
+
+	double JsonValue::getNumber(double const default_value) const {
+		return (type == JSON_NUMBER ? number : default_value);
+	}
+
+	std::string const & JsonValue::getString() const {
+		return string;
+	}
+
+	size_t JsonValue::size() const {
+		return elements.size();
+	}
+
+	JsonValue const & JsonValue::operator[](size_t const index) const {
+#ifdef _DEBUG
+		assert(index < elements.size());
+#endif
+		return elements[index];
+	}
+
+	JsonValue const * JsonValue::find(char const * const key) const {
+		if (type != JSON_OBJECT) {
+			return nullptr;
+		}
+		for (size_t m = 0; m < keys.size(); m++) {
+			if (keys[m] == key) {
+				return &elements[m];
+			}
+		}
+
+		return nullptr;
+	}
+
+	std::string const & JsonValue::getKey(size_t const index) const {
+		return keys[index];
+	}
+
+	JsonValue const & JsonValue::getMember(size_t const index) const {
+		return elements[index];
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -4,12 +4,21 @@
 #include "sphere.h"
 #include "sphere_graphics.h"
 #include "system.h"
+#include "benchmark.h"
+#include "checkpoint.h"
+#include "scene.h"
+#include "trajectory_player.h"
+#include "trajectory_recorder.h"
 #include <iostream>
+#include <cstring>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 
 #define M_PI 3.14159265f
 
+// Number of steps between two checkpoints
+#define CHECKPOINT_INTERVAL 100
+
 /* Define function prototypes */
 static void error_callback(int error, const char* description);
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -21,12 +30,40 @@ void resize(GLFWwindow* window);
 static glm::vec3 prev_position;
 static float phi, tao, r;
 
-int main(void) {
+// Trajectory being played back, controlled from the keyboard
+static pb::TrajectoryPlayer * player = nullptr;
+
+int main(int argc, char ** argv) {
 
 	/* Variables declaration */
 	GLFWwindow* window;
 	GLenum err;
 
+	// Run headless benchmarks if requested
+	if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+		return pb::Benchmark::runAll();
+	}
+
+	// Checkpoint and recording options
+	char const * checkpoint_path = nullptr;
+	char const * restart_path = nullptr;
+	char const * record_path = nullptr;
+	char const * play_path = nullptr;
+	char const * scene_path = nullptr;
+	for (int a = 1; a + 1 < argc; a++) {
+		if (strcmp(argv[a], "--checkpoint") == 0) {
+			checkpoint_path = argv[++a];
+		} else if (strcmp(argv[a], "--restart") == 0) {
+			restart_path = argv[++a];
+		} else if (strcmp(argv[a], "--record") == 0) {
+			record_path = argv[++a];
+		} else if (strcmp(argv[a], "--play") == 0) {
+			play_path = argv[++a];
+		} else if (strcmp(argv[a], "--scene") == 0) {
+			scene_path = argv[++a];
+		}
+	}
+
 	r = 8.f;
 	phi = M_PI / 4.f;
 	tao = M_PI / 4.f;
@@ -54,7 +91,12 @@ int main(void) {
 	window = glfwCreateWindow(800, 800, "Particle bodies", NULL, NULL);
 
 	if (!window) {
-		glfwTerminate();
+		// Flush the pending frames of the trajectory
+	if (recorder) {
+		recorder->close();
+	}
+
+	glfwTerminate();
 		fprintf(stderr, "Failed to create window\n");
 		getchar();
 
@@ -103,21 +145,101 @@ int main(void) {
 	GLuint sphere_v_buff, sphere_i_buff, sphere_num_elements;
 	pb::SphereGraphic::createSphereGraphic(40, 30, &sphere_v_buff, &sphere_i_buff, &sphere_num_elements);
 
-	// Create sphere
-	pb::Body * sphere0 = new pb::Sphere(pb::math::vec3f({ 0.f, 3.f, 0.f }), 1.f, pb::math::quaternionFromAngleAxis(0.f, pb::math::vec3f({1.f, 0.f, 0.f})), 1.f);
-	pb::Body * sphere1 = new pb::Sphere(pb::math::vec3f({ 0.f, -2.f, 0.f }), INFINITY, pb::math::quaternionFromAngleAxis(0.f, pb::math::vec3f({ 1.f, 0.f, 0.f })), 2.f);
-	pb::Body * sphere2 = new pb::Sphere(pb::math::vec3f({ 0.f, 6.f, 0.f }), 1.f, pb::math::quaternionFromAngleAxis(0.f, pb::math::vec3f({ 1.f, 0.f, 0.f })), 1.f);
+	// Play back a recorded trajectory instead of simulating
+	if (play_path != nullptr) {
+		pb::TrajectoryPlayer trajectory_player;
+		if (!trajectory_player.open(play_path)) {
+			fprintf(stderr, "Failed to open trajectory %s\n", play_path);
+			return 1;
+		}
+		player = &trajectory_player;
+		double previous_time = glfwGetTime();
+		while (!glfwWindowShouldClose(window)) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			// Poll for and process events
+			glfwPollEvents();
+
+			// Advance the playback by the elapsed time
+			double const current_time = glfwGetTime();
+			trajectory_player.update(current_time - previous_time);
+			previous_time = current_time;
+
+			char title[128];
+			snprintf(title, sizeof(title), "Particle bodies - frame %zu / %zu, t = %.3f, speed %.3gx%s",
+					 trajectory_player.getFrame() + 1, trajectory_player.getNumFrames(), trajectory_player.getTime(),
+					 trajectory_player.getSpeed(), trajectory_player.isPaused() ? " (paused)" : "");
+			glfwSetWindowTitle(window, title);
 
-	// Create sphere discretisation
-	pb::BodyParticlesDiscretisation sphere_discretisation0 = pb::BodyParticlesDiscretisation(sphere0, 0.3f);
-	pb::BodyParticlesDiscretisation sphere_discretisation1 = pb::BodyParticlesDiscretisation(sphere1, 0.3f);
-	pb::BodyParticlesDiscretisation sphere_discretisation2 = pb::BodyParticlesDiscretisation(sphere2, 0.3f);
+			// Call resize function
+			resize(window);
 
-	pb::System system = pb::System(0.f, 1.f / 30.f);
+			update_view(window, glm::vec3(0.f, 0.f, 0.f));
 
-	system.addBody(&sphere_discretisation0);
-	system.addBody(&sphere_discretisation1);
-	system.addBody(&sphere_discretisation2);
+			// Draw bodies
+			trajectory_player.draw(sphere_v_buff, sphere_i_buff, sphere_num_elements);
+
+			// Swap front and back buffers
+			glfwSwapBuffers(window);
+		}
+		player = nullptr;
+
+		glfwTerminate();
+
+		return 0;
+	}
+
+	// Create spheres owned by the system
+	pb::System system(0.f, 1.f / 30.f);
+	pb::math::quaternionr const orientation = pb::math::quaternionFromAngleAxis(pb::real(0), pb::math::vec3r({ 1.f, 0.f, 0.f }));
+	pb::real const unit_radius[pb::Body::MAX_SHAPE_PARAMETERS] = { 1.f, 0.f, 0.f, 0.f };
+	pb::real const ground_radius[pb::Body::MAX_SHAPE_PARAMETERS] = { 2.f, 0.f, 0.f, 0.f };
+	system.createBody(pb::SHAPE_SPHERE, unit_radius, pb::math::vec3r({ 0.f, 3.f, 0.f }), 1.f, orientation, 0.3f);
+	system.createBody(pb::SHAPE_SPHERE, ground_radius, pb::math::vec3r({ 0.f, -2.f, 0.f }), INFINITY, orientation, 0.3f);
+	system.createBody(pb::SHAPE_SPHERE, unit_radius, pb::math::vec3r({ 0.f, 6.f, 0.f }), 1.f, orientation, 0.3f);
+	// Bodies too long for the 16 bit voxel coordinates get larger particles than requested
+	for (auto body = system.getBodies().begin(); body != system.getBodies().end(); body++) {
+		if ((*body)->getSpacing() != pb::contact_real(0.3f)) {
+			fprintf(stderr, "Particle diameter 0.3 enlarged to %g\n", static_cast<double>((*body)->getSpacing()));
+		}
+	}
+	// The scene only has spheres, their contacts have a closed form
+	system.setAnalyticContacts(true);
+
+	// Replace the default scene with one loaded from a file or stored in a checkpoint
+	pb::System * simulation = &system;
+	pb::LoadedScene loaded;
+	if (scene_path != nullptr) {
+		if (!pb::SceneLoader::load(scene_path, &loaded)) {
+			fprintf(stderr, "Failed to load scene %s\n", scene_path);
+			return 1;
+		}
+		simulation = loaded.system.get();
+	}
+	pb::RestartedSystem restarted;
+	if (restart_path != nullptr) {
+		if (!pb::CheckpointReader::restart(restart_path, &restarted)) {
+			fprintf(stderr, "Failed to restart from checkpoint %s\n", restart_path);
+			return 1;
+		}
+		simulation = restarted.system.get();
+	}
+
+	// Write checkpoints periodically if requested
+	std::unique_ptr<pb::CheckpointWriter> checkpoint_writer;
+	if (checkpoint_path != nullptr) {
+		checkpoint_writer.reset(new pb::CheckpointWriter(checkpoint_path));
+	}
+	// Record the trajectory of the bodies at every step if requested
+	std::unique_ptr<pb::TrajectoryRecorder> recorder;
+	if (record_path != nullptr) {
+		recorder.reset(new pb::TrajectoryRecorder(record_path));
+		if (!recorder->isOpen()) {
+			fprintf(stderr, "Failed to open trajectory file %s\n", record_path);
+			return 1;
+		}
+	}
+	size_t step = 0;
 
 	/* Loop until the user closes the window */
 	while (!glfwWindowShouldClose(window)) {
@@ -127,7 +249,16 @@ int main(void) {
 		glfwPollEvents();
 
 		// Compute system step
-		system.computeStep();
+		simulation->computeStep();
+		step++;
+		if (checkpoint_writer && step % CHECKPOINT_INTERVAL == 0) {
+			if (!checkpoint_writer->write(*simulation)) {
+				fprintf(stderr, "Failed to write checkpoint %s\n", checkpoint_path);
+			}
+		}
+		if (recorder) {
+			recorder->record(*simulation);
+		}
 
 		// Call resize function
 		resize(window);
@@ -135,13 +266,18 @@ int main(void) {
 		update_view(window, glm::vec3(0.f, 0.f, 0.f));
 
 		// Draw system
-		system.draw(part_v_buff, part_i_buff, part_num_elements,
+		simulation->draw(part_v_buff, part_i_buff, part_num_elements,
 					sphere_v_buff, sphere_i_buff, sphere_num_elements);
 
 		// Swap front and back buffers
 		glfwSwapBuffers(window);
 	}
 
+	// Flush the pending frames of the trajectory
+	if (recorder) {
+		recorder->close();
+	}
+
 	glfwTerminate();
 
 	return 0;
@@ -156,6 +292,50 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
 		glfwSetWindowShouldClose(window, GL_TRUE);
 	}
+
+	// Playback controls: space pauses, left and right step one frame, page up and down
+	// jump by a tenth of the recording, home and end go to the ends, up and down change the
+	// speed and R reverses the direction
+	if (player == nullptr || action == GLFW_RELEASE) {
+		return;
+	}
+	long long const jump = static_cast<long long>(player->getNumFrames() / 10) + 1;
+	switch (key) {
+	case GLFW_KEY_SPACE:
+		player->setPaused(!player->isPaused());
+		break;
+	case GLFW_KEY_RIGHT:
+		player->setPaused(true);
+		player->step(1);
+		break;
+	case GLFW_KEY_LEFT:
+		player->setPaused(true);
+		player->step(-1);
+		break;
+	case GLFW_KEY_PAGE_UP:
+		player->step(jump);
+		break;
+	case GLFW_KEY_PAGE_DOWN:
+		player->step(-jump);
+		break;
+	case GLFW_KEY_HOME:
+		player->seek(0);
+		break;
+	case GLFW_KEY_END:
+		player->seek(player->getNumFrames() - 1);
+		break;
+	case GLFW_KEY_UP:
+		player->setSpeed(player->getSpeed() * 2.0);
+		break;
+	case GLFW_KEY_DOWN:
+		player->setSpeed(player->getSpeed() * 0.5);
+		break;
+	case GLFW_KEY_R:
+		player->setSpeed(-player->getSpeed());
+		break;
+	default:
+		break;
+	}
 }
 
 void scrollCallback(GLFWwindow* window, double x, double y) {
@@ -0,0 +1,107 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pb {
+
+#ifdef _WIN32
+	MappedFile::MappedFile()
+		: file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr), address(nullptr), length(0) {}
+#else
+	MappedFile::MappedFile()
+		: file_descriptor(-1), address(nullptr), length(0) {}
+#endif
+
+	MappedFile::~MappedFile() {
+		close();
+	}
+
+	bool MappedFile::open(char const * const path) {
+		close();
+
+#ifdef _WIN32
+		file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file_handle == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+			close();
+			return false;
+		}
+		mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping_handle == nullptr) {
+			close();
+			return false;
+		}
+		address = static_cast<unsigned char const *>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+		if (address == nullptr) {
+			close();
+			return false;
+		}
+		length = static_cast<size_t>(file_size.QuadPart);
+#else
+		file_descriptor = ::open(path, O_RDONLY);
+		if (file_descriptor < 0) {
+			return false;
+		}
+		struct stat file_stat;
+		if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size == 0) {
+			close();
+			return false;
+		}
+		void * const mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+		if (mapping == MAP_FAILED) {
+			close();
+			return false;
+		}
+		address = static_cast<unsigned char const *>(mapping);
+		length = static_cast<size_t>(file_stat.st_size);
+#endif
+
+		return true;
+	}
+
+	void MappedFile::close() {
+#ifdef _WIN32
+		if (address != nullptr) {
+			UnmapViewOfFile(address);
+		}
+		if (mapping_handle != nullptr) {
+			CloseHandle(mapping_handle);
+		}
+		if (file_handle != INVALID_HANDLE_VALUE) {
+			CloseHandle(file_handle);
+		}
+		file_handle = INVALID_HANDLE_VALUE;
+		mapping_handle = nullptr;
+#else
+		if (address != nullptr) {
+			munmap(const_cast<unsigned char *>(address), length);
+		}
+		if (file_descriptor >= 0) {
+			::close(file_descriptor);
+		}
+		file_descriptor = -1;
+#endif
+		address = nullptr;
+		length = 0;
+	}
+
+	unsigned char const * MappedFile::data() const {
+		return address;
+	}
+
+	size_t MappedFile::size() const {
+		return length;
+	}
+
+} // pb namespace
\ No newline at end of file
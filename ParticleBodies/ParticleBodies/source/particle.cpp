@@ -2,17 +2,24 @@
 
 namespace pb {
 
-	Particle::Particle(pb::math::vec3f const & p, float const radius) 
-		: position(p), radius(radius), force() {}
+	Particle::Particle(std::int16_t const i, std::int16_t const j, std::int16_t const k) {
+		voxel[0] = i;
+		voxel[1] = j;
+		voxel[2] = k;
+		voxel[3] = 0;
+		resetForce();
+	}
 
-	void Particle::addForce(pb::math::vec3f const & f) {
-		force = force + f;
+	void Particle::addForce(pb::math::vec3c const & f) {
+		force[0] += f(0);
+		force[1] += f(1);
+		force[2] += f(2);
 	}
 
 	void Particle::resetForce() {
-		force(0) = 0.f;
-		force(1) = 0.f;
-		force(2) = 0.f;
+		force[0] = 0;
+		force[1] = 0;
+		force[2] = 0;
 	}
 
 } // pb namespace
\ No newline at end of file
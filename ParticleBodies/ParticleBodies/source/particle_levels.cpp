@@ -0,0 +1,121 @@
+#include "particle_levels.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace pb {
+
+	// Relative margin of the cell spheres against rounding
+	static contact_real const CELL_RADIUS_MARGIN = contact_real(1.001);
+
+	// Sort items by their cell in z, y, x order, ties broken by index so the levels do not depend
+	// on the library
+	static void sortByCell(std::vector<std::int32_t> const & cells, std::vector<std::uint32_t> & items) {
+		std::sort(items.begin(), items.end(), [&cells](std::uint32_t const a, std::uint32_t const b) {
+			for (size_t c = 3; c-- > 0;) {
+				if (cells[3 * a + c] != cells[3 * b + c]) {
+					return (cells[3 * a + c] < cells[3 * b + c]);
+				}
+			}
+			return (a < b);
+		});
+	}
+
+	void ParticleLevels::build(Particle const * const particles, size_t const num_particles,
+							   contact_real const origin[3], contact_real const spacing, contact_real const particle_radius) {
+		levels.clear();
+		order.resize(num_particles);
+		if (num_particles == 0) {
+			return;
+		}
+
+		// Cell of every particle in the first level, the particles are grouped by it
+		std::vector<std::int32_t> cells(3 * num_particles);
+		for (size_t p = 0; p < num_particles; p++) {
+			order[p] = static_cast<std::uint32_t>(p);
+			for (size_t c = 0; c < 3; c++) {
+				cells[3 * p + c] = static_cast<std::int32_t>(particles[p].getVoxel()[c]) >> 1;
+			}
+		}
+		sortByCell(cells, order);
+		std::vector<std::int32_t> sorted_cells(cells.size());
+		for (size_t i = 0; i < num_particles; i++) {
+			std::copy(&cells[3 * order[i]], &cells[3 * order[i]] + 3, &sorted_cells[3 * i]);
+		}
+
+		// Every level groups the runs of items of the level below in the same cell. The voxels
+		// are 16 bit, after 16 levels every cell is 0 or -1 along every axis and there are at
+		// most ROOT_CELLS of them
+		for (size_t level = 1;; level++) {
+			std::int32_t const side = std::int32_t(1) << level;
+			Level current;
+			current.radius = (contact_real(0.5) * std::sqrt(contact_real(3)) * spacing * static_cast<contact_real>(side - 1) +
+							  particle_radius) * CELL_RADIUS_MARGIN;
+			cells.clear();
+			size_t const num_items = sorted_cells.size() / 3;
+			for (size_t i = 0; i < num_items;) {
+				std::int32_t const * const cell = &sorted_cells[3 * i];
+				size_t j = i + 1;
+				while (j < num_items && std::equal(cell, cell + 3, &sorted_cells[3 * j])) {
+					j++;
+				}
+				Cell node;
+				for (size_t c = 0; c < 3; c++) {
+					node.center[c] = origin[c] + spacing * (static_cast<contact_real>(cell[c] * side) +
+															contact_real(0.5) * static_cast<contact_real>(side - 1));
+					cells.push_back(cell[c] >> 1);
+				}
+				node.begin = static_cast<std::uint32_t>(i);
+				node.end = static_cast<std::uint32_t>(j);
+				current.cells.push_back(node);
+				i = j;
+			}
+			levels.push_back(current);
+			if (levels.back().cells.size() <= ROOT_CELLS) {
+				break;
+			}
+
+			// Group the cells of this level by their cell in the next one
+			std::vector<Cell> & below = levels.back().cells;
+			std::vector<std::uint32_t> items(below.size());
+			for (size_t i = 0; i < items.size(); i++) {
+				items[i] = static_cast<std::uint32_t>(i);
+			}
+			sortByCell(cells, items);
+			std::vector<Cell> sorted_below(below.size());
+			sorted_cells.resize(cells.size());
+			for (size_t i = 0; i < items.size(); i++) {
+				sorted_below[i] = below[items[i]];
+				std::copy(&cells[3 * items[i]], &cells[3 * items[i]] + 3, &sorted_cells[3 * i]);
+			}
+			below.swap(sorted_below);
+		}
+	}
+
+	bool ParticleLevels::empty() const {
+		return levels.empty();
+	}
+
+	size_t ParticleLevels::getNumLevels() const {
+		return levels.size();
+	}
+
+	std::vector<ParticleLevels::Cell> const & ParticleLevels::getCells(size_t const level) const {
+#ifdef _DEBUG
+		assert(level >= 1 && level <= levels.size());
+#endif
+		return levels[level - 1].cells;
+	}
+
+	contact_real ParticleLevels::getCellRadius(size_t const level) const {
+#ifdef _DEBUG
+		assert(level >= 1 && level <= levels.size());
+#endif
+		return levels[level - 1].radius;
+	}
+
+	std::uint32_t const * ParticleLevels::getOrder() const {
+		return order.data();
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include "particle_transform.h"
+
+namespace pb {
+
+	void ParticleWorldBuffer::resize(size_t const num_particles) {
+		px.resize(num_particles);
+		py.resize(num_particles);
+		pz.resize(num_particles);
+		vx.resize(num_particles);
+		vy.resize(num_particles);
+		vz.resize(num_particles);
+	}
+
+	void ParticleWorldBuffer::release() {
+		std::vector<contact_real>().swap(px);
+		std::vector<contact_real>().swap(py);
+		std::vector<contact_real>().swap(pz);
+		std::vector<contact_real>().swap(vx);
+		std::vector<contact_real>().swap(vy);
+		std::vector<contact_real>().swap(vz);
+	}
+
+	size_t ParticleWorldBuffer::getNumBytes() const {
+		return ((px.capacity() + py.capacity() + pz.capacity() + vx.capacity() + vy.capacity() + vz.capacity()) * sizeof(contact_real));
+	}
+
+	// Process particles in the range [begin, end) one at the time
+	static void transformParticlesRange(BodyTransform const & t,
+										Particle const * particles, size_t const begin, size_t const end,
+										contact_real const origin[3], contact_real const spacing,
+										ParticleWorldBuffer & world, bool const velocities) {
+		for (size_t p = begin; p < end; p++) {
+			// Decode local offset
+			contact_real offset[3];
+			decodeParticleOffset(particles[p].getVoxel(), origin, spacing, offset);
+			// Rotate offset
+			contact_real const rx = t.R[0] * offset[0] + t.R[1] * offset[1] + t.R[2] * offset[2];
+			contact_real const ry = t.R[3] * offset[0] + t.R[4] * offset[1] + t.R[5] * offset[2];
+			contact_real const rz = t.R[6] * offset[0] + t.R[7] * offset[1] + t.R[8] * offset[2];
+			// World position
+			world.px[p] = t.x[0] + rx;
+			world.py[p] = t.x[1] + ry;
+			world.pz[p] = t.x[2] + rz;
+			// World velocity
+			if (velocities) {
+				world.vx[p] = t.v[0] + t.omega[1] * rz - t.omega[2] * ry;
+				world.vy[p] = t.v[1] + t.omega[2] * rx - t.omega[0] * rz;
+				world.vz[p] = t.v[2] + t.omega[0] * ry - t.omega[1] * rx;
+			}
+		}
+	}
+
+	void transformParticlesScalar(BodyTransform const & transform,
+								  Particle const * particles, size_t const num_particles,
+								  contact_real const origin[3], contact_real const spacing,
+								  ParticleWorldBuffer & world, bool const velocities) {
+		transformParticlesRange(transform, particles, 0, num_particles, origin, spacing, world, velocities);
+	}
+
+#ifdef PB_SIMD_SSE
+	// Load the voxel coordinates of four particles as (i0 i1 i2 i3 j0 j1 j2 j3) and (k0 k1 k2 k3 - - - -)
+	static inline void loadVoxels4(Particle const * p, __m128i * ij, __m128i * k) {
+		__m128i const a = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(p[0].getVoxel()));
+		__m128i const b = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(p[1].getVoxel()));
+		__m128i const c = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(p[2].getVoxel()));
+		__m128i const d = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(p[3].getVoxel()));
+		// (i0 i1 j0 j1 k0 k1 - -) and (i2 i3 j2 j3 k2 k3 - -)
+		__m128i const ab = _mm_unpacklo_epi16(a, b);
+		__m128i const cd = _mm_unpacklo_epi16(c, d);
+		*ij = _mm_unpacklo_epi32(ab, cd);
+		*k = _mm_unpackhi_epi32(ab, cd);
+	}
+
+	// Sign extend the low and high four 16 bit integers and convert them to float
+	static inline __m128 lowToFloat(__m128i const v) {
+		return (_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)));
+	}
+
+	static inline __m128 highToFloat(__m128i const v) {
+		return (_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)));
+	}
+
+	void transformParticlesSSE(BodyTransform const & t,
+							   Particle const * particles, size_t const num_particles,
+							   contact_real const origin[3], contact_real const spacing,
+							   ParticleWorldBuffer & world, bool const velocities) {
+		// Broadcast constants
+		__m128 const s = _mm_set1_ps(spacing);
+		__m128 const o0 = _mm_set1_ps(origin[0]);
+		__m128 const o1 = _mm_set1_ps(origin[1]);
+		__m128 const o2 = _mm_set1_ps(origin[2]);
+		__m128 R[9];
+		for (size_t i = 0; i < 9; i++) {
+			R[i] = _mm_set1_ps(t.R[i]);
+		}
+		__m128 const x0 = _mm_set1_ps(t.x[0]);
+		__m128 const x1 = _mm_set1_ps(t.x[1]);
+		__m128 const x2 = _mm_set1_ps(t.x[2]);
+		__m128 const v0 = _mm_set1_ps(t.v[0]);
+		__m128 const v1 = _mm_set1_ps(t.v[1]);
+		__m128 const v2 = _mm_set1_ps(t.v[2]);
+		__m128 const w0 = _mm_set1_ps(t.omega[0]);
+		__m128 const w1 = _mm_set1_ps(t.omega[1]);
+		__m128 const w2 = _mm_set1_ps(t.omega[2]);
+
+		size_t p = 0;
+		for (; p + 4 <= num_particles; p += 4) {
+			// Decode four offsets
+			__m128i ij, k;
+			loadVoxels4(particles + p, &ij, &k);
+			__m128 const ox = _mm_add_ps(o0, _mm_mul_ps(s, lowToFloat(ij)));
+			__m128 const oy = _mm_add_ps(o1, _mm_mul_ps(s, highToFloat(ij)));
+			__m128 const oz = _mm_add_ps(o2, _mm_mul_ps(s, lowToFloat(k)));
+			// Rotate offsets
+			__m128 const rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(R[0], ox), _mm_mul_ps(R[1], oy)), _mm_mul_ps(R[2], oz));
+			__m128 const ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(R[3], ox), _mm_mul_ps(R[4], oy)), _mm_mul_ps(R[5], oz));
+			__m128 const rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(R[6], ox), _mm_mul_ps(R[7], oy)), _mm_mul_ps(R[8], oz));
+			// World positions
+			_mm_storeu_ps(&world.px[p], _mm_add_ps(x0, rx));
+			_mm_storeu_ps(&world.py[p], _mm_add_ps(x1, ry));
+			_mm_storeu_ps(&world.pz[p], _mm_add_ps(x2, rz));
+			// World velocities
+			if (velocities) {
+				_mm_storeu_ps(&world.vx[p], _mm_add_ps(v0, _mm_sub_ps(_mm_mul_ps(w1, rz), _mm_mul_ps(w2, ry))));
+				_mm_storeu_ps(&world.vy[p], _mm_add_ps(v1, _mm_sub_ps(_mm_mul_ps(w2, rx), _mm_mul_ps(w0, rz))));
+				_mm_storeu_ps(&world.vz[p], _mm_add_ps(v2, _mm_sub_ps(_mm_mul_ps(w0, ry), _mm_mul_ps(w1, rx))));
+			}
+		}
+
+		// Remaining particles
+		transformParticlesRange(t, particles, p, num_particles, origin, spacing, world, velocities);
+	}
+#endif
+
+#ifdef PB_SIMD_AVX2
+	// Load the voxel coordinates of eight particles as three vectors of eight floats
+	static inline void loadVoxels8(Particle const * p, __m256 * i, __m256 * j, __m256 * k) {
+		__m128i ij_lo, k_lo, ij_hi, k_hi;
+		loadVoxels4(p, &ij_lo, &k_lo);
+		loadVoxels4(p + 4, &ij_hi, &k_hi);
+		// Gather the eight 16 bit coordinates and widen them
+		*i = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_unpacklo_epi64(ij_lo, ij_hi)));
+		*j = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_unpackhi_epi64(ij_lo, ij_hi)));
+		*k = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_unpacklo_epi64(k_lo, k_hi)));
+	}
+
+	void transformParticlesAVX2(BodyTransform const & t,
+								Particle const * particles, size_t const num_particles,
+								contact_real const origin[3], contact_real const spacing,
+								ParticleWorldBuffer & world, bool const velocities) {
+		// Broadcast constants
+		__m256 const s = _mm256_set1_ps(spacing);
+		__m256 const o0 = _mm256_set1_ps(origin[0]);
+		__m256 const o1 = _mm256_set1_ps(origin[1]);
+		__m256 const o2 = _mm256_set1_ps(origin[2]);
+		__m256 R[9];
+		for (size_t i = 0; i < 9; i++) {
+			R[i] = _mm256_set1_ps(t.R[i]);
+		}
+		__m256 const x0 = _mm256_set1_ps(t.x[0]);
+		__m256 const x1 = _mm256_set1_ps(t.x[1]);
+		__m256 const x2 = _mm256_set1_ps(t.x[2]);
+		__m256 const v0 = _mm256_set1_ps(t.v[0]);
+		__m256 const v1 = _mm256_set1_ps(t.v[1]);
+		__m256 const v2 = _mm256_set1_ps(t.v[2]);
+		__m256 const w0 = _mm256_set1_ps(t.omega[0]);
+		__m256 const w1 = _mm256_set1_ps(t.omega[1]);
+		__m256 const w2 = _mm256_set1_ps(t.omega[2]);
+
+		size_t p = 0;
+		for (; p + 8 <= num_particles; p += 8) {
+			// Decode eight offsets
+			__m256 i, j, k;
+			loadVoxels8(particles + p, &i, &j, &k);
+			__m256 const ox = _mm256_add_ps(o0, _mm256_mul_ps(s, i));
+			__m256 const oy = _mm256_add_ps(o1, _mm256_mul_ps(s, j));
+			__m256 const oz = _mm256_add_ps(o2, _mm256_mul_ps(s, k));
+			// Rotate offsets
+			__m256 const rx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(R[0], ox), _mm256_mul_ps(R[1], oy)), _mm256_mul_ps(R[2], oz));
+			__m256 const ry = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(R[3], ox), _mm256_mul_ps(R[4], oy)), _mm256_mul_ps(R[5], oz));
+			__m256 const rz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(R[6], ox), _mm256_mul_ps(R[7], oy)), _mm256_mul_ps(R[8], oz));
+			// World positions
+			_mm256_storeu_ps(&world.px[p], _mm256_add_ps(x0, rx));
+			_mm256_storeu_ps(&world.py[p], _mm256_add_ps(x1, ry));
+			_mm256_storeu_ps(&world.pz[p], _mm256_add_ps(x2, rz));
+			// World velocities
+			if (velocities) {
+				_mm256_storeu_ps(&world.vx[p], _mm256_add_ps(v0, _mm256_sub_ps(_mm256_mul_ps(w1, rz), _mm256_mul_ps(w2, ry))));
+				_mm256_storeu_ps(&world.vy[p], _mm256_add_ps(v1, _mm256_sub_ps(_mm256_mul_ps(w2, rx), _mm256_mul_ps(w0, rz))));
+				_mm256_storeu_ps(&world.vz[p], _mm256_add_ps(v2, _mm256_sub_ps(_mm256_mul_ps(w0, ry), _mm256_mul_ps(w1, rx))));
+			}
+		}
+
+		// Remaining particles
+		transformParticlesRange(t, particles, p, num_particles, origin, spacing, world, velocities);
+	}
+#endif
+
+} // pb namespace
\ No newline at end of file
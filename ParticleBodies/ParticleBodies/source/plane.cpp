@@ -0,0 +1,136 @@
+#include "plane.h"
+#include <algorithm>
+#include <cmath>
+
+namespace pb {
+
+	Plane::Plane()
+		: Body(), half_width(1), half_thickness(real(0.5)), half_depth(1) {}
+
+	Plane::Plane(math::vec3r const & cm, real const mass,
+				 math::quaternionr const & orientation, real const half_width, real const half_depth,
+				 real const half_thickness, BodyStateStore * const store)
+		: Body(cm, mass, orientation, store), half_width(half_width), half_thickness(half_thickness), half_depth(half_depth) {
+		// Compute inertia tensor of the body
+		computeInertiaTensor();
+		// Initialise orientation matrix and velocities
+		states->computeDerivedQuantities(state_index);
+	}
+
+	void Plane::generateBBOX(math::vec3r * min, math::vec3r * max) const {
+		math::vec3r const x = getCenterOfMass();
+		math::mat3x3r const & R = getRotationMatrix();
+		math::vec3r const half_extents = getHalfExtents();
+
+		// Extent of the rotated box along every world axis
+		for (size_t i = 0; i < 3; i++) {
+			real const extent = std::abs(R(i, 0)) * half_extents(0) + std::abs(R(i, 1)) * half_extents(1) +
+				std::abs(R(i, 2)) * half_extents(2);
+			(*min)(i) = x(i) - extent;
+			(*max)(i) = x(i) + extent;
+		}
+	}
+
+	bool Plane::pointInside(math::vec3r const & p) const {
+		real distance;
+		signedDistance(p, distance);
+
+		return (distance <= real(0));
+	}
+
+	bool Plane::signedDistance(math::vec3r const & p, real & distance) const {
+		// Point in body space
+		math::vec3r const local = math::transpose(getRotationMatrix()) * (p - getCenterOfMass());
+		math::vec3r const half_extents = getHalfExtents();
+
+		// Distance outside the box, or to the nearest face inside it
+		real outside_sqr = real(0);
+		real inside = -real(INFINITY);
+		for (size_t i = 0; i < 3; i++) {
+			real const d = std::abs(local(i)) - half_extents(i);
+			outside_sqr += d > real(0) ? d * d : real(0);
+			inside = std::max(inside, d);
+		}
+		distance = outside_sqr > real(0) ? std::sqrt(outside_sqr) : inside;
+
+		return true;
+	}
+
+	ShapeType Plane::getShapeType() const {
+		return SHAPE_PLANE;
+	}
+
+	void Plane::getShapeParameters(real parameters[MAX_SHAPE_PARAMETERS]) const {
+		parameters[0] = half_width;
+		parameters[1] = half_depth;
+		parameters[2] = half_thickness;
+		for (size_t i = 3; i < MAX_SHAPE_PARAMETERS; i++) {
+			parameters[i] = real(0);
+		}
+	}
+
+	math::vec3r Plane::getHalfExtents() const {
+		return math::vec3r({ half_width, half_thickness, half_depth });
+	}
+
+	void Plane::drawPreprocess() const {
+		// Set matrix mode to model view
+		glMatrixMode(GL_MODELVIEW);
+
+		// Move to the body with the model matrix of the last state update
+		glPushMatrix();
+		math::mat4x4f M = math::transpose(getModelMatrix());
+		glMultMatrixf(&M(0, 0));
+		// Scale the unit box to the half extents
+		glScalef(half_width, half_thickness, half_depth);
+
+		// Set draw color
+		glColor4f(0.5f, 0.5f, 0.5f, 0.5f);
+	}
+
+	void Plane::drawShape(GLuint const /* num_elements */) const {
+		// Faces of the box from -1 to 1, by normal axis and side, counter clockwise from outside
+		glBegin(GL_QUADS);
+		for (int axis = 0; axis < 3; axis++) {
+			int const u = (axis + 1) % 3;
+			int const v = (axis + 2) % 3;
+			for (int side = -1; side <= 1; side += 2) {
+				GLfloat normal[3] = { 0.f, 0.f, 0.f };
+				normal[axis] = static_cast<GLfloat>(side);
+				glNormal3fv(normal);
+				GLfloat const corners[4][2] = { { -1.f, -1.f }, { 1.f, -1.f }, { 1.f, 1.f }, { -1.f, 1.f } };
+				for (int c = 0; c < 4; c++) {
+					// Reverse the winding on the negative side so every face points outside
+					int const k = side > 0 ? c : 3 - c;
+					GLfloat vertex[3];
+					vertex[axis] = static_cast<GLfloat>(side);
+					vertex[u] = corners[k][0];
+					vertex[v] = corners[k][1];
+					glVertex3fv(vertex);
+				}
+			}
+		}
+		glEnd();
+	}
+
+	void Plane::drawPostprocess() const {
+		// Set matrix mode to model view
+		glMatrixMode(GL_MODELVIEW);
+		glPopMatrix();
+	}
+
+	void Plane::computeInertiaTensor() {
+		// Box of sides twice the half extents
+		math::vec3r const half_extents = getHalfExtents();
+		math::vec3r const squared = math::vec3r({ half_extents(0) * half_extents(0), half_extents(1) * half_extents(1),
+												  half_extents(2) * half_extents(2) });
+		math::mat3x3r inertia_tensor_body, inv_inertia_tensor_body;
+		for (size_t i = 0; i < 3; i++) {
+			real const inertia_tensor_entry = getMass() / real(3) * (squared((i + 1) % 3) + squared((i + 2) % 3));
+			inertia_tensor_body(i, i) = inertia_tensor_entry;
+			inv_inertia_tensor_body(i, i) = real(1) / inertia_tensor_entry;
+		}
+		states->setInertiaTensorBody(state_index, inertia_tensor_body, inv_inertia_tensor_body);
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,512 @@
+#include "scene.h"
+#include "body.h"
+#include "constants.h"
+#include "json.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace pb {
+
+	// Body described by a scene before it is created
+	struct SceneBody {
+		ShapeType type;
+		real parameters[Body::MAX_SHAPE_PARAMETERS];
+		math::vec3r x;
+		math::quaternionr q;
+		math::vec3r v;
+		// Mass, or density if positive
+		real mass;
+		real density;
+		bool is_static;
+		real particle_diameter;
+	};
+
+	// Shapes with the same type, parameters and particle diameter share the discretisation
+	struct SceneShapeKey {
+		ShapeType type;
+		real parameters[Body::MAX_SHAPE_PARAMETERS];
+		real particle_diameter;
+
+		bool operator<(SceneShapeKey const & other) const {
+			if (type != other.type) {
+				return (type < other.type);
+			}
+			for (size_t p = 0; p < Body::MAX_SHAPE_PARAMETERS; p++) {
+				if (parameters[p] != other.parameters[p]) {
+					return (parameters[p] < other.parameters[p]);
+				}
+			}
+			return (particle_diameter < other.particle_diameter);
+		}
+	};
+
+	// Materials by name, their density
+	typedef std::map<std::string, real> SceneMaterials;
+
+	// Print an error of an element of the scene
+	static bool sceneError(std::string const & where, char const * const what) {
+		fprintf(stderr, "Scene: %s: %s\n", where.c_str(), what);
+		return false;
+	}
+
+	// Read an optional number member
+	static bool readNumber(JsonValue const & object, char const * const key, std::string const & where, real * const value) {
+		JsonValue const * const member = object.find(key);
+		if (member == nullptr) {
+			return true;
+		}
+		if (!member->isNumber()) {
+			return sceneError(where + "." + key, "expected a number");
+		}
+		*value = static_cast<real>(member->getNumber(0));
+
+		return true;
+	}
+
+	// Read an optional array of numbers member
+	static bool readNumbers(JsonValue const & object, char const * const key, std::string const & where,
+							size_t const count, real * const values) {
+		JsonValue const * const member = object.find(key);
+		if (member == nullptr) {
+			return true;
+		}
+		if (!member->isArray() || member->size() != count) {
+			return sceneError(where + "." + key, count == 3 ? "expected an array of 3 numbers" : "expected an array of 4 numbers");
+		}
+		for (size_t i = 0; i < count; i++) {
+			if (!(*member)[i].isNumber()) {
+				return sceneError(where + "." + key, "expected a number");
+			}
+			values[i] = static_cast<real>((*member)[i].getNumber(0));
+		}
+
+		return true;
+	}
+
+	// Read an optional vector member
+	static bool readVector(JsonValue const & object, char const * const key, std::string const & where, math::vec3r * const v) {
+		real values[3] = { (*v)(0), (*v)(1), (*v)(2) };
+		if (!readNumbers(object, key, where, 3, values)) {
+			return false;
+		}
+		*v = math::vec3r({ values[0], values[1], values[2] });
+
+		return true;
+	}
+
+	// Mass of a body
+	static real sceneBodyMass(SceneBody const & body) {
+		if (body.is_static) {
+			return real(INFINITY);
+		}
+		if (body.density > real(0)) {
+			return (body.density * Body::getShapeVolume(body.type, body.parameters));
+		}
+
+		return body.mass;
+	}
+
+	// Read the properties of a body, members not present keep their current value
+	static bool readBody(JsonValue const & object, SceneMaterials const & materials, std::string const & where,
+						 SceneBody * const body) {
+		if (!object.isObject()) {
+			return sceneError(where, "expected an object");
+		}
+
+		JsonValue const * const shape = object.find("shape");
+		if (shape != nullptr) {
+			ShapeType type;
+			if (shape->isString() && shape->getString() == "sphere") {
+				type = SHAPE_SPHERE;
+			} else if (shape->isString() && shape->getString() == "plane") {
+				type = SHAPE_PLANE;
+			} else {
+				return sceneError(where + ".shape", "unknown shape, expected \"sphere\" or \"plane\"");
+			}
+			// A new shape starts from its default parameters
+			if (type != body->type) {
+				std::fill(body->parameters, body->parameters + Body::MAX_SHAPE_PARAMETERS, real(0));
+				body->parameters[0] = real(1);
+				if (type == SHAPE_PLANE) {
+					body->parameters[1] = real(1);
+					body->parameters[2] = real(0.5);
+				}
+				body->type = type;
+			}
+		}
+		real half_extents[3] = { body->parameters[0], body->parameters[2], body->parameters[1] };
+		real q[4] = { body->q.getReal(), body->q.getImmaginary()(0), body->q.getImmaginary()(1), body->q.getImmaginary()(2) };
+		if ((body->type == SHAPE_SPHERE && !readNumber(object, "radius", where, &body->parameters[0])) ||
+			(body->type == SHAPE_PLANE && !readNumbers(object, "half_extents", where, 3, half_extents)) ||
+			!readVector(object, "position", where, &body->x) ||
+			!readNumbers(object, "orientation", where, 4, q) ||
+			!readVector(object, "velocity", where, &body->v) ||
+			!readNumber(object, "particle_diameter", where, &body->particle_diameter)) {
+			return false;
+		}
+		body->q = math::normalize(math::quaternionr(q[0], q[1], q[2], q[3]));
+		if (body->type == SHAPE_PLANE) {
+			body->parameters[0] = half_extents[0];
+			body->parameters[1] = half_extents[2];
+			body->parameters[2] = half_extents[1];
+		}
+
+		// Mass, explicit or from the density of the shape
+		JsonValue const * const is_static = object.find("static");
+		if (is_static != nullptr) {
+			body->is_static = is_static->getBool(false);
+		}
+		JsonValue const * const material = object.find("material");
+		if (object.find("mass") != nullptr) {
+			body->density = real(0);
+			if (!readNumber(object, "mass", where, &body->mass)) {
+				return false;
+			}
+		} else if (object.find("density") != nullptr) {
+			if (!readNumber(object, "density", where, &body->density)) {
+				return false;
+			}
+		} else if (material != nullptr) {
+			auto const found = material->isString() ? materials.find(material->getString()) : materials.end();
+			if (found == materials.end()) {
+				return sceneError(where + ".material", "unknown material");
+			}
+			body->density = found->second;
+		}
+
+		// Check values, the size of the shape is its radius or its largest half extent
+		real size = body->parameters[0];
+		if (body->type == SHAPE_PLANE) {
+			if (!(body->parameters[0] > real(0)) || !(body->parameters[1] > real(0)) || !(body->parameters[2] > real(0))) {
+				return sceneError(where + ".half_extents", "must be positive");
+			}
+			size = std::max(body->parameters[0], std::max(body->parameters[1], body->parameters[2]));
+		} else if (!(body->parameters[0] > real(0))) {
+			return sceneError(where + ".radius", "must be positive");
+		}
+		if (!(body->particle_diameter > real(0)) ||
+			size * real(2) / body->particle_diameter >= real(INT16_MAX)) {
+			return sceneError(where + ".particle_diameter", "must be positive and give less than 32767 particles per side");
+		}
+		if (!body->is_static && !(sceneBodyMass(*body) > real(0))) {
+			return sceneError(where, "mass must be positive");
+		}
+
+		return true;
+	}
+
+	// Place spheres with random radius at random positions in a box without overlaps, using a
+	// grid with cells larger than the spheres
+	static bool generateRandomPacking(JsonValue const & object, std::string const & where, SceneBody const & prototype,
+									  std::vector<SceneBody> & bodies) {
+		if (prototype.type != SHAPE_SPHERE) {
+			return sceneError(where + ".shape", "the random generator places spheres");
+		}
+		real count = real(0);
+		real seed = real(1);
+		math::vec3r min = math::vec3r({ real(0), real(0), real(0) });
+		math::vec3r max = math::vec3r({ real(10), real(10), real(10) });
+		real min_radius = prototype.parameters[0];
+		real max_radius = prototype.parameters[0];
+		if (!readNumber(object, "count", where, &count) || !readNumber(object, "seed", where, &seed) ||
+			!readVector(object, "min", where, &min) || !readVector(object, "max", where, &max) ||
+			!readNumber(object, "min_radius", where, &min_radius) || !readNumber(object, "max_radius", where, &max_radius)) {
+			return false;
+		}
+		if (!(count >= real(0)) || !(min_radius > real(0)) || !(max_radius >= min_radius) ||
+			max_radius * real(2) / prototype.particle_diameter >= real(INT16_MAX)) {
+			return sceneError(where, "invalid count or radius range");
+		}
+		bool const random_orientation = object.find("random_orientation") != nullptr && object.find("random_orientation")->getBool(false);
+		size_t const num_spheres = static_cast<size_t>(count);
+
+		// Grid of the centers, cells are at least a diameter wide and there are about 8 cells per sphere
+		real cell_size = real(2) * max_radius;
+		for (size_t a = 0; a < 3; a++) {
+			if (!(max(a) - min(a) > real(2) * max_radius)) {
+				return sceneError(where, "the box is smaller than a sphere");
+			}
+		}
+		real const volume = (max(0) - min(0)) * (max(1) - min(1)) * (max(2) - min(2));
+		cell_size = std::max(cell_size, std::cbrt(volume / (real(8) * num_spheres + real(4096))));
+		size_t cells[3];
+		for (size_t a = 0; a < 3; a++) {
+			cells[a] = std::max(static_cast<size_t>((max(a) - min(a)) / cell_size), static_cast<size_t>(1));
+		}
+		std::vector<std::uint32_t> cell_first(cells[0] * cells[1] * cells[2], UINT32_MAX);
+		std::vector<std::uint32_t> next;
+		std::vector<real> placed;
+		next.reserve(num_spheres);
+		placed.reserve(4 * num_spheres);
+
+		// Cell of a coordinate
+		auto const cellOf = [&](real const value, size_t const a) {
+			long long const c = static_cast<long long>((value - min(a)) / cell_size);
+			return static_cast<size_t>(std::min(std::max(c, 0ll), static_cast<long long>(cells[a]) - 1));
+		};
+
+		std::mt19937 generator(static_cast<std::uint32_t>(seed));
+		std::uniform_real_distribution<real> unit(real(0), real(1));
+		size_t const max_attempts = 100;
+		for (size_t s = 0; s < num_spheres; s++) {
+			bool found = false;
+			real x[3], radius;
+			for (size_t attempt = 0; attempt < max_attempts && !found; attempt++) {
+				radius = min_radius + (max_radius - min_radius) * unit(generator);
+				for (size_t a = 0; a < 3; a++) {
+					x[a] = min(a) + radius + (max(a) - min(a) - real(2) * radius) * unit(generator);
+				}
+
+				// Check the spheres in the neighbouring cells
+				found = true;
+				size_t const c0 = cellOf(x[0], 0), c1 = cellOf(x[1], 1), c2 = cellOf(x[2], 2);
+				for (size_t k = (c2 > 0 ? c2 - 1 : 0); found && k <= std::min(c2 + 1, cells[2] - 1); k++) {
+					for (size_t j = (c1 > 0 ? c1 - 1 : 0); found && j <= std::min(c1 + 1, cells[1] - 1); j++) {
+						for (size_t i = (c0 > 0 ? c0 - 1 : 0); found && i <= std::min(c0 + 1, cells[0] - 1); i++) {
+							for (std::uint32_t other = cell_first[(k * cells[1] + j) * cells[0] + i]; other != UINT32_MAX; other = next[other]) {
+								real const * const y = &placed[4 * other];
+								real const dx = x[0] - y[0], dy = x[1] - y[1], dz = x[2] - y[2];
+								real const distance = radius + y[3];
+								if (dx * dx + dy * dy + dz * dz < distance * distance) {
+									found = false;
+									break;
+								}
+							}
+						}
+					}
+				}
+			}
+			if (!found) {
+				fprintf(stderr, "Scene: %s: placed %zu of %zu spheres, the box is too full\n", where.c_str(), s, num_spheres);
+				break;
+			}
+
+			// Add sphere to the grid
+			std::uint32_t const index = static_cast<std::uint32_t>(s);
+			size_t const cell = (cellOf(x[2], 2) * cells[1] + cellOf(x[1], 1)) * cells[0] + cellOf(x[0], 0);
+			next.push_back(cell_first[cell]);
+			cell_first[cell] = index;
+			placed.insert(placed.end(), { x[0], x[1], x[2], radius });
+
+			SceneBody body = prototype;
+			body.parameters[0] = radius;
+			body.x = math::vec3r({ x[0], x[1], x[2] });
+			if (random_orientation) {
+				// Uniform random rotation
+				real const u1 = unit(generator), u2 = unit(generator) * real(TWO_PI), u3 = unit(generator) * real(TWO_PI);
+				real const a = std::sqrt(real(1) - u1), b = std::sqrt(u1);
+				body.q = math::quaternionr(a * std::sin(u2), a * std::cos(u2), b * std::sin(u3), b * std::cos(u3));
+			}
+			bodies.push_back(body);
+		}
+		return true;
+	}
+
+	// Place copies of a body on a regular grid
+	static bool generateGrid(JsonValue const & object, std::string const & where, SceneBody const & prototype,
+							 std::vector<SceneBody> & bodies) {
+		real count[3] = { real(1), real(1), real(1) };
+		math::vec3r origin = prototype.x;
+		real const default_spacing = real(2) * prototype.parameters[0];
+		math::vec3r spacing = math::vec3r({ default_spacing, default_spacing, default_spacing });
+		if (!readNumbers(object, "count", where, 3, count) || !readVector(object, "origin", where, &origin) ||
+			!readVector(object, "spacing", where, &spacing)) {
+			return false;
+		}
+		if (!(count[0] >= real(0)) || !(count[1] >= real(0)) || !(count[2] >= real(0))) {
+			return sceneError(where + ".count", "must not be negative");
+		}
+		size_t const nx = static_cast<size_t>(count[0]), ny = static_cast<size_t>(count[1]), nz = static_cast<size_t>(count[2]);
+
+		bodies.reserve(bodies.size() + nx * ny * nz);
+		for (size_t k = 0; k < nz; k++) {
+			for (size_t j = 0; j < ny; j++) {
+				for (size_t i = 0; i < nx; i++) {
+					SceneBody body = prototype;
+					body.x = origin + math::vec3r({ spacing(0) * i, spacing(1) * j, spacing(2) * k });
+					bodies.push_back(body);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool SceneLoader::load(char const * const path, LoadedScene * const scene) {
+		MappedFile file;
+		if (!file.open(path)) {
+			fprintf(stderr, "Scene: can not open %s\n", path);
+			return false;
+		}
+
+		return parse(reinterpret_cast<char const *>(file.data()), file.size(), scene);
+	}
+
+	bool SceneLoader::parse(char const * const text, size_t const size, LoadedScene * const scene) {
+		JsonValue document;
+		std::string error;
+		if (!JsonValue::parse(text, size, &document, &error)) {
+			return sceneError("document", error.c_str());
+		}
+		if (!document.isObject()) {
+			return sceneError("document", "expected an object");
+		}
+
+		// System parameters
+		real t0 = real(0);
+		real delta_t = real(1) / real(30);
+		if (!readNumber(document, "time", "document", &t0) || !readNumber(document, "time_step", "document", &delta_t)) {
+			return false;
+		}
+		if (!(delta_t > real(0))) {
+			return sceneError("document.time_step", "must be positive");
+		}
+
+		// Materials
+		SceneMaterials materials;
+		JsonValue const * const materials_object = document.find("materials");
+		if (materials_object != nullptr) {
+			if (!materials_object->isObject()) {
+				return sceneError("materials", "expected an object");
+			}
+			for (size_t m = 0; m < materials_object->size(); m++) {
+				std::string const where = "materials." + materials_object->getKey(m);
+				real density = real(1);
+				if (!materials_object->getMember(m).isObject() ||
+					!readNumber(materials_object->getMember(m), "density", where, &density)) {
+					return sceneError(where, "expected an object with a density");
+				}
+				if (!(density > real(0))) {
+					return sceneError(where + ".density", "must be positive");
+				}
+				materials[materials_object->getKey(m)] = density;
+			}
+		}
+
+		// Defaults of the bodies
+		SceneBody defaults;
+		defaults.type = SHAPE_SPHERE;
+		std::fill(defaults.parameters, defaults.parameters + Body::MAX_SHAPE_PARAMETERS, real(0));
+		defaults.parameters[0] = real(1);
+		defaults.x = math::vec3r({ real(0), real(0), real(0) });
+		defaults.q = math::quaternionr(real(1), real(0), real(0), real(0));
+		defaults.v = math::vec3r({ real(0), real(0), real(0) });
+		defaults.mass = real(1);
+		defaults.density = real(0);
+		defaults.is_static = false;
+		defaults.particle_diameter = real(0.3);
+
+		// Expand bodies and generators
+		std::vector<SceneBody> bodies;
+		JsonValue const * const bodies_array = document.find("bodies");
+		if (bodies_array != nullptr) {
+			if (!bodies_array->isArray()) {
+				return sceneError("bodies", "expected an array");
+			}
+			for (size_t b = 0; b < bodies_array->size(); b++) {
+				SceneBody body = defaults;
+				if (!readBody((*bodies_array)[b], materials, "bodies[" + std::to_string(b) + "]", &body)) {
+					return false;
+				}
+				bodies.push_back(body);
+			}
+		}
+		JsonValue const * const generators_array = document.find("generators");
+		if (generators_array != nullptr) {
+			if (!generators_array->isArray()) {
+				return sceneError("generators", "expected an array");
+			}
+			for (size_t g = 0; g < generators_array->size(); g++) {
+				JsonValue const & generator = (*generators_array)[g];
+				std::string const where = "generators[" + std::to_string(g) + "]";
+				SceneBody prototype = defaults;
+				if (!readBody(generator, materials, where, &prototype)) {
+					return false;
+				}
+				JsonValue const * const type = generator.find("type");
+				if (type != nullptr && type->isString() && type->getString() == "grid") {
+					if (!generateGrid(generator, where, prototype, bodies)) {
+						return false;
+					}
+				} else if (type != nullptr && type->isString() && type->getString() == "random") {
+					if (!generateRandomPacking(generator, where, prototype, bodies)) {
+						return false;
+					}
+				} else {
+					return sceneError(where + ".type", "unknown generator, expected \"grid\" or \"random\"");
+				}
+			}
+		}
+		if (bodies.empty()) {
+			return sceneError("document", "the scene has no bodies");
+		}
+
+		// Create the bodies directly in the store of the system
+		size_t const num_bodies = bodies.size();
+		scene->system.reset(new System(t0, delta_t));
+		JsonValue const * const analytic_contacts = document.find("analytic_contacts");
+		scene->system->setAnalyticContacts(analytic_contacts != nullptr && analytic_contacts->getBool(false));
+		scene->system->reserve(num_bodies);
+		BodyStateStore & states = scene->system->getStateStore();
+		Body ** const created = scene->arena.allocateArray<Body *>(num_bodies);
+		for (size_t b = 0; b < num_bodies; b++) {
+			SceneBody const & body = bodies[b];
+			real const mass = sceneBodyMass(body);
+			created[b] = Body::create(body.type, body.parameters, body.x, mass, body.q, &states, &scene->arena);
+			if (!body.is_static) {
+				states.setLinearMomentum(created[b]->getStateIndex(), mass * body.v);
+			}
+		}
+		states.computeDerivedQuantities();
+
+		// Find the distinct shapes, discretise them once in parallel in body space
+		std::map<SceneShapeKey, size_t> shapes;
+		std::vector<size_t> body_shape(num_bodies);
+		std::vector<SceneBody const *> shape_bodies;
+		for (size_t b = 0; b < num_bodies; b++) {
+			SceneShapeKey key;
+			key.type = bodies[b].type;
+			std::copy(bodies[b].parameters, bodies[b].parameters + Body::MAX_SHAPE_PARAMETERS, key.parameters);
+			key.particle_diameter = bodies[b].particle_diameter;
+			auto const shape = shapes.insert(std::make_pair(key, shape_bodies.size()));
+			if (shape.second) {
+				shape_bodies.push_back(&bodies[b]);
+			}
+			body_shape[b] = shape.first->second;
+		}
+		std::vector<std::unique_ptr<Body> > shape_templates(shape_bodies.size());
+		std::vector<std::unique_ptr<BodyParticlesDiscretisation> > shape_discretisations(shape_bodies.size());
+		parallelFor(0, shape_bodies.size(), 16, [&](size_t const s) {
+			SceneBody const & body = *shape_bodies[s];
+			shape_templates[s].reset(Body::create(body.type, body.parameters, math::vec3r({ real(0), real(0), real(0) }), real(1),
+												  math::quaternionr(real(1), real(0), real(0), real(0))));
+			shape_discretisations[s].reset(new BodyParticlesDiscretisation(shape_templates[s].get(), body.particle_diameter));
+		});
+
+		// Copy the particles of the shapes to the bodies
+		BodyParticlesDiscretisation * const discretisations = scene->arena.allocateArray<BodyParticlesDiscretisation>(num_bodies);
+		parallelFor(0, num_bodies, 1024, [&](size_t const b) {
+			BodyParticlesDiscretisation const & shape = *shape_discretisations[body_shape[b]];
+			new (&discretisations[b]) BodyParticlesDiscretisation(created[b], shape);
+		});
+		scene->arena.own(discretisations, num_bodies);
+
+		// Add all the bodies at once
+		BodyParticlesDiscretisation ** const added = scene->arena.allocateArray<BodyParticlesDiscretisation *>(num_bodies);
+		for (size_t b = 0; b < num_bodies; b++) {
+			added[b] = &discretisations[b];
+		}
+		scene->system->addBodies(added, num_bodies);
+
+		return true;
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -3,48 +3,66 @@
 namespace pb {
 
 	Sphere::Sphere()
-		: Body(), radius(1.f) {}
+		: Body(), radius(1) {}
 
-	Sphere::Sphere(math::vec3f const & cm, float const mass,
-				   math::quaternionf const & orientation, float const radius)
-		: Body(cm, mass, orientation), radius(radius) {
+	Sphere::Sphere(math::vec3r const & cm, real const mass,
+				   math::quaternionr const & orientation, real const radius,
+				   BodyStateStore * const store)
+		: Body(cm, mass, orientation, store), radius(radius) {
 		// Compute inertia tensor of the body
 		computeInertiaTensor();
+		// Initialise orientation matrix and velocities
+		states->computeDerivedQuantities(state_index);
 	}
 
-	void Sphere::generateBBOX(math::vec3f * min, math::vec3f * max) const {
+	void Sphere::generateBBOX(math::vec3r * min, math::vec3r * max) const {
+		math::vec3r const x = getCenterOfMass();
+
 		// Set BBOX minimum
-		*min = math::vec3f({ physical_properties.x(0) - radius,
-						   physical_properties.x(1) - radius,
-						   physical_properties.x(2) - radius});
+		*min = math::vec3r({ x(0) - radius,
+						   x(1) - radius,
+						   x(2) - radius});
 
 		// Set BBOX maximum
-		*max = math::vec3f({ physical_properties.x(0) + radius,
-						   physical_properties.x(1) + radius,
-						   physical_properties.x(2) + radius});
+		*max = math::vec3r({ x(0) + radius,
+						   x(1) + radius,
+						   x(2) + radius});
 	}
 
-	bool Sphere::pointInside(math::vec3f const & p) const {
+	bool Sphere::pointInside(math::vec3r const & p) const {
 		// Compute distance
-		float distance = math::magnitude(p - physical_properties.x);
+		real distance = math::magnitude(p - getCenterOfMass());
 		// Check if distance between center and voxel center is less than radius
 		return (distance <= radius);
 	}
 
+	bool Sphere::signedDistance(math::vec3r const & p, real & distance) const {
+		distance = math::magnitude(p - getCenterOfMass()) - radius;
+
+		return true;
+	}
+
+	ShapeType Sphere::getShapeType() const {
+		return SHAPE_SPHERE;
+	}
+
+	void Sphere::getShapeParameters(real parameters[MAX_SHAPE_PARAMETERS]) const {
+		parameters[0] = radius;
+		for (size_t i = 1; i < MAX_SHAPE_PARAMETERS; i++) {
+			parameters[i] = real(0);
+		}
+	}
+
 	void Sphere::drawPreprocess() const {
 		// Set matrix mode to model view
 		glMatrixMode(GL_MODELVIEW);
 
-		// Translate to center of mass
+		// Move to the body with the model matrix of the last state update
 		glPushMatrix();
-		// Translate to center of mass
-		glTranslatef(physical_properties.x(0), physical_properties.x(1), physical_properties.x(2));
+		math::mat4x4f M = math::transpose(getModelMatrix());
+		glMultMatrixf(&M(0, 0));
 		// Scale using radius
 		glScalef(radius, radius, radius);
-		// Rotate using quaternion
-		math::mat4x4f R = getOrientationMatrix();
-		R = math::transpose(R);
-		glMultMatrixf(&R(0, 0));
 
 		// Set draw color
 		glColor4f(1.f, 0.f, 0.f, 0.5f);
@@ -57,11 +75,13 @@ namespace pb {
 	}
 
 	void Sphere::computeInertiaTensor() {
-		float inertia_tensor_entry = 2.f / 5.f * physical_properties.mass * radius * radius;
+		real inertia_tensor_entry = real(2) / real(5) * getMass() * radius * radius;
+		math::mat3x3r inertia_tensor_body, inv_inertia_tensor_body;
 		for (size_t i = 0; i < 3; i++) {
-			physical_properties.inertia_tensor_body(i, i) = inertia_tensor_entry;
-			physical_properties.inv_inertia_tensor_body(i, i) = 1.f / inertia_tensor_entry;
+			inertia_tensor_body(i, i) = inertia_tensor_entry;
+			inv_inertia_tensor_body(i, i) = real(1) / inertia_tensor_entry;
 		}
+		states->setInertiaTensorBody(state_index, inertia_tensor_body, inv_inertia_tensor_body);
 	}
 
 } // pb namespace
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "sphere_tree.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace pb {
+
+	// Relative margin of the node spheres against rounding
+	static contact_real const NODE_RADIUS_MARGIN = contact_real(1.001);
+
+	void ParticleSphereTree::build(Particle const * const particles, size_t const num_particles,
+								   contact_real const origin[3], contact_real const spacing, contact_real const particle_radius) {
+		nodes.clear();
+		order.resize(num_particles);
+		positions.resize(3 * num_particles);
+		for (size_t p = 0; p < num_particles; p++) {
+			order[p] = static_cast<std::uint32_t>(p);
+			decodeParticleOffset(particles[p].getVoxel(), origin, spacing, &positions[3 * p]);
+		}
+		if (num_particles > 0) {
+			buildNode(0, static_cast<std::uint32_t>(num_particles), particle_radius);
+		}
+
+		// The positions are not needed by the traversals
+		positions.clear();
+		positions.shrink_to_fit();
+	}
+
+	bool ParticleSphereTree::empty() const {
+		return nodes.empty();
+	}
+
+	std::vector<ParticleSphereTree::Node> const & ParticleSphereTree::getNodes() const {
+		return nodes;
+	}
+
+	std::uint32_t const * ParticleSphereTree::getOrder() const {
+		return order.data();
+	}
+
+	std::uint32_t ParticleSphereTree::buildNode(std::uint32_t const begin, std::uint32_t const end,
+												contact_real const particle_radius) {
+		// Box of the particle centers
+		contact_real lower[3], upper[3];
+		for (size_t c = 0; c < 3; c++) {
+			lower[c] = std::numeric_limits<contact_real>::infinity();
+			upper[c] = -std::numeric_limits<contact_real>::infinity();
+		}
+		for (std::uint32_t i = begin; i < end; i++) {
+			contact_real const * const p = &positions[3 * order[i]];
+			for (size_t c = 0; c < 3; c++) {
+				lower[c] = std::min(lower[c], p[c]);
+				upper[c] = std::max(upper[c], p[c]);
+			}
+		}
+
+		// Sphere centered in the box through the farthest particle sphere
+		Node node;
+		contact_real radius_sqr = contact_real(0);
+		for (size_t c = 0; c < 3; c++) {
+			node.center[c] = contact_real(0.5) * (lower[c] + upper[c]);
+		}
+		for (std::uint32_t i = begin; i < end; i++) {
+			contact_real const * const p = &positions[3 * order[i]];
+			contact_real const dx = p[0] - node.center[0];
+			contact_real const dy = p[1] - node.center[1];
+			contact_real const dz = p[2] - node.center[2];
+			radius_sqr = std::max(radius_sqr, dx * dx + dy * dy + dz * dz);
+		}
+		node.radius = (std::sqrt(radius_sqr) + particle_radius) * NODE_RADIUS_MARGIN;
+		node.begin = begin;
+		node.end = end;
+		node.left = 0;
+		node.right = 0;
+		std::uint32_t const index = static_cast<std::uint32_t>(nodes.size());
+		nodes.push_back(node);
+		if (end - begin <= LEAF_SIZE) {
+			return index;
+		}
+
+		// Split at the median of the longest axis, ties broken by index so the tree does not
+		// depend on the library
+		size_t axis = 0;
+		for (size_t c = 1; c < 3; c++) {
+			if (upper[c] - lower[c] > upper[axis] - lower[axis]) {
+				axis = c;
+			}
+		}
+		std::uint32_t const middle = begin + (end - begin) / 2;
+		std::vector<contact_real> const & coordinates = positions;
+		std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+						 [&coordinates, axis](std::uint32_t const a, std::uint32_t const b) {
+			contact_real const ca = coordinates[3 * a + axis];
+			contact_real const cb = coordinates[3 * b + axis];
+			return (ca < cb || (ca == cb && a < b));
+		});
+		std::uint32_t const left = buildNode(begin, middle, particle_radius);
+		std::uint32_t const right = buildNode(middle, end, particle_radius);
+		nodes[index].left = left;
+		nodes[index].right = right;
+
+		return index;
+	}
+
+} // pb namespace
\ No newline at end of file
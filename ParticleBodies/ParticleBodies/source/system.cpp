@@ -1,61 +1,896 @@
 #include "system.h"
 #include "body.h"
-#include "euler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
 namespace pb {
 
-	System::System(float const t0, float const dt)
-		: t(t0), delta_t(dt) {}
+	// Slot without a body
+	static std::uint32_t const NO_INDEX = UINT32_MAX;
+	// Number of commands and of free handles that can be queued
+	static size_t const COMMAND_QUEUE_SIZE = 1 << 16;
+	static size_t const FREE_HANDLE_QUEUE_SIZE = 1 << 16;
+	// Bodies whose world particles are updated by one task
+	static size_t const WORLD_UPDATE_BLOCK = 64;
+	// Minimum cost, in particle pairs, of the islands processed by one task
+	static size_t const MIN_ISLAND_TASK_COST = 1 << 14;
+	// Islands with at least this number of pairs are split in colour batches, the threshold does
+	// not depend on the number of threads so that neither does the order of the contact forces
+	static size_t const MIN_COLOURED_ISLAND_PAIRS = 256;
+	// Tasks per thread of a colour batch and bodies per task of the update of a coloured island
+	static size_t const COLOUR_TASKS_PER_THREAD = 4;
+	static size_t const COLOURED_UPDATE_BLOCK = 64;
+	// Vertical force of gravity on every body
+	static real const GRAVITY_FORCE = real(-0.1);
+	// Relative margin of the bounding spheres of the boxes in the hash grid, against rounding
+	static contact_real const BOUNDING_SPHERE_MARGIN = contact_real(1.001);
 
-	void System::addBody(BodyParticlesDiscretisation * const body) {
+	// Body and its particles in body space, the particles are copied to the body created in the store
+	struct System::PreparedBody {
+		std::unique_ptr<Body> body;
+		std::unique_ptr<BodyParticlesDiscretisation> discretisation;
+	};
+
+	// Bounding sphere of the box of a body, return false if the body has no particles
+	static bool getBoundingSphere(BodyParticlesDiscretisation const & body, contact_real center[3], contact_real & radius) {
+		contact_real const * const min = body.getWorldBoundsMin();
+		contact_real const * const max = body.getWorldBoundsMax();
+		if (min[0] > max[0]) {
+			return false;
+		}
+		contact_real diagonal_sqr = contact_real(0);
+		for (size_t a = 0; a < 3; a++) {
+			center[a] = contact_real(0.5) * (min[a] + max[a]);
+			diagonal_sqr += (max[a] - min[a]) * (max[a] - min[a]);
+		}
+		radius = contact_real(0.5) * BOUNDING_SPHERE_MARGIN * std::sqrt(diagonal_sqr);
+
+		return true;
+	}
+
+	// Create a body in the store from the pool of its shape, nullptr if the type is unknown
+	static Body * createPooledBody(Pool<Sphere> & spheres, Pool<Plane> & planes, BodyStateStore * const states, ShapeType const type,
+								   real const parameters[Body::MAX_SHAPE_PARAMETERS], math::vec3r const & cm,
+								   real const mass, math::quaternionr const & orientation) {
+		switch (type) {
+		case SHAPE_SPHERE:
+			return spheres.create(cm, mass, orientation, parameters[0], states);
+		case SHAPE_PLANE:
+			return planes.create(cm, mass, orientation, parameters[0], parameters[1], parameters[2], states);
+		default:
+			return nullptr;
+		}
+	}
+
+	System::System(real const t0, real const dt)
+		: num_slots(0), free_handles(FREE_HANDLE_QUEUE_SIZE), commands(COMMAND_QUEUE_SIZE),
+		  states(new BodyStateStore()), pool(new ThreadPool()), broad_phase(BROAD_PHASE_SWEEP_AND_PRUNE),
+		  contact_detector(detectContactsBruteForce), contact_responder(respondContactsSpringDamper), analytic_contacts(false),
+		  contact_buffers(pool->getNumThreads()), contact_material(DEFAULT_CONTACT_MATERIAL),
+		  integration_mode(INTEGRATION_EXPLICIT_EULER), impulse_settings(DEFAULT_IMPULSE_SETTINGS),
+		  implicit_solvers(pool->getNumThreads()), impulse_solvers(pool->getNumThreads()),
+		  num_contacts(0), num_active_particles(0), num_solver_iterations(0), bodies_revision(0), t(t0), delta_t(dt) {
+		StepStatistics const no_step = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1.0, 0.0 };
+		statistics = no_step;
+	}
+
+	System::~System() {
+		// Drop the commands never applied
+		Command command;
+		while (commands.pop(command)) {
+			delete command.prepared;
+		}
+		for (size_t b = 0; b < bodies.size(); b++) {
+			if (slots[body_slots[b]].owned) {
+				destroyBody(bodies[b]);
+			}
+		}
+	}
+
+	BodyHandle System::createBody(ShapeType const type, real const parameters[Body::MAX_SHAPE_PARAMETERS],
+								  math::vec3r const & cm, real const mass, math::quaternionr const & orientation,
+								  real const particle_diameter) {
+		// Create the body directly in the store from the pool of its shape
+		Body * const body = createPooledBody(spheres, planes, states.get(), type, parameters, cm, mass, orientation);
+		if (body == nullptr) {
+			BodyHandle const invalid = { 0, 0 };
+			return invalid;
+		}
+		BodyHandle const handle = reserveHandle();
+		insertBody(discretisations.create(body, particle_diameter), true, handle);
+		bodies_revision++;
+
+		return handle;
+	}
+
+	BodyHandle System::addBody(BodyParticlesDiscretisation * const body) {
+		BodyHandle const handle = reserveHandle();
+		insertBody(body, false, handle);
+		bodies_revision++;
+
+		return handle;
+	}
+
+	void System::reserve(size_t const num_bodies) {
+		bodies.reserve(num_bodies);
+		body_slots.reserve(num_bodies);
+		states->reserve(num_bodies);
+	}
+
+	void System::addBodies(BodyParticlesDiscretisation * const * const new_bodies, size_t const count) {
+		reserve(bodies.size() + count);
+		for (size_t b = 0; b < count; b++) {
+			insertBody(new_bodies[b], false, reserveHandle());
+		}
+		bodies_revision++;
+	}
+
+	bool System::removeBody(BodyHandle const handle) {
+		if (!isValid(handle)) {
+			return false;
+		}
+		BodySlot & slot = slots[handle.slot];
+		size_t const index = slot.index;
+		BodyParticlesDiscretisation * const body = bodies[index];
+
+		// Bodies of the caller keep their state
+		if (!slot.owned) {
+			body->getBody()->releaseStateStore();
+		}
+
+		// Move the last body to the free index
+		size_t const moved = states->remove(index);
+		if (moved != index) {
+			bodies[index] = bodies[moved];
+			body_slots[index] = body_slots[moved];
+			slots[body_slots[index]].index = static_cast<std::uint32_t>(index);
+			bodies[index]->getBody()->setStateIndex(index);
+		}
+		bodies.pop_back();
+		body_slots.pop_back();
+		if (slot.owned) {
+			destroyBody(body);
+		}
+
+		// Invalidate the handles of the slot and reuse it first
+		slot.generation++;
+		slot.index = NO_INDEX;
+		BodyHandle const free_handle = { handle.slot, slot.generation };
+		releaseHandle(free_handle);
+		bodies_revision++;
+
+		return true;
+	}
+
+	BodyHandle System::enqueueCreateBody(ShapeType const type, real const parameters[Body::MAX_SHAPE_PARAMETERS],
+										 math::vec3r const & cm, real const mass, math::quaternionr const & orientation,
+										 real const particle_diameter) {
+		BodyHandle const invalid = { 0, 0 };
+
+		// Discretise the shape in body space on this thread
+		std::unique_ptr<PreparedBody> prepared(new PreparedBody());
+		prepared->body.reset(Body::create(type, parameters, math::vec3r({ real(0), real(0), real(0) }), real(1),
+										  math::quaternionr(real(1), real(0), real(0), real(0))));
+		if (!prepared->body) {
+			return invalid;
+		}
+		prepared->discretisation.reset(new BodyParticlesDiscretisation(prepared->body.get(), particle_diameter));
+
+		Command command;
+		command.type = Command::COMMAND_CREATE_BODY;
+		command.handle = reserveHandle();
+		command.shape = type;
+		std::copy(parameters, parameters + Body::MAX_SHAPE_PARAMETERS, command.parameters);
+		command.mass = mass;
+		command.prepared = prepared.get();
+		command.fields = 0;
+		command.x = cm;
+		command.q = orientation;
+		if (!pushCommand(command)) {
+			returnHandle(command.handle);
+			return invalid;
+		}
+		prepared.release();
+
+		return command.handle;
+	}
+
+	bool System::enqueueRemoveBody(BodyHandle const handle) {
+		Command command;
+		command.type = Command::COMMAND_REMOVE_BODY;
+		command.handle = handle;
+		command.prepared = nullptr;
+		command.fields = 0;
+
+		return pushCommand(command);
+	}
+
+	bool System::enqueueApplyImpulse(BodyHandle const handle, math::vec3r const & impulse, math::vec3r const & point) {
+		Command command;
+		command.type = Command::COMMAND_APPLY_IMPULSE;
+		command.handle = handle;
+		command.prepared = nullptr;
+		command.fields = 0;
+		command.x = point;
+		command.v = impulse;
+
+		return pushCommand(command);
+	}
+
+	bool System::enqueueSetState(BodyHandle const handle, unsigned int const fields,
+								 math::vec3r const & x, math::quaternionr const & q,
+								 math::vec3r const & v, math::vec3r const & omega) {
+		Command command;
+		command.type = Command::COMMAND_SET_STATE;
+		command.handle = handle;
+		command.prepared = nullptr;
+		command.fields = fields;
+		command.x = x;
+		command.q = q;
+		command.v = v;
+		command.omega = omega;
+
+		return pushCommand(command);
+	}
+
+	void System::applyCommands() {
+		// Retry the free handles that did not fit in the queue, with the ones given back by the
+		// other threads
+		{
+			std::lock_guard<std::mutex> lock(returned_mutex);
+			retired_handles.insert(retired_handles.end(), returned_handles.begin(), returned_handles.end());
+			returned_handles.clear();
+		}
+		while (!retired_handles.empty() && free_handles.push(retired_handles.back())) {
+			retired_handles.pop_back();
+		}
+
+		// Apply at most a queue of commands so producers can not stall the step, the set of
+		// bodies changes once
+		size_t const revision = bodies_revision;
+		Command command;
+		for (size_t c = 0; c < COMMAND_QUEUE_SIZE && commands.pop(command); c++) {
+			applyCommand(command);
+		}
+		if (bodies_revision != revision) {
+			bodies_revision = revision + 1;
+		}
+	}
+
+	bool System::isValid(BodyHandle const handle) const {
+		return (handle.slot < slots.size() && slots[handle.slot].index != NO_INDEX &&
+				slots[handle.slot].generation == handle.generation);
+	}
+
+	BodyParticlesDiscretisation * System::getBody(BodyHandle const handle) const {
+		return (isValid(handle) ? bodies[slots[handle.slot].index] : nullptr);
+	}
+
+	BodyHandle System::getHandle(size_t const index) const {
+		BodyHandle const handle = { body_slots[index], slots[body_slots[index]].generation };
+
+		return handle;
+	}
+
+	BodyHandle System::reserveHandle() {
+		// Reuse a free slot first, new slots start at generation 1 so a zero handle is never valid
+		BodyHandle handle;
+		if (!free_handles.pop(handle)) {
+			handle.slot = num_slots.fetch_add(1, std::memory_order_relaxed);
+			handle.generation = 1;
+		}
+
+		return handle;
+	}
+
+	void System::releaseHandle(BodyHandle const handle) {
+		if (!free_handles.push(handle)) {
+			retired_handles.push_back(handle);
+		}
+	}
+
+	void System::returnHandle(BodyHandle const handle) {
+		// The slot was never used, its generation is still free. If the queue is full the handle
+		// waits for the simulation thread instead of losing the slot
+		if (!free_handles.push(handle)) {
+			std::lock_guard<std::mutex> lock(returned_mutex);
+			returned_handles.push_back(handle);
+		}
+	}
+
+	bool System::pushCommand(Command const & command) {
+		return commands.push(command);
+	}
+
+	void System::applyCommand(Command & command) {
+		// Created bodies get the slot reserved when the command was queued
+		if (command.type == Command::COMMAND_CREATE_BODY) {
+			std::unique_ptr<PreparedBody> const prepared(command.prepared);
+			Body * const body = createPooledBody(spheres, planes, states.get(), command.shape, command.parameters,
+												 command.x, command.mass, command.q);
+			insertBody(discretisations.create(body, *prepared->discretisation), true, command.handle);
+			bodies_revision++;
+			return;
+		}
+		if (command.type == Command::COMMAND_REMOVE_BODY) {
+			removeBody(command.handle);
+			return;
+		}
+
+		// Commands on the state of a body, static bodies only move through state overrides
+		if (!isValid(command.handle)) {
+			return;
+		}
+		size_t const index = slots[command.handle.slot].index;
+		bool const is_dynamic = states->getMass(index) < real(INFINITY);
+		if (command.type == Command::COMMAND_APPLY_IMPULSE) {
+			if (is_dynamic) {
+				math::vec3r const arm = command.x - states->getPosition(index);
+				states->setLinearMomentum(index, states->getLinearMomentum(index) + command.v);
+				states->setAngularMomentum(index, states->getAngularMomentum(index) + math::crossProduct(arm, command.v));
+				states->computeDerivedQuantities(index);
+			}
+			return;
+		}
+		if ((command.fields & FIELD_POSITION) != 0) {
+			states->setPosition(index, command.x);
+		}
+		if ((command.fields & FIELD_ORIENTATION) != 0) {
+			states->setOrientation(index, math::normalize(command.q));
+		}
+		states->computeDerivedQuantities(index);
+		if (is_dynamic && (command.fields & (FIELD_LINEAR_VELOCITY | FIELD_ANGULAR_VELOCITY)) != 0) {
+			if ((command.fields & FIELD_LINEAR_VELOCITY) != 0) {
+				states->setLinearMomentum(index, states->getMass(index) * command.v);
+			}
+			if ((command.fields & FIELD_ANGULAR_VELOCITY) != 0) {
+				// L = R I R^T omega
+				math::mat3x3r const & R = states->getRotationMatrix(index);
+				math::vec3r const omega_body = math::transpose(R) * command.omega;
+				states->setAngularMomentum(index, R * (states->getInertiaTensorBody(index) * omega_body));
+			}
+			states->computeDerivedQuantities(index);
+		}
+	}
+
+	void System::insertBody(BodyParticlesDiscretisation * const body, bool const owned, BodyHandle const handle) {
+		body->getBody()->bindStateStore(states.get());
+#ifdef _DEBUG
+		assert(body->getBody()->getStateIndex() == bodies.size());
+#endif
+
+		// Add the slots handed out since the last insertion, they have no body until theirs is inserted
+		if (handle.slot >= slots.size()) {
+			BodySlot const empty_slot = { 0, NO_INDEX, false };
+			slots.resize(std::max<size_t>(handle.slot + 1, num_slots.load(std::memory_order_relaxed)), empty_slot);
+		}
+		BodySlot & slot = slots[handle.slot];
+		slot.generation = handle.generation;
+		slot.index = static_cast<std::uint32_t>(bodies.size());
+		slot.owned = owned;
 		bodies.push_back(body);
+		body_slots.push_back(handle.slot);
+	}
+
+	void System::destroyBody(BodyParticlesDiscretisation * const body) {
+		Body * const shape = body->getBody();
+		discretisations.destroy(body);
+		switch (shape->getShapeType()) {
+		case SHAPE_SPHERE:
+			spheres.destroy(static_cast<Sphere *>(shape));
+			break;
+		case SHAPE_PLANE:
+			planes.destroy(static_cast<Plane *>(shape));
+			break;
+		default:
+			break;
+		}
+	}
+
+	void System::buildIslands() {
+		size_t const num_bodies = bodies.size();
+
+		// Pose and world box of all the bodies
+		size_t const num_blocks = (num_bodies + WORLD_UPDATE_BLOCK - 1) / WORLD_UPDATE_BLOCK;
+		pool->run(num_blocks, [this, num_bodies](size_t const block) {
+			size_t const end = std::min((block + 1) * WORLD_UPDATE_BLOCK, num_bodies);
+			for (size_t b = block * WORLD_UPDATE_BLOCK; b < end; b++) {
+				bodies[b]->updateWorldTransform();
+			}
+		});
+
+		// Bodies with infinite mass do not connect the islands
+		static_bodies.resize(num_bodies);
+		body_costs.resize(num_bodies);
+		for (size_t b = 0; b < num_bodies; b++) {
+			static_bodies[b] = states->getMass(b) < real(INFINITY) ? 0 : 1;
+			body_costs[b] = static_cast<std::uint32_t>(bodies[b]->getNumParticles());
+		}
+
+		// Pairs of bodies that can touch
+		contact_pairs.clear();
+		if (broad_phase == BROAD_PHASE_HASH_GRID) {
+			findPairsHashGrid();
+		} else {
+			findPairsSweepAndPrune();
+		}
+
+		// Keep the order of the pairs of the serial all pairs loop, the contact forces of a
+		// particle are then summed in the same order whatever the number of threads
+		std::sort(contact_pairs.begin(), contact_pairs.end(), [](BodyPair const & a, BodyPair const & b) {
+			return (a.first < b.first || (a.first == b.first && a.second < b.second));
+		});
+
+		// Only the bodies of the pairs transform their particles to world space, the others free them
+		paired_bodies.assign(num_bodies, 0);
+		for (auto pair = contact_pairs.begin(); pair != contact_pairs.end(); pair++) {
+			paired_bodies[pair->first] = 1;
+			paired_bodies[pair->second] = 1;
+		}
+		pool->run(num_blocks, [this, num_bodies](size_t const block) {
+			size_t const end = std::min((block + 1) * WORLD_UPDATE_BLOCK, num_bodies);
+			for (size_t b = block * WORLD_UPDATE_BLOCK; b < end; b++) {
+				if (paired_bodies[b]) {
+					bodies[b]->updateWorldParticles();
+				} else {
+					bodies[b]->releaseWorldParticles();
+				}
+			}
+		});
+		islands.build(num_bodies, static_bodies, contact_pairs, body_costs, MIN_ISLAND_TASK_COST);
 	}
 
-	void System::computeForceAndTorque(float const time) const {
-		// Compute forces between bodies using particles approximation
-		for (auto body_1 = bodies.begin(); body_1 != bodies.end() - 1; body_1++) {
-			for (auto body_2 = body_1 + 1; body_2 != bodies.end(); body_2++) {
-				(*body_1)->colliding(*(*body_2));
+	void System::findPairsSweepAndPrune() {
+		size_t const num_bodies = bodies.size();
+
+		// Sweep the boxes along x to find the pairs of bodies that can touch
+		sweep_order.resize(num_bodies);
+		for (size_t b = 0; b < num_bodies; b++) {
+			sweep_order[b] = static_cast<std::uint32_t>(b);
+		}
+		std::sort(sweep_order.begin(), sweep_order.end(), [this](std::uint32_t const a, std::uint32_t const b) {
+			return bodies[a]->getWorldBoundsMin()[0] < bodies[b]->getWorldBoundsMin()[0];
+		});
+		for (size_t k = 0; k < num_bodies; k++) {
+			std::uint32_t const a = sweep_order[k];
+			contact_real const * const min_a = bodies[a]->getWorldBoundsMin();
+			contact_real const * const max_a = bodies[a]->getWorldBoundsMax();
+			for (size_t m = k + 1; m < num_bodies; m++) {
+				std::uint32_t const b = sweep_order[m];
+				contact_real const * const min_b = bodies[b]->getWorldBoundsMin();
+				contact_real const * const max_b = bodies[b]->getWorldBoundsMax();
+				if (min_b[0] > max_a[0]) {
+					break;
+				}
+				if ((static_bodies[a] && static_bodies[b]) || min_b[1] > max_a[1] || min_a[1] > max_b[1] ||
+					min_b[2] > max_a[2] || min_a[2] > max_b[2]) {
+					continue;
+				}
+				BodyPair const pair = { std::min(a, b), std::max(a, b) };
+				contact_pairs.push_back(pair);
 			}
 		}
+	}
 
+	void System::findPairsHashGrid() {
+		size_t const num_bodies = bodies.size();
+
+		// Bounding sphere of every box in the grid
+		body_grid.clear();
+		body_levels.resize(num_bodies);
+		for (size_t b = 0; b < num_bodies; b++) {
+			contact_real center[3];
+			contact_real radius;
+			if (getBoundingSphere(*bodies[b], center, radius)) {
+				body_grid.insert(static_cast<std::uint32_t>(b), center, radius);
+				body_levels[b] = HierarchicalHashGrid::getLevel(radius);
+			}
+		}
+		body_grid.build();
+
+		// Every body looks for the bodies at its level or above, a pair at the same level is kept
+		// by the body with the lower index
+		for (size_t k = 0; k < num_bodies; k++) {
+			std::uint32_t const a = static_cast<std::uint32_t>(k);
+			contact_real center[3];
+			contact_real radius;
+			if (!getBoundingSphere(*bodies[a], center, radius)) {
+				continue;
+			}
+			contact_real const * const min_a = bodies[a]->getWorldBoundsMin();
+			contact_real const * const max_a = bodies[a]->getWorldBoundsMax();
+			body_grid.query(center, radius, body_levels[a], [this, a, min_a, max_a](std::uint32_t const b) {
+				if (b == a || (body_levels[b] == body_levels[a] && b < a)) {
+					return;
+				}
+				contact_real const * const min_b = bodies[b]->getWorldBoundsMin();
+				contact_real const * const max_b = bodies[b]->getWorldBoundsMax();
+				if ((static_bodies[a] && static_bodies[b]) || min_b[0] > max_a[0] || min_a[0] > max_b[0] ||
+					min_b[1] > max_a[1] || min_a[1] > max_b[1] || min_b[2] > max_a[2] || min_a[2] > max_b[2]) {
+					return;
+				}
+				BodyPair const pair = { std::min(a, b), std::max(a, b) };
+				contact_pairs.push_back(pair);
+			});
+		}
+	}
+
+	size_t System::detectPairs(BodyPair const * const pairs, size_t const count) {
+		// Find the contacts of all the pairs, static bodies do not collect contact forces so that
+		// the islands touching them can run at the same time
+		ContactBuffer & contacts = contact_buffers[ThreadPool::getThreadIndex()];
+		size_t const begin = contacts.size();
+		size_t pairs_in_contact = 0;
+		for (size_t p = 0; p < count; p++) {
+			std::uint32_t const first = pairs[p].first;
+			std::uint32_t const second = pairs[p].second;
+			size_t found;
+			if (static_bodies[first]) {
+				found = getPairDetector(second, first)(*bodies[second], second, *bodies[first], first, false, contacts);
+			} else {
+				found = getPairDetector(first, second)(*bodies[first], first, *bodies[second], second, static_bodies[second] == 0, contacts);
+			}
+			pairs_in_contact += found > 0 ? 1 : 0;
+		}
+		restoreContacts(contacts, begin, contacts.size());
+
+		return pairs_in_contact;
+	}
+
+	ContactDetector System::getPairDetector(std::uint32_t const first, std::uint32_t const second) const {
+		if (analytic_contacts) {
+			ContactDetector const analytic = getAnalyticContactDetector(bodies[first]->getBody()->getShapeType(),
+																		bodies[second]->getBody()->getShapeType());
+			if (analytic != nullptr) {
+				return analytic;
+			}
+		}
+
+		return contact_detector;
+	}
+
+	size_t System::collidePairs(BodyPair const * const pairs, size_t const count) {
+		// Apply the forces of the contacts in the order they were found, with their history
+		ContactBuffer & contacts = contact_buffers[ThreadPool::getThreadIndex()];
+		size_t const begin = contacts.size();
+		size_t const pairs_in_contact = detectPairs(pairs, count);
+		contact_responder(contacts, begin, contacts.size(), contact_material, bodies.data());
+
+		return pairs_in_contact;
+	}
+
+	ContactKey System::getContactKey(ContactBuffer const & contacts, size_t const contact) const {
+		// Handles do not change when other bodies are removed, indices do
+		BodyHandle const handle_1 = getHandle(contacts.first_body[contact]);
+		BodyHandle const handle_2 = getHandle(contacts.second_body[contact]);
+		std::uint64_t const id_1 = (static_cast<std::uint64_t>(handle_1.generation) << 32) | handle_1.slot;
+		std::uint64_t const id_2 = (static_cast<std::uint64_t>(handle_2.generation) << 32) | handle_2.slot;
+		ContactKey key;
+		if (id_2 < id_1) {
+			key.body_1 = id_2;
+			key.particle_1 = contacts.second_particle[contact];
+			key.body_2 = id_1;
+			key.particle_2 = contacts.first_particle[contact];
+		} else {
+			key.body_1 = id_1;
+			key.particle_1 = contacts.first_particle[contact];
+			key.body_2 = id_2;
+			key.particle_2 = contacts.second_particle[contact];
+		}
+
+		return key;
+	}
+
+	void System::restoreContacts(ContactBuffer & contacts, size_t const begin, size_t const end) const {
+		for (size_t c = begin; c < end; c++) {
+			ContactHistory const * const history = contact_cache.find(getContactKey(contacts, c));
+			if (history != nullptr) {
+				contacts.age[c] = history->age + 1;
+				contacts.impulse[c] = history->normal_impulse;
+			}
+		}
+	}
+
+	void System::rememberContacts() {
+		size_t num_particle_contacts = 0;
+		for (auto contacts = contact_buffers.begin(); contacts != contact_buffers.end(); contacts++) {
+			num_particle_contacts += contacts->size();
+		}
+
+		// Record the contacts of the step with their history after the response
+		size_t num_persistent = 0;
+		contact_cache.beginStep(num_particle_contacts);
+		for (auto contacts = contact_buffers.begin(); contacts != contact_buffers.end(); contacts++) {
+			for (size_t c = 0; c < contacts->size(); c++) {
+				ContactKey const key = getContactKey(*contacts, c);
+				ContactHistory history;
+				history.age = contacts->age[c];
+				history.normal_impulse = contacts->impulse[c];
+				contact_cache.insert(key, history);
+				num_persistent += contacts->age[c] > 0 ? 1 : 0;
+			}
+		}
+		contact_cache.endStep();
+
+		statistics.num_particle_contacts = num_particle_contacts;
+		statistics.num_persistent_contacts = num_persistent;
+	}
+
+	void System::updateBodies(std::uint32_t const * const indices, size_t const count, real const step) {
 		// Add gravity to all bodies and transfer partcile forces to them
-		for (auto body = bodies.begin(); body != bodies.end(); body++) {
-			(*body)->getBody()->resetForce();
-			(*body)->getBody()->resetTorque();
+		size_t active = 0;
+		for (size_t b = 0; b < count; b++) {
+			BodyParticlesDiscretisation * const body = bodies[indices[b]];
+			active += body->getNumActiveParticles();
+			states->resetForce(indices[b]);
+			states->resetTorque(indices[b]);
 
 			// Add gravity
-			(*body)->getBody()->addForce(math::vec3f({0.f, -0.1f, 0.f}));
+			body->getBody()->addForce(math::vec3r({ real(0), GRAVITY_FORCE, real(0) }));
 
 			// Transfer particle forces to body
-			(*body)->transferForcesParticlesBody();
+			body->transferForcesParticlesBody();
+		}
+		num_active_particles += active;
+
+		// Integrate the bodies
+		if (step != real(0)) {
+			states->integrateEuler(indices, count, step);
 		}
 	}
 
-	void System::computeStep() {
-		// Allocate space
-		float * y0 = new float[PhysicalProperties::STATE_SIZE * bodies.size()];
-		float * y_end = new float[PhysicalProperties::STATE_SIZE * bodies.size()];
-		float * y_dot = new float[PhysicalProperties::STATE_SIZE * bodies.size()];
+	void System::processIsland(size_t const island, real const step) {
+		num_contacts += collidePairs(islands.getPairs(island), islands.getNumPairs(island));
+		updateBodies(islands.getBodies(island), islands.getNumBodies(island), step);
+	}
+
+	size_t System::solveIsland(size_t const island, ContactRange const * const ranges, size_t const num_ranges,
+							   real const step, ThreadPool * const island_pool) {
+		size_t const thread = ThreadPool::getThreadIndex();
+		math::vec3r const gravity = math::vec3r({ real(0), GRAVITY_FORCE, real(0) });
+		if (integration_mode == INTEGRATION_LINEARLY_IMPLICIT_EULER) {
+			return implicit_solvers[thread].step(*states, bodies.data(), static_bodies, islands.getBodies(island),
+												 islands.getNumBodies(island), ranges, num_ranges, contact_material, gravity, step);
+		}
 
-		computeForceAndTorque(t);
+		return impulse_solvers[thread].step(*states, bodies.data(), static_bodies, islands.getBodies(island),
+											islands.getNumBodies(island), ranges, num_ranges, impulse_settings, gravity, step,
+											island_pool);
+	}
+
+	void System::processSolvedIsland(size_t const island, real const step) {
+		ContactBuffer & contacts = contact_buffers[ThreadPool::getThreadIndex()];
+		ContactRange range = { &contacts, contacts.size(), contacts.size() };
+		num_contacts += detectPairs(islands.getPairs(island), islands.getNumPairs(island));
+		range.end = contacts.size();
+		num_solver_iterations += solveIsland(island, &range, 1, step, nullptr);
+	}
+
+	void System::processColouredIsland(size_t const island, real const step, double & busy, double & available) {
+		size_t const num_threads = pool->getNumThreads();
+		colouring.build(bodies.size(), static_bodies, islands.getPairs(island), islands.getNumPairs(island));
+		statistics.num_colour_batches += colouring.getNumBatches();
+
+		// The pairs of a batch touch different dynamic bodies, split them in tasks
+		for (size_t batch = 0; batch < colouring.getNumBatches(); batch++) {
+			BodyPair const * const pairs = colouring.getBatch(batch);
+			size_t const batch_size = colouring.getBatchSize(batch);
+			size_t const num_tasks = std::min(batch_size, num_threads * COLOUR_TASKS_PER_THREAD);
+			pool->run(num_tasks, [this, pairs, batch_size, num_tasks](size_t const task) {
+				size_t const begin = task * batch_size / num_tasks;
+				size_t const end = (task + 1) * batch_size / num_tasks;
+				num_contacts += collidePairs(pairs + begin, end - begin);
+			});
+
+			// Every thread gets at most the pairs of one thread rounded up
+			busy += static_cast<double>(batch_size);
+			available += static_cast<double>(num_threads * ((batch_size + num_threads - 1) / num_threads));
+		}
 
-		// Insert body state to array
-		for (size_t i = 0; i < bodies.size(); i++) {
-			bodies[i]->getBody()->bodyStateToArray(&y0[i * PhysicalProperties::STATE_SIZE]);
-			bodies[i]->getBody()->ddtBodyStateToArray(&y_dot[i * PhysicalProperties::STATE_SIZE]);
+		// Bodies are independent once their contact forces are summed
+		std::uint32_t const * const island_bodies = islands.getBodies(island);
+		size_t const num_bodies = islands.getNumBodies(island);
+		size_t const num_blocks = (num_bodies + COLOURED_UPDATE_BLOCK - 1) / COLOURED_UPDATE_BLOCK;
+		pool->run(num_blocks, [this, island_bodies, num_bodies, step](size_t const block) {
+			size_t const begin = block * COLOURED_UPDATE_BLOCK;
+			updateBodies(island_bodies + begin, std::min(COLOURED_UPDATE_BLOCK, num_bodies - begin), step);
+		});
+	}
+
+	void System::processLargeSolvedIsland(size_t const island, real const step) {
+		// The detection writes no particle, the pairs are split in tasks without colouring. The
+		// contacts of the tasks are solved in task order, which is the order of the pairs
+		BodyPair const * const pairs = islands.getPairs(island);
+		size_t const num_pairs = islands.getNumPairs(island);
+		size_t const num_tasks = std::min(num_pairs, pool->getNumThreads() * COLOUR_TASKS_PER_THREAD);
+		island_ranges.resize(num_tasks);
+		pool->run(num_tasks, [this, pairs, num_pairs, num_tasks](size_t const task) {
+			size_t const begin = task * num_pairs / num_tasks;
+			size_t const end = (task + 1) * num_pairs / num_tasks;
+			ContactBuffer & contacts = contact_buffers[ThreadPool::getThreadIndex()];
+			island_ranges[task].contacts = &contacts;
+			island_ranges[task].begin = contacts.size();
+			num_contacts += detectPairs(pairs + begin, end - begin);
+			island_ranges[task].end = contacts.size();
+		});
+
+		num_solver_iterations += solveIsland(island, island_ranges.data(), island_ranges.size(), step, pool.get());
+	}
+
+	void System::processIslands(real const step) {
+		// Islands with many pairs are coloured
+		auto const coloured = [this](size_t const island) {
+			return islands.getNumPairs(island) >= MIN_COLOURED_ISLAND_PAIRS;
+		};
+		// Forces alone are always computed by the explicit pipeline
+		bool const solved = integration_mode != INTEGRATION_EXPLICIT_EULER && step != real(0);
+
+		// The other islands run in parallel, one task at a time
+		num_contacts = 0;
+		num_active_particles = 0;
+		num_solver_iterations = 0;
+		for (auto contacts = contact_buffers.begin(); contacts != contact_buffers.end(); contacts++) {
+			contacts->clear();
 		}
+		pool->run(islands.getNumTasks(), [this, step, solved, &coloured](size_t const task) {
+			for (size_t island = islands.getTaskBegin(task); island < islands.getTaskEnd(task); island++) {
+				if (coloured(island)) {
+					continue;
+				}
+				if (solved) {
+					processSolvedIsland(island, step);
+				} else {
+					processIsland(island, step);
+				}
+			}
+		});
 
-		// Compute step
-		EulerSolver::odeStep(y0, y_dot, y_end, PhysicalProperties::STATE_SIZE * bodies.size(), t, t + delta_t);
+		// Coloured islands run one after the other on all the threads
+		double busy = 0.0;
+		double available = 0.0;
+		statistics.num_coloured_islands = 0;
+		statistics.num_colour_batches = 0;
+		for (size_t island = 0; island < islands.getNumIslands(); island++) {
+			if (coloured(island)) {
+				if (solved) {
+					processLargeSolvedIsland(island, step);
+				} else {
+					processColouredIsland(island, step, busy, available);
+					statistics.num_coloured_islands++;
+				}
+			}
+		}
 
-		// Update body state
-		for (size_t i = 0; i < bodies.size(); i++) {
-			bodies[i]->getBody()->arrayToBodyState(&y_end[i * PhysicalProperties::STATE_SIZE]);
+		// The contacts of a step are the history of the next one, forces alone do not advance it
+		if (step != real(0)) {
+			rememberContacts();
 		}
 
+		statistics.num_bodies = bodies.size();
+		statistics.num_pairs = contact_pairs.size();
+		statistics.num_contacts = num_contacts;
+		statistics.num_active_particles = num_active_particles;
+		statistics.num_solver_iterations = num_solver_iterations;
+		statistics.num_islands = islands.getNumIslands();
+		statistics.num_tasks = islands.getNumTasks();
+		statistics.colour_efficiency = available > 0.0 ? busy / available : 1.0;
+	}
+
+	void System::computeForceAndTorque() {
+		buildIslands();
+		processIslands(real(0));
+	}
+
+	void System::computeStep() {
+		auto const start = std::chrono::high_resolution_clock::now();
+
+		// Apply the commands queued since the last step
+		applyCommands();
+
+		// Forces and Euler step of every island
+		buildIslands();
+		processIslands(delta_t);
+
 		// Update time
 		t += delta_t;
+		statistics.step_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void System::setNumThreads(size_t const num_threads) {
+		pool.reset(new ThreadPool(num_threads));
+		contact_buffers.resize(pool->getNumThreads());
+		implicit_solvers.resize(pool->getNumThreads());
+		impulse_solvers.resize(pool->getNumThreads());
+	}
+
+	size_t System::getNumThreads() const {
+		return pool->getNumThreads();
+	}
+
+	ContactIslands const & System::getIslands() const {
+		return islands;
+	}
+
+	StepStatistics const & System::getStepStatistics() const {
+		return statistics;
+	}
+
+	void System::setContactStages(ContactDetector const detector, ContactResponder const responder) {
+		contact_detector = detector;
+		contact_responder = responder;
+	}
+
+	void System::setAnalyticContacts(bool const enabled) {
+		analytic_contacts = enabled;
+	}
+
+	bool System::getAnalyticContacts() const {
+		return analytic_contacts;
+	}
+
+	void System::setIntegrationMode(IntegrationMode const mode) {
+		integration_mode = mode;
+	}
+
+	System::IntegrationMode System::getIntegrationMode() const {
+		return integration_mode;
+	}
+
+	void System::setBroadPhase(BroadPhase const phase) {
+		broad_phase = phase;
+	}
+
+	System::BroadPhase System::getBroadPhase() const {
+		return broad_phase;
+	}
+
+	void System::setContactMaterial(ContactMaterial const & material) {
+		contact_material = material;
+	}
+
+	ContactMaterial const & System::getContactMaterial() const {
+		return contact_material;
+	}
+
+	void System::setImpulseSettings(ImpulseSettings const & settings) {
+		impulse_settings = settings;
+	}
+
+	ImpulseSettings const & System::getImpulseSettings() const {
+		return impulse_settings;
+	}
+
+	std::vector<ContactBuffer> const & System::getContactBuffers() const {
+		return contact_buffers;
+	}
+
+	ContactCache const & System::getContactCache() const {
+		return contact_cache;
+	}
+
+	real System::getTime() const {
+		return t;
+	}
+
+	real System::getTimeStep() const {
+		return delta_t;
+	}
+
+	std::vector<BodyParticlesDiscretisation *> const & System::getBodies() const {
+		return bodies;
+	}
+
+	BodyStateStore & System::getStateStore() {
+		return *states;
+	}
+
+	BodyStateStore const & System::getStateStore() const {
+		return *states;
+	}
+
+	size_t System::getBodiesRevision() const {
+		return bodies_revision;
 	}
 
 	void System::draw(GLuint const v_p, GLuint const i_p, GLuint const n_p,
@@ -0,0 +1,124 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace pb {
+
+	// Index of the thread in its pool, the threads that are not workers run as the first thread
+	static thread_local size_t thread_index = 0;
+
+	ThreadPool::ThreadPool(size_t const num_threads)
+		: batch_task(nullptr), remaining(0), batch(0), stopping(false) {
+		size_t const threads = num_threads > 0 ? num_threads :
+			std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+		for (size_t t = 0; t < threads; t++) {
+			deques.push_back(std::unique_ptr<TaskDeque>(new TaskDeque()));
+		}
+		for (size_t t = 1; t < threads; t++) {
+			workers.push_back(std::thread(&ThreadPool::workerLoop, this, t));
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto worker = workers.begin(); worker != workers.end(); worker++) {
+			worker->join();
+		}
+	}
+
+	size_t ThreadPool::getNumThreads() const {
+		return deques.size();
+	}
+
+	size_t ThreadPool::getThreadIndex() {
+		return thread_index;
+	}
+
+	void ThreadPool::run(size_t const count, std::function<void(size_t)> const & task) {
+		// Small batches are not worth waking the workers
+		if (workers.empty() || count < 2) {
+			for (size_t i = 0; i < count; i++) {
+				task(i);
+			}
+			return;
+		}
+
+		// Deal the tasks round robin so every thread starts with some of the longest ones
+		batch_task = &task;
+		remaining.store(count);
+		size_t const num_deques = deques.size();
+		for (size_t d = 0; d < num_deques; d++) {
+			std::lock_guard<std::mutex> lock(deques[d]->mutex);
+			for (size_t i = d; i < count; i += num_deques) {
+				deques[d]->tasks.push_front(i);
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			batch++;
+		}
+		wake.notify_all();
+
+		// Help until the deques are empty, then wait for the tasks still running
+		work(0);
+		while (remaining.load() > 0) {
+			std::this_thread::yield();
+		}
+		batch_task = nullptr;
+	}
+
+	void ThreadPool::workerLoop(size_t const worker) {
+		thread_index = worker;
+		size_t seen_batch = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&]() { return stopping || batch != seen_batch; });
+				if (stopping) {
+					return;
+				}
+				seen_batch = batch;
+			}
+			work(worker);
+		}
+	}
+
+	void ThreadPool::work(size_t const worker) {
+		size_t task;
+		while (takeTask(worker, task)) {
+			(*batch_task)(task);
+			remaining.fetch_sub(1);
+		}
+	}
+
+	bool ThreadPool::takeTask(size_t const worker, size_t & task) {
+		// Own tasks first, in dealing order
+		{
+			TaskDeque & own = *deques[worker];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.tasks.empty()) {
+				task = own.tasks.back();
+				own.tasks.pop_back();
+				return true;
+			}
+		}
+
+		// Steal the last task dealt to another thread
+		size_t const num_deques = deques.size();
+		for (size_t d = 1; d < num_deques; d++) {
+			TaskDeque & victim = *deques[(worker + d) % num_deques];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty()) {
+				task = victim.tasks.front();
+				victim.tasks.pop_front();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "trajectory_player.h"
+#include "trajectory_format.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace pb {
+
+	// No description loaded
+	static std::uint64_t const NO_DESCRIPTION = static_cast<std::uint64_t>(-1);
+
+	TrajectoryPlayer::TrajectoryPlayer()
+		: description_offset(NO_DESCRIPTION), frame(0), time(0), speed(1), paused(false) {}
+
+	bool TrajectoryPlayer::open(char const * const path) {
+		description_offset = NO_DESCRIPTION;
+		bodies.clear();
+		states.reset();
+		frame = 0;
+		paused = false;
+		if (!reader.open(path) || reader.getNumFrames() == 0) {
+			return false;
+		}
+
+		return seek(0);
+	}
+
+	size_t TrajectoryPlayer::getNumFrames() const {
+		return reader.getNumFrames();
+	}
+
+	size_t TrajectoryPlayer::getFrame() const {
+		return frame;
+	}
+
+	double TrajectoryPlayer::getTime() const {
+		return time;
+	}
+
+	double TrajectoryPlayer::getSpeed() const {
+		return speed;
+	}
+
+	void TrajectoryPlayer::setSpeed(double const speed) {
+		this->speed = speed;
+	}
+
+	bool TrajectoryPlayer::isPaused() const {
+		return paused;
+	}
+
+	void TrajectoryPlayer::setPaused(bool const paused) {
+		this->paused = paused;
+	}
+
+	bool TrajectoryPlayer::seek(size_t const frame) {
+		if (reader.getNumFrames() == 0) {
+			return false;
+		}
+		size_t const target = std::min(frame, reader.getNumFrames() - 1);
+		if (!showFrame(target)) {
+			return false;
+		}
+		time = poses.t;
+
+		return true;
+	}
+
+	bool TrajectoryPlayer::step(long long const frames) {
+		long long const target = static_cast<long long>(frame) + frames;
+
+		return seek(target < 0 ? 0 : static_cast<size_t>(target));
+	}
+
+	bool TrajectoryPlayer::update(double const elapsed) {
+		if (paused || reader.getNumFrames() == 0) {
+			return true;
+		}
+
+		// Advance the playback time, stop at the ends of the recording
+		double const start = reader.getFrameTime(0);
+		double const end = reader.getFrameTime(reader.getNumFrames() - 1);
+		time += elapsed * speed;
+		if (time <= start || time >= end) {
+			time = std::max(start, std::min(time, end));
+			paused = true;
+		}
+
+		size_t const target = reader.findFrame(time);
+		if (target == frame) {
+			return true;
+		}
+
+		return showFrame(target);
+	}
+
+	void TrajectoryPlayer::draw(GLuint const v_s, GLuint const i_s, GLuint const n_s) const {
+		for (auto body = bodies.begin(); body != bodies.end(); body++) {
+			(*body)->drawBody(v_s, i_s, n_s);
+		}
+	}
+
+	bool TrajectoryPlayer::showFrame(size_t const frame) {
+		if (!reader.readFrame(frame, &poses)) {
+			fprintf(stderr, "Failed to decode frame %zu of the trajectory\n", frame);
+			return false;
+		}
+		this->frame = frame;
+		if (poses.description_offset != description_offset && !createBodies(poses.description_offset)) {
+			return false;
+		}
+		if (poses.num_bodies != bodies.size()) {
+			fprintf(stderr, "Frame %zu has %zu poses for %zu bodies\n", frame, poses.num_bodies, bodies.size());
+			return false;
+		}
+
+		// The poses have the layout of the state store
+		size_t const num_bodies = poses.num_bodies;
+		for (size_t c = 0; c < TrajectoryFormat::POSE_SIZE; c++) {
+			std::copy(poses.poses.begin() + c * num_bodies, poses.poses.begin() + (c + 1) * num_bodies,
+					  states->state(BodyStateStore::STATE_X + c));
+		}
+		states->computeDerivedQuantities();
+
+		return true;
+	}
+
+	bool TrajectoryPlayer::createBodies(std::uint64_t const description_offset) {
+		std::vector<TrajectoryBody> description;
+		if (!reader.readDescription(description_offset, &description)) {
+			fprintf(stderr, "Failed to read the description of the bodies of the trajectory\n");
+			return false;
+		}
+
+		// Mass and pose are not recorded, they are set by the frames
+		bodies.clear();
+		states.reset(new BodyStateStore());
+		for (auto shape = description.begin(); shape != description.end(); shape++) {
+			Body * const body = Body::create(shape->type, shape->parameters, math::vec3r({ real(0), real(0), real(0) }), real(1),
+											 math::quaternionr(real(1), real(0), real(0), real(0)));
+			if (body == nullptr) {
+				fprintf(stderr, "Unknown shape %u in the trajectory\n", static_cast<unsigned int>(shape->type));
+				bodies.clear();
+				this->description_offset = NO_DESCRIPTION;
+				return false;
+			}
+			body->bindStateStore(states.get());
+			bodies.push_back(std::unique_ptr<Body>(body));
+		}
+		this->description_offset = description_offset;
+
+		return true;
+	}
+
+} // pb namespace
\ No newline at end of file
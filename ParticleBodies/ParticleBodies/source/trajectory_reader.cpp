@@ -0,0 +1,316 @@
+#include "trajectory_reader.h"
+#include "binary_io.h"
+#include "compression.h"
+#include "trajectory_format.h"
+#include <algorithm>
+
+namespace pb {
+
+	// No chunk decoded
+	static size_t const NO_CHUNK = static_cast<size_t>(-1);
+
+	TrajectoryReader::TrajectoryReader()
+		: position_quantum(0), orientation_quantum(0), num_frames(0),
+		decoded_chunk(NO_CHUNK), decoded_frames(0), raw_offset(0) {}
+
+	bool TrajectoryReader::open(char const * const path) {
+		close();
+		if (!file.open(path)) {
+			return false;
+		}
+
+		// Check header
+		BinaryReader reader(file.data(), file.size());
+		std::uint32_t magic, version, real_size, frames_per_chunk;
+		if (!reader.read(&magic) || !reader.read(&version) ||
+			!reader.read(&real_size) || !reader.read(&frames_per_chunk) ||
+			!reader.read(&position_quantum) || !reader.read(&orientation_quantum)) {
+			close();
+			return false;
+		}
+		if (magic != TrajectoryFormat::MAGIC || version != TrajectoryFormat::VERSION ||
+			!(position_quantum > 0) || !(orientation_quantum > 0)) {
+			close();
+			return false;
+		}
+
+		// Poses are stored quantised, a file can be read with any precision of real
+		if (!readIndex()) {
+			chunks.clear();
+			scanRecords();
+		}
+
+		// Position of the first frame of every chunk
+		for (auto chunk = chunks.begin(); chunk != chunks.end(); chunk++) {
+			chunk->first_frame = num_frames;
+			num_frames += chunk->num_frames;
+		}
+
+		return true;
+	}
+
+	void TrajectoryReader::close() {
+		file.close();
+		chunks.clear();
+		num_frames = 0;
+		decoded_chunk = NO_CHUNK;
+		decoded_frames = 0;
+	}
+
+	size_t TrajectoryReader::getNumFrames() const {
+		return num_frames;
+	}
+
+	std::uint64_t TrajectoryReader::getFrameIndex(size_t const frame) const {
+		size_t const chunk = findChunk(frame);
+		return chunkFrameIndex(chunk, frame - chunks[chunk].first_frame);
+	}
+
+	double TrajectoryReader::getFrameTime(size_t const frame) const {
+		size_t const chunk = findChunk(frame);
+		return chunkFrameTime(chunk, frame - chunks[chunk].first_frame);
+	}
+
+	size_t TrajectoryReader::findFrame(double const t) const {
+		if (chunks.empty()) {
+			return 0;
+		}
+
+		// Last chunk starting at or before t, only the first times of the visited chunks are read
+		size_t first = 0, last = chunks.size();
+		while (last - first > 1) {
+			size_t const middle = first + (last - first) / 2;
+			if (chunkFrameTime(middle, 0) <= t) {
+				first = middle;
+			} else {
+				last = middle;
+			}
+		}
+
+		// Last frame of the chunk at or before t
+		size_t frame = 0;
+		while (frame + 1 < chunks[first].num_frames && chunkFrameTime(first, frame + 1) <= t) {
+			frame++;
+		}
+
+		return (chunks[first].first_frame + frame);
+	}
+
+	bool TrajectoryReader::readFrame(size_t const frame, TrajectoryPoses * const poses) {
+#ifdef _DEBUG
+		assert(frame < num_frames);
+#endif
+		size_t const chunk = findChunk(frame);
+		size_t const chunk_frame = frame - chunks[chunk].first_frame;
+
+		// Read chunk header
+		std::uint64_t payload_size;
+		unsigned char const * const payload = recordPayload(chunks[chunk].offset, TrajectoryFormat::RECORD_CHUNK, &payload_size);
+		if (payload == nullptr) {
+			return false;
+		}
+		BinaryReader reader(payload, static_cast<size_t>(payload_size));
+		std::uint64_t description_offset, first_index, raw_size, compressed_size;
+		std::uint32_t chunk_frames, num_bodies;
+		if (!reader.read(&description_offset) || !reader.read(&first_index) ||
+			!reader.read(&chunk_frames) || !reader.read(&num_bodies) ||
+			!reader.read(&raw_size) || !reader.read(&compressed_size) ||
+			chunk_frames != chunks[chunk].num_frames ||
+			!reader.seek(TrajectoryFormat::CHUNK_HEADER_SIZE + chunk_frames * (sizeof(std::uint64_t) + sizeof(double))) ||
+			compressed_size > payload_size - reader.tell()) {
+			return false;
+		}
+
+		// Decompress the poses if the chunk changed
+		if (decoded_chunk != chunk) {
+			decoded_chunk = NO_CHUNK;
+			raw.resize(static_cast<size_t>(raw_size));
+			if (!BlockCompressor::decompress(reader.current(), static_cast<size_t>(compressed_size), raw.data(), raw.size())) {
+				return false;
+			}
+			decoded_chunk = chunk;
+			decoded_frames = 0;
+		}
+
+		// Decode the deltas from the keyframe, or from the last decoded frame when moving forward
+		size_t const num_values = TrajectoryFormat::POSE_SIZE * num_bodies;
+		if (decoded_frames == 0 || chunk_frame + 1 < decoded_frames) {
+			raw_offset = 0;
+			values.assign(num_values, 0);
+			decoded_frames = 0;
+		}
+		unsigned char const * p = raw.data() + raw_offset;
+		unsigned char const * const end = raw.data() + raw.size();
+		for (; decoded_frames <= chunk_frame; decoded_frames++) {
+			for (size_t i = 0; i < num_values; i++) {
+				std::uint64_t delta;
+				if (!readVarint(p, end, delta)) {
+					decoded_chunk = NO_CHUNK;
+					return false;
+				}
+				values[i] += zigzagDecode(delta);
+			}
+		}
+		raw_offset = static_cast<size_t>(p - raw.data());
+
+		// Dequantise
+		poses->index = chunkFrameIndex(chunk, chunk_frame);
+		poses->t = chunkFrameTime(chunk, chunk_frame);
+		poses->description_offset = description_offset;
+		poses->num_bodies = num_bodies;
+		poses->poses.resize(num_values);
+		for (size_t c = 0; c < TrajectoryFormat::POSE_SIZE; c++) {
+			double const quantum = c < 3 ? position_quantum : orientation_quantum;
+			for (size_t b = 0; b < num_bodies; b++) {
+				size_t const i = c * num_bodies + b;
+				poses->poses[i] = static_cast<real>(values[i] * quantum);
+			}
+		}
+
+		return true;
+	}
+
+	bool TrajectoryReader::readDescription(std::uint64_t const offset, std::vector<TrajectoryBody> * const bodies) const {
+		std::uint64_t payload_size;
+		unsigned char const * const payload = recordPayload(offset, TrajectoryFormat::RECORD_DESCRIPTION, &payload_size);
+		if (payload == nullptr) {
+			return false;
+		}
+		BinaryReader reader(payload, static_cast<size_t>(payload_size));
+		std::uint64_t num_bodies;
+		if (!reader.read(&num_bodies)) {
+			return false;
+		}
+
+		bodies->clear();
+		for (std::uint64_t b = 0; b < num_bodies; b++) {
+			std::uint32_t type, padding;
+			double parameters[Body::MAX_SHAPE_PARAMETERS];
+			if (!reader.read(&type) || !reader.read(&padding) || !reader.read(parameters, Body::MAX_SHAPE_PARAMETERS)) {
+				return false;
+			}
+			TrajectoryBody body;
+			body.type = static_cast<ShapeType>(type);
+			for (size_t p = 0; p < Body::MAX_SHAPE_PARAMETERS; p++) {
+				body.parameters[p] = static_cast<real>(parameters[p]);
+			}
+			bodies->push_back(body);
+		}
+
+		return true;
+	}
+
+	unsigned char const * TrajectoryReader::recordPayload(std::uint64_t const offset, std::uint32_t const type,
+														  std::uint64_t * const size) const {
+		BinaryReader reader(file.data(), file.size());
+		std::uint32_t record_type, padding;
+		if (!reader.seek(static_cast<size_t>(offset)) || !reader.read(&record_type) ||
+			!reader.read(&padding) || !reader.read(size) ||
+			record_type != type || *size > file.size() - reader.tell()) {
+			return nullptr;
+		}
+
+		return reader.current();
+	}
+
+	bool TrajectoryReader::readIndex() {
+		if (file.size() < TrajectoryFormat::HEADER_SIZE + TrajectoryFormat::TRAILER_SIZE) {
+			return false;
+		}
+
+		// Trailer
+		BinaryReader reader(file.data(), file.size());
+		std::uint64_t index_offset;
+		std::uint32_t magic, version;
+		if (!reader.seek(file.size() - TrajectoryFormat::TRAILER_SIZE) || !reader.read(&index_offset) ||
+			!reader.read(&magic) || !reader.read(&version) ||
+			magic != TrajectoryFormat::INDEX_MAGIC || version != TrajectoryFormat::VERSION) {
+			return false;
+		}
+
+		// Index record
+		std::uint64_t payload_size;
+		unsigned char const * const payload = recordPayload(index_offset, TrajectoryFormat::RECORD_INDEX, &payload_size);
+		if (payload == nullptr) {
+			return false;
+		}
+		BinaryReader index_reader(payload, static_cast<size_t>(payload_size));
+		std::uint64_t num_chunks;
+		if (!index_reader.read(&num_chunks)) {
+			return false;
+		}
+		for (std::uint64_t c = 0; c < num_chunks; c++) {
+			std::uint64_t offset, first_index;
+			std::uint32_t chunk_frames, padding;
+			if (!index_reader.read(&offset) || !index_reader.read(&first_index) ||
+				!index_reader.read(&chunk_frames) || !index_reader.read(&padding) ||
+				offset >= index_offset || chunk_frames == 0) {
+				return false;
+			}
+			Chunk const chunk = { offset, 0, chunk_frames };
+			chunks.push_back(chunk);
+		}
+
+		return true;
+	}
+
+	bool TrajectoryReader::scanRecords() {
+		BinaryReader reader(file.data(), file.size());
+		size_t offset = TrajectoryFormat::HEADER_SIZE;
+		while (reader.seek(offset)) {
+			std::uint32_t type, padding;
+			std::uint64_t size;
+			if (!reader.read(&type) || !reader.read(&padding) || !reader.read(&size) ||
+				size > file.size() - reader.tell()) {
+				// Truncated record, the recording was interrupted
+				break;
+			}
+			if (type == TrajectoryFormat::RECORD_CHUNK) {
+				std::uint64_t description_offset, first_index;
+				std::uint32_t chunk_frames;
+				if (size < TrajectoryFormat::CHUNK_HEADER_SIZE || !reader.read(&description_offset) ||
+					!reader.read(&first_index) || !reader.read(&chunk_frames)) {
+					break;
+				}
+				Chunk const chunk = { offset, 0, chunk_frames };
+				chunks.push_back(chunk);
+			} else if (type != TrajectoryFormat::RECORD_DESCRIPTION) {
+				break;
+			}
+			offset += TrajectoryFormat::RECORD_HEADER_SIZE + static_cast<size_t>(size);
+		}
+
+		return true;
+	}
+
+	size_t TrajectoryReader::findChunk(size_t const frame) const {
+		auto const chunk = std::upper_bound(chunks.begin(), chunks.end(), frame,
+											[](size_t const f, Chunk const & c) { return f < c.first_frame; });
+
+		return ((chunk - chunks.begin()) - 1);
+	}
+
+	std::uint64_t TrajectoryReader::chunkFrameIndex(size_t const chunk, size_t const frame) const {
+		std::uint64_t payload_size, index = 0;
+		unsigned char const * const payload = recordPayload(chunks[chunk].offset, TrajectoryFormat::RECORD_CHUNK, &payload_size);
+		BinaryReader reader(payload, payload == nullptr ? 0 : static_cast<size_t>(payload_size));
+		if (reader.seek(TrajectoryFormat::CHUNK_HEADER_SIZE + frame * sizeof(std::uint64_t))) {
+			reader.read(&index);
+		}
+
+		return index;
+	}
+
+	double TrajectoryReader::chunkFrameTime(size_t const chunk, size_t const frame) const {
+		std::uint64_t payload_size;
+		double t = 0;
+		unsigned char const * const payload = recordPayload(chunks[chunk].offset, TrajectoryFormat::RECORD_CHUNK, &payload_size);
+		BinaryReader reader(payload, payload == nullptr ? 0 : static_cast<size_t>(payload_size));
+		if (reader.seek(TrajectoryFormat::CHUNK_HEADER_SIZE + (chunks[chunk].num_frames + frame) * sizeof(std::uint64_t))) {
+			reader.read(&t);
+		}
+
+		return t;
+	}
+
+} // pb namespace
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "trajectory_recorder.h"
+#include "binary_io.h"
+#include "body.h"
+#include "compression.h"
+#include "trajectory_format.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace pb {
+
+	TrajectoryRecorder::TrajectoryRecorder(char const * const path,
+										   real const position_quantum,
+										   real const orientation_quantum,
+										   size_t const frames_per_chunk,
+										   size_t const queue_capacity)
+		: file(std::fopen(path, "wb")), position_quantum(position_quantum),
+		orientation_quantum(orientation_quantum), frames_per_chunk(frames_per_chunk),
+		frames(queue_capacity), free_frames(queue_capacity), recorded_frames(queue_capacity),
+		stopping(false), bodies_revision(0), description_pending(true), next_frame(0),
+		file_offset(0), description_offset(0), chunk_bodies(0),
+		recorded(0), dropped(0), bytes_written(0) {
+		if (file == nullptr) {
+			return;
+		}
+
+		// Write header
+		std::vector<unsigned char> header;
+		BinaryWriter writer(header);
+		writer.write(static_cast<std::uint32_t>(TrajectoryFormat::MAGIC));
+		writer.write(static_cast<std::uint32_t>(TrajectoryFormat::VERSION));
+		writer.write(static_cast<std::uint32_t>(sizeof(real)));
+		writer.write(static_cast<std::uint32_t>(frames_per_chunk));
+		writer.write(static_cast<double>(position_quantum));
+		writer.write(static_cast<double>(orientation_quantum));
+		std::fwrite(header.data(), 1, header.size(), file);
+		file_offset = header.size();
+
+		// All frames start free
+		for (auto frame = frames.begin(); frame != frames.end(); frame++) {
+			free_frames.push(&(*frame));
+		}
+
+		writer_thread = std::thread(&TrajectoryRecorder::run, this);
+	}
+
+	TrajectoryRecorder::~TrajectoryRecorder() {
+		close();
+	}
+
+	bool TrajectoryRecorder::isOpen() const {
+		return (file != nullptr);
+	}
+
+	bool TrajectoryRecorder::record(System const & system) {
+		if (file == nullptr || stopping.load(std::memory_order_relaxed)) {
+			return false;
+		}
+		std::uint64_t const frame_index = next_frame++;
+		if (system.getBodiesRevision() != bodies_revision) {
+			bodies_revision = system.getBodiesRevision();
+			description_pending = true;
+		}
+
+		// Get a free frame, drop the poses if the writer is behind
+		TrajectoryFrame * frame;
+		if (!free_frames.pop(frame)) {
+			dropped++;
+			return false;
+		}
+
+		// Copy poses
+		BodyStateStore const & states = system.getStateStore();
+		size_t const num_bodies = states.size();
+		frame->index = frame_index;
+		frame->t = system.getTime();
+		frame->num_bodies = num_bodies;
+		frame->poses.resize(TrajectoryFormat::POSE_SIZE * num_bodies);
+		for (size_t c = 0; c < TrajectoryFormat::POSE_SIZE; c++) {
+			real const * const component = states.state(BodyStateStore::STATE_X + c);
+			std::copy(component, component + num_bodies, frame->poses.begin() + c * num_bodies);
+		}
+
+		// Describe the shapes of the bodies if they changed since the last frame
+		frame->description.clear();
+		if (description_pending) {
+			BinaryWriter writer(frame->description);
+			std::vector<BodyParticlesDiscretisation *> const & bodies = system.getBodies();
+			writer.write(static_cast<std::uint64_t>(bodies.size()));
+			for (auto body = bodies.begin(); body != bodies.end(); body++) {
+				real parameters[Body::MAX_SHAPE_PARAMETERS];
+				(*body)->getBody()->getShapeParameters(parameters);
+				writer.write(static_cast<std::uint32_t>((*body)->getBody()->getShapeType()));
+				writer.write(static_cast<std::uint32_t>(0));
+				for (size_t p = 0; p < Body::MAX_SHAPE_PARAMETERS; p++) {
+					writer.write(static_cast<double>(parameters[p]));
+				}
+			}
+			description_pending = false;
+		}
+
+		// The queue has the size of the pool so it can not be full
+		recorded_frames.push(frame);
+		recorded++;
+
+		return true;
+	}
+
+	void TrajectoryRecorder::close() {
+		if (file == nullptr) {
+			return;
+		}
+
+		// Let the writer drain the queue and finish the file
+		stopping.store(true);
+		if (writer_thread.joinable()) {
+			writer_thread.join();
+		}
+		std::fclose(file);
+		file = nullptr;
+	}
+
+	std::uint64_t TrajectoryRecorder::getRecordedFrames() const {
+		return recorded.load();
+	}
+
+	std::uint64_t TrajectoryRecorder::getDroppedFrames() const {
+		return dropped.load();
+	}
+
+	std::uint64_t TrajectoryRecorder::getBytesWritten() const {
+		return bytes_written.load();
+	}
+
+	void TrajectoryRecorder::run() {
+		for (;;) {
+			TrajectoryFrame * frame;
+			if (recorded_frames.pop(frame)) {
+				writeFrame(*frame);
+				free_frames.push(frame);
+			} else if (stopping.load()) {
+				// The producer does not push after stopping is set, check the queue once more
+				if (recorded_frames.empty()) {
+					break;
+				}
+			} else {
+				std::this_thread::sleep_for(std::chrono::microseconds(500));
+			}
+		}
+
+		flushChunk();
+		writeIndex();
+		std::fflush(file);
+	}
+
+	void TrajectoryRecorder::writeFrame(TrajectoryFrame const & frame) {
+		// A new description or a different number of bodies starts a new chunk
+		if (!frame.description.empty()) {
+			flushChunk();
+			description_offset = file_offset;
+			writeRecord(TrajectoryFormat::RECORD_DESCRIPTION, frame.description.data(), frame.description.size());
+		}
+		if (!chunk_frames.empty() && frame.num_bodies != chunk_bodies) {
+			flushChunk();
+		}
+
+		// The first frame of a chunk is a keyframe
+		if (chunk_frames.empty()) {
+			chunk_bodies = frame.num_bodies;
+			previous.assign(TrajectoryFormat::POSE_SIZE * chunk_bodies, 0);
+		}
+
+		// Quantise and delta encode
+		for (size_t c = 0; c < TrajectoryFormat::POSE_SIZE; c++) {
+			real const quantum = c < 3 ? position_quantum : orientation_quantum;
+			for (size_t b = 0; b < chunk_bodies; b++) {
+				size_t const i = c * chunk_bodies + b;
+				std::int64_t const value = static_cast<std::int64_t>(std::llround(frame.poses[i] / quantum));
+				writeVarint(zigzagEncode(value - previous[i]), raw);
+				previous[i] = value;
+			}
+		}
+		chunk_frames.push_back(frame.index);
+		chunk_times.push_back(static_cast<double>(frame.t));
+
+		if (chunk_frames.size() == frames_per_chunk) {
+			flushChunk();
+		}
+	}
+
+	void TrajectoryRecorder::flushChunk() {
+		if (chunk_frames.empty()) {
+			return;
+		}
+
+		// Chunk header, frames and compressed poses
+		compressed.clear();
+		BinaryWriter writer(compressed);
+		writer.write(description_offset);
+		writer.write(chunk_frames.front());
+		writer.write(static_cast<std::uint32_t>(chunk_frames.size()));
+		writer.write(static_cast<std::uint32_t>(chunk_bodies));
+		writer.write(static_cast<std::uint64_t>(raw.size()));
+		size_t const compressed_size_offset = writer.size();
+		writer.write(static_cast<std::uint64_t>(0));
+		writer.write(chunk_frames.data(), chunk_frames.size());
+		writer.write(chunk_times.data(), chunk_times.size());
+		size_t const payload_offset = writer.size();
+		std::uint64_t const compressed_size = BlockCompressor::compress(raw.data(), raw.size(), compressed);
+		std::memcpy(&compressed[compressed_size_offset], &compressed_size, sizeof(compressed_size));
+
+		ChunkIndex const entry = { file_offset, chunk_frames.front(), static_cast<std::uint32_t>(chunk_frames.size()) };
+		index.push_back(entry);
+		writeRecord(TrajectoryFormat::RECORD_CHUNK, compressed.data(), payload_offset + static_cast<size_t>(compressed_size));
+
+		raw.clear();
+		chunk_frames.clear();
+		chunk_times.clear();
+	}
+
+	void TrajectoryRecorder::writeRecord(std::uint32_t const type, unsigned char const * const payload, size_t const size) {
+		std::uint32_t const padding = 0;
+		std::uint64_t const payload_size = size;
+		std::fwrite(&type, sizeof(type), 1, file);
+		std::fwrite(&padding, sizeof(padding), 1, file);
+		std::fwrite(&payload_size, sizeof(payload_size), 1, file);
+		std::fwrite(payload, 1, size, file);
+		file_offset += TrajectoryFormat::RECORD_HEADER_SIZE + size;
+		bytes_written.store(file_offset);
+	}
+
+	void TrajectoryRecorder::writeIndex() {
+		std::uint64_t const index_offset = file_offset;
+
+		std::vector<unsigned char> payload;
+		BinaryWriter writer(payload);
+		writer.write(static_cast<std::uint64_t>(index.size()));
+		for (auto entry = index.begin(); entry != index.end(); entry++) {
+			writer.write(entry->offset);
+			writer.write(entry->first_frame);
+			writer.write(entry->num_frames);
+			writer.write(static_cast<std::uint32_t>(0));
+		}
+		writeRecord(TrajectoryFormat::RECORD_INDEX, payload.data(), payload.size());
+
+		// Trailer
+		std::uint32_t const magic = TrajectoryFormat::INDEX_MAGIC;
+		std::uint32_t const version = TrajectoryFormat::VERSION;
+		std::fwrite(&index_offset, sizeof(index_offset), 1, file);
+		std::fwrite(&magic, sizeof(magic), 1, file);
+		std::fwrite(&version, sizeof(version), 1, file);
+		file_offset += TrajectoryFormat::TRAILER_SIZE;
+		bytes_written.store(file_offset);
+	}
+
+} // pb namespace
\ No newline at end of file